@@ -0,0 +1,11 @@
+#ifndef _ASM_GENERIC_ERRNO_H
+#define _ASM_GENERIC_ERRNO_H
+
+#include "errno-base.h"
+
+#define	ENAMETOOLONG	36	/* File name too long */
+#define	ENOSYS		38	/* Invalid system call number */
+#define	EOPNOTSUPP	95	/* Operation not supported on transport endpoint */
+#define	ETIMEDOUT	110	/* Connection timed out */
+
+#endif
@@ -5,6 +5,7 @@
 #define O_RDONLY   0x0000  // Read-only
 #define O_WRONLY   0x0001  // Write-only
 #define O_RDWR     0x0002  // Read and write
+#define O_ACCMODE  0x0003  // Mask of the access mode
 
 // File creation/modification flags
 #define O_CREAT    0x0040  // Create file if it doesn't exist
@@ -23,6 +24,10 @@
 #define O_CLOEXEC   0x80000 // Close on exec()
 #define O_TMPFILE   0x400000 // Temporary file (anonymous)
 
+// fcntl() commands
+#define F_GETFL    3       // Get the file status flags
+#define F_SETFL    4       // Set the file status flags, only O_APPEND and O_NONBLOCK can change
+
 // Enum for easier flag management
 typedef enum {
     RDONLY   = O_RDONLY,
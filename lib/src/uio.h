@@ -0,0 +1,15 @@
+#ifndef _UIO_H
+#define _UIO_H
+
+#include <stdint.h>
+
+// Most buffers a single readv() or writev() takes
+#define IOV_MAX 1024
+
+// One buffer of a scatter/gather I/O, same layout as Linux
+struct iovec {
+    void*    iov_base;  // Start of the buffer
+    uint32_t iov_len;   // Size of the buffer in bytes
+};
+
+#endif // _UIO_H
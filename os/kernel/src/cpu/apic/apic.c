@@ -0,0 +1,45 @@
+#include "apic.h"
+#include "lapic.h"
+#include "lapic_timer.h"
+#include "cpu/idt/irq.h"
+#include "drivers/vga/vga.h"
+#include <stddef.h>
+
+static cpu_topology_t topology;
+static bool topology_found = false;
+
+bool apic_init()
+{
+    if (!topology_discover(&topology))
+    {
+        vga_printf("No ACPI or MP tables, staying on the PIC\n");
+        return false;
+    }
+    topology_found = true;
+
+    if (!lapic_init(topology.lapic_phys_addr))
+    {
+        vga_printf("No local APIC, staying on the PIC\n");
+        return false;
+    }
+
+    if (!irq_route_through_ioapic(&topology))
+        vga_printf("No I/O APIC, IRQs stay on the PIC\n");
+
+    if (lapic_timer_init())
+    {
+        lapic_timer_start();
+        // The local timer ticks the system from now on
+        irq_toggle(PIT_IRQ, false);
+    }
+    else
+    {
+        vga_printf("Local APIC timer didn't count, staying on the PIT\n");
+    }
+    return true;
+}
+
+const cpu_topology_t* apic_get_topology()
+{
+    return topology_found ? &topology : NULL;
+}
@@ -0,0 +1,11 @@
+#pragma once
+#include <stdbool.h>
+#include "cpu/smp/topology.h"
+
+// Moves interrupt delivery from the 8259 PIC and the PIT to the APICs: the I/O APIC takes the
+// ISA IRQs and the boot cpu's local APIC timer takes over the system tick.
+// Whatever is missing stays on the PIC and PIT, returns false if there is no local APIC at all
+bool apic_init();
+
+// What the firmware tables said, NULL if there were none
+const cpu_topology_t* apic_get_topology();
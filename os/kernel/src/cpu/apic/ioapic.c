@@ -0,0 +1,95 @@
+#include "ioapic.h"
+#include "cpu/smp/topology.h"
+#include "memory/mmio/mmio.h"
+#include "memory/paging/paging.h"
+#include "sync/spinlock.h"
+#include <stddef.h>
+
+static volatile uint32_t* ioapic_base = NULL;
+static uint32_t ioapic_gsi_base = 0;
+static uint32_t ioapic_entries = 0;
+
+// Every access is a select then a read or write, nobody may select in between
+static spinlock_t ioapic_lock = SPINLOCK_INIT;
+
+static uint32_t ioapic_read(uint32_t reg)
+{
+    ioapic_base[IOAPIC_REGSEL / sizeof(uint32_t)] = reg;
+    return ioapic_base[IOAPIC_WINDOW / sizeof(uint32_t)];
+}
+
+static void ioapic_write(uint32_t reg, uint32_t value)
+{
+    ioapic_base[IOAPIC_REGSEL / sizeof(uint32_t)] = reg;
+    ioapic_base[IOAPIC_WINDOW / sizeof(uint32_t)] = value;
+}
+
+// The input of this I/O APIC a GSI is wired to, -1 if it isn't one of ours
+static int32_t ioapic_input(uint32_t gsi)
+{
+    if (ioapic_base == NULL || gsi < ioapic_gsi_base || gsi - ioapic_gsi_base >= ioapic_entries)
+        return -1;
+    return gsi - ioapic_gsi_base;
+}
+
+bool ioapic_init(uintptr_t phys_addr, uint32_t gsi_base)
+{
+    if (phys_addr == 0)
+        return false;
+
+    ioapic_base = mmio_map(phys_addr, PAGE_SIZE);
+    if (ioapic_base == NULL)
+        return false;
+
+    ioapic_gsi_base = gsi_base;
+    ioapic_entries = ((ioapic_read(IOAPIC_REG_VERSION) >> IOAPIC_MAX_ENTRIES_SHIFT) & 0xFF) + 1;
+
+    // Nothing is delivered until a driver asks for it
+    for (uint32_t input = 0; input < ioapic_entries; input++)
+    {
+        ioapic_write(IOAPIC_REG_REDIRECTION(input) + 1, 0);
+        ioapic_write(IOAPIC_REG_REDIRECTION(input), IOAPIC_REDIR_MASKED);
+    }
+    return true;
+}
+
+inline bool ioapic_is_present()
+{
+    return ioapic_base != NULL;
+}
+
+bool ioapic_route(uint32_t gsi, uint8_t vector, uint8_t apic_id, uint16_t flags)
+{
+    int32_t input = ioapic_input(gsi);
+    if (input < 0)
+        return false;
+
+    // Fixed delivery, physical destination, routes start masked
+    uint32_t low = vector | IOAPIC_REDIR_MASKED;
+    if ((flags & IRQ_FLAGS_POLARITY_MASK) == IRQ_FLAGS_ACTIVE_LOW)
+        low |= IOAPIC_REDIR_ACTIVE_LOW;
+    if ((flags & IRQ_FLAGS_TRIGGER_MASK) == IRQ_FLAGS_LEVEL)
+        low |= IOAPIC_REDIR_LEVEL;
+
+    uint32_t irq_flags = spin_lock_irqsave(&ioapic_lock);
+    ioapic_write(IOAPIC_REG_REDIRECTION(input) + 1, (uint32_t)apic_id << IOAPIC_REDIR_DEST_SHIFT);
+    ioapic_write(IOAPIC_REG_REDIRECTION(input), low);
+    spin_unlock_irqrestore(&ioapic_lock, irq_flags);
+    return true;
+}
+
+void ioapic_set_masked(uint32_t gsi, bool masked)
+{
+    int32_t input = ioapic_input(gsi);
+    if (input < 0)
+        return;
+
+    uint32_t flags = spin_lock_irqsave(&ioapic_lock);
+    uint32_t low = ioapic_read(IOAPIC_REG_REDIRECTION(input));
+    if (masked)
+        low |= IOAPIC_REDIR_MASKED;
+    else
+        low &= ~IOAPIC_REDIR_MASKED;
+    ioapic_write(IOAPIC_REG_REDIRECTION(input), low);
+    spin_unlock_irqrestore(&ioapic_lock, flags);
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+// The I/O APIC is accessed through a select register and a data window
+#define IOAPIC_REGSEL       0x00
+#define IOAPIC_WINDOW       0x10
+
+#define IOAPIC_REG_ID       0x00
+#define IOAPIC_REG_VERSION  0x01
+#define IOAPIC_REG_REDIRECTION(input) (0x10 + (input) * 2)
+
+#define IOAPIC_MAX_ENTRIES_SHIFT 16
+
+// Redirection entry, low half
+#define IOAPIC_REDIR_ACTIVE_LOW (1 << 13)
+#define IOAPIC_REDIR_LEVEL      (1 << 15)
+#define IOAPIC_REDIR_MASKED     (1 << 16)
+// High half
+#define IOAPIC_REDIR_DEST_SHIFT 24
+
+// Maps the I/O APIC that handles the GSIs from gsi_base on, every input starts masked
+bool ioapic_init(uintptr_t phys_addr, uint32_t gsi_base);
+bool ioapic_is_present();
+
+// Deliver a GSI as the given vector to one cpu, flags are the MADT/MP polarity and trigger bits
+bool ioapic_route(uint32_t gsi, uint8_t vector, uint8_t apic_id, uint16_t flags);
+void ioapic_set_masked(uint32_t gsi, bool masked);
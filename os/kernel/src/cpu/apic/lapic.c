@@ -0,0 +1,108 @@
+#include "lapic.h"
+#include "cpu/cpuid/cpuid.h"
+#include "cpu/msr/msr.h"
+#include "cpu/idt/isr.h"
+#include "memory/mmio/mmio.h"
+#include "memory/paging/paging.h"
+#include "cpu/idt/irq.h"
+#include <stddef.h>
+
+static volatile uint32_t* lapic_base = NULL;
+
+static void lapic_spurious(int_registers* regs)
+{
+    // Spurious interrupts aren't real interrupts, they must not get an EOI
+}
+
+bool lapic_init(uintptr_t phys_addr)
+{
+    if (!cpuid_has_feature(CPUID_EDX_APIC | CPUID_EDX_MSR))
+        return false;
+
+    uint64_t base = msr_read(MSR_IA32_APIC_BASE);
+    if (phys_addr == 0)
+        phys_addr = (uintptr_t)base & APIC_BASE_ADDRESS_MASK;
+
+    // Firmware may have left it hardware disabled, that can only be undone through the MSR
+    if (!(base & APIC_BASE_ENABLE))
+        msr_write(MSR_IA32_APIC_BASE, base | APIC_BASE_ENABLE);
+
+    lapic_base = mmio_map(phys_addr, PAGE_SIZE);
+    if (lapic_base == NULL)
+        return false;
+
+    register_isr_handler(LAPIC_SPURIOUS_VECTOR, lapic_spurious);
+    lapic_enable();
+    return true;
+}
+
+void lapic_enable()
+{
+    lapic_write(LAPIC_SVR, LAPIC_SVR_ENABLE | LAPIC_SPURIOUS_VECTOR);
+    // Accept every priority
+    lapic_write(LAPIC_TPR, 0);
+    lapic_write(LAPIC_LVT_ERROR, LAPIC_LVT_MASKED);
+
+    // The ESR has to be written before it can be read
+    lapic_write(LAPIC_ESR, 0);
+    lapic_write(LAPIC_ESR, 0);
+}
+
+bool lapic_is_enabled()
+{
+    return lapic_base != NULL;
+}
+
+uint8_t lapic_id()
+{
+    if (lapic_base == NULL)
+        return 0;
+    return lapic_read(LAPIC_ID) >> 24;
+}
+
+void lapic_eoi()
+{
+    lapic_write(LAPIC_EOI, 0);
+}
+
+static void lapic_send_command(uint8_t apic_id, uint32_t command)
+{
+    // An interrupt handler sending its own IPI between the two writes would change the destination
+    uint32_t flags = irq_save();
+
+    lapic_write(LAPIC_ICR_HIGH, (uint32_t)apic_id << LAPIC_ICR_DEST_SHIFT);
+    // Writing the low half sends it
+    lapic_write(LAPIC_ICR_LOW, command);
+
+    while (lapic_read(LAPIC_ICR_LOW) & LAPIC_ICR_PENDING)
+        asm volatile("pause");
+
+    irq_restore(flags);
+}
+
+void lapic_send_ipi(uint8_t apic_id, uint8_t vector)
+{
+    lapic_send_command(apic_id, LAPIC_ICR_FIXED | LAPIC_ICR_ASSERT | vector);
+}
+
+void lapic_send_init(uint8_t apic_id)
+{
+    lapic_send_command(apic_id, LAPIC_ICR_INIT | LAPIC_ICR_LEVEL | LAPIC_ICR_ASSERT);
+    // Deassert, old APICs need it and new ones ignore it
+    lapic_send_command(apic_id, LAPIC_ICR_INIT | LAPIC_ICR_LEVEL);
+}
+
+void lapic_send_startup(uint8_t apic_id, uint8_t vector)
+{
+    lapic_send_command(apic_id, LAPIC_ICR_STARTUP | vector);
+}
+
+inline uint32_t lapic_read(uint32_t reg)
+{
+    return lapic_base[reg / sizeof(uint32_t)];
+}
+
+inline void lapic_write(uint32_t reg, uint32_t value)
+{
+    lapic_base[reg / sizeof(uint32_t)] = value;
+}
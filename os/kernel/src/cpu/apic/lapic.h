@@ -0,0 +1,58 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+#define MSR_IA32_APIC_BASE      0x1B
+#define APIC_BASE_BSP           (1 << 8)
+#define APIC_BASE_ENABLE        (1 << 11)
+#define APIC_BASE_ADDRESS_MASK  0xFFFFF000
+
+// Register offsets
+#define LAPIC_ID            0x020
+#define LAPIC_VERSION       0x030
+#define LAPIC_TPR           0x080
+#define LAPIC_EOI           0x0B0
+#define LAPIC_SVR           0x0F0
+#define LAPIC_ESR           0x280
+#define LAPIC_ICR_LOW       0x300
+#define LAPIC_ICR_HIGH      0x310
+#define LAPIC_LVT_TIMER     0x320
+#define LAPIC_LVT_LINT0     0x350
+#define LAPIC_LVT_LINT1     0x360
+#define LAPIC_LVT_ERROR     0x370
+#define LAPIC_TIMER_INITIAL 0x380
+#define LAPIC_TIMER_CURRENT 0x390
+#define LAPIC_TIMER_DIVIDE  0x3E0
+
+#define LAPIC_SVR_ENABLE    (1 << 8)
+#define LAPIC_LVT_MASKED    (1 << 16)
+#define LAPIC_LVT_PERIODIC  (1 << 17)
+
+// Interrupt command register
+#define LAPIC_ICR_FIXED         (0 << 8)
+#define LAPIC_ICR_INIT          (5 << 8)
+#define LAPIC_ICR_STARTUP       (6 << 8)
+#define LAPIC_ICR_PENDING       (1 << 12)
+#define LAPIC_ICR_ASSERT        (1 << 14)
+#define LAPIC_ICR_LEVEL         (1 << 15)
+#define LAPIC_ICR_DEST_SHIFT    24
+
+// The low 4 bits of the spurious vector have to be set on old APICs
+#define LAPIC_SPURIOUS_VECTOR   0xFF
+
+// Maps the local APIC at the given physical address (0 to take it from the MSR), returns false if there is none
+bool lapic_init(uintptr_t phys_addr);
+// Software enables the local APIC of the cpu this runs on
+void lapic_enable();
+bool lapic_is_enabled();
+
+uint8_t lapic_id();
+void lapic_eoi();
+
+void lapic_send_ipi(uint8_t apic_id, uint8_t vector);
+void lapic_send_init(uint8_t apic_id);
+// vector is the 4K page the AP starts at in real mode
+void lapic_send_startup(uint8_t apic_id, uint8_t vector);
+
+uint32_t lapic_read(uint32_t reg);
+void lapic_write(uint32_t reg, uint32_t value);
@@ -0,0 +1,85 @@
+#include "lapic_timer.h"
+#include "lapic.h"
+#include "cpu/idt/isr.h"
+#include "cpu/pit/pit.h"
+#include "cpu/smp/smp.h"
+#include "process/manager/process_manager.h"
+#include "util/math/div64.h"
+#include <stddef.h>
+
+// Timer counts in one PIT tick, the same for every cpu since they share the bus clock
+static uint32_t counts_per_tick = 0;
+
+static void lapic_timer_irq(int_registers* regs)
+{
+    // The boot cpu's timer replaces the PIT, so it also keeps the system time
+    if (smp_cpu_id() == 0)
+        system_tick();
+    account_process_tick();
+
+    lapic_eoi();
+
+    if (is_schduling())
+        switch_process(regs);
+}
+
+// Count timer cycles while PIT channel 2 counts down LAPIC_TIMER_CALIBRATION_MS in one-shot mode
+static uint32_t lapic_timer_calibrate_once()
+{
+    const uint16_t latch = FREQ_HZ / (1000 / LAPIC_TIMER_CALIBRATION_MS);
+
+    // One-shot and masked, only the count is needed
+    lapic_write(LAPIC_TIMER_DIVIDE, LAPIC_TIMER_DIVIDE_16);
+    lapic_write(LAPIC_LVT_TIMER, LAPIC_LVT_MASKED | LAPIC_TIMER_VECTOR);
+
+    pit_oneshot_start(latch);
+    lapic_write(LAPIC_TIMER_INITIAL, 0xFFFFFFFF);
+    bool counted = pit_oneshot_wait();
+    uint32_t elapsed = 0xFFFFFFFF - lapic_read(LAPIC_TIMER_CURRENT);
+
+    lapic_write(LAPIC_TIMER_INITIAL, 0);
+
+    if (!counted || elapsed == 0)
+        return 0;
+
+    // Scale from the calibration window to one PIT tick
+    return (uint32_t)div64_u32((uint64_t)elapsed * get_reload_time(), latch, NULL);
+}
+
+bool lapic_timer_init()
+{
+    if (!lapic_is_enabled())
+        return false;
+
+    // Take the fastest run, anything that interrupts the measurement can only make it longer
+    uint32_t best = 0;
+    for (int i = 0; i < LAPIC_TIMER_CALIBRATION_RUNS; i++)
+    {
+        uint32_t counts = lapic_timer_calibrate_once();
+        if (counts != 0 && (best == 0 || counts < best))
+            best = counts;
+    }
+
+    if (best == 0)
+        return false;
+
+    counts_per_tick = best;
+    register_isr_handler(LAPIC_TIMER_VECTOR, lapic_timer_irq);
+    return true;
+}
+
+void lapic_timer_start()
+{
+    if (counts_per_tick == 0)
+        return;
+
+    lapic_write(LAPIC_TIMER_DIVIDE, LAPIC_TIMER_DIVIDE_16);
+    lapic_write(LAPIC_LVT_TIMER, LAPIC_LVT_PERIODIC | LAPIC_TIMER_VECTOR);
+    // Writing the initial count starts it
+    lapic_write(LAPIC_TIMER_INITIAL, counts_per_tick);
+}
+
+inline bool lapic_timer_is_available()
+{
+    return counts_per_tick != 0;
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+#define LAPIC_TIMER_VECTOR 0xEF
+
+// Divide the bus clock by 16, slow enough that a tick fits in the 32 bit count
+#define LAPIC_TIMER_DIVIDE_16 0x3
+
+#define LAPIC_TIMER_CALIBRATION_MS 10
+#define LAPIC_TIMER_CALIBRATION_RUNS 3
+
+// Calibrates the local APIC timer against PIT channel 2 so its period matches a PIT tick,
+// returns false if there is no local APIC or it didn't count
+bool lapic_timer_init();
+// Starts the periodic tick on the cpu this runs on, does nothing if the timer isn't calibrated
+void lapic_timer_start();
+bool lapic_timer_is_available();
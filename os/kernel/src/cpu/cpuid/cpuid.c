@@ -0,0 +1,15 @@
+#include "cpuid.h"
+
+void cpuid(uint32_t leaf, cpuid_registers* regs)
+{
+    asm volatile("cpuid"
+            : "=a"(regs->eax), "=b"(regs->ebx), "=c"(regs->ecx), "=d"(regs->edx)
+            : "a"(leaf), "c"(0));
+}
+
+bool cpuid_has_feature(uint32_t edx_feature)
+{
+    cpuid_registers regs;
+    cpuid(CPUID_LEAF_FEATURES, &regs);
+    return (regs.edx & edx_feature) == edx_feature;
+}
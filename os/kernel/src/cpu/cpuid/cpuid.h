@@ -0,0 +1,22 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+#define CPUID_LEAF_FEATURES 1
+
+// Feature bits in edx of CPUID leaf 1
+#define CPUID_EDX_FPU   (1 << 0)
+#define CPUID_EDX_TSC   (1 << 4)
+#define CPUID_EDX_MSR   (1 << 5)
+#define CPUID_EDX_APIC  (1 << 9)
+#define CPUID_EDX_SEP   (1 << 11)
+#define CPUID_EDX_PGE   (1 << 13)
+#define CPUID_EDX_FXSR  (1 << 24)
+#define CPUID_EDX_SSE   (1 << 25)
+
+typedef struct cpuid_registers {
+    uint32_t eax, ebx, ecx, edx;
+} cpuid_registers;
+
+void cpuid(uint32_t leaf, cpuid_registers* regs);
+bool cpuid_has_feature(uint32_t edx_feature);
@@ -0,0 +1,159 @@
+#include "fpu.h"
+#include "cpu/cpuid/cpuid.h"
+#include "cpu/idt/isr.h"
+#include "memory/heap/heap.h"
+#include "process/manager/process_manager.h"
+#include "drivers/vga/vga.h"
+#include "cpu/smp/smp.h"
+
+#define ALIGN_UP(value, alignment) (((value) + (alignment)-1) & ~((alignment)-1))
+
+static bool fpu_enabled = false;
+
+// fxsave image of a freshly initialized FPU, what a process starts with
+static uint8_t initial_state[FPU_STATE_SIZE] __attribute__((aligned(FPU_STATE_ALIGN)));
+
+static void fpu_device_not_available(int_registers* regs);
+
+static inline uint32_t read_cr0()
+{
+    uint32_t cr0;
+    asm volatile("mov %%cr0, %0" : "=r"(cr0));
+    return cr0;
+}
+
+static inline void write_cr0(uint32_t cr0)
+{
+    asm volatile("mov %0, %%cr0" :: "r"(cr0) : "memory");
+}
+
+static inline void fxsave(uint8_t* area)
+{
+    asm volatile("fxsave (%0)" :: "r"(area) : "memory");
+}
+
+static inline void fxrstor(const uint8_t* area)
+{
+    asm volatile("fxrstor (%0)" :: "r"(area) : "memory");
+}
+
+static inline void clts()
+{
+    asm volatile("clts" ::: "memory");
+}
+
+static inline void stts()
+{
+    write_cr0(read_cr0() | CR0_TS);
+}
+
+static void fpu_enable_cpu()
+{
+    // Native x87 errors, no emulation, and let wait/fwait honor TS too
+    write_cr0((read_cr0() & ~(CR0_EM | CR0_TS)) | CR0_MP | CR0_NE);
+
+    uint32_t cr4;
+    asm volatile("mov %%cr4, %0" : "=r"(cr4));
+    cr4 |= CR4_OSFXSR | CR4_OSXMMEXCPT;
+    asm volatile("mov %0, %%cr4" :: "r"(cr4) : "memory");
+}
+
+bool fpu_init()
+{
+    if (!cpuid_has_feature(CPUID_EDX_FPU | CPUID_EDX_FXSR | CPUID_EDX_SSE))
+    {
+        vga_printf("No FXSR/SSE, user programs can't use the FPU\n");
+        return false;
+    }
+
+    fpu_enable_cpu();
+
+    asm volatile("fninit");
+    fxsave(initial_state);
+
+    register_isr_handler(FPU_NM_INTERRUPT, fpu_device_not_available);
+    fpu_enabled = true;
+
+    // Nobody owns the FPU yet, the first use traps
+    stts();
+    return true;
+}
+
+void fpu_init_cpu()
+{
+    if (!fpu_enabled)
+        return;
+
+    fpu_enable_cpu();
+    stts();
+}
+
+void fpu_switch_to(const fpu_state_t* state)
+{
+    if (!fpu_enabled)
+        return;
+
+    // Writing cr0 is slow, only touch it when the TS bit actually has to change
+    const fpu_state_t* fpu_owner = smp_current_cpu()->fpu_owner;
+    bool trap = fpu_owner == NULL || state != fpu_owner;
+    bool ts_set = (read_cr0() & CR0_TS) != 0;
+
+    if (trap && !ts_set)
+        stts();
+    else if (!trap && ts_set)
+        clts();
+}
+
+void fpu_switch_from(fpu_state_t* state)
+{
+    cpu_t* cpu = smp_current_cpu();
+
+    // With one cpu the registers can wait in the FPU until someone else needs it
+    if (smp_cpu_count() == 1 || cpu->fpu_owner != state)
+        return;
+
+    clts();
+    fxsave(state->area);
+    cpu->fpu_owner = NULL;
+}
+
+void fpu_release(fpu_state_t* state)
+{
+    cpu_t* cpu = smp_current_cpu();
+    if (state == cpu->fpu_owner)
+        cpu->fpu_owner = NULL;
+
+    kfree(state->allocation);
+    state->allocation = NULL;
+    state->area = NULL;
+}
+
+// #NM, the current process used the FPU for the first time since it was switched to
+static void fpu_device_not_available(int_registers* regs)
+{
+    process_t* proc = get_current_process();
+    fpu_state_t* state = &proc->fpu;
+    cpu_t* cpu = smp_current_cpu();
+
+    clts();
+    if (cpu->fpu_owner == state)
+        return;
+
+    if (state->area == NULL)
+    {
+        state->allocation = kmalloc(FPU_STATE_SIZE + FPU_STATE_ALIGN);
+        if (state->allocation == NULL)
+        {
+            vga_printf("Out of memory for the FPU state\n");
+            exit_current_process();
+        }
+        state->area = (uint8_t*)ALIGN_UP((uintptr_t)state->allocation, FPU_STATE_ALIGN);
+        memcpy(state->area, initial_state, FPU_STATE_SIZE);
+    }
+
+    if (cpu->fpu_owner != NULL)
+        fxsave(cpu->fpu_owner->area);
+
+    fxrstor(state->area);
+    cpu->fpu_owner = state;
+}
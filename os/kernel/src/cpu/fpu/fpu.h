@@ -0,0 +1,33 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+#define FPU_NM_INTERRUPT 7
+
+#define FPU_STATE_SIZE  512 // fxsave area
+#define FPU_STATE_ALIGN 16
+
+#define CR0_MP (1 << 1)
+#define CR0_EM (1 << 2)
+#define CR0_TS (1 << 3)
+#define CR0_NE (1 << 5)
+#define CR4_OSFXSR     (1 << 9)
+#define CR4_OSXMMEXCPT (1 << 10)
+
+// The fxsave area of a process, allocated the first time the process touches the FPU
+typedef struct fpu_state {
+    void* allocation;   // what kmalloc returned, the area itself is aligned up from it
+    uint8_t* area;
+} fpu_state_t;
+
+// Enables the FPU and SSE and takes over #NM, returns false if there is no FXSR/SSE support
+bool fpu_init();
+// The same control register setup on the other cpus
+void fpu_init_cpu();
+// Called when switching to a process, arms the #NM trap unless the process already owns the FPU
+void fpu_switch_to(const fpu_state_t* state);
+// Called when switching away from a process, with more than one cpu the process may continue
+// on another one, so its registers are saved right away instead of waiting in this cpu's FPU
+void fpu_switch_from(fpu_state_t* state);
+// Called when a process exits
+void fpu_release(fpu_state_t* state);
@@ -1,33 +1,58 @@
 #include "gdt.h"
-
-struct gdt_entry gdt_table[GDT_SIZE] = {0};
-struct gdt_ptr info = {0};
-struct tss_entry_t tss = {0};
+#include "cpu/smp/smp.h"
+#include <stddef.h>
 
 void gdt_init() {
-    gdt_table[0] = (struct gdt_entry){0};
-    gdt_fill_entry(1, 0, 0xFFFFF, true, 0); // Kernel code segment
-    gdt_fill_entry(2, 0, 0xFFFFF, false, 0); // Kernel data segment
-    gdt_fill_entry(3, 0, 0xFFFFF, true, 3); // User code segment
-    gdt_fill_entry(4, 0, 0xFFFFF, false, 3); // User data segment
+    gdt_init_cpu(&smp_get_cpu(0)->descriptors);
+}
+
+void gdt_init_cpu(cpu_descriptors_t* descriptors)
+{
+    struct gdt_entry* table = descriptors->table;
 
-    tss_fill_entry(0xC1100000, 0x10, &tss);
-    gdt_fill_entry_as_tss(5, &tss);
+    table[0] = (struct gdt_entry){0};
+    gdt_fill_entry(table, 1, 0, 0xFFFFF, true, 0); // Kernel code segment
+    gdt_fill_entry(table, 2, 0, 0xFFFFF, false, 0); // Kernel data segment
+    gdt_fill_entry(table, 3, 0, 0xFFFFF, true, 3); // User code segment
+    gdt_fill_entry(table, 4, 0, 0xFFFFF, false, 3); // User data segment
 
-    info.limit = sizeof(struct gdt_entry) * GDT_SIZE;
-    info.base = (uint32_t)&gdt_table;
+    tss_fill_entry(0xC1100000, 0x10, &descriptors->tss);
+    gdt_fill_entry_as_tss(table, 5, &descriptors->tss);
+
+    descriptors->info.limit = sizeof(struct gdt_entry) * GDT_SIZE;
+    descriptors->info.base = (uint32_t)table;
     
-    load_gdt(&info, GDT_KERNEL_CODE_INDEX, GDT_KERNEL_DATA_INDEX);
-    __asm__("mov $0x28, %%ax\n"
-        "ltr %%ax" ::);
+    load_gdt(&descriptors->info, GDT_KERNEL_CODE_INDEX, GDT_KERNEL_DATA_INDEX);
+    __asm__("ltr %%ax" :: "a"(GDT_TSS_INDEX));
+}
+
+// Every cpu loaded a different GDT, sgdt is a cheap way to tell them apart
+cpu_descriptors_t* gdt_current_descriptors()
+{
+    struct gdt_ptr current;
+    __asm__ volatile("sgdt %0" : "=m"(current));
+    return (cpu_descriptors_t*)current.base;
 }
 
 void tss_fill_esp0(uint32_t esp0)
 {
-    tss_fill_entry(esp0, 0x10, &tss);
-    gdt_fill_entry_as_tss(5, &tss);
+    cpu_descriptors_t* descriptors = gdt_current_descriptors();
+    tss_fill_entry(esp0, 0x10, &descriptors->tss);
+    gdt_fill_entry_as_tss(descriptors->table, 5, &descriptors->tss);
+}
+
+// The only TSS field that changes between processes, no need to rebuild the TSS and its descriptor
+inline void tss_set_esp0(uint32_t esp0)
+{
+    gdt_current_descriptors()->tss.esp0 = esp0;
 }
 
+uint32_t* tss_get_esp0_address()
+{
+    // The TSS is packed, the field's address is taken from the base so it isn't a packed member's
+    uint8_t* tss = (uint8_t*)&gdt_current_descriptors()->tss;
+    return (uint32_t*)(tss + offsetof(struct tss_entry_t, esp0));
+}
 
 void tss_fill_entry(uint32_t esp0, uint32_t ss0, struct tss_entry_t* filled_tss)
 {
@@ -60,7 +85,7 @@ void tss_fill_entry(uint32_t esp0, uint32_t ss0, struct tss_entry_t* filled_tss)
     filled_tss->iomap_base = 0;
 }
 
-void gdt_fill_entry(int index, uint32_t base, uint32_t limit, bool is_executable, uint8_t privilege_level) {
+void gdt_fill_entry(struct gdt_entry* gdt_table, int index, uint32_t base, uint32_t limit, bool is_executable, uint8_t privilege_level) {
     gdt_table[index].limit_low = (limit & 0xFFFF); // 0 - 15
     gdt_table[index].limit_high = ((limit >> 16) & 0x0F);
 
@@ -82,7 +107,7 @@ void gdt_fill_entry(int index, uint32_t base, uint32_t limit, bool is_executable
 }
 
 
-void gdt_fill_entry_as_tss(int index, struct tss_entry_t *tss_entry)
+void gdt_fill_entry_as_tss(struct gdt_entry* gdt_table, int index, struct tss_entry_t *tss_entry)
 {
     uint32_t tss_entry_size = sizeof(struct tss_entry_t);
     uint32_t tss_entry_address = (uint32_t)tss_entry;
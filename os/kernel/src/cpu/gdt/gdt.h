@@ -66,9 +66,26 @@ struct gdt_ptr {
     unsigned int base;
 } __attribute__((packed));
 
+#define GDT_TSS_INDEX 5 * sizeof(struct gdt_entry)
+
+// Every cpu needs its own TSS, and with it its own GDT to point at it
+typedef struct cpu_descriptors {
+    struct gdt_entry table[GDT_SIZE];   // must stay first, the GDT base is how a cpu finds its descriptors
+    struct gdt_ptr info;
+    struct tss_entry_t tss;
+} cpu_descriptors_t;
+
+// Sets up the boot cpu's descriptors
 void gdt_init();
+// Fills and loads the GDT and TSS of the cpu this runs on
+void gdt_init_cpu(cpu_descriptors_t* descriptors);
+// The descriptors of the cpu this runs on
+cpu_descriptors_t* gdt_current_descriptors();
+
 void tss_fill_esp0(uint32_t esp0);
+void tss_set_esp0(uint32_t esp0);
+uint32_t* tss_get_esp0_address();
 void tss_fill_entry(uint32_t esp0, uint32_t ss0, struct tss_entry_t* filled_tss);
-void gdt_fill_entry(int index, uint32_t base, uint32_t limit, bool is_executable, uint8_t privilege_level);
-void gdt_fill_entry_as_tss(int index, struct tss_entry_t *tss_entry);
+void gdt_fill_entry(struct gdt_entry* table, int index, uint32_t base, uint32_t limit, bool is_executable, uint8_t privilege_level);
+void gdt_fill_entry_as_tss(struct gdt_entry* table, int index, struct tss_entry_t *tss_entry);
 extern void load_gdt(struct gdt_ptr* descriptor, uint16_t codeSegment, uint16_t dataSegment) __attribute__((cdecl));
\ No newline at end of file
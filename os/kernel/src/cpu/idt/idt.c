@@ -29,14 +29,20 @@ void idt_init()
 
     idt_ptr.limit = sizeof(struct idt_entry) * IDT_SIZE - 1;
     idt_ptr.offset = (uint32_t)&idt;
-    __asm__ volatile(
-        "lidt (%0)\n" ::"r"(&idt_ptr));
+    idt_load();
     // After setting up the PIC to not get a double fault:
     init_pic(PIC1_IRQ_INDEX, PIC2_IRQ_INDEX);
     init_irqs();
     enable_interrupts();
 }
 
+// All the cpus share the same IDT
+void idt_load()
+{
+    __asm__ volatile(
+        "lidt (%0)\n" ::"r"(&idt_ptr));
+}
+
 inline void enable_interrupts()
 {
     __asm__("sti");
@@ -24,5 +24,7 @@ void disable_interrupts();
 
 void idt_set_entry(uint8_t index, uint32_t handlerAddress, bool is_userspace);
 void idt_init();
+// Loads the IDT on the cpu this runs on, idt_init does it for the boot cpu
+void idt_load();
 // Defined in int_handlers.asm
 extern void* first_int_handlers[IDT_SIZE]; // an array of all the interrupt handlers to add to the IDT
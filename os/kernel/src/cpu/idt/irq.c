@@ -3,17 +3,88 @@
 #include "drivers/vga/vga.h"
 #include "cpu/pic/pic.h"
 #include "util/io/io.h"
+#include "cpu/apic/lapic.h"
+#include "cpu/apic/ioapic.h"
+#include "cpu/smp/topology.h"
+
+// Set once the I/O APIC delivers the ISA IRQs, the PIC is fully masked from then on
+static bool ioapic_routed = false;
+static uint32_t isa_irq_gsi[ISA_IRQ_COUNT];
 
 inline void irq_exit(uint32_t interrupt_number)
 {
-    // Send an End Of Interrupt command to the PIC to acknowledge we are done
-    if (interrupt_number >= PIC2_IRQ_INDEX)
+    // A single MMIO write instead of one or two port writes
+    if (ioapic_routed)
+    {
+        lapic_eoi();
+        return;
+    }
+
+    // Send an End Of Interrupt command to the PIC to acknowledge we are done,
+    // IRQs 8-15 come through the slave, which needs its own
+    if (interrupt_number >= 8)
     {
         io_out_byte(PIC2_CMD, PIC_EOI);
     }
     io_out_byte(PIC1_CMD, PIC_EOI);
 }
 
+void irq_toggle(uint8_t irq_number, bool toggle_on)
+{
+    if (ioapic_routed)
+        ioapic_set_masked(isa_irq_gsi[irq_number], !toggle_on);
+    else
+        pic_toggle_irq(irq_number, toggle_on);
+}
+
+bool irq_route_through_ioapic(const cpu_topology_t* topology)
+{
+    if (!ioapic_init(topology->ioapic_phys_addr, topology->ioapic_gsi_base))
+        return false;
+
+    // Same vectors the PIC used, so the registered handlers don't change
+    uint8_t pic_masks[2] = { io_in_byte(PIC1_DATA), io_in_byte(PIC2_DATA) };
+    for (uint8_t irq = 0; irq < ISA_IRQ_COUNT; irq++)
+    {
+        if (irq == CASCADE_IRQ)
+            continue;
+
+        isa_irq_gsi[irq] = topology->isa_irqs[irq].gsi;
+        if (!ioapic_route(isa_irq_gsi[irq], PIC1_IRQ_INDEX + irq, lapic_id(), topology->isa_irqs[irq].flags))
+            continue;
+
+        bool enabled = !(pic_masks[irq / 8] & (1 << (irq % 8)));
+        if (enabled)
+            ioapic_set_masked(isa_irq_gsi[irq], false);
+    }
+
+    // The PIC stays programmed, only masked, so an IRQ it already raised lands on its usual vector
+    io_out_byte(PIC1_DATA, 0xFF);
+    io_out_byte(PIC2_DATA, 0xFF);
+    ioapic_routed = true;
+    return true;
+}
+
+inline bool irq_is_ioapic_routed()
+{
+    return ioapic_routed;
+}
+
+inline uint32_t irq_save()
+{
+    uint32_t flags;
+    asm volatile("pushf\n"
+                 "pop %0\n"
+                 "cli" : "=r"(flags) :: "memory");
+    return flags;
+}
+
+inline void irq_restore(uint32_t flags)
+{
+    if (flags & EFLAGS_IF)
+        asm volatile("sti" ::: "memory");
+}
+
 void example_irq_handler(int_registers* regs)
 {
     vga_printf("IRQ TRIGGERED %d\n", regs->interrupt - PIC1_IRQ_INDEX);
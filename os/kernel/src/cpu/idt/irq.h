@@ -1,5 +1,6 @@
 #pragma once
 #include <stdint.h>
+#include <stdbool.h>
 
 enum IRQ_NUMBERS
 {
@@ -21,5 +22,19 @@ enum IRQ_NUMBERS
     SECONDARY_ATA_IRQ
 };
 
+#define EFLAGS_IF 0x200
+
+struct cpu_topology;
+
+// Acknowledge an IRQ, on the I/O APIC's local APIC or on the PIC
 void irq_exit(uint32_t interrupt_number);
+// Mask or unmask an ISA IRQ, on whichever controller delivers it
+void irq_toggle(uint8_t irq_number, bool toggle_on);
+// Moves the ISA IRQs from the PIC to the I/O APIC, keeping which ones are unmasked.
+// Must be called with interrupts disabled, returns false (and keeps the PIC) if there is no I/O APIC
+bool irq_route_through_ioapic(const struct cpu_topology* topology);
+bool irq_is_ioapic_routed();
+// Disable interrupts and return the previous eflags, irq_restore turns them back on if they were on
+uint32_t irq_save();
+void irq_restore(uint32_t flags);
 void init_irqs();
@@ -3,6 +3,7 @@
 #include "cpu/pic/pic.h"
 #include "drivers/vga/vga.h"
 #include "process/manager/process_manager.h"
+#include "sync/kernel_lock.h"
 #include "util/io/io.h"
 
 isr_handler handlers[IDT_SIZE] = {NULL};
@@ -55,6 +56,8 @@ void isr_wrapper(int_registers *regs)
         // indexes 0-31 are CPU exceptions
         if (regs->interrupt == 14) // if page fault, close that probably caused it
          {  
+            // Exiting is process context work, a fault from user mode doesn't hold the lock yet
+            kernel_lock();
             vga_printf("Segmentation fault\nregs->eip=%x\nregs->eax=%x\n", regs->eip, regs->eax);
             exit_current_process();
         }
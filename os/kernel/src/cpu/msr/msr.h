@@ -0,0 +1,10 @@
+#pragma once
+#include <stdint.h>
+
+#define MSR_IA32_SYSENTER_CS  0x174
+#define MSR_IA32_SYSENTER_ESP 0x175
+#define MSR_IA32_SYSENTER_EIP 0x176
+
+// Only call these after checking CPUID_EDX_MSR
+uint64_t msr_read(uint32_t msr);
+void msr_write(uint32_t msr, uint64_t value);
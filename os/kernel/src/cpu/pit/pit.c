@@ -5,14 +5,20 @@
 #include "util/io/io.h"
 #include "process/manager/process_manager.h"
 #include "drivers/vga/vga.h"
+#include "time/clock.h"
+#include "time/timer.h"
+#include "util/math/div64.h"
 
-uint32_t expected_clock_fraction = 0;
 uint16_t reload_time = 0;
 
-uint32_t system_time = 0;
-uint32_t system_clock_fractions = 0;
+uint32_t system_ticks = 0;
 uint32_t context_switch = 0;
 
+// Port 0x61 as it was before a one-shot count, it also drives the speaker
+static uint8_t oneshot_saved_gate = 0;
+
+static void timer_irq(int_registers* regs);
+
 void pit_init()
 {
     io_out_byte(MODE_COMMAND_REGISTER, 0x36);
@@ -22,27 +28,27 @@ void pit_init()
     // Bit 0 (0): Binary mode (16-bit binary).
 
     reload_time = get_reload_time();
-    expected_clock_fraction = get_expected_clock_fraction(); // calculate the rounding error
 
     io_out_byte(CHANNEL0_PORT, reload_time & 0xFF);
     io_out_byte(CHANNEL0_PORT, reload_time >> 8);
     
     register_isr_handler(PIC1_IRQ_INDEX + PIT_IRQ, timer_irq);
-    pic_toggle_irq(PIT_IRQ, true);
+    irq_toggle(PIT_IRQ, true);
 }
 
 
+void system_tick()
+{
+    system_ticks++;
+    clock_tick();
+    timer_wheel_run(system_ticks);
+}
+
 static void timer_irq(int_registers* regs)
 {
-    system_time++;
     context_switch++;
-    system_clock_fractions += expected_clock_fraction;
-
-    if (system_clock_fractions > TARGET_FREQ_HZ) // compensate for rounding error
-    {
-        system_time++;
-        system_clock_fractions -= TARGET_FREQ_HZ;
-    }
+    system_tick();
+    account_process_tick();
 
     irq_exit(PIT_IRQ);
 
@@ -55,14 +61,42 @@ static void timer_irq(int_registers* regs)
     }
 }
 
-inline uint32_t get_system_time()
+void pit_oneshot_start(uint16_t latch)
+{
+    // Raise the channel 2 gate and keep the speaker disconnected
+    oneshot_saved_gate = io_in_byte(PIT_CHANNEL2_GATE_PORT);
+    io_out_byte(PIT_CHANNEL2_GATE_PORT, (oneshot_saved_gate & ~PIT_SPEAKER_BIT) | PIT_CHANNEL2_GATE_BIT);
+
+    io_out_byte(MODE_COMMAND_REGISTER, 0xB0);
+    // Bits 6 and 7 (10): Select channel 2.
+    // Bits 4 and 5 (11): Access mode - lobyte/hibyte.
+    // Bits 1 to 3 (000): Operating mode - Mode 0 (Interrupt On Terminal Count).
+    // Bit 0 (0): Binary mode (16-bit binary).
+
+    io_out_byte(PIT_CHANNEL2_PORT, latch & 0xFF);
+    io_out_byte(PIT_CHANNEL2_PORT, latch >> 8);
+}
+
+bool pit_oneshot_wait()
+{
+    uint32_t polls = 0;
+    // OUT2 goes high when the count reaches zero
+    while (!(io_in_byte(PIT_CHANNEL2_GATE_PORT) & PIT_CHANNEL2_OUT_BIT))
+        polls++;
+
+    io_out_byte(PIT_CHANNEL2_GATE_PORT, oneshot_saved_gate);
+    return polls != 0;
+}
+
+// The tick isn't exactly 1ms (FREQ_HZ isn't a multiple of 1000), so go through the clock
+uint32_t get_system_time()
 {
-    return system_time;
+    return (uint32_t)div64_u32(clock_monotonic_ns(), NSEC_PER_MSEC, NULL);
 }
 
-inline uint32_t get_expected_clock_fraction()
+inline uint32_t get_system_ticks()
 {
-    return FREQ_HZ - (reload_time * TARGET_FREQ_HZ);
+    return system_ticks;
 }
 
 inline uint16_t get_reload_time()
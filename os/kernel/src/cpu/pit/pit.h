@@ -1,17 +1,31 @@
 #pragma once
 
 #include "../idt/isr.h"
+#include <stdbool.h>
 
 #define CHANNEL0_PORT 0x40
 #define MODE_COMMAND_REGISTER 0x43
 
+#define PIT_CHANNEL2_PORT 0x42
+#define PIT_CHANNEL2_GATE_PORT 0x61
+
+#define PIT_CHANNEL2_GATE_BIT 0x01
+#define PIT_SPEAKER_BIT 0x02
+#define PIT_CHANNEL2_OUT_BIT 0x20
+
 #define FREQ_HZ 1193182
 #define TARGET_FREQ_HZ 1000 // This will mean that every 1/1000 seconds will be an update
 
 void pit_init();
+// Advances the system time by one tick: the clock, the ticks count and the timer wheel.
+// Called by whichever timer interrupt drives the system, the PIT or the boot cpu's local APIC timer
+void system_tick();
 
-static void timer_irq(int_registers* regs);
+// Counts down latch PIT cycles on channel 2 without an interrupt, for calibrating other timers.
+// pit_oneshot_wait returns false if the count was already over on the first poll (no PIT)
+void pit_oneshot_start(uint16_t latch);
+bool pit_oneshot_wait();
 
-uint32_t get_system_time();
-uint32_t get_expected_clock_fraction();
+uint32_t get_system_time(); // milliseconds since boot
+uint32_t get_system_ticks();
 uint16_t get_reload_time();
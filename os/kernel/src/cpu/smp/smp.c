@@ -0,0 +1,175 @@
+#include "smp.h"
+#include "cpu/apic/lapic.h"
+#include "cpu/apic/lapic_timer.h"
+#include "cpu/apic/apic.h"
+#include "cpu/idt/idt.h"
+#include "cpu/idt/isr.h"
+#include "cpu/fpu/fpu.h"
+#include "memory/paging/paging.h"
+#include "memory/heap/heap.h"
+#include "process/manager/process_manager.h"
+#include "process/syscalls/syscalls.h"
+#include "drivers/vga/vga.h"
+#include "time/clock.h"
+#include "cpu/tsc/tsc.h"
+#include <string.h>
+
+#define INIT_DELAY_NS       (10 * NSEC_PER_MSEC)
+#define STARTUP_DELAY_NS    (200 * NSEC_PER_USEC)
+#define AP_START_TIMEOUT_NS (100 * NSEC_PER_MSEC)
+#define STARTUP_IPI_COUNT   2
+
+// trampoline.asm
+extern uint8_t ap_trampoline_start[];
+extern uint8_t ap_trampoline_end[];
+extern uint8_t ap_trampoline_cr3[];
+extern uint8_t ap_trampoline_stack[];
+extern uint8_t ap_trampoline_entry[];
+
+static cpu_t cpus[MAX_CPUS];
+static volatile uint32_t cpu_count = 1;
+
+// The AP that is starting right now, they are started one at a time since they share the trampoline
+static cpu_t* volatile booting_cpu = NULL;
+
+static void delay_ns(uint64_t ns)
+{
+    uint64_t end = clock_monotonic_ns() + ns;
+    while (clock_monotonic_ns() < end)
+        asm volatile("pause");
+}
+
+static void reschedule_interrupt(int_registers* regs)
+{
+    lapic_eoi();
+    if (is_schduling())
+        switch_process(regs);
+}
+
+// The address of a trampoline variable in the copy the APs run
+static uint32_t* trampoline_variable(uint8_t* variable)
+{
+    return (uint32_t*)(AP_TRAMPOLINE_ADDR + RELOCATION_OFFSET + (variable - ap_trampoline_start));
+}
+
+static bool smp_start_ap(cpu_t* cpu)
+{
+    void* stack = kmalloc_pages(AP_BOOT_STACK_PAGES);
+    if (stack == NULL || !sched_init_cpu(cpu->id))
+        return false;
+
+    *trampoline_variable(ap_trampoline_cr3) = get_physical_address(get_kernel_pd());
+    *trampoline_variable(ap_trampoline_stack) = (uint32_t)stack + AP_BOOT_STACK_PAGES * PAGE_SIZE;
+    *trampoline_variable(ap_trampoline_entry) = (uint32_t)smp_ap_main;
+    booting_cpu = cpu;
+
+    // INIT, then the startup IPIs, the second one is only there in case the first got lost
+    lapic_send_init(cpu->apic_id);
+    delay_ns(INIT_DELAY_NS);
+    for (int i = 0; i < STARTUP_IPI_COUNT && !cpu->online; i++)
+    {
+        lapic_send_startup(cpu->apic_id, AP_TRAMPOLINE_ADDR / PAGE_SIZE);
+        delay_ns(STARTUP_DELAY_NS);
+    }
+
+    uint64_t deadline = clock_monotonic_ns() + AP_START_TIMEOUT_NS;
+    while (!cpu->online && clock_monotonic_ns() < deadline)
+        asm volatile("pause");
+
+    return cpu->online;
+}
+
+void smp_init()
+{
+    cpus[0].online = true;
+
+    // apic_init already said what is missing
+    const cpu_topology_t* topology = apic_get_topology();
+    if (topology == NULL || !lapic_is_enabled())
+        return;
+
+    // The startup delays are timed with the clock, which doesn't move with interrupts off without a TSC
+    if (!tsc_is_available())
+    {
+        vga_printf("No TSC to time the startup IPIs, running on one cpu\n");
+        return;
+    }
+
+    cpus[0].apic_id = lapic_id();
+    register_isr_handler(RESCHEDULE_VECTOR, reschedule_interrupt);
+
+    memcpy((void*)(AP_TRAMPOLINE_ADDR + RELOCATION_OFFSET), ap_trampoline_start,
+        ap_trampoline_end - ap_trampoline_start);
+
+    for (uint32_t i = 0; i < topology->cpu_count && cpu_count < MAX_CPUS; i++)
+    {
+        if (topology->apic_ids[i] == cpus[0].apic_id)
+            continue;
+
+        cpu_t* cpu = &cpus[cpu_count];
+        cpu->id = cpu_count;
+        cpu->apic_id = topology->apic_ids[i];
+
+        // A late AP would still use the trampoline variables, so don't start any more after it
+        if (!smp_start_ap(cpu))
+        {
+            vga_printf("CPU with APIC id %d didn't start\n", cpu->apic_id);
+            break;
+        }
+        cpu_count++;
+    }
+
+    vga_printf("%d cpus online\n", cpu_count);
+}
+
+void smp_ap_main()
+{
+    cpu_t* cpu = booting_cpu;
+
+    // From here on smp_current_cpu() works on this cpu
+    gdt_init_cpu(&cpu->descriptors);
+    cpu->page_directory = get_kernel_pd();
+
+    idt_load();
+    paging_init_cpu();
+    fpu_init_cpu();
+
+    lapic_enable();
+    // Only the boot cpu gets the PIC's interrupts
+    lapic_write(LAPIC_LVT_LINT0, LAPIC_LVT_MASKED);
+    lapic_write(LAPIC_LVT_LINT1, LAPIC_LVT_MASKED);
+    // Its own tick, the first one comes once the idle thread enables interrupts
+    lapic_timer_start();
+
+    syscall_init_cpu();
+
+    cpu->online = true;
+    sched_start_cpu();
+}
+
+cpu_t* smp_current_cpu()
+{
+    // The descriptors are the first member, so the GDT base is the cpu struct itself
+    return (cpu_t*)gdt_current_descriptors();
+}
+
+uint32_t smp_cpu_id()
+{
+    return smp_current_cpu()->id;
+}
+
+cpu_t* smp_get_cpu(uint32_t id)
+{
+    return &cpus[id];
+}
+
+uint32_t smp_cpu_count()
+{
+    return cpu_count;
+}
+
+void smp_send_reschedule(uint32_t cpu_id)
+{
+    if (cpu_id < cpu_count && cpu_id != smp_cpu_id())
+        lapic_send_ipi(cpus[cpu_id].apic_id, RESCHEDULE_VECTOR);
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "cpu/gdt/gdt.h"
+#include "topology.h"
+
+// The APs start in real mode at this address, it has to be page aligned and below 1MB
+#define AP_TRAMPOLINE_ADDR 0x8000
+#define AP_BOOT_STACK_PAGES 1
+
+// Sent to a cpu to make it look at its run queue
+#define RESCHEDULE_VECTOR 0xF0
+
+struct page_directory_entry;
+struct fpu_state;
+
+typedef struct cpu {
+    cpu_descriptors_t descriptors;  // must stay first, the GDT base is how a cpu finds this struct
+    uint32_t id;                    // index in the cpu array, the boot cpu is 0
+    uint8_t apic_id;
+    volatile bool online;
+    struct page_directory_entry* page_directory;    // the one loaded in cr3
+    const struct fpu_state* fpu_owner;              // the process whose registers are in this FPU
+} cpu_t;
+
+// Starts the other cpus apic_init found, if anything is missing the boot cpu just runs alone
+void smp_init();
+// Where the trampoline jumps to in the higher half, never returns
+void smp_ap_main();
+
+cpu_t* smp_current_cpu();
+uint32_t smp_cpu_id();
+cpu_t* smp_get_cpu(uint32_t id);
+// The cpus that are online, always counts the boot cpu
+uint32_t smp_cpu_count();
+
+void smp_send_reschedule(uint32_t cpu_id);
@@ -0,0 +1,315 @@
+#include "topology.h"
+#include "drivers/acpi/acpi.h"
+#include "memory/mmio/mmio.h"
+#include <string.h>
+#include <stddef.h>
+
+#define MADT_SIGNATURE "APIC"
+
+#define MADT_LOCAL_APIC         0
+#define MADT_IO_APIC            1
+#define MADT_IRQ_OVERRIDE       2
+#define MADT_LOCAL_APIC_ENABLED 1
+
+#define MP_SIGNATURE "_MP_"
+#define MP_CONFIG_SIGNATURE "PCMP"
+#define MP_SIGNATURE_SIZE 4
+
+#define MP_PROCESSOR        0
+#define MP_BUS              1
+#define MP_IO_APIC          2
+#define MP_IO_INTERRUPT     3
+#define MP_PROCESSOR_ENABLED 1
+#define MP_IO_APIC_ENABLED   1
+#define MP_INTERRUPT_INT     0
+#define MP_BUS_ISA "ISA   "
+#define MP_BUS_TYPE_SIZE 6
+#define MP_NO_ISA_BUS 0xFF
+
+#define EBDA_SEGMENT_PTR 0x40E
+#define BASE_MEMORY_END  0xA0000
+#define BIOS_ROM_START   0xF0000
+#define BIOS_ROM_END     0x100000
+#define MP_SEARCH_SIZE   0x400
+
+typedef struct madt {
+    acpi_table_header_t header;
+    uint32_t lapic_address;
+    uint32_t flags;
+    uint8_t entries[];
+} __attribute__((packed)) madt_t;
+
+typedef struct madt_entry_header {
+    uint8_t type;
+    uint8_t length;
+} __attribute__((packed)) madt_entry_header_t;
+
+typedef struct madt_local_apic {
+    madt_entry_header_t header;
+    uint8_t processor_id;
+    uint8_t apic_id;
+    uint32_t flags;
+} __attribute__((packed)) madt_local_apic_t;
+
+typedef struct madt_io_apic {
+    madt_entry_header_t header;
+    uint8_t id;
+    uint8_t reserved;
+    uint32_t address;
+    uint32_t gsi_base;
+} __attribute__((packed)) madt_io_apic_t;
+
+typedef struct madt_irq_override {
+    madt_entry_header_t header;
+    uint8_t bus;
+    uint8_t source;     // the ISA IRQ
+    uint32_t gsi;
+    uint16_t flags;
+} __attribute__((packed)) madt_irq_override_t;
+
+typedef struct mp_floating_pointer {
+    char signature[MP_SIGNATURE_SIZE];
+    uint32_t config_address;
+    uint8_t length;     // in 16 byte units
+    uint8_t revision;
+    uint8_t checksum;
+    uint8_t default_config;     // not 0 for the predefined configurations, they have no table
+    uint8_t features[4];
+} __attribute__((packed)) mp_floating_pointer_t;
+
+typedef struct mp_config {
+    char signature[MP_SIGNATURE_SIZE];
+    uint16_t length;
+    uint8_t revision;
+    uint8_t checksum;
+    char oem_id[8];
+    char product_id[12];
+    uint32_t oem_table;
+    uint16_t oem_table_size;
+    uint16_t entry_count;
+    uint32_t lapic_address;
+    uint16_t extended_length;
+    uint8_t extended_checksum;
+    uint8_t reserved;
+    uint8_t entries[];
+} __attribute__((packed)) mp_config_t;
+
+typedef struct mp_processor {
+    uint8_t type;
+    uint8_t apic_id;
+    uint8_t apic_version;
+    uint8_t flags;
+    uint32_t signature;
+    uint32_t features;
+    uint32_t reserved[2];
+} __attribute__((packed)) mp_processor_t;
+
+typedef struct mp_bus {
+    uint8_t type;
+    uint8_t id;
+    char bus_type[MP_BUS_TYPE_SIZE];
+} __attribute__((packed)) mp_bus_t;
+
+typedef struct mp_io_apic {
+    uint8_t type;
+    uint8_t id;
+    uint8_t version;
+    uint8_t flags;
+    uint32_t address;
+} __attribute__((packed)) mp_io_apic_t;
+
+typedef struct mp_io_interrupt {
+    uint8_t type;
+    uint8_t interrupt_type;
+    uint16_t flags;
+    uint8_t source_bus;
+    uint8_t source_irq;
+    uint8_t dest_apic;
+    uint8_t dest_input;
+} __attribute__((packed)) mp_io_interrupt_t;
+
+static void topology_reset(cpu_topology_t* topology)
+{
+    memset(topology, 0, sizeof(cpu_topology_t));
+
+    // Without overrides every ISA IRQ goes to the I/O APIC input with the same number
+    for (uint32_t irq = 0; irq < ISA_IRQ_COUNT; irq++)
+        topology->isa_irqs[irq].gsi = irq;
+}
+
+static void topology_add_cpu(cpu_topology_t* topology, uint8_t apic_id)
+{
+    if (topology->cpu_count < MAX_CPUS)
+        topology->apic_ids[topology->cpu_count++] = apic_id;
+}
+
+static bool topology_from_madt(cpu_topology_t* topology)
+{
+    const madt_t* madt = (const madt_t*)acpi_find_table(MADT_SIGNATURE);
+    if (madt == NULL)
+        return false;
+
+    topology_reset(topology);
+    topology->lapic_phys_addr = madt->lapic_address;
+
+    const uint8_t* entry = madt->entries;
+    const uint8_t* end = (const uint8_t*)madt + madt->header.length;
+    while (entry + sizeof(madt_entry_header_t) <= end)
+    {
+        const madt_entry_header_t* header = (const madt_entry_header_t*)entry;
+        if (header->length < sizeof(madt_entry_header_t))
+            break;
+
+        switch (header->type)
+        {
+        case MADT_LOCAL_APIC:
+        {
+            const madt_local_apic_t* lapic = (const madt_local_apic_t*)entry;
+            if (lapic->flags & MADT_LOCAL_APIC_ENABLED)
+                topology_add_cpu(topology, lapic->apic_id);
+            break;
+        }
+        case MADT_IO_APIC:
+        {
+            // Only the first I/O APIC, the ISA IRQs are on it
+            const madt_io_apic_t* ioapic = (const madt_io_apic_t*)entry;
+            if (topology->ioapic_phys_addr == 0)
+            {
+                topology->ioapic_phys_addr = ioapic->address;
+                topology->ioapic_id = ioapic->id;
+                topology->ioapic_gsi_base = ioapic->gsi_base;
+            }
+            break;
+        }
+        case MADT_IRQ_OVERRIDE:
+        {
+            const madt_irq_override_t* override = (const madt_irq_override_t*)entry;
+            if (override->source < ISA_IRQ_COUNT)
+            {
+                topology->isa_irqs[override->source].gsi = override->gsi;
+                topology->isa_irqs[override->source].flags = override->flags;
+            }
+            break;
+        }
+        }
+        entry += header->length;
+    }
+
+    return topology->cpu_count > 0;
+}
+
+static bool mp_checksum_valid(const void* data, uint32_t size)
+{
+    const uint8_t* bytes = data;
+    uint8_t sum = 0;
+
+    for (uint32_t i = 0; i < size; i++)
+        sum += bytes[i];
+    return sum == 0;
+}
+
+static const mp_floating_pointer_t* mp_search(uintptr_t phys_start, uintptr_t phys_end)
+{
+    const uint8_t* start = mmio_map_memory(phys_start, phys_end - phys_start);
+
+    for (uintptr_t offset = 0; offset + sizeof(mp_floating_pointer_t) <= phys_end - phys_start; offset += 16)
+    {
+        const mp_floating_pointer_t* pointer = (const mp_floating_pointer_t*)(start + offset);
+        if (strncmp(pointer->signature, MP_SIGNATURE, MP_SIGNATURE_SIZE) == 0
+            && mp_checksum_valid(pointer, pointer->length * 16))
+            return pointer;
+    }
+    return NULL;
+}
+
+static bool topology_from_mp_table(cpu_topology_t* topology)
+{
+    uintptr_t ebda = (uintptr_t)*(const uint16_t*)mmio_map_memory(EBDA_SEGMENT_PTR, sizeof(uint16_t)) << 4;
+
+    const mp_floating_pointer_t* pointer = NULL;
+    if (ebda != 0)
+        pointer = mp_search(ebda, ebda + MP_SEARCH_SIZE);
+    if (pointer == NULL)
+        pointer = mp_search(BASE_MEMORY_END - MP_SEARCH_SIZE, BASE_MEMORY_END);
+    if (pointer == NULL)
+        pointer = mp_search(BIOS_ROM_START, BIOS_ROM_END);
+
+    // The predefined configurations are from the 486 days, don't bother with them
+    if (pointer == NULL || pointer->config_address == 0 || pointer->default_config != 0)
+        return false;
+
+    const mp_config_t* config = mmio_map_memory(pointer->config_address, sizeof(mp_config_t));
+    if (config == NULL || strncmp(config->signature, MP_CONFIG_SIGNATURE, MP_SIGNATURE_SIZE) != 0)
+        return false;
+    config = mmio_map_memory(pointer->config_address, config->length);
+    if (config == NULL || !mp_checksum_valid(config, config->length))
+        return false;
+
+    topology_reset(topology);
+    topology->lapic_phys_addr = config->lapic_address;
+
+    // The bus entries come before the interrupt entries that refer to them
+    uint8_t isa_bus = MP_NO_ISA_BUS;
+    const uint8_t* entry = config->entries;
+    const uint8_t* end = (const uint8_t*)config + config->length;
+    for (uint16_t i = 0; i < config->entry_count && entry < end; i++)
+    {
+        switch (*entry)
+        {
+        case MP_PROCESSOR:
+        {
+            const mp_processor_t* processor = (const mp_processor_t*)entry;
+            if (processor->flags & MP_PROCESSOR_ENABLED)
+                topology_add_cpu(topology, processor->apic_id);
+            entry += sizeof(mp_processor_t);
+            break;
+        }
+        case MP_BUS:
+        {
+            const mp_bus_t* bus = (const mp_bus_t*)entry;
+            if (strncmp(bus->bus_type, MP_BUS_ISA, MP_BUS_TYPE_SIZE) == 0)
+                isa_bus = bus->id;
+            entry += sizeof(mp_bus_t);
+            break;
+        }
+        case MP_IO_APIC:
+        {
+            const mp_io_apic_t* ioapic = (const mp_io_apic_t*)entry;
+            if ((ioapic->flags & MP_IO_APIC_ENABLED) && topology->ioapic_phys_addr == 0)
+            {
+                topology->ioapic_phys_addr = ioapic->address;
+                topology->ioapic_id = ioapic->id;
+                topology->ioapic_gsi_base = 0;
+            }
+            entry += sizeof(mp_io_apic_t);
+            break;
+        }
+        case MP_IO_INTERRUPT:
+        {
+            const mp_io_interrupt_t* interrupt = (const mp_io_interrupt_t*)entry;
+            if (interrupt->interrupt_type == MP_INTERRUPT_INT && interrupt->source_bus == isa_bus
+                && interrupt->source_irq < ISA_IRQ_COUNT)
+            {
+                topology->isa_irqs[interrupt->source_irq].gsi = interrupt->dest_input;
+                topology->isa_irqs[interrupt->source_irq].flags = interrupt->flags;
+            }
+            entry += sizeof(mp_io_interrupt_t);
+            break;
+        }
+        default:
+            // Local interrupt entries and anything newer, all 8 bytes
+            entry += sizeof(mp_io_interrupt_t);
+            break;
+        }
+    }
+
+    return topology->cpu_count > 0;
+}
+
+bool topology_discover(cpu_topology_t* topology)
+{
+    if (acpi_init() && topology_from_madt(topology))
+        return true;
+
+    return topology_from_mp_table(topology);
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+#define MAX_CPUS 8
+#define ISA_IRQ_COUNT 16
+
+// Polarity and trigger mode of an interrupt source, same encoding in the MADT and the MP table
+#define IRQ_FLAGS_POLARITY_MASK 0x3
+#define IRQ_FLAGS_ACTIVE_HIGH   0x1
+#define IRQ_FLAGS_ACTIVE_LOW    0x3
+#define IRQ_FLAGS_TRIGGER_MASK  0xC
+#define IRQ_FLAGS_EDGE          0x4
+#define IRQ_FLAGS_LEVEL         0xC
+
+// Where an ISA IRQ is wired to on the I/O APIC
+typedef struct isa_irq_route {
+    uint32_t gsi;       // global system interrupt, the I/O APIC input
+    uint16_t flags;     // 0 means the ISA default: edge triggered, active high
+} isa_irq_route_t;
+
+// What the firmware tells about the cpus and the interrupt controllers
+typedef struct cpu_topology {
+    uint32_t cpu_count;
+    uint8_t apic_ids[MAX_CPUS];
+    uintptr_t lapic_phys_addr;
+    uintptr_t ioapic_phys_addr;     // 0 if there is no I/O APIC
+    uint8_t ioapic_id;
+    uint32_t ioapic_gsi_base;
+    isa_irq_route_t isa_irqs[ISA_IRQ_COUNT];
+} cpu_topology_t;
+
+// Reads the ACPI MADT, or the MP table on machines without ACPI, returns false if neither is there
+bool topology_discover(cpu_topology_t* topology);
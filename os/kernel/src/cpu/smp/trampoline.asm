@@ -0,0 +1,65 @@
+bits 16
+
+; The APs wake up in real mode at AP_TRAMPOLINE_ADDR, smp_init copies this code there.
+; It can't use its link address, every address is computed relative to the copy.
+AP_TRAMPOLINE_ADDR equ 0x8000
+%define REL(label) (AP_TRAMPOLINE_ADDR + (label) - ap_trampoline_start)
+
+section .text
+
+global ap_trampoline_start
+global ap_trampoline_end
+global ap_trampoline_cr3
+global ap_trampoline_stack
+global ap_trampoline_entry
+
+ap_trampoline_start:
+    cli
+    cld
+    xor ax, ax
+    mov ds, ax
+
+    lgdt [REL(trampoline_gdt_ptr)]
+    mov eax, cr0
+    or eax, 1
+    mov cr0, eax
+    jmp dword 0x08:REL(trampoline_protected_mode)
+
+bits 32
+trampoline_protected_mode:
+    mov ax, 0x10
+    mov ds, ax
+    mov es, ax
+    mov fs, ax
+    mov gs, ax
+    mov ss, ax
+
+    ; The kernel page directory still identity maps the low memory, so this code keeps running
+    mov eax, [REL(ap_trampoline_cr3)]
+    mov cr3, eax
+    mov eax, cr0
+    or eax, 0x80000000
+    mov cr0, eax
+
+    ; From here on everything is in the higher half
+    mov esp, [REL(ap_trampoline_stack)]
+    xor ebp, ebp
+    mov eax, [REL(ap_trampoline_entry)]
+    jmp eax
+
+; Flat segments, same selectors as the kernel GDT, until the AP loads its own
+align 8
+trampoline_gdt:
+    dq 0
+    dq 0x00CF9A000000FFFF   ; code
+    dq 0x00CF92000000FFFF   ; data
+trampoline_gdt_ptr:
+    dw trampoline_gdt_ptr - trampoline_gdt - 1
+    dd REL(trampoline_gdt)
+
+; Filled by smp_init for every AP it starts
+ap_trampoline_cr3:   dd 0
+ap_trampoline_stack: dd 0
+ap_trampoline_entry: dd 0
+
+ap_trampoline_end:
@@ -0,0 +1,65 @@
+#include "tsc.h"
+#include "cpu/cpuid/cpuid.h"
+#include "cpu/pit/pit.h"
+#include "util/math/div64.h"
+
+static bool tsc_available = false;
+static uint32_t tsc_khz = 0;
+
+static uint32_t tsc_calibrate_once();
+
+bool tsc_init()
+{
+    if (!cpuid_has_feature(CPUID_EDX_TSC))
+        return false;
+
+    // Take the fastest run, anything that interrupts the measurement can only make it longer
+    uint32_t best_khz = 0;
+    for (int i = 0; i < TSC_CALIBRATION_RUNS; i++)
+    {
+        uint32_t khz = tsc_calibrate_once();
+        if (khz != 0 && (best_khz == 0 || khz < best_khz))
+            best_khz = khz;
+    }
+
+    if (best_khz == 0)
+        return false;
+
+    tsc_khz = best_khz;
+    tsc_available = true;
+    return true;
+}
+
+// Count TSC cycles while PIT channel 2 counts down TSC_CALIBRATION_MS in one-shot mode
+static uint32_t tsc_calibrate_once()
+{
+    const uint16_t latch = FREQ_HZ / (1000 / TSC_CALIBRATION_MS);
+
+    pit_oneshot_start(latch);
+    uint64_t start = tsc_read();
+    bool counted = pit_oneshot_wait();
+    uint64_t end = tsc_read();
+
+    // The counter must have actually counted, otherwise the PIT isn't there
+    if (!counted || end <= start)
+        return 0;
+
+    return (uint32_t)div64_u32(end - start, TSC_CALIBRATION_MS, NULL);
+}
+
+inline bool tsc_is_available()
+{
+    return tsc_available;
+}
+
+inline uint32_t tsc_get_khz()
+{
+    return tsc_khz;
+}
+
+inline uint64_t tsc_read()
+{
+    uint32_t low, high;
+    asm volatile("rdtsc" : "=a"(low), "=d"(high));
+    return ((uint64_t)high << 32) | low;
+}
@@ -0,0 +1,12 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+#define TSC_CALIBRATION_MS 10
+#define TSC_CALIBRATION_RUNS 3
+
+// Detect the TSC and calibrate its frequency against PIT channel 2
+bool tsc_init();
+bool tsc_is_available();
+uint32_t tsc_get_khz();
+uint64_t tsc_read();
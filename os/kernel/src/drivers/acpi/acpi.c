@@ -0,0 +1,104 @@
+#include "acpi.h"
+#include "memory/mmio/mmio.h"
+#include <string.h>
+#include <stddef.h>
+
+#define RSDP_SIGNATURE "RSD PTR "
+#define RSDP_SIGNATURE_SIZE 8
+#define RSDT_SIGNATURE "RSDT"
+
+// The BIOS data area keeps the segment of the EBDA here
+#define EBDA_SEGMENT_PTR 0x40E
+#define EBDA_SEARCH_SIZE 0x400
+#define BIOS_ROM_START   0xE0000
+#define BIOS_ROM_END     0x100000
+#define RSDP_ALIGNMENT   16
+
+typedef struct rsdp {
+    char signature[RSDP_SIGNATURE_SIZE];
+    uint8_t checksum;
+    char oem_id[6];
+    uint8_t revision;
+    uint32_t rsdt_address;
+} __attribute__((packed)) rsdp_t;
+
+typedef struct rsdt {
+    acpi_table_header_t header;
+    uint32_t tables[];      // physical addresses of the other tables
+} __attribute__((packed)) rsdt_t;
+
+static const rsdt_t* rsdt = NULL;
+
+// ACPI structures are valid when all of their bytes add up to 0
+static bool acpi_checksum_valid(const void* data, uint32_t size)
+{
+    const uint8_t* bytes = data;
+    uint8_t sum = 0;
+
+    for (uint32_t i = 0; i < size; i++)
+        sum += bytes[i];
+    return sum == 0;
+}
+
+static const rsdp_t* rsdp_search(uintptr_t phys_start, uintptr_t phys_end)
+{
+    const uint8_t* start = mmio_map_memory(phys_start, phys_end - phys_start);
+
+    for (uintptr_t offset = 0; offset + sizeof(rsdp_t) <= phys_end - phys_start; offset += RSDP_ALIGNMENT)
+    {
+        const rsdp_t* rsdp = (const rsdp_t*)(start + offset);
+        if (strncmp(rsdp->signature, RSDP_SIGNATURE, RSDP_SIGNATURE_SIZE) == 0
+            && acpi_checksum_valid(rsdp, sizeof(rsdp_t)))
+            return rsdp;
+    }
+    return NULL;
+}
+
+// The header tells how long the table is, so map it first and then map the whole table
+static const acpi_table_header_t* acpi_map_table(uintptr_t phys_addr)
+{
+    const acpi_table_header_t* header = mmio_map_memory(phys_addr, sizeof(acpi_table_header_t));
+    if (header == NULL || header->length < sizeof(acpi_table_header_t))
+        return NULL;
+
+    const acpi_table_header_t* table = mmio_map_memory(phys_addr, header->length);
+    if (table == NULL || !acpi_checksum_valid(table, table->length))
+        return NULL;
+    return table;
+}
+
+bool acpi_init()
+{
+    uintptr_t ebda = (uintptr_t)*(const uint16_t*)mmio_map_memory(EBDA_SEGMENT_PTR, sizeof(uint16_t)) << 4;
+
+    const rsdp_t* rsdp = NULL;
+    if (ebda != 0)
+        rsdp = rsdp_search(ebda, ebda + EBDA_SEARCH_SIZE);
+    if (rsdp == NULL)
+        rsdp = rsdp_search(BIOS_ROM_START, BIOS_ROM_END);
+    if (rsdp == NULL)
+        return false;
+
+    // Only the 32 bit RSDT, the XSDT has the same tables but with 64 bit addresses
+    const acpi_table_header_t* table = acpi_map_table(rsdp->rsdt_address);
+    if (table == NULL || strncmp(table->signature, RSDT_SIGNATURE, ACPI_SIGNATURE_SIZE) != 0)
+        return false;
+
+    rsdt = (const rsdt_t*)table;
+    return true;
+}
+
+const acpi_table_header_t* acpi_find_table(const char* signature)
+{
+    if (rsdt == NULL)
+        return NULL;
+
+    uint32_t count = (rsdt->header.length - sizeof(acpi_table_header_t)) / sizeof(uint32_t);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const acpi_table_header_t* header = mmio_map_memory(rsdt->tables[i], sizeof(acpi_table_header_t));
+        if (header != NULL && strncmp(header->signature, signature, ACPI_SIGNATURE_SIZE) == 0)
+            return acpi_map_table(rsdt->tables[i]);
+    }
+    return NULL;
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+#define ACPI_SIGNATURE_SIZE 4
+
+// Every ACPI table (RSDT, MADT, ...) starts with this header
+typedef struct acpi_table_header {
+    char signature[ACPI_SIGNATURE_SIZE];
+    uint32_t length;            // of the whole table, header included
+    uint8_t revision;
+    uint8_t checksum;
+    char oem_id[6];
+    char oem_table_id[8];
+    uint32_t oem_revision;
+    uint32_t creator_id;
+    uint32_t creator_revision;
+} __attribute__((packed)) acpi_table_header_t;
+
+// Finds the RSDP and the RSDT, returns false if the firmware has no (valid) ACPI tables
+bool acpi_init();
+// Maps the table with the given signature ("APIC", "FACP", ...), NULL if there is no such table
+const acpi_table_header_t* acpi_find_table(const char* signature);
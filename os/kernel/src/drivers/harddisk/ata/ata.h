@@ -19,6 +19,8 @@ This file contains the ata pio actions implementations
 #define ATA_CMD_STATUS 0x1F7
 
 #define SECTOR_SIZE 512
+// The sector count register is 8 bit, and 0 here would mean nothing rather than 256
+#define ATA_MAX_SECTORS 255
 
 typedef struct ata_drive {
     uint16_t cylinders;
@@ -5,6 +5,8 @@
 #include "../vga/vga.h"
 #include "process/manager/process_manager.h"
 #include "terminal/terminal_manager.h"
+#include "process/workqueue/workqueue.h"
+#include "sync/spinlock.h"
 
 unsigned char key_map[128] =
     {
@@ -88,13 +90,26 @@ unsigned char key_map_shift[128] =
 
 static keyboard_state_flags keyboard_state = {0};
 
+// Drawing is slow, the IRQ only queues the echo and the worker thread draws it
+static char echo_buffer[ECHO_BUFFER_SIZE];
+static uint32_t echo_head = 0; // only the IRQ moves it
+static uint32_t echo_tail = 0;
+// The worker and a reader flushing the echo may drain it at once, a byte is drawn and taken off
+// under the lock, so each one is drawn once
+static spinlock_t echo_lock = SPINLOCK_INIT;
+static work_t echo_work;
+
 static void keyboard_irq(int_registers *regs);
 static void keyboard_handler(uint8_t scan_code);
 static uint8_t get_scan_code();
+static void keyboard_echo(char c);
+static void echo_work_func(work_t* work);
+static void echo_drain();
 
 void keyboard_init()
 {
-    pic_toggle_irq(KEYBOARD_IRQ, true);
+    work_init(&echo_work, echo_work_func, NULL);
+    irq_toggle(KEYBOARD_IRQ, true);
     register_isr_handler(PIC1_IRQ_INDEX + KEYBOARD_IRQ, keyboard_irq);
 }
 
@@ -161,35 +176,23 @@ static void keyboard_handler(uint8_t scan_code)
         default:
         {
             terminal_struct_t* active_terminal = get_active_terminal_struct();
-            if (key_map[scan_code] == '\b')
-            {
-                if (active_terminal->input_len > 0)
-                {
-                    active_terminal->input_buf[--active_terminal->input_len] = '\0';
-                    vga_putchar('\b');
-                }
-                break;
-            }
+            char c;
 
             if ((keyboard_state.caps_lock_pressed 
                 && (key_map[scan_code] >= 'a' && key_map[scan_code] <= 'z') 
                 && !(keyboard_state.left_shift_pressed || keyboard_state.right_shift_pressed)) 
                 || keyboard_state.left_shift_pressed || keyboard_state.right_shift_pressed)
             {
-                active_terminal->input_buf[active_terminal->input_len++] = key_map_shift[scan_code];
-                vga_putchar(key_map_shift[scan_code]);
+                c = key_map_shift[scan_code];
             }
             else
             {
-                active_terminal->input_buf[active_terminal->input_len++] = key_map[scan_code];
-                vga_putchar(key_map[scan_code]);
+                c = key_map[scan_code];
             }
 
-            if (key_map[scan_code] == '\n')
-            {
-                active_terminal->is_input_ready = true;
-                wake_up_terminal_processes(get_active_terminal_id());
-            }
+            // Keys without a character, like the F keys, aren't input
+            if (c != 0 && active_terminal != NULL && terminal_push_input(active_terminal, c))
+                keyboard_echo(c);
 
             break;
         }
@@ -197,6 +200,49 @@ static void keyboard_handler(uint8_t scan_code)
     }
 }
 
+static void keyboard_echo(char c)
+{
+    uint32_t flags = spin_lock_irqsave(&echo_lock);
+    // If the worker fell that far behind, drop the echo, the input itself is kept
+    if (echo_head - echo_tail < ECHO_BUFFER_SIZE)
+    {
+        echo_buffer[echo_head % ECHO_BUFFER_SIZE] = c;
+        echo_head++;
+    }
+    spin_unlock_irqrestore(&echo_lock, flags);
+
+    schedule_work(&echo_work);
+}
+
+static void echo_work_func(work_t* work)
+{
+    echo_drain();
+}
+
+static void echo_drain()
+{
+    while (true)
+    {
+        // Interrupts stay off too, processes also draw and mustn't get in with the cursor half updated
+        uint32_t flags = spin_lock_irqsave(&echo_lock);
+        if (echo_tail == echo_head)
+        {
+            spin_unlock_irqrestore(&echo_lock, flags);
+            break;
+        }
+        vga_putchar(echo_buffer[echo_tail % ECHO_BUFFER_SIZE]);
+        echo_tail++;
+        spin_unlock_irqrestore(&echo_lock, flags);
+    }
+}
+
+void keyboard_flush_echo()
+{
+    // Drained here rather than through flush_work(), which doesn't wait for a run the worker
+    // already started, so the echo could still be behind the reader
+    echo_drain();
+}
+
 static uint8_t get_scan_code()
 {
     return io_in_byte(0x60);
@@ -1,6 +1,8 @@
 #pragma once
 #include "../../cpu/idt/isr.h"
 
+#define ECHO_BUFFER_SIZE 64
+
 typedef struct keyboard_state_flags
 {
     uint8_t right_shift_pressed : 1;
@@ -22,3 +24,5 @@ typedef struct keyboard_state_flags
 } keyboard_state_flags;
 
 void keyboard_init();
+// Draw the pending echo now, so it shows up before anything the reader prints
+void keyboard_flush_echo();
@@ -0,0 +1,97 @@
+#include "rtc.h"
+#include "util/io/io.h"
+#include <stdbool.h>
+
+static uint8_t cmos_read(uint8_t reg)
+{
+    io_out_byte(CMOS_ADDRESS, reg);
+    return io_in_byte(CMOS_DATA);
+}
+
+static uint8_t bcd_to_binary(uint8_t value)
+{
+    return (value & 0x0F) + (value >> 4) * 10;
+}
+
+static void rtc_read_raw(rtc_time* time, uint8_t* century)
+{
+    while (cmos_read(RTC_STATUS_A) & RTC_STATUS_A_UPDATE_IN_PROGRESS);
+
+    time->second = cmos_read(RTC_SECONDS);
+    time->minute = cmos_read(RTC_MINUTES);
+    time->hour = cmos_read(RTC_HOURS);
+    time->day = cmos_read(RTC_DAY);
+    time->month = cmos_read(RTC_MONTH);
+    time->year = cmos_read(RTC_YEAR);
+    *century = cmos_read(RTC_CENTURY);
+}
+
+static bool rtc_time_equal(const rtc_time* a, const rtc_time* b)
+{
+    return a->second == b->second && a->minute == b->minute && a->hour == b->hour
+        && a->day == b->day && a->month == b->month && a->year == b->year;
+}
+
+void rtc_read_time(rtc_time* time)
+{
+    rtc_time previous;
+    uint8_t century, previous_century;
+
+    // Read until two reads agree, so we didn't catch the RTC in the middle of an update
+    rtc_read_raw(time, &century);
+    do
+    {
+        previous = *time;
+        previous_century = century;
+        rtc_read_raw(time, &century);
+    } while (!rtc_time_equal(&previous, time) || previous_century != century);
+
+    uint8_t status_b = cmos_read(RTC_STATUS_B);
+    bool is_pm = time->hour & RTC_HOUR_PM;
+    time->hour &= ~RTC_HOUR_PM;
+
+    if (!(status_b & RTC_STATUS_B_BINARY))
+    {
+        time->second = bcd_to_binary(time->second);
+        time->minute = bcd_to_binary(time->minute);
+        time->hour = bcd_to_binary(time->hour);
+        time->day = bcd_to_binary(time->day);
+        time->month = bcd_to_binary(time->month);
+        time->year = bcd_to_binary(time->year);
+        century = bcd_to_binary(century);
+    }
+
+    if (!(status_b & RTC_STATUS_B_24_HOUR))
+    {
+        // 12 hour clock, 12am is 0 and 12pm is 12
+        time->hour %= 12;
+        if (is_pm)
+            time->hour += 12;
+    }
+
+    // Not every machine has the century register
+    if (century >= 19 && century <= 99)
+        time->year += century * 100;
+    else
+        time->year += 2000;
+}
+
+// Days since 1970-01-01 of a gregorian date
+static uint32_t days_from_civil(uint32_t year, uint32_t month, uint32_t day)
+{
+    year -= month <= 2;
+    uint32_t era = year / 400;
+    uint32_t year_of_era = year - era * 400;
+    uint32_t day_of_year = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    uint32_t day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + day_of_era - 719468;
+}
+
+uint32_t rtc_read_unix_time()
+{
+    rtc_time time;
+    rtc_read_time(&time);
+
+    return days_from_civil(time.year, time.month, time.day) * 86400
+        + time.hour * 3600 + time.minute * 60 + time.second;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <stdint.h>
+
+#define CMOS_ADDRESS 0x70
+#define CMOS_DATA    0x71
+
+// CMOS registers
+#define RTC_SECONDS  0x00
+#define RTC_MINUTES  0x02
+#define RTC_HOURS    0x04
+#define RTC_DAY      0x07
+#define RTC_MONTH    0x08
+#define RTC_YEAR     0x09
+#define RTC_STATUS_A 0x0A
+#define RTC_STATUS_B 0x0B
+#define RTC_CENTURY  0x32
+
+#define RTC_STATUS_A_UPDATE_IN_PROGRESS 0x80
+#define RTC_STATUS_B_24_HOUR 0x02
+#define RTC_STATUS_B_BINARY  0x04
+#define RTC_HOUR_PM          0x80
+
+typedef struct rtc_time {
+    uint8_t second;
+    uint8_t minute;
+    uint8_t hour;
+    uint8_t day;
+    uint8_t month;
+    uint16_t year;
+} rtc_time;
+
+void rtc_read_time(rtc_time* time);
+// Seconds since the unix epoch (UTC), as currently kept by the RTC
+uint32_t rtc_read_unix_time();
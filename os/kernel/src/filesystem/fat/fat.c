@@ -2,22 +2,51 @@
 #include "drivers/harddisk/ata/ata.h"
 #include "drivers/vga/vga.h"
 #include "memory/heap/heap.h"
+#include "sync/mutex.h"
+#include "fat_cache.h"
 
 #define IS_END_OF_CLUSTER_CHAIN(cluster) (cluster >= 0xFFF8 && cluster <= 0xFFFF)
 
+// How deep fat_defrag() goes into subdirectories, each level is a frame on the kernel stack
+#define FAT_DEFRAG_MAX_DEPTH 32
+
 // Global FAT16 filesystem structure
 FAT16_FS fat16_fs;
 
 uint16_t* fat_table; // will be heap allocated later
 FAT16_DirEntry root_dir = {0};
 
+// The FAT, the directories and the clusters are all shared, a whole operation runs under this.
+// Operations wait on the disk, so it's a sleeping lock
+static lock_stats_t fat_lock_stats = LOCK_STATS_INIT("fat");
+static mutex_t fat_lock = MUTEX_INIT_STATS(&fat_lock_stats);
+
+/*
+ * Files grown by a truncate whose new part no data landed on yet. Past valid_length the file reads
+ * as zeros without the disk being touched, and its clusters are only written when data lands on
+ * them. FAT16 has no place to keep the length on the disk, so whatever is still unwritten is zeroed
+ * by fat_fill_unwritten() before the file is closed. A file is found by its start cluster
+ */
+typedef struct fat_unwritten {
+    uint16_t start_cluster;     // 0 for a free slot
+    uint32_t valid_length;      // the bytes at the start of the file that hold real data
+} fat_unwritten_t;
+
+static fat_unwritten_t unwritten_files[FAT_UNWRITTEN_MAX];
+
 // Static cluster operations
 static int fat_read_data_cluster(uint32_t cluster_num, void *buffer);
 static int fat_write_data_cluster(uint32_t cluster_num, const void *buffer);
 static int get_ith_cluster(uint32_t starting_cluster, uint32_t i);
+static int fat_seek_chain(uint32_t start_cluster, uint32_t offset, uint32_t* cluster, uint32_t* cluster_offset);
+static int fat_transfer_chain(uint32_t* cluster, uint32_t* cluster_offset, uint8_t* buffer, uint32_t size,
+    uint8_t** cluster_buffer, bool write);
 
 // FAT operations
 static int fat_find_free();
+static int fat_find_free_from(uint32_t start);
+static int fat_find_free_run(uint32_t start, uint32_t count);
+static int fat_flush_table(uint32_t first_index, uint32_t last_index);
 static void fat_update_chain(int starting_fat, int new_fat_index);
 static void fat_free_chain(int fat_index);
 
@@ -35,6 +64,29 @@ static bool check_file_name(const char *file_name);
 static void get_parent_dir(const char *path, char *parent_dir);
 static void get_base_name(const char *path, char *name);
 
+// Unwritten parts of files
+static fat_unwritten_t* fat_find_unwritten(uint32_t start_cluster);
+static uint32_t fat_valid_length(const FAT16_DirEntry* file);
+static uint32_t fat_chunk_size();
+static int fat_zero_range(const FAT16_DirEntry* file, uint32_t from, uint32_t to);
+static int fat_extend_unwritten(const FAT16_DirEntry* file, uint32_t old_size);
+static int fat_fill_gap(const FAT16_DirEntry* file, uint32_t offset);
+static void fat_mark_written(const FAT16_DirEntry* file, uint32_t end);
+
+// The public functions take the lock and call these, which also call each other
+static int32_t fat_write_unlocked(FAT16_DirEntry* file, FAT16_DirEntry* parent_dir, uint32_t offset, uint32_t size, const void* buffer);
+static int fat_truncate_unlocked(FileData* file, uint32_t size);
+
+// Defragmentation
+static uint32_t fat_count_fragments(uint32_t start_cluster, uint32_t* clusters);
+static void fat_count_file(fat_frag_stats_t* stats, uint32_t start_cluster);
+static void fat_count_free(fat_frag_stats_t* stats);
+static int fat_copy_to_run(uint32_t start_cluster, uint32_t run, uint32_t count);
+static int fat_defrag_file(uint32_t dir_cluster, FAT16_DirEntry* entries, FAT16_DirEntry* entry, fat_moved_fn moved);
+static bool fat_is_dot_entry(const FAT16_DirEntry* entry);
+static int fat_defrag_dir(uint32_t dir_start_cluster, uint32_t parent_start_cluster, fat_frag_stats_t* before,
+    fat_frag_stats_t* after, fat_moved_fn moved, uint32_t depth);
+
 bool fat_init()
 {
     uint8_t boot_sector[512];
@@ -72,6 +124,10 @@ bool fat_init()
         return false;
     memset(fat_table, 0, fat16_fs.bytes_per_sector / sizeof(uint16_t) * fat16_fs.sectors_per_fat);
 
+    // Without the cache every read goes to the disk, which still works
+    if (!fat_cache_init(fat16_fs.bytes_per_sector * fat16_fs.sectors_per_cluster))
+        vga_putstring("Failed to allocate the cluster cache.\n");
+
     // now read the whole fat table into ram
     for(int i = 0; i < fat16_fs.sectors_per_fat; i++)
     {
@@ -115,6 +171,77 @@ static int fat_find_free()
 }
 
 
+// The first free cluster at start or after it, wrapping around to the start of the data clusters
+static int fat_find_free_from(uint32_t start)
+{
+    uint32_t total_fat_entries = (fat16_fs.sectors_per_fat * fat16_fs.bytes_per_sector) / 2;
+
+    // Entries 0 and 1 are reserved
+    if (start < 2 || start >= total_fat_entries)
+        start = 2;
+
+    for (uint32_t i = start; i < total_fat_entries; i++) {
+        if (fat_table[i] == FAT16_FREE_CLUSTER)
+            return i;
+    }
+    for (uint32_t i = 2; i < start; i++) {
+        if (fat_table[i] == FAT16_FREE_CLUSTER)
+            return i;
+    }
+
+    return -1;  // No free cluster found
+}
+
+// The first count free clusters in a row between from and to
+static int fat_scan_free_run(uint32_t from, uint32_t to, uint32_t count)
+{
+    uint32_t length = 0;
+    for (uint32_t i = from; i < to; i++) {
+        length = fat_table[i] == FAT16_FREE_CLUSTER ? length + 1 : 0;
+        if (length == count)
+            return i - count + 1;
+    }
+    return -1;
+}
+
+// The first count free clusters in a row from start on, wrapping around like fat_find_free_from().
+// -1 if no run is that long
+static int fat_find_free_run(uint32_t start, uint32_t count)
+{
+    uint32_t total_fat_entries = (fat16_fs.sectors_per_fat * fat16_fs.bytes_per_sector) / 2;
+
+    if (start < 2 || start >= total_fat_entries)
+        start = 2;
+
+    int run = fat_scan_free_run(start, total_fat_entries, count);
+    if (run == -1) {
+        // A run crossing start was only seen in part by the first scan
+        uint32_t end = start + count - 1 < total_fat_entries ? start + count - 1 : total_fat_entries;
+        run = fat_scan_free_run(2, end, count);
+    }
+    return run;
+}
+
+// Writes the FAT sectors holding the entries from first_index to last_index, as few commands as the drive takes
+static int fat_flush_table(uint32_t first_index, uint32_t last_index)
+{
+    uint32_t entries_per_sector = fat16_fs.bytes_per_sector / 2;
+    uint32_t sector = first_index / entries_per_sector;
+    uint32_t last_sector = last_index / entries_per_sector;
+
+    while (sector <= last_sector)
+    {
+        uint32_t count = last_sector - sector + 1;
+        if (count > ATA_MAX_SECTORS)
+            count = ATA_MAX_SECTORS;
+
+        if (ata_write(fat16_fs.reserved_sectors + sector, count, &fat_table[sector * entries_per_sector]))
+            return -1;
+        sector += count;
+    }
+    return 0;
+}
+
 static void fat_update_chain(int starting_fat, int new_fat_index)
 {
     uint8_t* buffer = (uint8_t*)kmalloc(fat16_fs.bytes_per_sector * fat16_fs.sectors_per_cluster);
@@ -184,13 +311,188 @@ static void fat_free_chain(int fat_index)
 
 static int fat_read_data_cluster(uint32_t cluster_num, void *buffer)
 {
-    return ata_read(cluster_num * fat16_fs.sectors_per_cluster + fat16_fs.root_dir_start, fat16_fs.sectors_per_cluster, buffer);
+    if (fat_cache_read(cluster_num, buffer))
+        return 0;
+
+    if (ata_read(cluster_num * fat16_fs.sectors_per_cluster + fat16_fs.root_dir_start, fat16_fs.sectors_per_cluster, buffer))
+        return 1;
+    fat_cache_store(cluster_num, buffer);
+    return 0;
 }
 
 
 static int fat_write_data_cluster(uint32_t cluster_num, const void *buffer)
 {
-    return ata_write(cluster_num * fat16_fs.sectors_per_cluster + fat16_fs.root_dir_start, fat16_fs.sectors_per_cluster, buffer);
+    if (ata_write(cluster_num * fat16_fs.sectors_per_cluster + fat16_fs.root_dir_start, fat16_fs.sectors_per_cluster, buffer))
+        return 1;
+    fat_cache_update(cluster_num, buffer);
+    return 0;
+}
+
+// Loads count clusters of a chain from cluster on into the cache, the ones not cached yet that
+// follow each other on the disk with a single command. Best effort, a failure only means a miss later
+static void fat_read_ahead(uint32_t cluster, uint32_t count)
+{
+    uint32_t bytes_per_cluster = fat16_fs.bytes_per_sector * fat16_fs.sectors_per_cluster;
+    uint32_t max_run = ATA_MAX_SECTORS / fat16_fs.sectors_per_cluster;
+    if (max_run > count)
+        max_run = count;
+
+    uint8_t* buffer = (uint8_t*)kmalloc(max_run * bytes_per_cluster);
+    if (buffer == NULL)
+        return;
+
+    uint32_t i = 0;
+    while (i < count && cluster >= 2 && !IS_END_OF_CLUSTER_CHAIN(cluster) && cluster != FAT16_BAD_CLUSTER)
+    {
+        if (fat_cache_contains(cluster))
+        {
+            cluster = fat_table[cluster];
+            i++;
+            continue;
+        }
+
+        uint32_t run = 1;
+        uint32_t last = cluster;
+        while (run < max_run && i + run < count && fat_table[last] == last + 1 && !fat_cache_contains(last + 1))
+        {
+            last++;
+            run++;
+        }
+
+        if (ata_read(cluster * fat16_fs.sectors_per_cluster + fat16_fs.root_dir_start,
+            run * fat16_fs.sectors_per_cluster, buffer))
+        {
+            break;
+        }
+        for (uint32_t j = 0; j < run; j++)
+        {
+            fat_cache_store(cluster + j, buffer + j * bytes_per_cluster);
+        }
+
+        cluster = fat_table[last];
+        i += run;
+    }
+
+    kfree(buffer);
+}
+
+// Finds where offset falls in the chain. A position at the end of a cluster stays on it, so the
+// chain doesn't need the cluster after it until something is moved there
+static int fat_seek_chain(uint32_t start_cluster, uint32_t offset, uint32_t* cluster, uint32_t* cluster_offset)
+{
+    uint32_t bytes_per_cluster = fat16_fs.bytes_per_sector * fat16_fs.sectors_per_cluster;
+    uint32_t cluster_index = offset / bytes_per_cluster;
+    *cluster_offset = offset % bytes_per_cluster;
+    if (cluster_index > 0 && *cluster_offset == 0)
+    {
+        cluster_index--;
+        *cluster_offset = bytes_per_cluster;
+    }
+
+    *cluster = start_cluster;
+    for (uint32_t i = 0; i < cluster_index; i++)
+    {
+        if (IS_END_OF_CLUSTER_CHAIN(fat_table[*cluster]) || fat_table[*cluster] == FAT16_FREE_CLUSTER)
+            return -1;
+        *cluster = fat_table[*cluster];
+    }
+    return 0;
+}
+
+/*
+ * Moves size bytes between the buffer and the chain from *cluster at *cluster_offset on, and
+ * leaves the position after them. Whole clusters go straight between the disk and the buffer, the
+ * ones that follow each other on the disk by a single multi-sector command, and a cached one is
+ * copied from the cache. Only a part of a cluster goes through *cluster_buffer, which is allocated
+ * the first time it's needed and freed by the caller.
+ */
+static int fat_transfer_chain(uint32_t* cluster, uint32_t* cluster_offset, uint8_t* buffer, uint32_t size,
+    uint8_t** cluster_buffer, bool write)
+{
+    uint32_t bytes_per_cluster = fat16_fs.bytes_per_sector * fat16_fs.sectors_per_cluster;
+    uint32_t max_run = ATA_MAX_SECTORS / fat16_fs.sectors_per_cluster;
+    uint32_t done = 0;
+
+    while (done < size)
+    {
+        // Step onto the next cluster once this one is used up
+        if (*cluster_offset == bytes_per_cluster)
+        {
+            uint32_t next = fat_table[*cluster];
+            if (IS_END_OF_CLUSTER_CHAIN(next) || next == FAT16_FREE_CLUSTER)
+                return -1;
+            *cluster = next;
+            *cluster_offset = 0;
+        }
+
+        uint32_t remaining = size - done;
+        if (!write && *cluster_offset == 0 && remaining >= bytes_per_cluster && fat_cache_read(*cluster, buffer + done))
+        {
+            done += bytes_per_cluster;
+            *cluster_offset = bytes_per_cluster;
+            continue;
+        }
+
+        // A cached cluster is read from memory instead, the run stops before it
+        if (*cluster_offset == 0 && remaining >= bytes_per_cluster && (write || !fat_cache_contains(*cluster)))
+        {
+            uint32_t run = 1;
+            uint32_t last = *cluster;
+            while (run < max_run && remaining >= (run + 1) * bytes_per_cluster && fat_table[last] == last + 1
+                && (write || !fat_cache_contains(last + 1)))
+            {
+                last++;
+                run++;
+            }
+
+            uint32_t sector = *cluster * fat16_fs.sectors_per_cluster + fat16_fs.root_dir_start;
+            uint32_t sector_count = run * fat16_fs.sectors_per_cluster;
+            int r = write ? ata_write(sector, sector_count, buffer + done) : ata_read(sector, sector_count, buffer + done);
+            if (r)
+                return -1;
+            if (write)
+            {
+                for (uint32_t i = 0; i < run; i++)
+                {
+                    fat_cache_update(*cluster + i, buffer + done + i * bytes_per_cluster);
+                }
+            }
+
+            done += run * bytes_per_cluster;
+            *cluster = last;
+            *cluster_offset = bytes_per_cluster;
+            continue;
+        }
+
+        uint32_t chunk = bytes_per_cluster - *cluster_offset;
+        if (chunk > remaining)
+            chunk = remaining;
+
+        if (*cluster_buffer == NULL)
+        {
+            *cluster_buffer = (uint8_t*)kmalloc(bytes_per_cluster);
+            if (*cluster_buffer == NULL)
+                return -1;
+        }
+
+        if (fat_read_data_cluster(*cluster, *cluster_buffer))
+            return -1;
+        if (write)
+        {
+            memcpy(*cluster_buffer + *cluster_offset, buffer + done, chunk);
+            if (fat_write_data_cluster(*cluster, *cluster_buffer))
+                return -1;
+        }
+        else
+        {
+            memcpy(buffer + done, *cluster_buffer + *cluster_offset, chunk);
+        }
+
+        done += chunk;
+        *cluster_offset += chunk;
+    }
+    return 0;
 }
 
 static int get_ith_cluster(uint32_t starting_cluster, uint32_t i)
@@ -380,19 +682,58 @@ static bool fat_remove_dir_entry(const char *name, const FAT16_DirEntry *current
     return false;
 }
 
+// Appends the clusters to the chain in one pass: the end of the chain is found once, the clusters
+// are a single run of free ones if the volume has one that long, the first after the end of the
+// chain, otherwise they are taken one by one going forward from it. Each touched FAT sector is
+// written once at the end. The new clusters aren't cleared, whoever grows
+// the file writes them or leaves them unwritten
 static bool fat_allocate_space(uint32_t amount_of_clusters, const FAT16_DirEntry *entry)
 {
-    for (int i = 0; i < amount_of_clusters; i++)
+    uint32_t total_fat_entries = (fat16_fs.sectors_per_fat * fat16_fs.bytes_per_sector) / 2;
+    bool result = true;
+
+    if (amount_of_clusters == 0)
+        return true;
+
+    uint32_t tail = entry->start_cluster;
+    while (!IS_END_OF_CLUSTER_CHAIN(fat_table[tail]) && fat_table[tail] != FAT16_FREE_CLUSTER)
     {
-        int index = fat_find_free();
+        tail = fat_table[tail];
+        if (tail >= total_fat_entries)
+        {
+            // Prevent infinite loops if the FAT chain is corrupted
+            vga_printf("Corrupted FAT chain detected!\n");
+            return false;
+        }
+    }
 
+    int run = fat_find_free_run(tail + 1, amount_of_clusters);
+
+    uint32_t first_dirty = tail;
+    uint32_t last_dirty = tail;
+    for (uint32_t i = 0; i < amount_of_clusters; i++)
+    {
+        int index = run != -1 ? run + (int)i : fat_find_free_from(tail + 1);
         if (index == -1)
-            return false;
+        {
+            result = false;
+            break;
+        }
 
-        fat_update_chain(entry->start_cluster, index);
+        fat_table[tail] = index;
+        fat_table[index] = FAT16_CLUSTER_CHAIN_END;
+        if (index < first_dirty)
+            first_dirty = index;
+        if (index > last_dirty)
+            last_dirty = index;
+        tail = index;
     }
 
-    return true;
+    // What was linked stays linked even on failure, so the table on the disk matches the memory
+    if (fat_flush_table(first_dirty, last_dirty))
+        result = false;
+
+    return result;
 }
 
 static uint32_t fat_get_cluster_amount(const FAT16_DirEntry *entry)
@@ -649,6 +990,11 @@ static uint32_t fat_delete(const char *path, bool is_directory)
     if (err)
         return err;
 
+    // The chain goes back to the free clusters, another file may start where this one did
+    fat_unwritten_t* unwritten = fat_find_unwritten(dir.start_cluster);
+    if (unwritten != NULL)
+        unwritten->start_cluster = 0;
+
     fat_remove_dir_entry(dir_name, &parent_dir, true);
 
     parent_dir.file_size--;
@@ -659,15 +1005,21 @@ static uint32_t fat_delete(const char *path, bool is_directory)
 
 uint32_t fat_create_file(const char *path)
 {
-    fat_create(path, false);
+    mutex_lock(&fat_lock);
+    uint32_t r = fat_create(path, false);
+    mutex_unlock(&fat_lock);
+    return r;
 }
 
 uint32_t fat_create_directory(const char *path)
 {
-    fat_create(path, true);
+    mutex_lock(&fat_lock);
+    uint32_t r = fat_create(path, true);
+    mutex_unlock(&fat_lock);
+    return r;
 }
 
-uint32_t fat_rename(const char *path, const char *new_name)
+static uint32_t fat_rename_unlocked(const char *path, const char *new_name)
 {
     FAT16_DirEntry file;
     FAT16_DirEntry parent_dir;
@@ -707,7 +1059,7 @@ uint32_t fat_rename(const char *path, const char *new_name)
     return SUCCESS;
 }
 
-int fat_get_file_data(const char *path, FileData *fileData)
+static int fat_get_file_data_unlocked(const char *path, FileData *fileData)
 {
     FAT16_DirEntry file;
     FileData data = {0};  // Initialize all to zero first
@@ -733,7 +1085,7 @@ int fat_get_file_data(const char *path, FileData *fileData)
     return 0;
 }
 
-int fat_get_dir_data(const char *path, FileData *fileData)
+static int fat_get_dir_data_unlocked(const char *path, FileData *fileData)
 {
     FAT16_DirEntry dir;
     FileData data = {0};  // Initialize all to zero first
@@ -762,17 +1114,218 @@ int fat_get_dir_data(const char *path, FileData *fileData)
 
 uint32_t fat_delete_file(const char *path)
 {
-    return fat_delete(path, false);
+    mutex_lock(&fat_lock);
+    uint32_t r = fat_delete(path, false);
+    mutex_unlock(&fat_lock);
+    return r;
 }
 
 uint32_t fat_delete_dir(const char *path)
 {
-    return fat_delete(path, true);
+    mutex_lock(&fat_lock);
+    uint32_t r = fat_delete(path, true);
+    mutex_unlock(&fat_lock);
+    return r;
+}
+
+static fat_unwritten_t* fat_find_unwritten(uint32_t start_cluster)
+{
+    for (uint32_t i = 0; i < FAT_UNWRITTEN_MAX; i++)
+    {
+        if (unwritten_files[i].start_cluster == start_cluster)
+            return &unwritten_files[i];
+    }
+    return NULL;
+}
+
+// The part of the file that is read from the disk, the rest of it reads as zeros
+static uint32_t fat_valid_length(const FAT16_DirEntry* file)
+{
+    fat_unwritten_t* unwritten = fat_find_unwritten(file->start_cluster);
+    return unwritten != NULL ? unwritten->valid_length : file->file_size;
+}
+
+// As many whole clusters as a single command moves, up to FAT_COPY_CHUNK_MAX
+static uint32_t fat_chunk_size()
+{
+    uint32_t bytes_per_cluster = fat16_fs.bytes_per_sector * fat16_fs.sectors_per_cluster;
+    uint32_t chunk_size = (ATA_MAX_SECTORS / fat16_fs.sectors_per_cluster) * bytes_per_cluster;
+    if (chunk_size > FAT_COPY_CHUNK_MAX)
+        chunk_size = FAT_COPY_CHUNK_MAX / bytes_per_cluster * bytes_per_cluster;
+    if (chunk_size < bytes_per_cluster)
+        chunk_size = bytes_per_cluster;
+    return chunk_size;
+}
+
+// Writes zeros over the range of the file, a run of clusters at a time from one zeroed chunk
+static int fat_zero_range(const FAT16_DirEntry* file, uint32_t from, uint32_t to)
+{
+    if (from >= to)
+        return 0;
+
+    uint32_t chunk_size = fat_chunk_size();
+    if (chunk_size > to - from)
+        chunk_size = to - from;
+
+    uint8_t* zeros = (uint8_t*)kmalloc(chunk_size);
+    if (zeros == NULL)
+        return -1;
+    memset(zeros, 0, chunk_size);
+
+    uint8_t* cluster_buffer = NULL;
+    uint32_t cluster, cluster_offset;
+    int r = fat_seek_chain(file->start_cluster, from, &cluster, &cluster_offset);
+    while (r == 0 && from < to)
+    {
+        uint32_t chunk = to - from < chunk_size ? to - from : chunk_size;
+        r = fat_transfer_chain(&cluster, &cluster_offset, zeros, chunk, &cluster_buffer, true);
+        from += chunk;
+    }
+
+    kfree(cluster_buffer);
+    kfree(zeros);
+    return r;
 }
 
-// Read data from a file
-// Returns number of bytes read, or negative value on error
-int32_t fat_read(FAT16_DirEntry* file, uint32_t offset, uint32_t size, void* buffer) {
+// The file grew from old_size, the new part is left unwritten. Without a free slot it's zeroed now
+static int fat_extend_unwritten(const FAT16_DirEntry* file, uint32_t old_size)
+{
+    // Already tracked, its valid length is at most the old size
+    if (fat_find_unwritten(file->start_cluster) != NULL)
+        return 0;
+
+    fat_unwritten_t* slot = fat_find_unwritten(0);
+    if (slot == NULL)
+        return fat_zero_range(file, old_size, file->file_size);
+
+    slot->start_cluster = file->start_cluster;
+    slot->valid_length = old_size;
+    return 0;
+}
+
+// Before data is written at offset, the unwritten part between the valid one and it is zeroed
+static int fat_fill_gap(const FAT16_DirEntry* file, uint32_t offset)
+{
+    fat_unwritten_t* unwritten = fat_find_unwritten(file->start_cluster);
+    if (unwritten == NULL || offset <= unwritten->valid_length)
+        return 0;
+
+    if (fat_zero_range(file, unwritten->valid_length, offset))
+        return -1;
+    unwritten->valid_length = offset;
+    return 0;
+}
+
+// After data was written up to end, which started inside the valid part thanks to fat_fill_gap()
+static void fat_mark_written(const FAT16_DirEntry* file, uint32_t end)
+{
+    fat_unwritten_t* unwritten = fat_find_unwritten(file->start_cluster);
+    if (unwritten == NULL)
+        return;
+
+    if (end > unwritten->valid_length)
+        unwritten->valid_length = end;
+    if (unwritten->valid_length >= file->file_size)
+        unwritten->start_cluster = 0;
+}
+
+// Where a scatter/gather I/O is in its buffers
+typedef struct iov_cursor {
+    const struct iovec* iov;
+    uint32_t index;
+    uint32_t offset;
+} iov_cursor_t;
+
+static uint32_t iov_total_length(const struct iovec* iov, uint32_t iovcnt)
+{
+    uint32_t total = 0;
+    for (uint32_t i = 0; i < iovcnt; i++)
+        total += iov[i].iov_len;
+    return total;
+}
+
+// Gathers len bytes from the buffers
+static void iov_copy_in(iov_cursor_t* cursor, uint8_t* dst, uint32_t len)
+{
+    while (len > 0)
+    {
+        const struct iovec* segment = &cursor->iov[cursor->index];
+        uint32_t chunk = segment->iov_len - cursor->offset;
+        if (chunk > len)
+            chunk = len;
+
+        memcpy(dst, (const uint8_t*)segment->iov_base + cursor->offset, chunk);
+        dst += chunk;
+        len -= chunk;
+        cursor->offset += chunk;
+        if (cursor->offset == segment->iov_len)
+        {
+            cursor->index++;
+            cursor->offset = 0;
+        }
+    }
+}
+
+/*
+ * Called after every read of an open file. A read that starts where the last one ended is
+ * sequential, it opens a window of clusters to load ahead of the reads. Once the reads get
+ * within half a window of what was loaded, the window doubles and the clusters past what was
+ * loaded are read ahead in as few commands as they take, so the next reads come from the cache.
+ * Any other read closes the window. last_cluster is the cluster the read ended in.
+ */
+static void fat_update_readahead(FAT16_DirEntry* file, uint32_t offset, uint32_t bytes_read, uint32_t last_cluster,
+    fat_readahead_t* ra)
+{
+    uint32_t bytes_per_cluster = fat16_fs.bytes_per_sector * fat16_fs.sectors_per_cluster;
+    uint32_t max_window = fat_cache_slots() / 2;
+    if (max_window > FAT_READAHEAD_MAX)
+        max_window = FAT_READAHEAD_MAX;
+
+    if (offset != ra->next_offset || max_window == 0)
+    {
+        ra->window = 0;
+        ra->ahead_until = 0;
+    }
+    else if (ra->window == 0)
+    {
+        ra->window = FAT_READAHEAD_MIN < max_window ? FAT_READAHEAD_MIN : max_window;
+    }
+    ra->next_offset = offset + bytes_read;
+
+    if (ra->window == 0 || bytes_read == 0)
+        return;
+
+    uint32_t last_index = (offset + bytes_read - 1) / bytes_per_cluster;
+    uint32_t file_clusters = (file->file_size + bytes_per_cluster - 1) / bytes_per_cluster;
+    if (last_index + 1 + ra->window / 2 < ra->ahead_until)
+        return;
+
+    uint32_t start = ra->ahead_until > last_index + 1 ? ra->ahead_until : last_index + 1;
+    uint32_t end = last_index + 1 + ra->window;
+    if (end > file_clusters)
+        end = file_clusters;
+
+    if (start < end)
+    {
+        // The chain is walked on from where the read ended, not from the start of the file
+        uint32_t cluster = last_cluster;
+        for (uint32_t i = last_index; i < start && !IS_END_OF_CLUSTER_CHAIN(cluster) && cluster != FAT16_FREE_CLUSTER; i++)
+        {
+            cluster = fat_table[cluster];
+        }
+        fat_read_ahead(cluster, end - start);
+    }
+
+    ra->ahead_until = end;
+    ra->window = ra->window * 2 < max_window ? ra->window * 2 : max_window;
+}
+
+// Read data from a file into the buffers one after the other, the cluster chain is walked once
+// for all of them. Whole clusters are read straight into the buffers, only the parts of clusters
+// at the edges of a buffer go through a bounce buffer, and an unwritten part is zeroed without
+// the disk. Returns number of bytes read, or negative value on error
+static int32_t fat_readv_unlocked(FAT16_DirEntry* file, uint32_t offset, const struct iovec* iov, uint32_t iovcnt,
+    fat_readahead_t* ra) {
     // Check if file is actually a directory
     if (file->attr & FAT_ATTR_DIRECTORY) {
         return -1;
@@ -784,66 +1337,60 @@ int32_t fat_read(FAT16_DirEntry* file, uint32_t offset, uint32_t size, void* buf
     }
 
     // Adjust size if it would read past end of file
-    if (offset + size > file->file_size) {
+    uint32_t size = iov_total_length(iov, iovcnt);
+    if (size > file->file_size - offset) {
         size = file->file_size - offset;
     }
 
-    // Calculate starting cluster and offset within cluster
-    uint32_t bytes_per_cluster = fat16_fs.bytes_per_sector * fat16_fs.sectors_per_cluster;
-    uint32_t start_cluster_index = offset / bytes_per_cluster;
-    uint32_t cluster_offset = offset % bytes_per_cluster;
-
-    // Find the starting cluster by traversing the chain
-    uint32_t current_cluster = file->start_cluster;
-    for (uint32_t i = 0; i < start_cluster_index; i++) {
-        if (current_cluster >= FAT16_CLUSTER_CHAIN_END || current_cluster == 0) {
-            return -1; // Reached end of chain prematurely
-        }
-        current_cluster = fat_table[current_cluster];
+    // Only the valid part comes from the disk
+    uint32_t valid_length = fat_valid_length(file);
+    uint32_t disk_size = offset < valid_length ? valid_length - offset : 0;
+    if (disk_size > size) {
+        disk_size = size;
     }
 
-    uint32_t bytes_read = 0;
-    uint8_t* buf_ptr = (uint8_t*)buffer;
-    uint8_t* cluster_buffer = (uint8_t*)kmalloc(fat16_fs.bytes_per_sector * fat16_fs.sectors_per_cluster);
-    if (cluster_buffer == NULL)
-        return GENERAL_ERROR;
-    memset(cluster_buffer, 0, fat16_fs.bytes_per_sector * fat16_fs.sectors_per_cluster);
-
-    while (bytes_read < size && current_cluster < FAT16_CLUSTER_CHAIN_END && current_cluster != 0) {
-        // Read entire cluster
-        if (fat_read_data_cluster(current_cluster, cluster_buffer)) {
-            kfree(cluster_buffer);
-            return -1;
-        }
+    // Find the starting cluster by traversing the chain, once for all the buffers
+    uint32_t current_cluster, cluster_offset;
+    if (fat_seek_chain(file->start_cluster, offset, &current_cluster, &cluster_offset)) {
+        return -1; // Reached end of chain prematurely
+    }
 
-        // Calculate how many bytes to copy from this cluster
-        uint32_t bytes_to_copy = bytes_per_cluster - cluster_offset;
-        if (bytes_to_copy > (size - bytes_read)) {
+    // Each buffer goes on from where the one before it ended
+    uint32_t bytes_read = 0;
+    uint8_t* cluster_buffer = NULL;
+    for (uint32_t i = 0; i < iovcnt && bytes_read < size; i++) {
+        uint32_t bytes_to_copy = iov[i].iov_len;
+        if (bytes_to_copy > size - bytes_read) {
             bytes_to_copy = size - bytes_read;
         }
 
-        // Copy data from cluster to output buffer
-        memcpy(buf_ptr + bytes_read, 
-               cluster_buffer + cluster_offset, 
-               bytes_to_copy);
+        uint32_t from_disk = bytes_read < disk_size ? disk_size - bytes_read : 0;
+        if (from_disk > bytes_to_copy) {
+            from_disk = bytes_to_copy;
+        }
 
-        bytes_read += bytes_to_copy;
-        cluster_offset = 0; // Reset offset for subsequent clusters
-        
-        // Move to next cluster
-        if (bytes_read < size) {
-            current_cluster = fat_table[current_cluster];
+        if (from_disk > 0 && fat_transfer_chain(&current_cluster, &cluster_offset, (uint8_t*)iov[i].iov_base,
+            from_disk, &cluster_buffer, false)) {
+            kfree(cluster_buffer);
+            return -1;
         }
+        memset((uint8_t*)iov[i].iov_base + from_disk, 0, bytes_to_copy - from_disk);
+        bytes_read += bytes_to_copy;
     }
 
     kfree(cluster_buffer);
 
+    // Nothing to read ahead in a part that isn't on the disk
+    if (ra != NULL && disk_size == size)
+        fat_update_readahead(file, offset, bytes_read, current_cluster, ra);
+
     return bytes_read;
 }
 
-// Write data to a file
-// Returns number of bytes written, or negative value on error
-int32_t fat_write(FAT16_DirEntry* file, FAT16_DirEntry* parent_dir, uint32_t offset, uint32_t size, const void* buffer) 
+// Write data from the buffers one after the other to a file, the file is extended and the
+// cluster chain walked once for all of them. Whole clusters are written straight from the buffers,
+// only a part of a cluster is read, patched and written back. Returns number of bytes written, or negative value on error
+static int32_t fat_writev_unlocked(FAT16_DirEntry* file, FAT16_DirEntry* parent_dir, uint32_t offset, const struct iovec* iov, uint32_t iovcnt) 
 {
     // Check if file is actually a directory
     if (file->attr & FAT_ATTR_DIRECTORY) 
@@ -851,9 +1398,7 @@ int32_t fat_write(FAT16_DirEntry* file, FAT16_DirEntry* parent_dir, uint32_t off
         return -1;
     }
 
-    uint32_t bytes_per_cluster = fat16_fs.bytes_per_sector * fat16_fs.sectors_per_cluster;
-    uint32_t start_cluster_index = offset / bytes_per_cluster;
-    uint32_t cluster_offset = offset % bytes_per_cluster;
+    uint32_t size = iov_total_length(iov, iovcnt);
     
     // Ensure the file has enough space
     uint32_t new_size = offset + size;
@@ -862,78 +1407,234 @@ int32_t fat_write(FAT16_DirEntry* file, FAT16_DirEntry* parent_dir, uint32_t off
         FileData fileData;
         memcpy(&fileData.file_entry, file, sizeof(FAT16_DirEntry));
         memcpy(&fileData.parent_entry, parent_dir, sizeof(FAT16_DirEntry));
-        if (fat_truncate(&fileData, new_size) != 0) 
+        if (fat_truncate_unlocked(&fileData, new_size) != 0) 
         {
             return -1;
         }
         memcpy(file, &fileData.file_entry, sizeof(FAT16_DirEntry));
     }
 
-    // Traverse to the starting cluster
-    uint32_t current_cluster = file->start_cluster;
-    for (uint32_t i = 0; i < start_cluster_index; i++) 
+    if (fat_fill_gap(file, offset))
     {
-        if (current_cluster >= FAT16_CLUSTER_CHAIN_END) 
+        return -1;
+    }
+
+    // Traverse to the starting cluster, once for all the buffers
+    uint32_t current_cluster, cluster_offset;
+    if (fat_seek_chain(file->start_cluster, offset, &current_cluster, &cluster_offset)) 
+    {
+        return -1;
+    }
+
+    // Each buffer goes on from where the one before it ended
+    uint32_t bytes_written = 0;
+    uint8_t* cluster_buffer = NULL;
+    for (uint32_t i = 0; i < iovcnt; i++) 
+    {
+        if (fat_transfer_chain(&current_cluster, &cluster_offset, (uint8_t*)iov[i].iov_base, iov[i].iov_len,
+            &cluster_buffer, true)) 
         {
+            kfree(cluster_buffer);
             return -1;
         }
-        current_cluster = fat_table[current_cluster];
+        bytes_written += iov[i].iov_len;
     }
 
-    uint32_t bytes_written = 0;
-    const uint8_t* buf_ptr = (const uint8_t*)buffer;
-    uint8_t* cluster_buffer = (uint8_t*)kmalloc(fat16_fs.bytes_per_sector * fat16_fs.sectors_per_cluster);
-    if (cluster_buffer == NULL)
-        return GENERAL_ERROR;
-    memset(cluster_buffer, 0, fat16_fs.bytes_per_sector * fat16_fs.sectors_per_cluster);
+    kfree(cluster_buffer);
+    fat_mark_written(file, new_size);
+
+    return bytes_written;
+}
+
+// Copies a range of one file into another without leaving the kernel. The destination is
+// extended in one pass before the copy, then the data moves in runs of clusters. An unwritten
+// part of the source is copied as zeros without reading it.
+// Returns number of bytes copied, or negative value on error
+static int32_t fat_copy_range_unlocked(FAT16_DirEntry* src, uint32_t src_offset, FAT16_DirEntry* dst,
+    FAT16_DirEntry* dst_parent, uint32_t dst_offset, uint32_t size)
+{
+    uint32_t bytes_per_cluster = fat16_fs.bytes_per_sector * fat16_fs.sectors_per_cluster;
+
+    if ((src->attr | dst->attr) & FAT_ATTR_DIRECTORY)
+        return -1;
 
-    while (bytes_written < size) 
+    // Copying past end of file copies nothing
+    if (src_offset >= src->file_size)
+        return 0;
+    if (size > src->file_size - src_offset)
+        size = src->file_size - src_offset;
+    if (size == 0)
+        return 0;
+
+    uint32_t src_valid_length = fat_valid_length(src);
+    uint32_t src_disk_size = src_offset < src_valid_length ? src_valid_length - src_offset : 0;
+    if (src_disk_size > size)
+        src_disk_size = size;
+
+    uint32_t new_size = dst_offset + size;
+    if (new_size > dst->file_size)
     {
-        // Read existing cluster data if we're not writing a complete cluster
-        if (cluster_offset > 0 || (size - bytes_written) < bytes_per_cluster) 
+        uint32_t old_size = dst->file_size;
+        uint32_t new_cluster_amount = new_size / bytes_per_cluster + 1;
+        uint32_t curr_cluster_amount = fat_get_cluster_amount(dst);
+
+        if (new_cluster_amount > curr_cluster_amount
+            && !fat_allocate_space(new_cluster_amount - curr_cluster_amount, dst))
         {
-            if (fat_read_data_cluster(current_cluster, cluster_buffer)) 
-            {
-                kfree(cluster_buffer);
-                return -1;
-            }
+            return -1;
         }
 
-        // Calculate how many bytes to write to this cluster
-        uint32_t bytes_to_write = bytes_per_cluster - cluster_offset;
-        if (bytes_to_write > (size - bytes_written)) 
+        dst->file_size = new_size;
+        if (!fat_update_dir_entry(dst->name, dst_parent, dst))
+            return -1;
+
+        // The copy overwrites the new part, only a gap before where it starts is zeroed below
+        if (fat_extend_unwritten(dst, old_size))
+            return -1;
+    }
+
+    if (fat_fill_gap(dst, dst_offset))
+        return -1;
+
+    uint32_t chunk_size = fat_chunk_size();
+    uint8_t* chunk_buffer = (uint8_t*)kmalloc(chunk_size);
+    uint8_t* cluster_buffer = NULL;
+    if (chunk_buffer == NULL)
+        return GENERAL_ERROR;
+
+    uint32_t src_cluster, src_cluster_offset, dst_cluster, dst_cluster_offset;
+    int32_t result = size;
+    if (fat_seek_chain(src->start_cluster, src_offset, &src_cluster, &src_cluster_offset)
+        || fat_seek_chain(dst->start_cluster, dst_offset, &dst_cluster, &dst_cluster_offset))
+    {
+        result = -1;
+    }
+
+    uint32_t copied = 0;
+    while (result >= 0 && copied < size)
+    {
+        uint32_t chunk = size - copied;
+        if (chunk > chunk_size)
+            chunk = chunk_size;
+
+        uint32_t from_disk = copied < src_disk_size ? src_disk_size - copied : 0;
+        if (from_disk > chunk)
+            from_disk = chunk;
+
+        if (from_disk > 0
+            && fat_transfer_chain(&src_cluster, &src_cluster_offset, chunk_buffer, from_disk, &cluster_buffer, false))
         {
-            bytes_to_write = size - bytes_written;
+            result = -1;
+            break;
         }
+        memset(chunk_buffer + from_disk, 0, chunk - from_disk);
 
-        // Copy data from input buffer to cluster buffer
-        memcpy(cluster_buffer + cluster_offset,
-               buf_ptr + bytes_written,
-               bytes_to_write);
-
-        // Write cluster back to disk
-        if (fat_write_data_cluster(current_cluster, cluster_buffer)) 
+        if (fat_transfer_chain(&dst_cluster, &dst_cluster_offset, chunk_buffer, chunk, &cluster_buffer, true))
         {
-            kfree(cluster_buffer);
-            return -1;
+            result = -1;
+            break;
         }
+        copied += chunk;
+    }
+
+    kfree(chunk_buffer);
+    kfree(cluster_buffer);
+    if (result >= 0)
+        fat_mark_written(dst, new_size);
+    return result;
+}
+
+// Writes what wb holds back after the end of the file. The clusters for it are only allocated now,
+// in one pass, then it's written a run of clusters at a time
+static int fat_flush_unlocked(FileData* file, fat_write_buffer_t* wb)
+{
+    uint32_t bytes_per_cluster = fat16_fs.bytes_per_sector * fat16_fs.sectors_per_cluster;
+
+    if (wb->length == 0)
+        return 0;
+
+    uint32_t disk_size = file->file_entry.file_size;
+    uint32_t new_size = disk_size + wb->length;
+    uint32_t new_cluster_amount = new_size / bytes_per_cluster + 1;
+    uint32_t curr_cluster_amount = fat_get_cluster_amount(&file->file_entry);
+
+    // Nothing reads the new clusters before the data lands on them, so they aren't zeroed
+    if (new_cluster_amount > curr_cluster_amount
+        && !fat_allocate_space(new_cluster_amount - curr_cluster_amount, &file->file_entry))
+    {
+        return CANT_ALLOCATE_SPACE;
+    }
+
+    // A part a truncate left unwritten before the held back data must read as zeros from now on
+    if (fat_fill_gap(&file->file_entry, disk_size))
+        return GENERAL_ERROR;
 
-        bytes_written += bytes_to_write;
-        cluster_offset = 0; // Reset offset for subsequent clusters
+    uint8_t* cluster_buffer = NULL;
 
-        // Move to next cluster
-        if (bytes_written < size) 
+    // The data goes first and the size after it, so the file never ends in clusters never written
+    uint32_t cluster, cluster_offset;
+    int r = fat_seek_chain(file->file_entry.start_cluster, disk_size, &cluster, &cluster_offset);
+    if (r == 0)
+        r = fat_transfer_chain(&cluster, &cluster_offset, wb->data, wb->length, &cluster_buffer, true);
+    kfree(cluster_buffer);
+    if (r != 0)
+        return GENERAL_ERROR;
+
+    // The data is on the disk even if the entry can't be updated, it isn't held back anymore
+    file->file_entry.file_size = new_size;
+    fat_mark_written(&file->file_entry, new_size);
+    wb->length = 0;
+    if (!fat_update_dir_entry(file->file_entry.name, &file->parent_entry, &file->file_entry))
+        return GENERAL_ERROR;
+    return 0;
+}
+
+/*
+ * An append right after what is held back is copied into the buffer, and only when it's full is
+ * it written out. Small appends add up to whole clusters that way, instead of rewriting the last
+ * cluster of the file each time. Anything else flushes the buffer and is written to the disk.
+ */
+static int32_t fat_write_buffered_unlocked(FileData* file, fat_write_buffer_t* wb, uint32_t offset,
+    const struct iovec* iov, uint32_t iovcnt)
+{
+    uint32_t size = iov_total_length(iov, iovcnt);
+    bool append = offset == file->file_entry.file_size + wb->length;
+
+    if (append && size <= FAT_WRITEBACK_MAX && !(file->file_entry.attr & FAT_ATTR_DIRECTORY))
+    {
+        if (wb->data == NULL)
+            wb->data = (uint8_t*)kmalloc(FAT_WRITEBACK_MAX);
+
+        if (wb->data != NULL)
         {
-            current_cluster = fat_table[current_cluster];
+            int r = wb->length + size > FAT_WRITEBACK_MAX ? fat_flush_unlocked(file, wb) : 0;
+            if (r != 0)
+                return r;
+
+            iov_cursor_t cursor = { .iov = iov };
+            iov_copy_in(&cursor, wb->data + wb->length, size);
+            wb->length += size;
+
+            // Already in the buffer, a failure shows up at the next write or flush
+            if (wb->length == FAT_WRITEBACK_MAX)
+                fat_flush_unlocked(file, wb);
+            return size;
         }
     }
 
-    kfree(cluster_buffer);
+    int r = fat_flush_unlocked(file, wb);
+    if (r != 0)
+        return r;
+    return fat_writev_unlocked(&file->file_entry, &file->parent_entry, offset, iov, iovcnt);
+}
 
-    return bytes_written;
+static int32_t fat_write_unlocked(FAT16_DirEntry* file, FAT16_DirEntry* parent_dir, uint32_t offset, uint32_t size, const void* buffer)
+{
+    struct iovec iov = { .iov_base = (void*)buffer, .iov_len = size };
+    return fat_writev_unlocked(file, parent_dir, offset, &iov, 1);
 }
 
-int fat_truncate(FileData* file, uint32_t size)
+static int fat_truncate_unlocked(FileData* file, uint32_t size)
 {
     // Check if file is actually a directory
     if (file->file_entry.attr & FAT_ATTR_DIRECTORY) 
@@ -957,24 +1658,30 @@ int fat_truncate(FileData* file, uint32_t size)
             curr_cluster_amount--;
         }
         fat_table[cluster] = FAT16_CLUSTER_CHAIN_END;
+
+        // What was cut off can't be unwritten anymore
+        fat_unwritten_t* unwritten = fat_find_unwritten(file->file_entry.start_cluster);
+        if (unwritten != NULL && unwritten->valid_length >= size)
+            unwritten->start_cluster = 0;
     }
     else if(size > file->file_entry.file_size)
     {
         // if new size is bigger then the current size, allocate new clusters
         int new_cluster_amount = size / (fat16_fs.bytes_per_sector * fat16_fs.sectors_per_cluster) + 1;
         int curr_cluster_amount = fat_get_cluster_amount(&file->file_entry);
+        uint32_t old_size = file->file_entry.file_size;
 
         if (!fat_allocate_space(new_cluster_amount - curr_cluster_amount, &file->file_entry)) 
         {
             return -1;
         }
-        char* buf = kmalloc(size - file->file_entry.file_size);
-        if (buf == NULL)
-            return -1;
-        memset(buf, 0, size - file->file_entry.file_size);
+
+        // The new part reads as zeros, but isn't written until data lands on it
         file->file_entry.file_size = size;
-        fat_write(&file->file_entry, &file->parent_entry, file->file_entry.file_size, size - file->file_entry.file_size, buf);
-        kfree(buf);
+        if (fat_extend_unwritten(&file->file_entry, old_size))
+        {
+            return -1;
+        }
     }
     else 
     {
@@ -991,7 +1698,19 @@ int fat_truncate(FileData* file, uint32_t size)
     return 0;
 }
 
-int fat_get_dir_entry(FAT16_DirEntry *dir, int n, FAT16_DirEntry *entry)
+static int fat_fill_unwritten_unlocked(FAT16_DirEntry* file)
+{
+    fat_unwritten_t* unwritten = fat_find_unwritten(file->start_cluster);
+    if (unwritten == NULL)
+        return 0;
+
+    if (fat_zero_range(file, unwritten->valid_length, file->file_size))
+        return -1;
+    unwritten->start_cluster = 0;
+    return 0;
+}
+
+static int fat_get_dir_entry_unlocked(FAT16_DirEntry *dir, int n, FAT16_DirEntry *entry)
 {
     int count = 0, cluster_num = dir->start_cluster, i = 0;
     if (n >= dir->file_size)
@@ -1026,4 +1745,356 @@ int fat_get_dir_entry(FAT16_DirEntry *dir, int n, FAT16_DirEntry *entry)
     }
 
     return FILE_NOT_FOUND;
-}   
\ No newline at end of file
+}   
+
+
+uint32_t fat_rename(const char *path, const char *new_name)
+{
+    mutex_lock(&fat_lock);
+    uint32_t r = fat_rename_unlocked(path, new_name);
+    mutex_unlock(&fat_lock);
+    return r;
+}
+
+int fat_get_file_data(const char *path, FileData *fileData)
+{
+    mutex_lock(&fat_lock);
+    int r = fat_get_file_data_unlocked(path, fileData);
+    mutex_unlock(&fat_lock);
+    return r;
+}
+
+int fat_get_dir_data(const char *path, FileData *fileData)
+{
+    mutex_lock(&fat_lock);
+    int r = fat_get_dir_data_unlocked(path, fileData);
+    mutex_unlock(&fat_lock);
+    return r;
+}
+
+int32_t fat_read(FAT16_DirEntry* file, uint32_t offset, uint32_t size, void* buffer)
+{
+    struct iovec iov = { .iov_base = buffer, .iov_len = size };
+    return fat_readv(file, offset, &iov, 1, NULL);
+}
+
+int32_t fat_readv(FAT16_DirEntry* file, uint32_t offset, const struct iovec* iov, uint32_t iovcnt, fat_readahead_t* ra)
+{
+    mutex_lock(&fat_lock);
+    int32_t r = fat_readv_unlocked(file, offset, iov, iovcnt, ra);
+    mutex_unlock(&fat_lock);
+    return r;
+}
+
+int32_t fat_write(FAT16_DirEntry* file, FAT16_DirEntry* parent_dir, uint32_t offset, uint32_t size, const void* buffer)
+{
+    mutex_lock(&fat_lock);
+    int32_t r = fat_write_unlocked(file, parent_dir, offset, size, buffer);
+    mutex_unlock(&fat_lock);
+    return r;
+}
+
+int32_t fat_writev(FAT16_DirEntry* file, FAT16_DirEntry* parent_dir, uint32_t offset, const struct iovec* iov, uint32_t iovcnt)
+{
+    mutex_lock(&fat_lock);
+    int32_t r = fat_writev_unlocked(file, parent_dir, offset, iov, iovcnt);
+    mutex_unlock(&fat_lock);
+    return r;
+}
+
+int32_t fat_copy_range(FAT16_DirEntry* src, uint32_t src_offset, FAT16_DirEntry* dst, FAT16_DirEntry* dst_parent,
+    uint32_t dst_offset, uint32_t size)
+{
+    mutex_lock(&fat_lock);
+    int32_t r = fat_copy_range_unlocked(src, src_offset, dst, dst_parent, dst_offset, size);
+    mutex_unlock(&fat_lock);
+    return r;
+}
+
+int32_t fat_write_buffered(FileData* file, fat_write_buffer_t* wb, uint32_t offset, const struct iovec* iov, uint32_t iovcnt)
+{
+    mutex_lock(&fat_lock);
+    int32_t r = fat_write_buffered_unlocked(file, wb, offset, iov, iovcnt);
+    mutex_unlock(&fat_lock);
+    return r;
+}
+
+int fat_flush(FileData* file, fat_write_buffer_t* wb)
+{
+    mutex_lock(&fat_lock);
+    int r = fat_flush_unlocked(file, wb);
+    mutex_unlock(&fat_lock);
+    return r;
+}
+
+void fat_write_buffer_free(fat_write_buffer_t* wb)
+{
+    kfree(wb->data);
+    wb->data = NULL;
+    wb->length = 0;
+}
+
+int fat_truncate(FileData* file, uint32_t size)
+{
+    mutex_lock(&fat_lock);
+    int r = fat_truncate_unlocked(file, size);
+    mutex_unlock(&fat_lock);
+    return r;
+}
+
+int fat_fill_unwritten(FAT16_DirEntry* file)
+{
+    mutex_lock(&fat_lock);
+    int r = fat_fill_unwritten_unlocked(file);
+    mutex_unlock(&fat_lock);
+    return r;
+}
+
+// Runs of clusters the chain is made of, clusters gets its length
+static uint32_t fat_count_fragments(uint32_t start_cluster, uint32_t* clusters)
+{
+    uint32_t total_fat_entries = (fat16_fs.sectors_per_fat * fat16_fs.bytes_per_sector) / 2;
+    uint32_t fragments = 1;
+    uint32_t count = 1;
+    uint32_t cluster = start_cluster;
+
+    // A corrupted chain that loops stops at the size of the table
+    while (!IS_END_OF_CLUSTER_CHAIN(fat_table[cluster]) && fat_table[cluster] != FAT16_FREE_CLUSTER
+        && count < total_fat_entries)
+    {
+        if (fat_table[cluster] != cluster + 1)
+            fragments++;
+        cluster = fat_table[cluster];
+        count++;
+    }
+
+    *clusters = count;
+    return fragments;
+}
+
+static void fat_count_file(fat_frag_stats_t* stats, uint32_t start_cluster)
+{
+    uint32_t clusters;
+    uint32_t fragments = fat_count_fragments(start_cluster, &clusters);
+
+    stats->files++;
+    stats->clusters += clusters;
+    stats->fragments += fragments;
+    if (fragments > 1)
+        stats->fragmented_files++;
+}
+
+static void fat_count_free(fat_frag_stats_t* stats)
+{
+    uint32_t total_fat_entries = (fat16_fs.sectors_per_fat * fat16_fs.bytes_per_sector) / 2;
+    uint32_t run = 0;
+
+    stats->free_clusters = 0;
+    stats->largest_free_run = 0;
+    for (uint32_t i = 2; i < total_fat_entries; i++)
+    {
+        if (fat_table[i] != FAT16_FREE_CLUSTER)
+        {
+            run = 0;
+            continue;
+        }
+
+        stats->free_clusters++;
+        if (++run > stats->largest_free_run)
+            stats->largest_free_run = run;
+    }
+}
+
+// Copies the chain into the free run and links the run as a chain of its own on the disk. The
+// old chain is left as it is, on failure the run is free again
+static int fat_copy_to_run(uint32_t start_cluster, uint32_t run, uint32_t count)
+{
+    uint32_t bytes_per_cluster = fat16_fs.bytes_per_sector * fat16_fs.sectors_per_cluster;
+
+    // Linked in memory first so fat_transfer_chain() can walk it, it reaches the disk after the data
+    for (uint32_t i = 0; i < count; i++)
+    {
+        fat_table[run + i] = i + 1 < count ? run + i + 1 : FAT16_CLUSTER_CHAIN_END;
+    }
+
+    uint32_t chunk_size = fat_chunk_size();
+    uint8_t* chunk_buffer = (uint8_t*)kmalloc(chunk_size);
+    uint8_t* cluster_buffer = NULL;
+    int r = chunk_buffer == NULL ? -1 : 0;
+
+    uint32_t src_cluster = start_cluster, src_offset = 0;
+    uint32_t dst_cluster = run, dst_offset = 0;
+    uint32_t size = count * bytes_per_cluster;
+    for (uint32_t copied = 0; r == 0 && copied < size; copied += chunk_size)
+    {
+        uint32_t chunk = size - copied < chunk_size ? size - copied : chunk_size;
+        if (fat_transfer_chain(&src_cluster, &src_offset, chunk_buffer, chunk, &cluster_buffer, false)
+            || fat_transfer_chain(&dst_cluster, &dst_offset, chunk_buffer, chunk, &cluster_buffer, true))
+        {
+            r = -1;
+        }
+    }
+
+    kfree(chunk_buffer);
+    kfree(cluster_buffer);
+
+    if (r == 0 && fat_flush_table(run, run + count - 1) == 0)
+        return 0;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        fat_table[run + i] = FAT16_FREE_CLUSTER;
+    }
+    fat_flush_table(run, run + count - 1);
+    return -1;
+}
+
+// Moves a fragmented file into the lowest run of free clusters that fits it. Its entry is one of
+// entries, the directory cluster dir_cluster read into memory, which is written back with it
+static int fat_defrag_file(uint32_t dir_cluster, FAT16_DirEntry* entries, FAT16_DirEntry* entry, fat_moved_fn moved)
+{
+    uint32_t clusters;
+    if (fat_count_fragments(entry->start_cluster, &clusters) == 1)
+        return 0;
+
+    // Nowhere to put it in one piece, it stays as it is
+    int run = fat_find_free_run(2, clusters);
+    if (run == -1)
+        return 0;
+
+    uint32_t old_start = entry->start_cluster;
+    if (fat_copy_to_run(old_start, run, clusters))
+        return -1;
+
+    entry->start_cluster = run;
+    if (fat_write_data_cluster(dir_cluster, entries))
+    {
+        entry->start_cluster = old_start;
+        for (uint32_t i = 0; i < clusters; i++)
+        {
+            fat_table[run + i] = FAT16_FREE_CLUSTER;
+        }
+        fat_flush_table(run, run + clusters - 1);
+        return -1;
+    }
+
+    // Nothing points at the old chain anymore, all of it is freed with one pass over the table
+    uint32_t first_dirty = old_start;
+    uint32_t last_dirty = old_start;
+    uint32_t cluster = old_start;
+    for (uint32_t i = 0; i < clusters; i++)
+    {
+        uint32_t next = fat_table[cluster];
+        fat_table[cluster] = FAT16_FREE_CLUSTER;
+        if (cluster < first_dirty)
+            first_dirty = cluster;
+        if (cluster > last_dirty)
+            last_dirty = cluster;
+        cluster = next;
+    }
+    fat_flush_table(first_dirty, last_dirty);
+
+    fat_unwritten_t* unwritten = fat_find_unwritten(old_start);
+    if (unwritten != NULL)
+        unwritten->start_cluster = run;
+
+    if (moved != NULL)
+        moved(old_start, run);
+    return 0;
+}
+
+// "." and "..", padded with NULs by fat_create() or with spaces by other tools
+static bool fat_is_dot_entry(const FAT16_DirEntry* entry)
+{
+    int dots = 0;
+    while (dots < 2 && entry->name[dots] == '.')
+        dots++;
+    if (dots == 0)
+        return false;
+
+    for (int i = dots; i < FAT16_FILENAME_SIZE && entry->name[i] != '\0'; i++)
+    {
+        if (entry->name[i] != ' ')
+            return false;
+    }
+    return true;
+}
+
+static int fat_defrag_dir(uint32_t dir_start_cluster, uint32_t parent_start_cluster, fat_frag_stats_t* before,
+    fat_frag_stats_t* after, fat_moved_fn moved, uint32_t depth)
+{
+    uint32_t entries_per_cluster = fat16_fs.bytes_per_sector / sizeof(FAT16_DirEntry) * fat16_fs.sectors_per_cluster;
+    FAT16_DirEntry* entries = (FAT16_DirEntry*)kmalloc(fat16_fs.bytes_per_sector * fat16_fs.sectors_per_cluster);
+    if (entries == NULL)
+        return -1;
+
+    int r = 0;
+    int cluster;
+    for (uint32_t i = 0; r == 0 && (cluster = get_ith_cluster(dir_start_cluster, i)) != -1; i++)
+    {
+        if (fat_read_data_cluster(cluster, entries))
+        {
+            r = -1;
+            break;
+        }
+
+        for (uint32_t e = 0; r == 0 && e < entries_per_cluster; e++)
+        {
+            FAT16_DirEntry* entry = &entries[e];
+            if (entry->name[0] == '\0' || (uint8_t)entry->name[0] == FAT16_DELETED_ENTRY
+                || (entry->attr & FAT_ATTR_VOLUME_ID) || fat_is_dot_entry(entry))
+            {
+                continue;
+            }
+
+            // fat_create() gives every entry a cluster, this guards against images written by other
+            // tools, where empty files have none and a ".." entry pointing at the root has 0
+            if (entry->start_cluster < 2)
+                continue;
+
+            if (entry->attr & FAT_ATTR_DIRECTORY)
+            {
+                // Entries pointing back at this directory or its parent would walk the tree again
+                if (depth < FAT_DEFRAG_MAX_DEPTH && entry->start_cluster != dir_start_cluster
+                    && entry->start_cluster != parent_start_cluster)
+                {
+                    r = fat_defrag_dir(entry->start_cluster, dir_start_cluster, before, after, moved, depth + 1);
+                }
+                continue;
+            }
+
+            fat_count_file(before, entry->start_cluster);
+            r = fat_defrag_file(cluster, entries, entry, moved);
+            fat_count_file(after, entry->start_cluster);
+        }
+    }
+
+    kfree(entries);
+    return r;
+}
+
+int fat_defrag(fat_frag_stats_t* before, fat_frag_stats_t* after, fat_moved_fn moved)
+{
+    fat_frag_stats_t before_stats = {0};
+    fat_frag_stats_t after_stats = {0};
+
+    mutex_lock(&fat_lock);
+    fat_count_free(&before_stats);
+    int r = fat_defrag_dir(root_dir.start_cluster, root_dir.start_cluster, &before_stats, &after_stats, moved, 0);
+    fat_count_free(&after_stats);
+    mutex_unlock(&fat_lock);
+
+    if (before != NULL)
+        *before = before_stats;
+    if (after != NULL)
+        *after = after_stats;
+    return r;
+}
+
+int fat_get_dir_entry(FAT16_DirEntry *dir, int n, FAT16_DirEntry *entry)
+{
+    mutex_lock(&fat_lock);
+    int r = fat_get_dir_entry_unlocked(dir, n, entry);
+    mutex_unlock(&fat_lock);
+    return r;
+}
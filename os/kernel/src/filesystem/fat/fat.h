@@ -5,6 +5,7 @@
 #include <errno-base.h>
 #include "string.h"
 #include "ctype.h"
+#include "uio.h"
 
 // Define constants for FAT16
 #define FAT16_SIGNATURE 0xAA55
@@ -13,6 +14,13 @@
 #define FAT16_CLUSTER_CHAIN_END 0xFFF8
 #define FAT16_BAD_CLUSTER 0xFFF7
 #define FAT16_FREE_CLUSTER 0x0000
+#define FAT16_DELETED_ENTRY 0xE5 // first byte of the name of a deleted directory entry
+
+// The most a file copy or a zero fill keeps in memory at once
+#define FAT_COPY_CHUNK_MAX (64 * 1024)
+
+// How many files grown by a truncate can have their new part unwritten at once, see fat_fill_unwritten()
+#define FAT_UNWRITTEN_MAX 32
 
 #define FAT16_FILENAME_SIZE 11 // 8.3 filename (8 bytes name, 3 bytes extension)
 
@@ -53,6 +61,44 @@ typedef struct FileData {
     FAT16_DirEntry parent_entry;
 } FileData;
 
+// Readahead window of a file read sequentially, in clusters. It starts at the minimum and doubles
+// every time it's used, up to the maximum or half the cache
+#define FAT_READAHEAD_MIN 4
+#define FAT_READAHEAD_MAX 32
+
+// Readahead state of an open file, zeroed when the file is opened
+typedef struct fat_readahead {
+    uint32_t next_offset;   // where the next read starts if the file is read sequentially
+    uint32_t window;        // clusters to keep loaded past the reads, 0 while they are random
+    uint32_t ahead_until;   // the clusters of the file before this one were already read ahead
+} fat_readahead_t;
+
+// The most appended data a file holds back in memory before it's written out
+#define FAT_WRITEBACK_MAX (64 * 1024)
+
+/*
+ * Data appended to an open file but not written to the disk yet, it goes right after the file's
+ * size on the disk. No cluster is taken for it until it's flushed, then all the clusters it needs
+ * are allocated in one pass, so they follow each other, and it's written in whole clusters.
+ */
+typedef struct fat_write_buffer {
+    uint8_t* data;      // FAT_WRITEBACK_MAX bytes, NULL until the first append held back
+    uint32_t length;    // bytes held back
+} fat_write_buffer_t;
+
+// Fragmentation of the volume, fat_defrag() fills one before it runs and one after
+typedef struct fat_frag_stats {
+    uint32_t files;             // regular files, directories aren't counted
+    uint32_t fragmented_files;  // files whose clusters aren't a single run
+    uint32_t fragments;         // runs of clusters of all the files together
+    uint32_t clusters;          // clusters of all the files together
+    uint32_t free_clusters;
+    uint32_t largest_free_run;  // in clusters
+} fat_frag_stats_t;
+
+// Told about every file fat_defrag() moves, so the copies of its directory entry can follow it
+typedef void (*fat_moved_fn)(uint32_t old_start_cluster, uint32_t new_start_cluster);
+
 typedef enum FAT16_FileAttribute {
     FAT_ATTR_READ_ONLY = 0x01,
     FAT_ATTR_HIDDEN = 0x02,
@@ -92,5 +138,31 @@ uint32_t fat_delete_file(const char *path);
 uint32_t fat_delete_dir(const char *path);
 int32_t fat_read(FAT16_DirEntry* file, uint32_t offset, uint32_t size, void* buffer);
 int32_t fat_write(FAT16_DirEntry* file, FAT16_DirEntry* parent_dir, uint32_t offset, uint32_t size, const void* buffer);
+// Scatter/gather versions, the buffers are one range of the file and the cluster chain is walked once.
+// With ra set, reads that follow each other load the next clusters of the file into the cache
+int32_t fat_readv(FAT16_DirEntry* file, uint32_t offset, const struct iovec* iov, uint32_t iovcnt, fat_readahead_t* ra);
+int32_t fat_writev(FAT16_DirEntry* file, FAT16_DirEntry* parent_dir, uint32_t offset, const struct iovec* iov, uint32_t iovcnt);
+// Copies size bytes of src at src_offset into dst at dst_offset on the disk, dst grows as needed
+int32_t fat_copy_range(FAT16_DirEntry* src, uint32_t src_offset, FAT16_DirEntry* dst, FAT16_DirEntry* dst_parent,
+    uint32_t dst_offset, uint32_t size);
+// Writes like fat_writev(), but appends are held back in wb, which is flushed first for any other write.
+// A failed flush returns its error, the clusters of held back data are only allocated then
+int32_t fat_write_buffered(FileData* file, fat_write_buffer_t* wb, uint32_t offset, const struct iovec* iov, uint32_t iovcnt);
+// Writes what wb holds back to the disk, the file's size grows by it. Returns 0, CANT_ALLOCATE_SPACE
+// or GENERAL_ERROR, on failure wb keeps the data
+int fat_flush(FileData* file, fat_write_buffer_t* wb);
+// Frees the memory of a flushed write buffer
+void fat_write_buffer_free(fat_write_buffer_t* wb);
+// The part a file grows by reads as zeros, but is only written when data lands on it or the file is filled
 int fat_truncate(FileData* file, uint32_t size);
-int fat_get_dir_entry(FAT16_DirEntry *dir, int n, FAT16_DirEntry *entry);
\ No newline at end of file
+// Writes the zeros of the part a truncate grew the file by that no data landed on, before it's closed
+int fat_fill_unwritten(FAT16_DirEntry* file);
+int fat_get_dir_entry(FAT16_DirEntry *dir, int n, FAT16_DirEntry *entry);
+/*
+ * Moves every fragmented file into the lowest run of free clusters that fits it, so it can be read
+ * in multi-sector transfers. The data is copied and the new chain written before the directory
+ * entry points at it, and only then is the old chain freed, so a failure leaves the file as it was.
+ * Directories aren't moved. moved is called under the lock for every file that was, a copy of its
+ * directory entry that isn't updated through it reads freed clusters. Either stats may be NULL
+ */
+int fat_defrag(fat_frag_stats_t* before, fat_frag_stats_t* after, fat_moved_fn moved);
\ No newline at end of file
@@ -0,0 +1,108 @@
+#include "fat_cache.h"
+#include "memory/heap/heap.h"
+#include <string.h>
+#include <stddef.h>
+
+typedef struct fat_cache_slot {
+    uint32_t cluster;
+    uint32_t last_used;     // the use counter at the last access, the lowest one is reused first
+    bool valid;
+    uint8_t* data;
+} fat_cache_slot_t;
+
+static fat_cache_slot_t* slots = NULL;
+static uint32_t slot_count = 0;
+static uint32_t cluster_bytes = 0;
+static uint32_t use_counter = 0;
+
+static fat_cache_slot_t* fat_cache_find(uint32_t cluster);
+
+bool fat_cache_init(uint32_t cluster_size)
+{
+    uint32_t count = FAT_CACHE_BYTES / cluster_size;
+    if (count < FAT_CACHE_MIN_SLOTS)
+        count = FAT_CACHE_MIN_SLOTS;
+
+    fat_cache_slot_t* new_slots = kmalloc(count * sizeof(fat_cache_slot_t));
+    uint8_t* memory = kmalloc(count * cluster_size);
+    if (new_slots == NULL || memory == NULL)
+    {
+        kfree(new_slots);
+        kfree(memory);
+        return false;
+    }
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        new_slots[i].cluster = 0;
+        new_slots[i].last_used = 0;
+        new_slots[i].valid = false;
+        new_slots[i].data = memory + i * cluster_size;
+    }
+
+    slots = new_slots;
+    slot_count = count;
+    cluster_bytes = cluster_size;
+    return true;
+}
+
+uint32_t fat_cache_slots()
+{
+    return slot_count;
+}
+
+bool fat_cache_read(uint32_t cluster, void* buffer)
+{
+    fat_cache_slot_t* slot = fat_cache_find(cluster);
+    if (slot == NULL)
+        return false;
+
+    slot->last_used = ++use_counter;
+    memcpy(buffer, slot->data, cluster_bytes);
+    return true;
+}
+
+bool fat_cache_contains(uint32_t cluster)
+{
+    return fat_cache_find(cluster) != NULL;
+}
+
+void fat_cache_store(uint32_t cluster, const void* data)
+{
+    if (slot_count == 0)
+        return;
+
+    fat_cache_slot_t* slot = fat_cache_find(cluster);
+    if (slot == NULL)
+    {
+        // A free slot if there is one, the least recently used one otherwise
+        slot = &slots[0];
+        for (uint32_t i = 0; i < slot_count && slot->valid; i++)
+        {
+            if (!slots[i].valid || slots[i].last_used < slot->last_used)
+                slot = &slots[i];
+        }
+        slot->cluster = cluster;
+        slot->valid = true;
+    }
+
+    slot->last_used = ++use_counter;
+    memcpy(slot->data, data, cluster_bytes);
+}
+
+void fat_cache_update(uint32_t cluster, const void* data)
+{
+    fat_cache_slot_t* slot = fat_cache_find(cluster);
+    if (slot != NULL)
+        memcpy(slot->data, data, cluster_bytes);
+}
+
+static fat_cache_slot_t* fat_cache_find(uint32_t cluster)
+{
+    for (uint32_t i = 0; i < slot_count; i++)
+    {
+        if (slots[i].valid && slots[i].cluster == cluster)
+            return &slots[i];
+    }
+    return NULL;
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+// The memory the cache takes, whatever the cluster size
+#define FAT_CACHE_BYTES (256 * 1024)
+// Fewer slots than this and the readahead of one file would push out what it just loaded
+#define FAT_CACHE_MIN_SLOTS 16
+
+/*
+ * The data clusters of the FAT volume most recently read, so reading them again doesn't go to the
+ * disk. Reads and readahead fill it, writes go through to the disk and refresh what is cached.
+ * When it's full the least recently used cluster goes. There is no lock of its own, it's only
+ * used under the FAT lock.
+ */
+
+// Sets the cache up for the volume's cluster size, without it every lookup misses
+bool fat_cache_init(uint32_t cluster_size);
+// How many clusters fit in the cache, 0 if it couldn't be set up
+uint32_t fat_cache_slots();
+
+// Copies the cluster into buffer if it's cached
+bool fat_cache_read(uint32_t cluster, void* buffer);
+bool fat_cache_contains(uint32_t cluster);
+// Caches the data of the cluster, in place of the least recently used one if it isn't cached yet
+void fat_cache_store(uint32_t cluster, const void* data);
+// Refreshes the cluster if it's cached, for writes that shouldn't push what was read out
+void fat_cache_update(uint32_t cluster, const void* data);
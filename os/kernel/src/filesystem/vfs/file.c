@@ -1,4 +1,9 @@
 #include "file.h"
+#include "sync/mutex.h"
+#include "drivers/vga/vga.h"
+#include "time/timer.h"
+#include "cpu/pit/pit.h"
+#include "process/workqueue/workqueue.h"
 
 
 int read_fat_fs(void *buf, uint32_t count, uint32_t off, struct global_file_descriptor_t* glob_fd)
@@ -8,6 +13,20 @@ int read_fat_fs(void *buf, uint32_t count, uint32_t off, struct global_file_desc
 
 global_file_descriptor global_fd_table[MAX_FD] = {0};
 
+// Lookups and allocations in the table, and the reference counts
+static lock_stats_t global_fd_lock_stats = LOCK_STATS_INIT("global fd table");
+static mutex_t global_fd_mutex = MUTEX_INIT_STATS(&global_fd_lock_stats);
+
+void global_fd_lock()
+{
+    mutex_lock(&global_fd_mutex);
+}
+
+void global_fd_unlock()
+{
+    mutex_unlock(&global_fd_mutex);
+}
+
 global_file_descriptor* get_glob_fd()
 {
     return global_fd_table;
@@ -61,4 +80,147 @@ global_file_descriptor* allocate_device_fd()
     }
 
     return NULL;
-}
\ No newline at end of file
+}
+
+// Held back appends are written out by the worker thread, the timer only queues it
+static void writeback_timer_fired(ktimer_t* timer);
+static void writeback_work_run(work_t* work);
+static ktimer_t writeback_timer = { .callback = writeback_timer_fired };
+static work_t writeback_work = { .func = writeback_work_run };
+
+static inline bool is_fat_file(const global_file_descriptor* glob_fd)
+{
+    return glob_fd->_read == read_fat_fs && !glob_fd->is_dir;
+}
+
+int global_fd_flush(global_file_descriptor* glob_fd)
+{
+    if (!is_fat_file(glob_fd) || glob_fd->write_buffer.length == 0)
+        return 0;
+    return fat_flush(&glob_fd->file, &glob_fd->write_buffer);
+}
+
+uint32_t global_fd_size(const global_file_descriptor* glob_fd)
+{
+    return glob_fd->file.file_entry.file_size + glob_fd->write_buffer.length;
+}
+
+void writeback_schedule()
+{
+    if (!writeback_timer.pending)
+        timer_add(&writeback_timer, get_system_ticks() + timer_ns_to_ticks(WRITEBACK_DELAY_MS * 1000000ULL));
+}
+
+static void writeback_timer_fired(ktimer_t* timer)
+{
+    schedule_work(&writeback_work);
+}
+
+static void writeback_work_run(work_t* work)
+{
+    bool failed = false;
+
+    global_fd_lock();
+    for (int i = 0; i < MAX_FD; i++)
+    {
+        if (global_fd_table[i].is_used && global_fd_flush(&global_fd_table[i]) != 0)
+            failed = true;
+    }
+    global_fd_unlock();
+
+    // What failed stays held back, tried again later and reported by the next fsync() or close()
+    if (failed)
+        writeback_schedule();
+}
+
+// Called by fat_defrag() under the FAT lock, with the table locked by global_fd_defrag()
+static void defrag_moved(uint32_t old_start_cluster, uint32_t new_start_cluster)
+{
+    for (int i = 0; i < MAX_FD; i++)
+    {
+        global_file_descriptor* glob_fd = &global_fd_table[i];
+        if (glob_fd->is_used && is_fat_file(glob_fd) && glob_fd->file.file_entry.start_cluster == old_start_cluster)
+            glob_fd->file.file_entry.start_cluster = new_start_cluster;
+    }
+}
+
+int global_fd_defrag(fat_frag_stats_t* before, fat_frag_stats_t* after)
+{
+    // Held for the whole run, so no file is opened with a start cluster that is about to move
+    global_fd_lock();
+    int r = fat_defrag(before, after, defrag_moved);
+    global_fd_unlock();
+    return r;
+}
+
+// Must be called with the table locked
+static void put_global_fd_locked(global_file_descriptor* glob_fd)
+{
+    if (--glob_fd->ref_count > 0)
+        return;
+
+    // Nothing can write the file anymore, so what it held back goes now, and the zeros of a part
+    // an ftruncate() grew it by are written since the disk can't tell they were never there.
+    // The file goes either way, a failure is all that's left to report
+    if (is_fat_file(glob_fd))
+    {
+        uint32_t held_back = glob_fd->write_buffer.length;
+        int r = fat_flush(&glob_fd->file, &glob_fd->write_buffer);
+        if (r != 0)
+            vga_printf("%s: lost %d bytes held back, error %d\n", glob_fd->path, held_back, -r);
+        fat_write_buffer_free(&glob_fd->write_buffer);
+
+        if (fat_fill_unwritten(&glob_fd->file.file_entry) != 0)
+            vga_printf("%s: failed to zero the end of the file\n", glob_fd->path);
+    }
+
+    if (glob_fd->_release != NULL)
+        glob_fd->_release(glob_fd);
+    memset(glob_fd, 0, sizeof(global_file_descriptor));
+}
+
+void fd_get(file_descriptor* dst, const file_descriptor* src)
+{
+    global_fd_lock();
+    *dst = *src;
+    if (dst->global_fd != NULL)
+        dst->global_fd->ref_count++;
+    global_fd_unlock();
+}
+
+void fd_put(file_descriptor* fd)
+{
+    global_fd_lock();
+    if (fd->global_fd != NULL)
+        put_global_fd_locked(fd->global_fd);
+    global_fd_unlock();
+
+    memset(fd, 0, sizeof(file_descriptor));
+}
+
+void fd_table_copy(file_descriptor* dst, const file_descriptor* src, size_t size)
+{
+    global_fd_lock();
+    for (size_t i = 0; i < size; i++)
+    {
+        if (dst[i].is_used && dst[i].global_fd != NULL)
+            put_global_fd_locked(dst[i].global_fd);
+
+        dst[i] = src[i];
+        if (dst[i].is_used && dst[i].global_fd != NULL)
+            dst[i].global_fd->ref_count++;
+    }
+    global_fd_unlock();
+}
+
+void fd_table_release(file_descriptor* table, size_t size)
+{
+    global_fd_lock();
+    for (size_t i = 0; i < size; i++)
+    {
+        if (table[i].is_used && table[i].global_fd != NULL)
+            put_global_fd_locked(table[i].global_fd);
+        memset(&table[i], 0, sizeof(file_descriptor));
+    }
+    global_fd_unlock();
+}
@@ -5,6 +5,32 @@
 
 int read_fat_fs(void *buf, uint32_t count, uint32_t off, struct global_file_descriptor_t* glob_fd);
 
+// The lookup and allocations below must be done with the table locked
+void global_fd_lock();
+void global_fd_unlock();
+
 global_file_descriptor* get_opened_fd(char *path);
 global_file_descriptor* allocate_global_fd(char *path);
-global_file_descriptor* allocate_device_fd();
\ No newline at end of file
+global_file_descriptor* allocate_device_fd();
+
+// References of process fds to the global ones, these take the table lock themselves.
+// Dropping the last reference releases the global fd
+void fd_get(file_descriptor* dst, const file_descriptor* src);
+void fd_put(file_descriptor* fd);
+// Replaces every fd of dst with the ones of src, for a new process that inherits its files
+void fd_table_copy(file_descriptor* dst, const file_descriptor* src, size_t size);
+void fd_table_release(file_descriptor* table, size_t size);
+
+// How long appends may stay in memory before they are written out
+#define WRITEBACK_DELAY_MS 2000
+
+// Writes out the appends a FAT file holds back, does nothing for anything else.
+// Returns 0, -ENOSPC or -EIO, on failure the appends stay held back
+int global_fd_flush(global_file_descriptor* glob_fd);
+// The size of a file including the appends it holds back
+uint32_t global_fd_size(const global_file_descriptor* glob_fd);
+// Flushes every file WRITEBACK_DELAY_MS from now, called after a write was held back
+void writeback_schedule();
+
+// Runs fat_defrag() with the table locked, the open files follow their clusters to where they move
+int global_fd_defrag(fat_frag_stats_t* before, fat_frag_stats_t* after);
\ No newline at end of file
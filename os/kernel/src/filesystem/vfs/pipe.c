@@ -0,0 +1,206 @@
+#include "pipe.h"
+#include "file.h"
+#include "memory/heap/heap.h"
+#include "sync/atomic.h"
+#include "errno-base.h"
+#include <stddef.h>
+
+static int pipe_read(void *buf, uint32_t count, uint32_t off, global_file_descriptor* glob_fd);
+static int pipe_write(const void *buf, uint32_t count, uint32_t off, global_file_descriptor* glob_fd);
+static void pipe_release(global_file_descriptor* glob_fd);
+static uint32_t pipe_poll(global_file_descriptor* glob_fd, struct poll_table* table);
+
+int pipe_create(global_file_descriptor** read_end, global_file_descriptor** write_end)
+{
+    pipe_t* pipe = kmalloc(sizeof(pipe_t));
+    if (pipe == NULL)
+        return -ENOMEM;
+
+    pipe->buffer = kmalloc_pages(PIPE_PAGES);
+    if (pipe->buffer == NULL)
+    {
+        kfree(pipe);
+        return -ENOMEM;
+    }
+    pipe->head = 0;
+    pipe->tail = 0;
+    mutex_init(&pipe->read_mutex);
+    mutex_init(&pipe->write_mutex);
+    spin_init(&pipe->wait_lock);
+    wait_queue_init(&pipe->readers);
+    wait_queue_init(&pipe->writers);
+    poll_head_init(&pipe->poll);
+    pipe->read_open = true;
+    pipe->write_open = true;
+
+    *read_end = allocate_device_fd();
+    *write_end = allocate_device_fd();
+    if (*read_end == NULL || *write_end == NULL)
+    {
+        if (*read_end != NULL)
+            memset(*read_end, 0, sizeof(global_file_descriptor));
+        kfree(pipe->buffer);
+        kfree(pipe);
+        return -ENFILE;
+    }
+
+    (*read_end)->_read = pipe_read;
+    (*read_end)->_release = pipe_release;
+    (*read_end)->_poll = pipe_poll;
+    (*read_end)->pipe = pipe;
+    (*write_end)->_write = pipe_write;
+    (*write_end)->_release = pipe_release;
+    (*write_end)->_poll = pipe_poll;
+    (*write_end)->pipe = pipe;
+    return 0;
+}
+
+// Wakes whoever sleeps on the other side of the ring, and whoever polls either end
+static void pipe_wake(pipe_t* pipe, wait_queue_t* queue)
+{
+    uint32_t flags = spin_lock_irqsave(&pipe->wait_lock);
+    wait_queue_wake_one(queue);
+    spin_unlock_irqrestore(&pipe->wait_lock, flags);
+    poll_wake(&pipe->poll);
+}
+
+static int pipe_read(void *buf, uint32_t count, uint32_t off, global_file_descriptor* glob_fd)
+{
+    pipe_t* pipe = glob_fd->pipe;
+    uint8_t* dst = buf;
+
+    if (count == 0)
+        return 0;
+
+    mutex_lock(&pipe->read_mutex);
+    uint32_t tail = pipe->tail;
+    while (pipe->head == tail)
+    {
+        uint32_t flags = spin_lock_irqsave(&pipe->wait_lock);
+        // Checked again under the lock, the writer moves head before it takes the lock to wake us
+        if (pipe->head != tail || !pipe->write_open)
+        {
+            bool eof = pipe->head == tail;
+            spin_unlock_irqrestore(&pipe->wait_lock, flags);
+            if (eof)
+            {
+                mutex_unlock(&pipe->read_mutex);
+                return 0; // every writer is gone
+            }
+            break;
+        }
+
+        wait_entry_t entry;
+        wait_queue_add(&pipe->readers, &entry);
+        wait_queue_sleep(&entry, &pipe->wait_lock, &flags);
+        spin_unlock_irqrestore(&pipe->wait_lock, flags);
+    }
+
+    uint32_t available = pipe->head - tail;
+    uint32_t len = count < available ? count : available;
+    for (uint32_t i = 0; i < len; i++)
+        dst[i] = pipe->buffer[(tail + i) % PIPE_SIZE];
+
+    // The bytes are copied out before the writer may reuse their room
+    compiler_barrier();
+    pipe->tail = tail + len;
+    mutex_unlock(&pipe->read_mutex);
+
+    pipe_wake(pipe, &pipe->writers);
+    return len;
+}
+
+static int pipe_write(const void *buf, uint32_t count, uint32_t off, global_file_descriptor* glob_fd)
+{
+    pipe_t* pipe = glob_fd->pipe;
+    const uint8_t* src = buf;
+    uint32_t written = 0;
+
+    mutex_lock(&pipe->write_mutex);
+    while (written < count)
+    {
+        if (!pipe->read_open)
+        {
+            mutex_unlock(&pipe->write_mutex);
+            return written > 0 ? (int)written : -EPIPE;
+        }
+
+        uint32_t head = pipe->head;
+        uint32_t room = PIPE_SIZE - (head - pipe->tail);
+        if (room == 0)
+        {
+            uint32_t flags = spin_lock_irqsave(&pipe->wait_lock);
+            // Same as the reader, the reader moves tail before it takes the lock to wake us
+            if (PIPE_SIZE - (head - pipe->tail) == 0 && pipe->read_open)
+            {
+                wait_entry_t entry;
+                wait_queue_add(&pipe->writers, &entry);
+                wait_queue_sleep(&entry, &pipe->wait_lock, &flags);
+            }
+            spin_unlock_irqrestore(&pipe->wait_lock, flags);
+            continue;
+        }
+
+        uint32_t len = count - written < room ? count - written : room;
+        for (uint32_t i = 0; i < len; i++)
+            pipe->buffer[(head + i) % PIPE_SIZE] = src[written + i];
+
+        // The bytes are in the ring before the reader can see them
+        compiler_barrier();
+        pipe->head = head + len;
+        written += len;
+
+        pipe_wake(pipe, &pipe->readers);
+    }
+    mutex_unlock(&pipe->write_mutex);
+
+    return written;
+}
+
+// The last reference to one of the ends is gone, the pipe goes with the second one
+static void pipe_release(global_file_descriptor* glob_fd)
+{
+    pipe_t* pipe = glob_fd->pipe;
+
+    uint32_t flags = spin_lock_irqsave(&pipe->wait_lock);
+    if (glob_fd->_read == pipe_read)
+        pipe->read_open = false;
+    else
+        pipe->write_open = false;
+    // A reader gets its end of file, a writer its broken pipe
+    wait_queue_wake_one(&pipe->readers);
+    wait_queue_wake_one(&pipe->writers);
+    bool last_end = !pipe->read_open && !pipe->write_open;
+    spin_unlock_irqrestore(&pipe->wait_lock, flags);
+    // The end that's left polls for the hang up, a pipe with no ends has no pollers
+    poll_wake(&pipe->poll);
+
+    if (last_end)
+    {
+        kfree(pipe->buffer);
+        kfree(pipe);
+    }
+}
+
+static uint32_t pipe_poll(global_file_descriptor* glob_fd, struct poll_table* table)
+{
+    pipe_t* pipe = glob_fd->pipe;
+    uint32_t mask = 0;
+
+    poll_wait(&pipe->poll, table);
+    if (glob_fd->_read == pipe_read)
+    {
+        if (pipe->head != pipe->tail)
+            mask |= POLLIN;
+        if (!pipe->write_open)
+            mask |= POLLHUP;
+    }
+    else
+    {
+        if (pipe->head - pipe->tail < PIPE_SIZE)
+            mask |= POLLOUT;
+        if (!pipe->read_open)
+            mask |= POLLERR;
+    }
+    return mask;
+}
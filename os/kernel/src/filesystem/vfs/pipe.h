@@ -0,0 +1,34 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "process/manager/process_manager.h"
+#include "sync/spinlock.h"
+#include "sync/mutex.h"
+#include "sync/wait_queue.h"
+#include "poll.h"
+
+#define PIPE_PAGES 4
+#define PIPE_SIZE (PIPE_PAGES * PAGE_SIZE)
+
+/*
+ * An in-memory byte stream between a read end and a write end, each its own global fd.
+ * The ring itself is lock free: only the reader moves tail and only the writer moves head, both
+ * count bytes forever and wrap on their own. The mutexes make sure there is a single reader and a
+ * single writer at a time, and wait_lock is only taken to go to sleep or to wake the other side.
+ */
+typedef struct pipe {
+    uint8_t* buffer;
+    volatile uint32_t head;         // bytes written so far, only the writer moves it
+    volatile uint32_t tail;         // bytes read so far, only the reader moves it
+    mutex_t read_mutex;
+    mutex_t write_mutex;
+    spinlock_t wait_lock;           // protects everything below
+    wait_queue_t readers;           // waiting for data
+    wait_queue_t writers;           // waiting for room
+    poll_head_t poll;               // poll() and select() on either end
+    bool read_open;
+    bool write_open;
+} pipe_t;
+
+// Allocates the pipe and its two ends, must be called with the global fd table locked
+int pipe_create(global_file_descriptor** read_end, global_file_descriptor** write_end);
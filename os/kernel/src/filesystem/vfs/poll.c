@@ -0,0 +1,169 @@
+#include "poll.h"
+#include "file.h"
+#include "process/manager/process_manager.h"
+#include "memory/heap/heap.h"
+#include "cpu/pit/pit.h"
+#include "time/timer.h"
+#include "errno.h"
+#include <stddef.h>
+
+static int poll_scan(struct pollfd* fds, file_descriptor* files, uint32_t nfds, poll_table_t* table);
+static void poll_table_release(poll_table_t* table);
+
+void poll_head_init(poll_head_t* head)
+{
+    spin_init(&head->lock);
+    head->entries = NULL;
+}
+
+void poll_wait(poll_head_t* head, poll_table_t* table)
+{
+    if (table == NULL || table->entry_count == table->capacity)
+        return;
+
+    poll_entry_t* entry = &table->entries[table->entry_count++];
+    entry->table = table;
+    entry->head = head;
+
+    uint32_t flags = spin_lock_irqsave(&head->lock);
+    entry->next = head->entries;
+    head->entries = entry;
+    spin_unlock_irqrestore(&head->lock, flags);
+}
+
+void poll_wake(poll_head_t* head)
+{
+    uint32_t flags = spin_lock_irqsave(&head->lock);
+    for (poll_entry_t* entry = head->entries; entry != NULL; entry = entry->next)
+    {
+        poll_table_t* table = entry->table;
+
+        // Lock order: the file's head, then the poller's table
+        spin_lock(&table->lock);
+        wait_entry_wake(&table->waiter);
+        spin_unlock(&table->lock);
+    }
+    spin_unlock_irqrestore(&head->lock, flags);
+}
+
+int poll_fds(struct pollfd* fds, uint32_t nfds, int32_t timeout_ticks)
+{
+    process_t* proc = get_current_process();
+    file_descriptor* files = NULL;
+    poll_table_t table = { .waiter.proc = proc };
+    uint32_t deadline = get_system_ticks() + timeout_ticks + 1;
+    uint32_t alarms = proc->pending_alarms;
+    int ready;
+
+    spin_init(&table.lock);
+    if (nfds > 0)
+    {
+        // Every fd registers at most one head
+        files = kmalloc(nfds * sizeof(file_descriptor));
+        table.entries = kmalloc(nfds * sizeof(poll_entry_t));
+        if (files == NULL || table.entries == NULL)
+        {
+            kfree(files);
+            kfree(table.entries);
+            return -ENOMEM;
+        }
+        table.capacity = nfds;
+    }
+
+    // Another thread may close the fds meanwhile, the references keep what we wait on alive
+    for (uint32_t i = 0; i < nfds; i++)
+    {
+        int fd = fds[i].fd;
+        if (fd >= 0 && fd < MAX_LOCAL_FD && proc->shared->fd_table[fd].is_used)
+            fd_get(&files[i], &proc->shared->fd_table[fd]);
+        else
+            memset(&files[i], 0, sizeof(file_descriptor));
+    }
+
+    // Registered on the first scan only, after it the heads only need to wake us up
+    bool registered = timeout_ticks == 0;
+    while (true)
+    {
+        uint32_t flags = spin_lock_irqsave(&table.lock);
+        table.waiter.woken = false;
+        spin_unlock_irqrestore(&table.lock, flags);
+
+        ready = poll_scan(fds, files, nfds, registered ? NULL : &table);
+        registered = true;
+
+        if (ready > 0 || timeout_ticks == 0)
+            break;
+        if (timeout_ticks > 0 && (int32_t)(get_system_ticks() - deadline) >= 0)
+            break;
+        if (proc->pending_alarms != alarms)
+        {
+            ready = -EINTR;
+            break;
+        }
+        // Another thread called exit_group(), the syscall exits this one on its way out
+        if (proc->shared->exiting)
+            break;
+
+        // A file that got ready since the scan has woken the waiter already, it doesn't sleep then
+        flags = spin_lock_irqsave(&table.lock);
+        wait_queue_sleep_timed(&table.waiter, &table.lock, &flags, timeout_ticks > 0, deadline);
+        spin_unlock_irqrestore(&table.lock, flags);
+    }
+
+    poll_table_release(&table);
+    for (uint32_t i = 0; i < nfds; i++)
+    {
+        if (files[i].is_used)
+            fd_put(&files[i]);
+    }
+    kfree(files);
+    kfree(table.entries);
+    return ready;
+}
+
+static int poll_scan(struct pollfd* fds, file_descriptor* files, uint32_t nfds, poll_table_t* table)
+{
+    int ready = 0;
+
+    for (uint32_t i = 0; i < nfds; i++)
+    {
+        uint32_t mask;
+
+        if (fds[i].fd < 0)
+        {
+            fds[i].revents = 0;
+            continue;
+        }
+
+        if (!files[i].is_used)
+            mask = POLLNVAL;
+        else if (files[i].global_fd == NULL)
+            mask = POLLOUT; // stdout and stderr of a process without a terminal go to the screen
+        else if (files[i].global_fd->_poll == NULL)
+            mask = POLLIN | POLLOUT; // regular files never block
+        else
+            mask = files[i].global_fd->_poll(files[i].global_fd, table);
+
+        fds[i].revents = mask & (fds[i].events | POLLERR | POLLHUP | POLLNVAL);
+        if (fds[i].revents != 0)
+            ready++;
+    }
+    return ready;
+}
+
+static void poll_table_release(poll_table_t* table)
+{
+    for (uint32_t i = 0; i < table->entry_count; i++)
+    {
+        poll_entry_t* entry = &table->entries[i];
+        uint32_t flags = spin_lock_irqsave(&entry->head->lock);
+        poll_entry_t** link = &entry->head->entries;
+        while (*link != entry)
+        {
+            link = &(*link)->next;
+        }
+        *link = entry->next;
+        spin_unlock_irqrestore(&entry->head->lock, flags);
+    }
+    table->entry_count = 0;
+}
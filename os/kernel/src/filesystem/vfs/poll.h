@@ -0,0 +1,63 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "sync/spinlock.h"
+#include "sync/wait_queue.h"
+
+// poll() events, same as Linux
+#define POLLIN   0x001
+#define POLLPRI  0x002
+#define POLLOUT  0x004
+#define POLLERR  0x008
+#define POLLHUP  0x010
+#define POLLNVAL 0x020
+
+struct process;
+struct poll_table;
+
+struct pollfd {
+    int fd;
+    short events;   // what the caller waits for
+    short revents;  // what happened, POLLERR, POLLHUP and POLLNVAL are reported even if not asked for
+};
+
+// A file's pollers, woken on every change of its readiness
+typedef struct poll_head {
+    spinlock_t lock;                // protects the entries, taken from interrupts too
+    struct poll_entry* entries;
+} poll_head_t;
+
+// The link between a poller and one of the files it watches, lives in the poll table
+typedef struct poll_entry {
+    struct poll_table* table;
+    poll_head_t* head;
+    struct poll_entry* next;
+} poll_entry_t;
+
+// A process in poll() or select(), woken by whichever of its files gets ready first
+typedef struct poll_table {
+    wait_entry_t waiter;            // woken when a file got ready since the last scan
+    spinlock_t lock;                // protects the waiter
+    poll_entry_t* entries;
+    uint32_t entry_count;
+    uint32_t capacity;
+} poll_table_t;
+
+#define POLL_HEAD_INIT {0}
+
+void poll_head_init(poll_head_t* head);
+
+/*
+ * Called by a file's _poll() on each head whose wake ups change what it returns. The table is
+ * NULL when the caller only wants the current state, e.g. after the first scan of poll().
+ */
+void poll_wait(poll_head_t* head, poll_table_t* table);
+// Wakes every poller of the file, safe from interrupts
+void poll_wake(poll_head_t* head);
+
+/*
+ * Sleeps until one of the fds of the current process is ready for what is asked, or the timeout
+ * runs out. timeout_ticks of 0 only checks, a negative one waits forever.
+ * Returns how many fds have revents set, or -EINTR if an alarm fired.
+ */
+int poll_fds(struct pollfd* fds, uint32_t nfds, int32_t timeout_ticks);
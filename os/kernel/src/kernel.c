@@ -13,10 +13,14 @@
 #include "process/syscalls/syscalls.h"
 #include "terminal/terminal_manager.h"
 #include "process/syscalls/handlers/time/time.h"
+#include "time/clock.h"
+#include "cpu/fpu/fpu.h"
+#include "process/workqueue/workqueue.h"
+#include "cpu/apic/apic.h"
+#include "cpu/smp/smp.h"
 
 #include <fcntl.h>
 
-extern void jump_usermode(process_registers_t *addr);
 void system_startup_animation();
 
 void kernel_physical_end(void);
@@ -37,12 +41,15 @@ void kmain(multiboot_info_t *mbi)
         return;
     }
 
+    paging_init();
+
     if (!heap_init())
     {
         vga_printf("failed heap init");
         return;
     }
 
+    clock_init();
     pit_init();
 
     fat_init();
@@ -50,8 +57,12 @@ void kmain(multiboot_info_t *mbi)
     keyboard_init();
     syscall_init();
 
+    fpu_init();
     proc_manager_init();
+    workqueue_init();
     set_active_terminal(create_terminal(1));
+    apic_init();
+    smp_init();
 
     system_startup_animation();
 
@@ -1,6 +1,7 @@
 #include "heap.h"
 #include "../paging/paging.h"
 #include "../../drivers/vga/vga.h"
+#include "sync/spinlock.h"
 
 #define BLOCK_SIZE(block) ((uintptr_t)block->next - (uintptr_t)block - sizeof(heap_entry))
 #define ALIGN(size, alignment) (((size) + (alignment)-1) & ~((alignment)-1))
@@ -10,10 +11,15 @@ static const uintptr_t heap_start = KERNEL_CODE_END;
 static uintptr_t curr_heap_end = KERNEL_CODE_END;
 static heap_entry* last_entry;
 
+// One lock for the whole heap, every cpu allocates from it
+static lock_stats_t heap_lock_stats = LOCK_STATS_INIT("heap");
+static spinlock_t heap_lock = SPINLOCK_INIT_STATS(&heap_lock_stats);
+
 static void *heap_find_first_free_space(size_t wanted_size);
 static void free_block(heap_entry *block);
 static bool allocate_heap_page();
 static void deallocate_last_heap_page();
+static void* heap_allocate_pages(size_t page_amount);
 
 bool heap_init()
 {
@@ -160,10 +166,21 @@ static void deallocate_last_heap_page()
 
 inline void* kmalloc(size_t size)
 {
-    return heap_find_first_free_space(size);
+    uint32_t flags = spin_lock_irqsave(&heap_lock);
+    void* addr = heap_find_first_free_space(size);
+    spin_unlock_irqrestore(&heap_lock, flags);
+    return addr;
 }
 
 void* kmalloc_pages(size_t page_amount)
+{
+    uint32_t flags = spin_lock_irqsave(&heap_lock);
+    void* addr = heap_allocate_pages(page_amount);
+    spin_unlock_irqrestore(&heap_lock, flags);
+    return addr;
+}
+
+static void* heap_allocate_pages(size_t page_amount)
 {
     if (page_amount == 0 || page_amount > (KERNEL_HEAP_END - heap_start) / PAGE_SIZE)
     {
@@ -216,7 +233,9 @@ inline void kfree(void *addr)
         return;
     }
     // free the block using the heap entry's address
+    uint32_t flags = spin_lock_irqsave(&heap_lock);
     free_block((heap_entry *)((uintptr_t)addr - sizeof(heap_entry)));
+    spin_unlock_irqrestore(&heap_lock, flags);
 }
 
 inline int get_heap_end()
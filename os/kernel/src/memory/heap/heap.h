@@ -7,7 +7,7 @@
 // extern char _kernel_end;
 
 #define KERNEL_CODE_END 0xC1800000
-#define KERNEL_HEAP_END 0xFFFFF000
+#define KERNEL_HEAP_END 0xFF800000 // the last page table before the recursive mapping is for MMIO
 
 typedef struct heap_entry
 {
@@ -0,0 +1,110 @@
+#include "mmap.h"
+#include "process/manager/process_manager.h"
+#include "memory/paging/paging.h"
+#include "memory/heap/heap.h"
+#include "errno.h"
+#include <stddef.h>
+
+static void unmap_region(mmap_region_t* region);
+
+int mmap_map(process_shared_t* shared, shm_object_t* shm, uint32_t first_page,
+    uint32_t page_count, bool writable, uintptr_t* addr)
+{
+    uint32_t length = page_count * PAGE_SIZE;
+    uintptr_t start = MMAP_BASE;
+    mmap_region_t** link = &shared->mmap_regions;
+
+    // First fit, the list is sorted so the gaps come in order
+    while (*link != NULL && start + length > (*link)->start)
+    {
+        start = (*link)->start + (*link)->page_count * PAGE_SIZE;
+        link = &(*link)->next;
+    }
+    if (length > MMAP_END - start)
+        return -ENOMEM;
+
+    mmap_region_t* region = kmalloc(sizeof(mmap_region_t));
+    if (region == NULL)
+        return -ENOMEM;
+
+    for (uint32_t i = 0; i < page_count; i++)
+    {
+        uintptr_t page_addr = start + i * PAGE_SIZE;
+        uintptr_t page_table_phys_addr = get_physical_address(get_page_table((void*)page_addr));
+
+        // The first page of a new page table, paging_map_page expects it blank
+        if (page_table_phys_addr == 0)
+        {
+            void* page_table = kmalloc_pages(1);
+            if (page_table == NULL)
+            {
+                for (uint32_t j = 0; j < i; j++)
+                {
+                    paging_unmap_page(start / PAGE_SIZE + j);
+                }
+                kfree(region);
+                return -ENOMEM;
+            }
+            memset(page_table, 0, PAGE_SIZE);
+            page_table_phys_addr = get_physical_address(page_table);
+        }
+
+        paging_map_page(shm_page_frame(shm, first_page + i), page_addr / PAGE_SIZE, false,
+            page_table_phys_addr);
+        if (!writable)
+        {
+            get_pte(page_addr / PAGE_SIZE)->read_write = 0;
+        }
+    }
+
+    region->start = start;
+    region->page_count = page_count;
+    region->first_page = first_page;
+    region->shm = shm;
+    region->next = *link;
+    *link = region;
+
+    *addr = start;
+    return 0;
+}
+
+int mmap_unmap(process_shared_t* shared, uintptr_t addr, uint32_t length)
+{
+    mmap_region_t** link = &shared->mmap_regions;
+    while (*link != NULL && (*link)->start < addr)
+    {
+        link = &(*link)->next;
+    }
+
+    mmap_region_t* region = *link;
+    if (region == NULL || region->start != addr
+        || (length + PAGE_SIZE - 1) / PAGE_SIZE != region->page_count)
+    {
+        return -EINVAL;
+    }
+
+    *link = region->next;
+    unmap_region(region);
+    return 0;
+}
+
+void mmap_release_all(process_shared_t* shared)
+{
+    while (shared->mmap_regions != NULL)
+    {
+        mmap_region_t* region = shared->mmap_regions;
+        shared->mmap_regions = region->next;
+        unmap_region(region);
+    }
+}
+
+static void unmap_region(mmap_region_t* region)
+{
+    // Only the mapping goes, the frames belong to the object
+    for (uint32_t i = 0; i < region->page_count; i++)
+    {
+        paging_unmap_page(region->start / PAGE_SIZE + i);
+    }
+    shm_map_put(region->shm);
+    kfree(region);
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "memory/shm/shm.h"
+
+// Where mmap() places mappings, between the program break and the stack
+#define MMAP_BASE 0x40000000
+#define MMAP_END  0xB0000000
+
+#define PROT_NONE  0x0
+#define PROT_READ  0x1
+#define PROT_WRITE 0x2
+#define PROT_EXEC  0x4
+
+#define MAP_SHARED    0x01
+#define MAP_PRIVATE   0x02
+#define MAP_FIXED     0x10
+#define MAP_ANONYMOUS 0x20
+
+struct process_shared;
+
+// A run of pages of a shared memory object mapped into a process
+typedef struct mmap_region {
+    uintptr_t start;
+    uint32_t page_count;
+    uint32_t first_page;        // the page of the object the region starts at
+    shm_object_t* shm;          // holds a mapping reference
+    struct mmap_region* next;   // the regions of a process, sorted by address
+} mmap_region_t;
+
+/*
+ * The region list is only walked and changed under the big kernel lock, without sleeping in
+ * between, so sibling threads can't map or unmap at the same time.
+ */
+
+// Maps the pages of shm into the current page directory, takes over a mapping reference of shm.
+// The address it picked is returned in addr
+int mmap_map(struct process_shared* shared, shm_object_t* shm, uint32_t first_page,
+    uint32_t page_count, bool writable, uintptr_t* addr);
+// Only whole regions can be unmapped
+int mmap_unmap(struct process_shared* shared, uintptr_t addr, uint32_t length);
+// Unmaps everything, for the last thread of a process. Its page directory must be the loaded one
+void mmap_release_all(struct process_shared* shared);
@@ -0,0 +1,44 @@
+#include "mmio.h"
+#include "memory/paging/paging.h"
+#include "sync/spinlock.h"
+
+static uintptr_t next_free = MMIO_VIRT_START;
+static spinlock_t mmio_lock = SPINLOCK_INIT;
+
+void* mmio_map(uintptr_t phys_addr, size_t size)
+{
+    uintptr_t first_page = phys_addr / PAGE_SIZE;
+    uintptr_t page_count = (phys_addr + size + PAGE_SIZE - 1) / PAGE_SIZE - first_page;
+
+    uint32_t flags = spin_lock_irqsave(&mmio_lock);
+    if (page_count == 0 || page_count > (MMIO_VIRT_END - next_free) / PAGE_SIZE)
+    {
+        spin_unlock_irqrestore(&mmio_lock, flags);
+        return NULL;
+    }
+    uintptr_t virt_addr = next_free;
+    next_free += page_count * PAGE_SIZE;
+    spin_unlock_irqrestore(&mmio_lock, flags);
+
+    for (uintptr_t i = 0; i < page_count; i++)
+    {
+        uint32_t virtual_page_index = virt_addr / PAGE_SIZE + i;
+        paging_map_kernel_page(first_page + i, virtual_page_index, true);
+
+        // Registers have side effects, the cpu must not cache or combine the accesses
+        page_table_entry* pte = get_pte(virtual_page_index);
+        pte->cache_disabled = 1;
+        pte->write_through = 1;
+        asm volatile("invlpg (%0)" :: "r"(virtual_page_index * PAGE_SIZE) : "memory");
+    }
+
+    return (void*)(virt_addr + phys_addr % PAGE_SIZE);
+}
+
+void* mmio_map_memory(uintptr_t phys_addr, size_t size)
+{
+    if (phys_addr + size <= LOW_MEMORY_END)
+        return (void*)(phys_addr + RELOCATION_OFFSET);
+
+    return mmio_map(phys_addr, size);
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// Device registers and firmware tables are mapped into the last kernel page table
+// before the recursive mapping, right after the end of the heap
+#define MMIO_VIRT_START 0xFF800000
+#define MMIO_VIRT_END   0xFFC00000
+
+// The boot page tables map this much physical memory at RELOCATION_OFFSET
+#define LOW_MEMORY_END  0x01800000
+
+// Maps size bytes of physical memory starting at phys_addr, uncached.
+// Mappings are never undone, returns NULL if the window is full
+void* mmio_map(uintptr_t phys_addr, size_t size);
+// For ordinary memory like firmware tables, reuses the boot mapping when it covers the range
+void* mmio_map_memory(uintptr_t phys_addr, size_t size);
@@ -1,4 +1,6 @@
 #include "paging.h"
+#include "cpu/cpuid/cpuid.h"
+#include "cpu/smp/smp.h"
 
 #define PAGE_DIR_ADDR    0xFFFFF000
 #define PAGE_TABLES_ADDR 0xFFC00000
@@ -6,15 +8,69 @@
 #define KERNEL_PAGE_DIR_PHYS_ADDR 0x00006000
 #define KERNEL_PAGE_TABLES_PHYS_ADDR 0x01100000
 
+#define CR4_PGE (1 << 7)
+
+#define KERNEL_FIRST_PDE (RELOCATION_OFFSET / PAGE_SIZE / PAGES_PER_TABLE)
+#define RECURSIVE_PDE    (PAGES_PER_DIR - 1)
+
 #define GET_PAGE_TABLE(vpn) ((page_table_entry*)(PAGE_TABLES_ADDR + ((vpn) / PAGES_PER_TABLE) * PAGE_SIZE))
 
 // The locations of the structures that work along all directories thanks to recursive mapping
 static const page_directory_entry* page_directory = (page_directory_entry*)PAGE_DIR_ADDR;
 static const page_table_entry* page_tables = (page_table_entry*)PAGE_TABLES_ADDR;
-// A variable to keep track of the virtual address (in the higher half) of the current pd
-// of the current process
-static page_directory_entry* current_page_directory = 
-(page_directory_entry*)(KERNEL_PAGE_DIR_PHYS_ADDR + RELOCATION_OFFSET);
+
+static inline void invalidate_page(uint32_t virtual_page_index)
+{
+    asm volatile("invlpg (%0)" :: "r"(virtual_page_index * PAGE_SIZE) : "memory");
+}
+
+/*
+ * Gives every kernel PDE its own page table and marks the kernel pages global.
+ * The boot code shares the first higher half page tables with the identity map, move them to the
+ * slots paging_map_page uses for them, so only higher half entries get the global bit.
+ * With every kernel PDE present up front, the copies in the process page directories never go
+ * stale, and with PGE the kernel's TLB entries survive CR3 reloads.
+ */
+void paging_init()
+{
+    page_directory_entry* kernel_pd = get_kernel_pd();
+
+    for (uint32_t pde = KERNEL_FIRST_PDE; pde < RECURSIVE_PDE; pde++)
+    {
+        uintptr_t table_phys_addr = KERNEL_PAGE_TABLES_PHYS_ADDR + pde * PAGE_SIZE;
+        page_table_entry* table = (page_table_entry*)(table_phys_addr + RELOCATION_OFFSET);
+
+        if (kernel_pd[pde].present && kernel_pd[pde].table_entry_address != table_phys_addr >> 12)
+        {
+            memcpy(table, (void*)((kernel_pd[pde].table_entry_address << 12) + RELOCATION_OFFSET), PAGE_SIZE);
+        }
+
+        for (uint32_t i = 0; i < PAGES_PER_TABLE; i++)
+        {
+            if (table[i].present)
+                table[i].global = 1;
+        }
+
+        // Never set the global bit on the PDE itself, the recursive mapping would turn it into a global page
+        kernel_pd[pde].table_entry_address = table_phys_addr >> 12;
+        kernel_pd[pde].read_write = 1;
+        kernel_pd[pde].present = 1;
+    }
+    smp_current_cpu()->page_directory = kernel_pd;
+    load_pd_phys_addr(get_current_pd_phys_addr());
+
+    paging_init_cpu();
+}
+
+void paging_init_cpu()
+{
+    if (cpuid_has_feature(CPUID_EDX_PGE))
+    {
+        asm volatile("mov %%cr4, %%eax\n"
+                     "or %0, %%eax\n"
+                     "mov %%eax, %%cr4" :: "i"(CR4_PGE) : "eax", "memory");
+    }
+}
 
 // page table addr can be NULL if the page is in the higher half (above 0xC0000000) 
 void paging_map_page(uint32_t physical_page_index, uint32_t virtual_page_index, 
@@ -39,12 +95,18 @@ void paging_map_page(uint32_t physical_page_index, uint32_t virtual_page_index,
     // Bit shifting is necessary to transfer
     page_table_entry* page_table = GET_PAGE_TABLE(virtual_page_index);
     page_table_entry* pt_entry = &page_table[virtual_page_index % 1024];
+    bool was_present = pt_entry->present;
 
     // Initialize the page table entry
     pt_entry->physical_page_address = physical_page_index;
     pt_entry->user_supervisor = !only_kernel_mode;
     pt_entry->present = 1;
     pt_entry->read_write = 1;
+    // Kernel pages are the same in every address space, keep them in the TLB across CR3 loads
+    pt_entry->global = virtual_page_index >= RELOCATION_OFFSET / PAGE_SIZE && only_kernel_mode;
+
+    if (was_present)
+        invalidate_page(virtual_page_index);
 
     // Set pd_entry values
     pd_entry->user_supervisor |= !only_kernel_mode; // if the entry is already with user permissions then keep it
@@ -83,6 +145,7 @@ void paging_unmap_page(uint32_t virtual_page_index)
     if (pte)
     {
         pte->present = 0;
+        invalidate_page(virtual_page_index);
     }
 }
 
@@ -110,6 +173,28 @@ uintptr_t get_physical_address(void* virtual_address)
     return (pt_entry->physical_page_address << 12) + ((uintptr_t)virtual_address % PAGE_SIZE);
 }
 
+bool is_user_range_mapped(const void* address, uint32_t size)
+{
+    uintptr_t start = (uintptr_t)address;
+    if (size == 0)
+        return true;
+    if (start >= RELOCATION_OFFSET || size > RELOCATION_OFFSET - start)
+        return false;
+
+    uint32_t last_page_index = (start + size - 1) / PAGE_SIZE;
+    for (uint32_t virtual_page_index = start / PAGE_SIZE; virtual_page_index <= last_page_index; virtual_page_index++)
+    {
+        const page_directory_entry* pd_entry = &page_directory[virtual_page_index / PAGES_PER_TABLE];
+        if (!pd_entry->present || !pd_entry->user_supervisor)
+            return false;
+
+        const page_table_entry* pt_entry = &GET_PAGE_TABLE(virtual_page_index)[virtual_page_index % PAGES_PER_TABLE];
+        if (!pt_entry->present || !pt_entry->user_supervisor)
+            return false;
+    }
+    return true;
+}
+
 // Wrappers for physical memory
 bool allocate_kernel_virtual_page(uint32_t virtual_page_index, bool supervisor_permissions)
 {
@@ -132,6 +217,7 @@ void deallocate_virtual_page(uint32_t virtual_page_index)
     {
         pmm_deallocate_page(pte->physical_page_address);
         pte->present = 0;
+        invalidate_page(virtual_page_index);
     }
 }
 
@@ -143,8 +229,13 @@ page_table_entry* get_pte(uint32_t virtual_page_index)
 
 inline void load_pd(page_directory_entry *pd)
 {
+    // A CR3 load flushes the TLB, don't pay for it when nothing changes
+    cpu_t* cpu = smp_current_cpu();
+    if (pd == cpu->page_directory)
+        return;
+
     uintptr_t phys_addr = get_physical_address(pd);
-    current_page_directory = pd;
+    cpu->page_directory = pd;
     load_pd_phys_addr(phys_addr);
 }
 
@@ -158,9 +249,10 @@ inline void load_pd_phys_addr(uintptr_t pd_phys_addr)
     );
 }
 
+// The virtual address (in the higher half) of the page directory this cpu has loaded
 inline page_directory_entry* get_current_pd()
 {
-    return current_page_directory;
+    return smp_current_cpu()->page_directory;
 }
 
 struct page_directory_entry* get_kernel_pd()
@@ -42,6 +42,11 @@ typedef struct page_table_entry
 #define PAGES_PER_TABLE 1024
 #define PAGES_PER_DIR	1024
 
+// Moves the kernel to its own global page tables, must run before any process is created
+void paging_init();
+// Turns on global pages on the cpu this runs on, paging_init does it for the boot cpu
+void paging_init_cpu();
+
 // Helper functions
 page_table_entry* get_pte(uint32_t virtual_page_index);
 
@@ -57,6 +62,9 @@ void paging_unmap_page(uint32_t virtual_page_index);
 // Physical memory wrappers
 page_table_entry* get_page_table(void* virtual_address);
 uintptr_t get_physical_address(void* virtual_address);
+// Whether the whole range is mapped for user mode in the current address space, below the kernel.
+// User pages are always writable, so it holds for reads and writes alike
+bool is_user_range_mapped(const void* address, uint32_t size);
 bool allocate_kernel_virtual_page(uint32_t virtual_page_index, bool supervisor_permissions);
 void deallocate_virtual_page(uint32_t virtual_page_index);
 
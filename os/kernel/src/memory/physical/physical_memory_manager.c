@@ -1,4 +1,5 @@
 #include "physical_memory_manager.h"
+#include "sync/spinlock.h"
 
 #define PAGE_SIZE           4096            // 4 KB pages
 #define PAGE_SIZE_BITS      12             // 2^12 = 4096
@@ -10,6 +11,9 @@ static pmm_info_t pmm_info = {0};
 
 static bool is_initialized = false;
 
+// The bitmap is shared by every cpu, and pages are also allocated with interrupts off
+static spinlock_t pmm_lock = SPINLOCK_INIT;
+
 pmm_status_t pmm_init(multiboot_info_t *mbi) {
     // Chekc if already initialized
     if (!mbi || is_initialized) {
@@ -108,21 +112,28 @@ int find_first_free_block() {
 
 // allocate a block (page frame)
 uint32_t pmm_allocate_page() {
+    uint32_t flags = spin_lock_irqsave(&pmm_lock);
     uint32_t page_index = find_first_free_block();
 
     if (page_index == -1)
+    {
+        spin_unlock_irqrestore(&pmm_lock, flags);
         return 0; // out of memory
+    }
 
     set_occupied(page_index);
     ++pmm_info.used_pages;
 
+    spin_unlock_irqrestore(&pmm_lock, flags);
     return page_index;
 }
 
 // free block (page frame)
 void pmm_deallocate_page(uint32_t page_index) {
+    uint32_t flags = spin_lock_irqsave(&pmm_lock);
     --pmm_info.used_pages;
     set_free(page_index);
+    spin_unlock_irqrestore(&pmm_lock, flags);
 }
 
 void set_bit_status(uint32_t bit_index, enum PAGE_STATUS status) {
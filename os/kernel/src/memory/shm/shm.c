@@ -0,0 +1,208 @@
+#include "shm.h"
+#include "memory/heap/heap.h"
+#include "memory/paging/paging.h"
+#include "sync/mutex.h"
+#include "errno.h"
+#include <string.h>
+#include <stddef.h>
+
+#define ALIGN_UP(size, alignment) (((size) + (alignment)-1) & ~((alignment)-1))
+
+// The named objects and every reference count, taken after the global fd table lock
+static lock_stats_t shm_lock_stats = LOCK_STATS_INIT("shm objects");
+static mutex_t shm_mutex = MUTEX_INIT_STATS(&shm_lock_stats);
+static shm_object_t* shm_objects = NULL;
+
+static shm_object_t* shm_alloc(const char* name);
+static void shm_put_locked(shm_object_t* shm);
+static int shm_resize_locked(shm_object_t* shm, uint32_t size);
+
+int shm_open_object(const char* name, bool create, bool exclusive, shm_object_t** result)
+{
+    size_t name_len = strlen(name);
+    if (name_len == 0 || strchr(name, '/') != NULL)
+        return -EINVAL;
+    if (name_len >= SHM_NAME_MAX)
+        return -ENAMETOOLONG;
+
+    mutex_lock(&shm_mutex);
+    shm_object_t* shm = shm_objects;
+    while (shm != NULL && strcmp(shm->name, name) != 0)
+    {
+        shm = shm->next;
+    }
+
+    if (shm != NULL)
+    {
+        if (create && exclusive)
+        {
+            mutex_unlock(&shm_mutex);
+            return -EEXIST;
+        }
+        shm->ref_count++;
+    }
+    else
+    {
+        if (!create)
+        {
+            mutex_unlock(&shm_mutex);
+            return -ENOENT;
+        }
+        shm = shm_alloc(name);
+        if (shm == NULL)
+        {
+            mutex_unlock(&shm_mutex);
+            return -ENOMEM;
+        }
+        shm->linked = true;
+        shm->next = shm_objects;
+        shm_objects = shm;
+    }
+    mutex_unlock(&shm_mutex);
+
+    *result = shm;
+    return 0;
+}
+
+shm_object_t* shm_create_anonymous(uint32_t size)
+{
+    shm_object_t* shm = shm_alloc("");
+    if (shm == NULL)
+        return NULL;
+
+    if (shm_resize_locked(shm, size) != 0)
+    {
+        kfree(shm);
+        return NULL;
+    }
+    return shm;
+}
+
+int shm_unlink_object(const char* name)
+{
+    mutex_lock(&shm_mutex);
+    shm_object_t** link = &shm_objects;
+    while (*link != NULL && strcmp((*link)->name, name) != 0)
+    {
+        link = &(*link)->next;
+    }
+
+    if (*link == NULL)
+    {
+        mutex_unlock(&shm_mutex);
+        return -ENOENT;
+    }
+
+    // The name goes now, the memory stays until whoever has it open or mapped lets it go
+    shm_object_t* shm = *link;
+    *link = shm->next;
+    shm->linked = false;
+    shm_put_locked(shm);
+    mutex_unlock(&shm_mutex);
+    return 0;
+}
+
+void shm_get(shm_object_t* shm)
+{
+    mutex_lock(&shm_mutex);
+    shm->ref_count++;
+    mutex_unlock(&shm_mutex);
+}
+
+void shm_put(shm_object_t* shm)
+{
+    mutex_lock(&shm_mutex);
+    shm_put_locked(shm);
+    mutex_unlock(&shm_mutex);
+}
+
+void shm_map_get(shm_object_t* shm)
+{
+    mutex_lock(&shm_mutex);
+    shm->ref_count++;
+    shm->map_count++;
+    mutex_unlock(&shm_mutex);
+}
+
+void shm_map_put(shm_object_t* shm)
+{
+    mutex_lock(&shm_mutex);
+    shm->map_count--;
+    shm_put_locked(shm);
+    mutex_unlock(&shm_mutex);
+}
+
+int shm_resize(shm_object_t* shm, uint32_t size)
+{
+    mutex_lock(&shm_mutex);
+    int r = shm_resize_locked(shm, size);
+    mutex_unlock(&shm_mutex);
+    return r;
+}
+
+uint32_t shm_page_frame(shm_object_t* shm, uint32_t page_index)
+{
+    return get_physical_address(shm->memory + page_index * PAGE_SIZE) / PAGE_SIZE;
+}
+
+static shm_object_t* shm_alloc(const char* name)
+{
+    shm_object_t* shm = kmalloc(sizeof(shm_object_t));
+    if (shm == NULL)
+        return NULL;
+
+    memset(shm, 0, sizeof(shm_object_t));
+    strncpy(shm->name, name, sizeof(shm->name) - 1);
+    // The name holds a reference of its own while it is linked, so the creator's is the second
+    shm->ref_count = name[0] != '\0' ? 2 : 1;
+    return shm;
+}
+
+static void shm_put_locked(shm_object_t* shm)
+{
+    if (--shm->ref_count > 0)
+        return;
+
+    if (shm->memory != NULL)
+        kfree(shm->memory);
+    kfree(shm);
+}
+
+static int shm_resize_locked(shm_object_t* shm, uint32_t size)
+{
+    uint32_t old_pages = ALIGN_UP(shm->size, PAGE_SIZE) / PAGE_SIZE;
+    uint32_t new_pages = ALIGN_UP(size, PAGE_SIZE) / PAGE_SIZE;
+
+    if (size > KERNEL_HEAP_END - KERNEL_CODE_END)
+        return -EINVAL;
+
+    if (old_pages != new_pages)
+    {
+        // The mappings point at the current frames, moving the memory would tear them apart
+        if (shm->map_count > 0)
+            return -EBUSY;
+
+        uint8_t* memory = NULL;
+        if (new_pages > 0)
+        {
+            memory = kmalloc_pages(new_pages);
+            if (memory == NULL)
+                return -ENOMEM;
+            memset(memory, 0, new_pages * PAGE_SIZE);
+            if (shm->memory != NULL)
+                memcpy(memory, shm->memory, (old_pages < new_pages ? old_pages : new_pages) * PAGE_SIZE);
+        }
+
+        if (shm->memory != NULL)
+            kfree(shm->memory);
+        shm->memory = memory;
+    }
+    else if (size < shm->size)
+    {
+        // What was cut off reads as zeros if the object grows back
+        memset(shm->memory + size, 0, shm->size - size);
+    }
+
+    shm->size = size;
+    return 0;
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SHM_PATH_PREFIX "/dev/shm/"
+#define SHM_NAME_MAX 64
+
+/*
+ * A shared memory object, memory that several processes map at once (POSIX shm_open()).
+ * Named objects live under /dev/shm/ until shm_unlink(), anonymous ones back MAP_ANONYMOUS
+ * mappings. The memory is a run of kernel heap pages, a mapping points straight at their frames,
+ * so a store in one process is seen by the others without any copy.
+ * The object is freed when its last reference goes: open fds and mappings each hold one.
+ */
+typedef struct shm_object {
+    char name[SHM_NAME_MAX];    // empty for anonymous objects
+    uint32_t ref_count;         // open fds and mappings
+    uint32_t map_count;         // mappings, the object can't be resized while it has any
+    uint32_t size;              // in bytes, set with ftruncate()
+    uint8_t* memory;            // the kernel address of the pages, NULL while the size is 0
+    bool linked;                // can still be found by name
+    struct shm_object* next;    // named objects list
+} shm_object_t;
+
+// Looks the name up, creates it if create is set. A new reference is returned in result
+int shm_open_object(const char* name, bool create, bool exclusive, shm_object_t** result);
+// A nameless zeroed object of size bytes for MAP_ANONYMOUS, with one reference
+shm_object_t* shm_create_anonymous(uint32_t size);
+int shm_unlink_object(const char* name);
+
+void shm_get(shm_object_t* shm);
+void shm_put(shm_object_t* shm);
+void shm_map_get(shm_object_t* shm);
+void shm_map_put(shm_object_t* shm);
+
+// Grows or shrinks the object, new memory reads as zeros
+int shm_resize(shm_object_t* shm, uint32_t size);
+// The physical page a page of the object lives in
+uint32_t shm_page_frame(shm_object_t* shm, uint32_t page_index);
@@ -3,6 +3,7 @@
 #include "process/elf/parser.h"
 #include "memory/physical/physical_memory_manager.h"
 #include "memory/heap/heap.h"
+#include "time/vdso.h"
 
 // returns the process' program break
 uintptr_t elf_load_process(const uint8_t* elf_content, uint32_t elf_len,
@@ -36,6 +37,9 @@ uintptr_t elf_load_process(const uint8_t* elf_content, uint32_t elf_len,
         kfree(process_page_tables);
         return 0;
     }
+
+    // the time page lives right above the stack, in the same page table
+    vdso_map(page_tables_phys_addr);
     
     for (uint32_t i = 0; i < header->e_shnum; i++)
     {
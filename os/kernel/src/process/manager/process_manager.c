@@ -5,21 +5,70 @@
 #include "cpu/gdt/gdt.h"
 #include "drivers/vga/vga.h"
 #include "process/syscalls/handlers/file/file.h"
+#include "filesystem/vfs/file.h"
 #include "terminal/terminal_manager.h"
-
-extern void jump_usermode(process_registers_t *addr);
-extern void jump_kernelmode(process_registers_t *addr);
+#include "cpu/pic/pic.h"
+#include "cpu/idt/irq.h"
+#include "cpu/idt/idt.h"
+#include "cpu/pit/pit.h"
+#include "cpu/smp/smp.h"
+#include "sync/spinlock.h"
+#include "sync/kernel_lock.h"
+#include "sync/atomic.h"
+#include "sync/futex.h"
+#include "memory/mmap/mmap.h"
+
+extern void jump_usermode(process_registers_t *addr, volatile bool* prev_on_cpu);
+extern void jump_kernelmode(process_registers_t *addr, volatile bool* prev_on_cpu);
 
 #define HIGHER_HALF_START 0xC0000000
 
+// The processes that are ready to run on one cpu, the one it is running isn't in it
+typedef struct run_queue {
+    spinlock_t lock;
+    process_node_t* head;
+    process_node_t* tail;
+    volatile uint32_t length;
+} run_queue_t;
+
+typedef struct sched_cpu {
+    run_queue_t run_queue;
+    process_node_t* current;
+    process_node_t* idle;   // runs when the run queue is empty and there is nothing to steal
+} sched_cpu_t;
+
 static process_node_t* process_list_head = NULL;
 static process_node_t* process_list_tail = NULL;
+// Interrupt handlers walk the list to wake processes up, so it has its own lock
+static lock_stats_t process_list_lock_stats = LOCK_STATS_INIT("process list");
+static spinlock_t process_list_lock = SPINLOCK_INIT_STATS(&process_list_lock_stats);
 static uint32_t next_pid = 1;
-static process_node_t* current_process_g = NULL;
+static sched_cpu_t sched_cpus[MAX_CPUS];
 static bool run_processes = false;
 
 static bool manage_initialized = false;
 
+// Kernel threads have no user memory or files of their own, they all share this
+static process_shared_t kthread_shared = { .ref_count = 1, .cwd = "/" };
+
+// Where a kernel thread starts, with its function and argument on the stack
+typedef void (*kthread_entry_t)(int (*thread_fn)(void* arg), void* arg);
+
+static void enqueue_new_process(process_node_t* node);
+static void schedule(sched_cpu_t* cpu, process_node_t* prev);
+static void jump_proc_wrapper(process_t* proc, volatile bool* prev_on_cpu);
+
+static inline sched_cpu_t* this_sched_cpu()
+{
+    return &sched_cpus[smp_cpu_id()];
+}
+
+// The process is the first member of its node
+static inline process_node_t* node_of(process_t* proc)
+{
+    return (process_node_t*)proc;
+}
+
 void add_to_linked_list(process_node_t* new_process_node)
 {
     if (!new_process_node) return; // Avoid NULL pointer issues
@@ -27,6 +76,7 @@ void add_to_linked_list(process_node_t* new_process_node)
     new_process_node->next = NULL;
     new_process_node->prev = NULL; // Initialize prev to avoid garbage value
 
+    uint32_t flags = spin_lock_irqsave(&process_list_lock);
     if (process_list_head == NULL)
     {
         process_list_head = new_process_node;
@@ -38,6 +88,9 @@ void add_to_linked_list(process_node_t* new_process_node)
         new_process_node->prev = process_list_tail; // Correctly set prev
         process_list_tail = new_process_node;
     }
+    spin_unlock_irqrestore(&process_list_lock, flags);
+
+    enqueue_new_process(new_process_node);
 }
 
 void proc_manager_init()
@@ -49,8 +102,11 @@ void proc_manager_init()
 
     manage_initialized= true;
 
+    if (!sched_init_cpu(0))
+        panic_screen("Can't create the idle thread");
+
     // register force_context_switch interrupt
-    register_isr_handler(0x69, switch_process);
+    register_isr_handler(FORCE_SWITCH_INTERRUPT, switch_process);
 }
 
 void init_proc_fd(file_descriptor *fd_table, size_t size)
@@ -70,6 +126,7 @@ static int remove_from_linked_list(process_node_t* proc_node)
 {
     if (!proc_node) return -1; // Handle NULL input
     
+    uint32_t flags = spin_lock_irqsave(&process_list_lock);
     if (proc_node == process_list_head) {
         process_list_head = proc_node->next;
     }
@@ -85,10 +142,162 @@ static int remove_from_linked_list(process_node_t* proc_node)
     if (proc_node->next) {
         proc_node->next->prev = proc_node->prev;
     }
+    spin_unlock_irqrestore(&process_list_lock, flags);
 
     return 0;
 }
 
+// All the run queue helpers need the queue's lock
+static void run_queue_push(run_queue_t* rq, process_node_t* node)
+{
+    if (node->proc.on_run_queue)
+        return;
+
+    node->run_next = NULL;
+    node->run_prev = rq->tail;
+    if (rq->tail != NULL)
+        rq->tail->run_next = node;
+    else
+        rq->head = node;
+    rq->tail = node;
+    rq->length++;
+    node->proc.on_run_queue = true;
+}
+
+static void run_queue_remove(run_queue_t* rq, process_node_t* node)
+{
+    if (!node->proc.on_run_queue)
+        return;
+
+    if (node->run_prev != NULL)
+        node->run_prev->run_next = node->run_next;
+    else
+        rq->head = node->run_next;
+    if (node->run_next != NULL)
+        node->run_next->run_prev = node->run_prev;
+    else
+        rq->tail = node->run_prev;
+
+    node->run_next = NULL;
+    node->run_prev = NULL;
+    rq->length--;
+    node->proc.on_run_queue = false;
+}
+
+// Takes the first process no other cpu is still switching away from, self is the process this cpu runs
+static process_node_t* run_queue_pop(run_queue_t* rq, process_node_t* self)
+{
+    for (process_node_t* iter = rq->head; iter != NULL; iter = iter->run_next)
+    {
+        if (!iter->proc.on_cpu || iter == self)
+        {
+            run_queue_remove(rq, iter);
+            return iter;
+        }
+    }
+    return NULL;
+}
+
+// New processes go to the cpu with the shortest run queue
+static void enqueue_new_process(process_node_t* node)
+{
+    uint32_t target = 0;
+    for (uint32_t id = 1; id < smp_cpu_count(); id++)
+    {
+        if (sched_cpus[id].run_queue.length < sched_cpus[target].run_queue.length)
+            target = id;
+    }
+
+    run_queue_t* rq = &sched_cpus[target].run_queue;
+    uint32_t flags = spin_lock_irqsave(&rq->lock);
+    node->proc.cpu = target;
+    node->proc.state = PROCESS_READY;
+    run_queue_push(rq, node);
+    bool idle = sched_cpus[target].current == sched_cpus[target].idle;
+    spin_unlock_irqrestore(&rq->lock, flags);
+
+    if (idle)
+        smp_send_reschedule(target);
+}
+
+// Puts a process that waits in the given state back on its run queue, returns false if it wasn't in it
+static bool wake_process(process_node_t* node, process_state_t from)
+{
+    // A waiting process doesn't move between cpus, the queue can't change under our feet
+    uint32_t cpu_id = node->proc.cpu;
+    sched_cpu_t* cpu = &sched_cpus[cpu_id];
+
+    uint32_t flags = spin_lock_irqsave(&cpu->run_queue.lock);
+    bool woken = node->proc.state == from;
+    if (woken)
+    {
+        node->proc.state = PROCESS_READY;
+        run_queue_push(&cpu->run_queue, node);
+    }
+    bool idle = cpu->current == cpu->idle;
+    spin_unlock_irqrestore(&cpu->run_queue.lock, flags);
+
+    // A halted cpu only looks at its run queue again on an interrupt
+    if (woken && idle)
+        smp_send_reschedule(cpu_id);
+    return woken;
+}
+
+// The current process went to sleep but found out it doesn't have to, undo a wake up that came in between
+static void keep_running(process_node_t* node)
+{
+    run_queue_t* rq = &this_sched_cpu()->run_queue;
+
+    uint32_t flags = spin_lock_irqsave(&rq->lock);
+    run_queue_remove(rq, node);
+    node->proc.state = PROCESS_RUNNING;
+    spin_unlock_irqrestore(&rq->lock, flags);
+}
+
+static void wake_sleeping_process(ktimer_t* timer)
+{
+    wake_process(node_of((process_t*)timer->data), PROCESS_SLEEPING);
+}
+
+static void alarm_expired(ktimer_t* timer)
+{
+    process_t* proc = (process_t*)timer->data;
+
+    atomic_add(&proc->pending_alarms, 1);
+    if (proc->alarm_interval)
+        timer_add(timer, timer->expires + proc->alarm_interval);
+
+    // There are no signal handlers, so an alarm just interrupts whatever sleep the process is in
+    if (proc->state == PROCESS_SLEEPING)
+    {
+        timer_cancel(&proc->sleep_timer);
+        wake_process(node_of(proc), PROCESS_SLEEPING);
+    }
+}
+
+// Everything a new process starts with, no matter where its code comes from
+static void init_process_fields(process_t* proc)
+{
+    proc->pid = next_pid++;
+    proc->parent_pid = get_current_process() ? get_current_process()->pid : 0;
+    proc->state = PROCESS_READY;
+    proc->cpu = 0;
+    proc->on_cpu = false;
+    proc->on_run_queue = false;
+    proc->kernel_lock_depth = 0;
+    proc->is_kthread = false;
+    proc->in_syscall = false;
+    proc->shared = NULL;
+    proc->clear_child_tid = NULL;
+    proc->regs = (process_registers_t){0};
+    proc->acct = (process_accounting_t){0};
+    proc->children_acct = (process_accounting_t){0};
+    proc->alarm_interval = 0;
+    proc->pending_alarms = 0;
+    proc->fpu = (fpu_state_t){0};
+    timer_init(&proc->sleep_timer, wake_sleeping_process, proc);
+    timer_init(&proc->alarm_timer, alarm_expired, proc);
+}
 
 static bool create_process_from_elf(const uint8_t* elf_content, uint32_t elf_len, int flags, bool is_kernel_mode)
 {
@@ -111,50 +320,64 @@ static bool create_process_from_elf(const uint8_t* elf_content, uint32_t elf_len
         return false;
     }
 
-    memset(new_process_node->proc.cwd, 0, 256);
-    strcpy(new_process_node->proc.cwd, "/");
+    process_shared_t* shared = kmalloc(sizeof(process_shared_t));
+    if (shared == NULL)
+    {
+        kfree(new_process_node);
+        return false;
+    }
+    memset(shared, 0, sizeof(process_shared_t));
+    strcpy(shared->cwd, "/");
 
     elf_hdr* elf_header = elf_get_header(elf_content);
 
-    new_process_node->proc.pid = next_pid++;
-    new_process_node->proc.state = PROCESS_READY;
-    new_process_node->proc.regs = (process_registers_t){0};
+    init_process_fields(&new_process_node->proc);
+    new_process_node->proc.shared = shared;
+    shared->ref_count = 1;
+    shared->pid = new_process_node->proc.pid;
     
     new_process_node->proc.kernel_stack = kmalloc_pages(PROC_KERNEL_STACK_SIZE) + PAGE_SIZE * PROC_KERNEL_STACK_SIZE;
-    new_process_node->proc.page_directory = (struct page_directory_entry*)kmalloc_pages(1);
-    if (new_process_node->proc.page_directory == NULL)
+    shared->page_directory = (struct page_directory_entry*)kmalloc_pages(1);
+    if (shared->page_directory == NULL)
     {
+        kfree(shared);
         kfree(new_process_node);
         return false;
     }
 
     // Copy the kernel page directory entries
     // [0x300] - [0x400] entries are for the kernel
-    memcpy(&new_process_node->proc.page_directory[HIGHER_HALF_START / PAGE_SIZE / PAGES_PER_DIR],
+    memcpy(&shared->page_directory[HIGHER_HALF_START / PAGE_SIZE / PAGES_PER_DIR],
         &kernel_pd[HIGHER_HALF_START / PAGE_SIZE / PAGES_PER_DIR], 
         sizeof(struct page_directory_entry) * (PAGES_PER_DIR - (HIGHER_HALF_START / PAGE_SIZE / PAGES_PER_DIR)));
     
     // Implement recursive mapping (map the last entry to the page directory itself)
-    new_process_node->proc.page_directory[PAGES_PER_DIR - 1].table_entry_address 
-        = (get_physical_address(new_process_node->proc.page_directory) >> 12);
+    shared->page_directory[PAGES_PER_DIR - 1].table_entry_address 
+        = (get_physical_address(shared->page_directory) >> 12);
 
-    load_pd(new_process_node->proc.page_directory);
+    load_pd(shared->page_directory);
 
     // Load process to memory
-    uintptr_t process_break = elf_load_process(elf_content, elf_len, new_process_node->proc.page_directory, is_kernel_mode);
+    uintptr_t process_break = elf_load_process(elf_content, elf_len, shared->page_directory, is_kernel_mode);
     load_pd(kernel_pd);
 
     if (process_break == 0)
     {
-        kfree(new_process_node->proc.page_directory);
+        kfree(shared->page_directory);
+        kfree(shared);
         kfree(new_process_node);
         return false;
     }
 
-    new_process_node->proc.process_break = process_break;
+    shared->process_break = process_break;
     
-    init_proc_fd(new_process_node->proc.fd_table, MAX_LOCAL_FD);
+    init_proc_fd(shared->fd_table, MAX_LOCAL_FD);
     attach_process_to_terminal(get_active_terminal_id(), &new_process_node->proc);
+    // Like a fork and exec, the new process starts with the files of the one that ran it,
+    // that's how the shell hands a program a pipe or a file as its stdin and stdout
+    process_t* parent = get_current_process();
+    if (parent != NULL && !parent->is_kthread)
+        fd_table_copy(shared->fd_table, parent->shared->fd_table, MAX_LOCAL_FD);
     
     new_process_node->proc.regs.eip = elf_header->e_entry;
     new_process_node->proc.regs.esp = USER_STACK_TOP - 4;
@@ -173,16 +396,17 @@ static bool create_process_from_elf(const uint8_t* elf_content, uint32_t elf_len
     }
     new_process_node->proc.regs.eflags = 0x0202; // interrupt enable flag + reserved flag
     
-    add_to_linked_list(new_process_node);
-
-    load_pd(prev_pd);
-
+    // Waiting before the child is queued, another cpu may run it to the end right away
     if (get_current_process() != NULL)
     {   
         get_current_process()->waiting_for = new_process_node->proc.pid;
         get_current_process()->state = PROCESS_WAITING;
     }
 
+    add_to_linked_list(new_process_node);
+
+    load_pd(prev_pd);
+
     return true;
 }
 
@@ -232,21 +456,208 @@ int create_kernelmode_process(const char* path, int flags)
     return create_process(path, flags, true);
 }
 
-static void free_proc_node(process_t* process)
+// Kernel threads start here, with the function and its argument on their stack
+static void kthread_start(int (*thread_fn)(void* arg), void* arg)
 {
-    kfree(process->page_directory); // TODO: Free page tables
-    kfree(process);
+    // Kernel threads run kernel code in process context, just like syscalls
+    kernel_lock();
+    thread_fn(arg);
+    exit_current_process();
+}
+
+// Idle threads halt until the next interrupt, they never hold the kernel lock.
+// Same frame as kthread_start, neither argument is used
+static void idle_loop(int (*thread_fn)(void* arg), void* arg)
+{
+    while (true)
+        asm volatile("sti\n"
+                     "hlt");
+}
+
+static process_node_t* kthread_alloc(kthread_entry_t entry, int (*thread_fn)(void* arg), void* arg)
+{
+    process_node_t* new_thread_node = kmalloc(sizeof(process_node_t));
+    if (new_thread_node == NULL)
+        return NULL;
+
+    process_t* thread = &new_thread_node->proc;
+    memset(thread, 0, sizeof(process_t));
+    init_process_fields(thread);
+    thread->is_kthread = true;
+    thread->is_kernel_mode = true;
+
+    // Kernel threads only touch kernel memory, which is the same in every page directory
+    kthread_shared.page_directory = get_kernel_pd();
+    thread->shared = &kthread_shared;
+
+    void* stack = kmalloc_pages(PROC_KERNEL_STACK_SIZE);
+    if (stack == NULL)
+    {
+        kfree(new_thread_node);
+        return NULL;
+    }
+    thread->kernel_stack = stack + PAGE_SIZE * PROC_KERNEL_STACK_SIZE;
+
+    // The frame the entry expects: return address (never used), thread_fn, arg
+    uint32_t* stack_top = (uint32_t*)thread->kernel_stack;
+    *--stack_top = (uint32_t)arg;
+    *--stack_top = (uint32_t)thread_fn;
+    *--stack_top = 0;
+
+    thread->regs.eip = (uint32_t)entry;
+    thread->regs.esp = (uint32_t)stack_top;
+    thread->regs.cs = GDT_KERNEL_CODE_INDEX;
+    thread->regs.ss = GDT_KERNEL_DATA_INDEX;
+    thread->regs.eflags = 0x0202; // interrupt enable flag + reserved flag
+
+    return new_thread_node;
+}
+
+process_t* create_thread(const struct int_registers* regs, uintptr_t stack)
+{
+    process_t* parent = get_current_process();
+    if (!manage_initialized || parent == NULL || parent->is_kthread)
+        return NULL;
+
+    process_node_t* new_thread_node = kmalloc(sizeof(process_node_t));
+    if (new_thread_node == NULL)
+        return NULL;
+
+    void* kernel_stack = kmalloc_pages(PROC_KERNEL_STACK_SIZE);
+    if (kernel_stack == NULL)
+    {
+        kfree(new_thread_node);
+        return NULL;
+    }
+
+    process_t* thread = &new_thread_node->proc;
+    memset(thread, 0, sizeof(process_t));
+    init_process_fields(thread);
+    // A sibling, not a child: the parent waits on the whole process
+    thread->parent_pid = parent->parent_pid;
+    thread->terminal_id = parent->terminal_id;
+    thread->is_kernel_mode = parent->is_kernel_mode;
+    thread->kernel_stack = kernel_stack + PAGE_SIZE * PROC_KERNEL_STACK_SIZE;
+    thread->shared = parent->shared;
+    atomic_add(&parent->shared->ref_count, 1);
+
+    copy_registers(regs, &thread->regs);
+    thread->regs.eax = 0;
+    thread->regs.esp = stack;
+    // sysenter comes in with interrupts off, the pushed flags don't have them on
+    thread->regs.eflags |= 0x0200;
+
+    return thread;
+}
+
+void start_thread(process_t* thread)
+{
+    add_to_linked_list(node_of(thread));
+}
+
+process_t* kthread_create(int (*thread_fn)(void* arg), void* arg)
+{
+    if (!manage_initialized)
+        return NULL;
+
+    process_node_t* new_thread_node = kthread_alloc(kthread_start, thread_fn, arg);
+    if (new_thread_node == NULL)
+        return NULL;
+
+    add_to_linked_list(new_thread_node);
+    return &new_thread_node->proc;
+}
+
+// The idle thread isn't in the process list and never in a run queue, the scheduler falls back to it
+bool sched_init_cpu(uint32_t cpu_id)
+{
+    sched_cpu_t* cpu = &sched_cpus[cpu_id];
+
+    spin_init(&cpu->run_queue.lock);
+    cpu->run_queue.head = NULL;
+    cpu->run_queue.tail = NULL;
+    cpu->run_queue.length = 0;
+    cpu->current = NULL;
+
+    cpu->idle = kthread_alloc(idle_loop, NULL, NULL);
+    if (cpu->idle == NULL)
+        return false;
+
+    cpu->idle->proc.pid = 0;
+    cpu->idle->proc.cpu = cpu_id;
+    cpu->idle->proc.state = PROCESS_RUNNING;
+    return true;
+}
+
+void sched_start_cpu()
+{
+    sched_cpu_t* cpu = this_sched_cpu();
+
+    disable_interrupts();
+    cpu->current = cpu->idle;
+    cpu->idle->proc.on_cpu = true;
+    jump_proc_wrapper(&cpu->idle->proc, NULL);
+}
+
+void wake_up_process(process_t* proc)
+{
+    wake_process(node_of(proc), PROCESS_SLEEPING);
+}
+
+static process_node_t* find_process_node(uint32_t pid)
+{
+    for (process_node_t* iter = process_list_head; iter != NULL; iter = iter->next)
+    {
+        if (iter->proc.pid == pid)
+            return iter;
+    }
+    return NULL;
 }
 
-static void jump_proc_wrapper(process_t* proc)
+// Add the cpu usage of an exiting process (and of its own children) to its parent
+static void charge_parent_accounting(process_t* child)
 {
-    load_pd(proc->page_directory);
-    tss_fill_esp0((uint32_t)proc->kernel_stack);
+    uint32_t flags = spin_lock_irqsave(&process_list_lock);
+    process_node_t* parent = find_process_node(child->parent_pid);
+    if (parent == NULL)
+    {
+        spin_unlock_irqrestore(&process_list_lock, flags);
+        return;
+    }
 
-    if (proc->is_kernel_mode)
-        jump_kernelmode(&proc->regs);
+    process_accounting_t* total = &parent->proc.children_acct;
+    total->user_ticks += child->acct.user_ticks + child->children_acct.user_ticks;
+    total->system_ticks += child->acct.system_ticks + child->children_acct.system_ticks;
+    total->voluntary_switches += child->acct.voluntary_switches + child->children_acct.voluntary_switches;
+    total->involuntary_switches += child->acct.involuntary_switches + child->children_acct.involuntary_switches;
+    spin_unlock_irqrestore(&process_list_lock, flags);
+}
+
+static void free_proc_node(process_t* process, bool last_thread)
+{
+    // Kernel threads borrow the kernel page directory, user threads leave it to the last of them
+    if (last_thread)
+    {
+        kfree(process->shared->page_directory); // TODO: Free page tables
+        kfree(process->shared);
+    }
+    kfree(process);
+}
+
+static void jump_proc_wrapper(process_t* proc, volatile bool* prev_on_cpu)
+{
+    // load_pd skips the CR3 load when the page directory is already loaded, so switching between
+    // sibling threads, which share it, keeps the TLB
+    load_pd(proc->shared->page_directory);
+    tss_set_esp0((uint32_t)proc->kernel_stack);
+    fpu_switch_to(&proc->fpu);
+
+    // A user process can also be stopped in ring 0, in the middle of a syscall.
+    // The jump clears prev_on_cpu once it is off the previous process' stack
+    if ((proc->regs.cs & 0b11) == 0)
+        jump_kernelmode(&proc->regs, prev_on_cpu);
     else
-        jump_usermode(&proc->regs);
+        jump_usermode(&proc->regs, prev_on_cpu);
 }
 
 
@@ -254,41 +665,97 @@ int exit_proc(process_node_t* exiting_proc)
 {
     if (!exiting_proc) return -EINVAL; // Validate input
     //vga_printf("Exiting process %d\n", exiting_proc->proc.pid);
-    // Check if there are any processes left
-    if (!process_list_head) {
-        panic_screen("No process running, Reboot PC1!!!");
+
+    process_t* proc = &exiting_proc->proc;
+    bool last_thread = !proc->is_kthread && atomic_sub(&proc->shared->ref_count, 1) == 1;
+    // Closing a pipe end wakes the other side, and the fd table and shm locks may sleep, so before
+    // the interrupts go off
+    if (last_thread)
+    {
+        mmap_release_all(proc->shared);
+        fd_table_release(proc->shared->fd_table, MAX_LOCAL_FD);
     }
 
-    wake_up_waiting_processes(exiting_proc->proc.pid);
+    // Kernel threads exit with interrupts on
+    disable_interrupts();
 
-    // Switch to the next process in the list
-    if (current_process_g->next) {
-        current_process_g = current_process_g->next;
-    } else {
-        current_process_g = process_list_head;
+    // A join waits for this word to clear, the thread's page directory is still the loaded one
+    if (proc->clear_child_tid != NULL && get_physical_address(proc->clear_child_tid) != 0)
+    {
+        *proc->clear_child_tid = 0;
+        futex_wake(proc->clear_child_tid, 1);
     }
 
-    if (!current_process_g) {
-        panic_screen("No process running, Reboot PC2!!!");
-    }
+    timer_cancel(&proc->sleep_timer);
+    timer_cancel(&proc->alarm_timer);
+    fpu_release(&proc->fpu);
+    charge_parent_accounting(proc);
+
+    // The parent waits for the process, which is over once its last thread is
+    if (last_thread)
+        wake_up_waiting_processes(proc->shared->pid);
+
+    sched_cpu_t* cpu = this_sched_cpu();
+    // A wake up that raced with the exit may have queued it again
+    spin_lock(&cpu->run_queue.lock);
+    exiting_proc->proc.state = PROCESS_TERMINATED;
+    run_queue_remove(&cpu->run_queue, exiting_proc);
+    cpu->current = NULL;
+    spin_unlock(&cpu->run_queue.lock);
 
     load_pd(get_kernel_pd());
     remove_from_linked_list(exiting_proc);
-    free_proc_node(&exiting_proc->proc);
+    kernel_lock_release_all();
+    // Still running on its kernel stack, only the process itself can go
+    free_proc_node(proc, last_thread);
 
-    jump_proc_wrapper(&current_process_g->proc);
+    schedule(cpu, NULL);
+    return 0;
 }
 
 void exit_current_process()
 {
-    process_node_t* exiting_proc = current_process_g;
+    process_node_t* exiting_proc = this_sched_cpu()->current;
     exit_proc(exiting_proc);
 }
 
+void exit_current_thread_group()
+{
+    process_t* proc = get_current_process();
+    process_shared_t* shared = proc->shared;
+
+    shared->exiting = true;
+
+    uint32_t flags = spin_lock_irqsave(&process_list_lock);
+    for (process_node_t* iter = process_list_head; iter != NULL; iter = iter->next)
+    {
+        if (iter->proc.shared != shared || &iter->proc == proc)
+            continue;
+
+        // Sleepers and readers exit on their way out of the syscall, the rest the next time they
+        // are scheduled, which the reschedule makes come sooner for the running ones
+        if (!wake_process(iter, PROCESS_SLEEPING))
+            wake_process(iter, PROCESS_BLOCKED);
+        if (iter->proc.state == PROCESS_RUNNING && iter->proc.cpu != smp_cpu_id())
+            smp_send_reschedule(iter->proc.cpu);
+    }
+    spin_unlock_irqrestore(&process_list_lock, flags);
+
+    exit_current_process();
+}
+
+// Where a thread whose process is exiting goes instead of back to user space
+static void exit_thread_of_exiting_group()
+{
+    kernel_lock();
+    exit_current_process();
+}
+
 inline process_t* get_current_process()
 {
-    if (current_process_g)
-        return &current_process_g->proc;
+    process_node_t* current = this_sched_cpu()->current;
+    if (current)
+        return &current->proc;
     return NULL;
 }
 
@@ -297,85 +764,164 @@ inline void force_switch_process()
     asm("int $0x69");
 }
 
-void wake_up_terminal_processes(uint32_t terminal_id)
+// Sleep for at least the given amount of ticks, returns false if an alarm cut the sleep short
+bool sleep_current_process(uint32_t ticks)
 {
-    process_node_t* iter = current_process_g;
+    process_t* proc = get_current_process();
+    uint32_t alarms = proc->pending_alarms;
 
-    do {
-        if (iter->proc.state == PROCESS_BLOCKED)
-        {
-            if (iter->proc.terminal_id == terminal_id)
-                iter->proc.state = PROCESS_READY;
-        }
-        if (iter->next != NULL)
-        {
-            iter = iter->next;
-        }
-        else
-        {
-            iter = process_list_head;
-        }
-    } while(iter != current_process_g);
+    // Asleep before the timer is armed, so a timer that fires right away still finds it asleep
+    proc->state = PROCESS_SLEEPING;
+    // +1 since the current tick is already partly over
+    timer_add(&proc->sleep_timer, get_system_ticks() + ticks + 1);
+    force_switch_process();
+
+    return proc->pending_alarms == alarms;
+}
+
+// Wait for the next alarm, returns right away if one already fired
+void pause_current_process()
+{
+    process_t* proc = get_current_process();
+
+    // Asleep before checking, so an alarm that fires in between still wakes it up
+    proc->state = PROCESS_SLEEPING;
+    while (proc->pending_alarms == 0)
+    {
+        force_switch_process();
+        proc->state = PROCESS_SLEEPING;
+    }
+    keep_running(node_of(proc));
+    atomic_sub(&proc->pending_alarms, 1);
+}
+
+// Called on every timer tick, charges the tick to the running process
+void account_process_tick()
+{
+    sched_cpu_t* cpu = this_sched_cpu();
+    if (!run_processes || cpu->current == NULL || cpu->current == cpu->idle)
+        return;
+
+    if (cpu->current->proc.in_syscall)
+        cpu->current->proc.acct.system_ticks++;
+    else
+        cpu->current->proc.acct.user_ticks++;
 }
 
 void wake_up_waiting_processes(uint32_t wait_for_pid)
 {
-    process_node_t* iter = current_process_g;
+    uint32_t flags = spin_lock_irqsave(&process_list_lock);
+    for (process_node_t* iter = process_list_head; iter != NULL; iter = iter->next)
+    {
+        if (iter->proc.waiting_for == wait_for_pid && wake_process(iter, PROCESS_WAITING))
+            iter->proc.waiting_for = 0;
+    }
+    spin_unlock_irqrestore(&process_list_lock, flags);
+}
+
+// Take a process from the longest run queue of another cpu
+static process_node_t* steal_process(sched_cpu_t* thief)
+{
+    uint32_t thief_id = thief - sched_cpus;
+    sched_cpu_t* victim = NULL;
+    uint32_t longest = 0;
 
-    do {
-        if (iter->proc.state == PROCESS_WAITING)
-        {
-            if (iter->proc.waiting_for == wait_for_pid)
-            {   
-                iter->proc.state = PROCESS_READY;
-                iter->proc.waiting_for = 0;
-            }
-        }
-        if (iter->next != NULL)
-        {
-            iter = iter->next;
-        }
-        else
+    for (uint32_t id = 0; id < smp_cpu_count(); id++)
+    {
+        if (id != thief_id && sched_cpus[id].run_queue.length > longest)
         {
-            iter = process_list_head;
+            longest = sched_cpus[id].run_queue.length;
+            victim = &sched_cpus[id];
         }
-    } while(iter != current_process_g);
+    }
+    if (victim == NULL)
+        return NULL;
+
+    // The victim may be stealing from us at the same time, trylock so the two can't deadlock
+    if (!spin_trylock(&victim->run_queue.lock))
+        return NULL;
+
+    process_node_t* node = run_queue_pop(&victim->run_queue, NULL);
+    if (node != NULL)
+        node->proc.cpu = thief_id;
+    spin_unlock(&victim->run_queue.lock);
+    return node;
 }
 
+// Picks what runs next on this cpu and jumps to it, must be called with interrupts off
+static void schedule(sched_cpu_t* cpu, process_node_t* prev)
+{
+    run_queue_t* rq = &cpu->run_queue;
+
+    spin_lock(&rq->lock);
+    // only if process was running, set it as ready (if its blocked then dont run ofc)
+    if (prev != NULL && prev != cpu->idle && prev->proc.state == PROCESS_RUNNING)
+    {
+        prev->proc.state = PROCESS_READY;
+        run_queue_push(rq, prev);
+    }
+
+    process_node_t* next = run_queue_pop(rq, prev);
+    if (next == NULL)
+        next = steal_process(cpu);
+    if (next == NULL)
+        next = cpu->idle;
+
+    next->proc.state = PROCESS_RUNNING;
+    next->proc.on_cpu = true;
+    cpu->current = next;
+    spin_unlock(&rq->lock);
+
+    volatile bool* prev_on_cpu = NULL;
+    if (prev != NULL && prev != next)
+    {
+        fpu_switch_from(&prev->proc.fpu);
+        prev_on_cpu = &prev->proc.on_cpu;
+    }
+
+    // Another thread called exit_group(), so instead of going back to user space this one exits
+    // too. Nothing on its kernel stack is needed anymore and the exit never returns
+    if (next->proc.shared->exiting && (next->proc.regs.cs & 0b11) != 0)
+    {
+        next->proc.regs.eip = (uint32_t)exit_thread_of_exiting_group;
+        next->proc.regs.esp = (uint32_t)next->proc.kernel_stack - sizeof(uint32_t);
+        next->proc.regs.cs = GDT_KERNEL_CODE_INDEX;
+        next->proc.regs.ss = GDT_KERNEL_DATA_INDEX;
+        next->proc.regs.eflags = 0x0202; // interrupt enable flag + reserved flag
+    }
+
+    // A process stopped inside a syscall gets its kernel lock back before it continues
+    if ((next->proc.regs.cs & 0b11) == 0)
+    {
+        kernel_lock_reacquire(next->proc.kernel_lock_depth);
+        next->proc.kernel_lock_depth = 0;
+    }
+
+    jump_proc_wrapper(&next->proc, prev_on_cpu);
+}
 
 void switch_process(struct int_registers* regs)
 {
-    if (process_list_head == NULL)
+    sched_cpu_t* cpu = this_sched_cpu();
+    process_node_t* prev = cpu->current;
+
+    // Still booting, nothing to switch to yet
+    if (prev == NULL && process_list_head == NULL)
         return;
 
-    if (current_process_g == NULL)
+    if (prev != NULL)
     {
-        current_process_g = process_list_head;
-        if (current_process_g->proc.state == PROCESS_READY)
-            goto switch_label;
-    }
-    else
-    {
-        if (current_process_g->proc.state == PROCESS_RUNNING) // only if process was running, set it as ready (if its blocked then dont run ofc)
-            current_process_g->proc.state = PROCESS_READY;
+        copy_registers(regs, &prev->proc.regs);
+        prev->proc.kernel_lock_depth = kernel_lock_release_all();
 
-        copy_registers(regs, &current_process_g->proc.regs);
-        do
-        {
-            if (current_process_g->next != NULL)
-            {
-                current_process_g = current_process_g->next;
-            }
-            else
-            {
-                current_process_g = process_list_head;
-            }
-        } while (current_process_g->proc.state != PROCESS_READY);
+        // int 0x69 is the process giving up the cpu, everything else (timer, reschedule IPI) preempts it
+        if (regs->interrupt == FORCE_SWITCH_INTERRUPT)
+            prev->proc.acct.voluntary_switches++;
+        else
+            prev->proc.acct.involuntary_switches++;
     }
 
-switch_label:
-    current_process_g->proc.state = PROCESS_RUNNING;
-    jump_proc_wrapper(&current_process_g->proc);
+    schedule(cpu, prev);
 }
 
 
@@ -391,8 +937,19 @@ void copy_registers(const struct int_registers *src, process_registers_t *dst) {
     dst->eip = src->eip;
     dst->cs = src->cs;
     dst->eflags = src->eflags;
-    dst->esp = src->esp;
-    dst->ss = src->ss;
+
+    // The cpu only pushes esp and ss when the privilege changes, an interrupt in ring 0
+    // leaves the stack right where the frame ends
+    if ((src->cs & 0b11) == 0)
+    {
+        dst->esp = (uint32_t)&src->esp;
+        dst->ss = GDT_KERNEL_DATA_INDEX;
+    }
+    else
+    {
+        dst->esp = src->esp;
+        dst->ss = src->ss;
+    }
 }
 
 void enable_processes()
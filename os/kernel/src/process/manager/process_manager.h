@@ -3,21 +3,37 @@
 #include "memory/paging/paging.h"
 #include "filesystem/fat/fat.h"
 #include "cpu/idt/isr.h"
+#include "time/timer.h"
+#include "cpu/fpu/fpu.h"
 
 #define MAX_GLOB_FD 256
 #define MAX_LOCAL_FD 128
 #define PROC_KERNEL_STACK_SIZE 2
+#define FORCE_SWITCH_INTERRUPT 0x69
 typedef enum {
     PROCESS_RUNNING,
     PROCESS_READY,
     PROCESS_BLOCKED,
     PROCESS_WAITING,
+    PROCESS_SLEEPING,   // off the run queue until a timer, an alarm or wake_up_process() wakes it
     PROCESS_TERMINATED
 } process_state_t;
 
+struct pipe;
+struct shm_object;
+struct poll_table;
+struct mmap_region;
+
 typedef struct global_file_descriptor_t {
     int (*_read)(void *buf, uint32_t count, uint32_t off, struct global_file_descriptor_t* glob_fd); // the read function of the fd
+    int (*_write)(const void *buf, uint32_t count, uint32_t off, struct global_file_descriptor_t* glob_fd); // NULL for FAT files
+    void (*_release)(struct global_file_descriptor_t* glob_fd); // called when the last reference goes, can be NULL
+    uint32_t (*_poll)(struct global_file_descriptor_t* glob_fd, struct poll_table* table); // readiness for poll(), NULL if it never blocks
+    int (*_ioctl)(struct global_file_descriptor_t* glob_fd, uint32_t request, void* arg); // device control, NULL for anything but terminals
+    struct pipe* pipe;      // the pipe this is an end of, NULL for anything else
+    struct shm_object* shm; // the shared memory object this is open on, NULL for anything else
     FileData file;
+    fat_write_buffer_t write_buffer; // appends to a FAT file not on the disk yet, see writeback_schedule()
     int ref_count;
     char path[256];
     bool is_dir;
@@ -29,6 +45,7 @@ typedef struct file_descriptor_t {
     global_file_descriptor* global_fd;
     uint32_t flags;
     uint32_t offset;
+    fat_readahead_t readahead;  // sequential reads of a FAT file, kept per open like the offset
     bool is_used;
 } file_descriptor;
 
@@ -37,38 +54,89 @@ typedef struct {
    uint32_t eip, cs, eflags, esp, ss;
 } process_registers_t;
 
+// CPU usage of a process, counted in timer ticks
 typedef struct {
-    uint32_t pid;
+    uint32_t user_ticks;            // ticks spent outside of syscalls
+    uint32_t system_ticks;          // ticks spent inside syscalls
+    uint32_t voluntary_switches;    // gave up the cpu (blocked, waiting or yielded)
+    uint32_t involuntary_switches;  // preempted by the timer
+} process_accounting_t;
+
+// What the threads of a process share, freed along with the last of them
+typedef struct process_shared {
+    volatile uint32_t ref_count;        // threads using it
+    uint32_t pid;                       // the pid of the first thread, which getpid() gives all of them
+    volatile bool exiting;              // exit_group() was called, the other threads exit once they run
+    struct page_directory_entry* page_directory;
+    uintptr_t process_break;            // end of process memory, grows with sbrk()
+    struct mmap_region* mmap_regions;   // shared memory mapped with mmap(), by address
+    file_descriptor fd_table[MAX_LOCAL_FD];
+    char cwd[256];
+} process_shared_t;
+
+// A thread of execution, the unit the scheduler runs
+typedef struct process {
+    uint32_t pid;                       // unique per thread, the thread id
+    uint32_t parent_pid;
     uint32_t terminal_id;
     uint32_t waiting_for;
     bool is_kernel_mode;
-    char cwd[256];
-    struct page_directory_entry* page_directory;
+    bool is_kthread;        // runs kernel code on the kernel page directory, has no user memory
+    bool in_syscall;
+    process_shared_t* shared;           // address space, open files and cwd, shared with sibling threads
+    uint32_t* clear_child_tid;          // zeroed and futex woken when the thread exits, for joins
     void* kernel_stack;
-    uintptr_t process_break; // end of process memory, grows with sbrk()
-    process_state_t state;
-    file_descriptor fd_table[MAX_LOCAL_FD];
+    volatile process_state_t state;
+    uint32_t cpu;                       // whose run queue it is on, or the cpu it last ran on
+    volatile bool on_cpu;               // a cpu still runs on its stack, set until the switch away is done
+    bool on_run_queue;
+    uint32_t kernel_lock_depth;         // the big kernel lock it held when it was switched out
     process_registers_t regs;
+    process_accounting_t acct;
+    process_accounting_t children_acct; // summed usage of exited children
+    ktimer_t sleep_timer;               // wakes the process up from nanosleep()
+    ktimer_t alarm_timer;               // ITIMER_REAL, armed by setitimer() and alarm()
+    uint32_t alarm_interval;            // ticks between alarms, 0 for a one shot alarm
+    volatile uint32_t pending_alarms;   // alarms that fired and weren't consumed by pause() yet
+    fpu_state_t fpu;                    // x87/SSE registers, saved lazily
 } process_t;
 
 typedef struct process_node_t {
-    process_t proc;
+    process_t proc;                     // must stay first
     struct process_node_t* next;
     struct process_node_t* prev;
+    struct process_node_t* run_next;    // run queue links
+    struct process_node_t* run_prev;
 } process_node_t;
 
 void proc_manager_init();
+// Creates the idle thread of a cpu, before the cpu starts
+bool sched_init_cpu(uint32_t cpu_id);
+// Called by a cpu when it is done starting up, switches to its idle thread
+void sched_start_cpu();
 void init_proc_fd(file_descriptor *fd_table, size_t size);
 
 int create_kernelmode_process(const char *path, int flags);
 int create_usermode_process(const char *path, int flags);
 
+// Start a kernel thread running thread_fn(arg), the thread exits when thread_fn returns
+process_t* kthread_create(int (*thread_fn)(void* arg), void* arg);
+// A new thread of the current process that shares its memory and files. It returns 0 from the
+// syscall in regs, on the given user stack, once start_thread() queues it
+process_t* create_thread(const struct int_registers* regs, uintptr_t stack);
+void start_thread(process_t* thread);
+void wake_up_process(process_t* proc);
+
 int exit_proc(process_node_t* exiting_proc);
 void exit_current_process();
+// Exits every thread of the current process, the others go the next time they run
+void exit_current_thread_group();
 process_t* get_current_process();
 
 void force_switch_process();
-void wake_up_terminal_processes(uint32_t terminal_id);
+bool sleep_current_process(uint32_t ticks);
+void pause_current_process();
+void account_process_tick();
 void wake_up_waiting_processes(uint32_t wait_for_pid);
 
 void switch_process(struct int_registers* regs);
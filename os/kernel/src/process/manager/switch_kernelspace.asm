@@ -1,8 +1,27 @@
 global jump_kernelmode
 jump_kernelmode:
-    ; set the segments to be ring 4
+    mov eax, [esp + 4]
+    mov edx, [esp + 8] ; the previous process' on_cpu flag, can be NULL
     mov esp, eax
 
+    ; off the previous process' stack, other cpus may run it from now on
+    test edx, edx
+    jz .prev_released
+    mov byte [edx], 0
+.prev_released:
+
+    ; iret in ring 0 doesn't pop esp and ss, so build the eip, cs, eflags frame
+    ; on the process' own stack, right below where it was stopped
+    mov ebx, [esp + 44] ; esp
+    sub ebx, 12
+    mov ecx, [esp + 32] ; eip
+    mov [ebx], ecx
+    mov ecx, [esp + 36] ; cs
+    mov [ebx + 4], ecx
+    mov ecx, [esp + 40] ; eflags
+    mov [ebx + 8], ecx
+    mov [esp + 12], ebx ; popad skips this slot, keep the frame address in it
+
     mov ax, 0x10
     mov ds, ax
     mov es, ax 
@@ -11,5 +30,5 @@ jump_kernelmode:
 
     ; pop all registers
     popad
-    sti
-    iret ; pop eip, cs, flags, esp, ss and jump to the usermode code
\ No newline at end of file
+    mov esp, [esp - 20] ; the skipped slot
+    iret ; pop eip, cs, flags and jump back into the kernel code
@@ -1,8 +1,16 @@
 global jump_usermode
 jump_usermode:
+    mov eax, [esp + 4]
+    mov edx, [esp + 8] ; the previous process' on_cpu flag, can be NULL
     ; set the segments to be ring 4
     mov esp, eax
 
+    ; off the previous process' stack, other cpus may run it from now on
+    test edx, edx
+    jz .prev_released
+    mov byte [edx], 0
+.prev_released:
+
     mov ax, 0x23
     mov ds, ax
     mov es, ax 
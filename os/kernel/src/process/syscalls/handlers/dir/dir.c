@@ -4,6 +4,8 @@
 #include "process/manager/process_manager.h"
 #include "filesystem/fat/fat.h"
 #include "process/syscalls/handlers/file/file.h"
+#include "filesystem/vfs/file.h"
+#include "memory/shm/shm.h"
 
 int _chdir(const char *pathname)
 {
@@ -16,7 +18,7 @@ int _chdir(const char *pathname)
     }
     else
     {
-        join_path(current_process->cwd, pathname, newPath, sizeof(newPath));
+        join_path(current_process->shared->cwd, pathname, newPath, sizeof(newPath));
     }
 
     // char* normalized = simplify_path(newPath);
@@ -29,7 +31,7 @@ int _chdir(const char *pathname)
 
     if (tmp_dir.file_entry.attr & FAT_ATTR_DIRECTORY)
     {
-        strncpy(current_process->cwd, newPath, sizeof(current_process->cwd));
+        strncpy(current_process->shared->cwd, newPath, sizeof(current_process->shared->cwd));
         return 0;
     }
     else
@@ -50,7 +52,7 @@ int _mkdir(const char *pathname, mode_t mode)
     }
     else
     {
-        join_path(current_process->cwd, pathname, newPath, sizeof(newPath));
+        join_path(current_process->shared->cwd, pathname, newPath, sizeof(newPath));
     }
 
     if((code = fat_create_directory(newPath)) != 0)
@@ -73,7 +75,7 @@ int _rmdir(const char *pathname)
     }
     else
     {
-        join_path(current_process->cwd, pathname, newPath, sizeof(newPath));
+        join_path(current_process->shared->cwd, pathname, newPath, sizeof(newPath));
     }
 
     if (get_glob_fd(newPath) != NULL)
@@ -101,10 +103,10 @@ int _rename(const char *oldpath, const char *newpath)
     }
     else
     {
-        join_path(current_process->cwd, oldpath, fullOldPath, sizeof(fullOldPath));
+        join_path(current_process->shared->cwd, oldpath, fullOldPath, sizeof(fullOldPath));
     }
 
-    join_path(current_process->cwd, newpath, fullNewPath, sizeof(fullNewPath));
+    join_path(current_process->shared->cwd, newpath, fullNewPath, sizeof(fullNewPath));
 
     char* oldFormattedPath = simplify_path(fullOldPath);
     char* newFormattedPath = simplify_path(fullNewPath);
@@ -127,11 +129,13 @@ int _rename(const char *oldpath, const char *newpath)
         return -EINVAL;
     }
 
+    global_fd_lock();
     global_file_descriptor* file_fd = get_opened_fd(oldFormattedPath);
     if (file_fd != NULL)
     {
         strncpy(file_fd->path, newFormattedPath, sizeof(file_fd->path));    
     }
+    global_fd_unlock();
 
     return 0;
 }
@@ -148,15 +152,21 @@ int _unlink(const char *path)
     }
     else
     {
-        join_path(current_process->cwd, path, full_path, sizeof(full_path));
+        join_path(current_process->shared->cwd, path, full_path, sizeof(full_path));
     }
 
+    // shm_unlink(), the object goes once nothing has it open or mapped
+    if (strncmp(full_path, SHM_PATH_PREFIX, strlen(SHM_PATH_PREFIX)) == 0)
+        return shm_unlink_object(full_path + strlen(SHM_PATH_PREFIX));
+
     FileData tmp = {0};
     if((r = fat_get_file_data(full_path, &tmp)) != 0)
     {
         return r;
     }
 
+    // Locked until it's deleted, so it can't be opened in between
+    global_fd_lock();
     if (get_opened_fd(full_path) == NULL)
     {    
         r = fat_delete_file(full_path);
@@ -165,6 +175,7 @@ int _unlink(const char *path)
     {
         r = -EBUSY;
     }
+    global_fd_unlock();
 
     return r;
 }
@@ -179,23 +190,23 @@ int _getdents(unsigned int fd, struct linux_dirent *dirp, unsigned int count)
     
     if (fd < 0 || fd >= MAX_LOCAL_FD)
         return -EBADF;
-    if (!current_process->fd_table[fd].is_used)
+    if (!current_process->shared->fd_table[fd].is_used)
         return -EBADF;
-    if (!(current_process->fd_table[fd].flags & O_DIRECTORY))
+    if (!(current_process->shared->fd_table[fd].flags & O_DIRECTORY))
         return -ENOTDIR;
-    if (current_process->fd_table[fd].flags & O_RDONLY)
+    if (current_process->shared->fd_table[fd].flags & O_RDONLY)
         return -EPERM;
 
-    if (current_process->fd_table[fd].offset >= current_process->fd_table[fd].global_fd->file.file_entry.file_size)
+    if (current_process->shared->fd_table[fd].offset >= current_process->shared->fd_table[fd].global_fd->file.file_entry.file_size)
         return 0;
     
     // get dir entries
     while (count > 0)
     {
-        if (current_process->fd_table[fd].offset >= current_process->fd_table[fd].global_fd->file.file_entry.file_size)
+        if (current_process->shared->fd_table[fd].offset >= current_process->shared->fd_table[fd].global_fd->file.file_entry.file_size)
             return buff_index;
 
-        if ((r = fat_get_dir_entry(&current_process->fd_table[fd].global_fd->file.file_entry, current_process->fd_table[fd].offset, &entry)) != 0)
+        if ((r = fat_get_dir_entry(&current_process->shared->fd_table[fd].global_fd->file.file_entry, current_process->shared->fd_table[fd].offset, &entry)) != 0)
         {    
             if (r == FILE_NOT_FOUND)
             {
@@ -213,14 +224,14 @@ int _getdents(unsigned int fd, struct linux_dirent *dirp, unsigned int count)
 
         tmp->d_ino = entry.start_cluster;
         tmp->d_reclen = entry_size;
-        tmp->d_off = current_process->fd_table[fd].offset;
+        tmp->d_off = current_process->shared->fd_table[fd].offset;
         strcpy(tmp->d_name, entry.name);
         tmp->d_name[name_len] = 0;
         tmp->d_name[name_len + 1] = (entry.attr & FAT_ATTR_DIRECTORY) ? DT_DIR : DT_REG;
         memcpy((void*)((int)dirp + buff_index), tmp, entry_size);
         kfree(tmp);
 
-        current_process->fd_table[fd].offset++;
+        current_process->shared->fd_table[fd].offset++;
         buff_index += entry_size;
         count -= entry_size;
     }
@@ -231,9 +242,9 @@ int _getdents(unsigned int fd, struct linux_dirent *dirp, unsigned int count)
 int _getcwd(char *buf, unsigned long size)
 {
     process_t *current_process = get_current_process();
-    if (strlen(current_process->cwd) + 1 > size)
+    if (strlen(current_process->shared->cwd) + 1 > size)
         return -ERANGE;
-    strcpy(buf, current_process->cwd);
+    strcpy(buf, current_process->shared->cwd);
     return 0;
 }
 
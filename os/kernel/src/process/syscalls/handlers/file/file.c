@@ -1,16 +1,76 @@
 #include "file.h"
 #include "process/syscalls/handlers/dir/dir.h"
 #include "memory/heap/heap.h"
-#include "errno-base.h"
+#include "errno.h"
 #include "drivers/vga/vga.h"
 #include "filesystem/vfs/file.h"
+#include "filesystem/vfs/pipe.h"
+#include "memory/shm/shm.h"
+#include "filesystem/vfs/poll.h"
+#include "time/timer.h"
+#include "memory/paging/paging.h"
 #include <fcntl.h>
 
+static int open_locked(process_t* current_process, char *path, uint32_t flags);
+static int open_shm_locked(process_t* current_process, const char *name, uint32_t flags);
+static void release_shm(global_file_descriptor* glob_fd);
+static int do_readv(int fd, const struct iovec* iov, uint32_t iovcnt, uint32_t offset, bool positional);
+static int do_writev(int fd, const struct iovec* iov, uint32_t iovcnt, uint32_t offset, bool positional);
+static int read_unchecked(int fd, void* buf, uint32_t count);
+static int write_unchecked(int fd, void* buf, uint32_t count);
+
+// A regular file, read and written by the FAT driver straight into the buffers
+static inline bool fd_is_fat_file(file_descriptor* fd)
+{
+    return fd->global_fd != NULL && fd->global_fd->_read == read_fat_fs && !(fd->flags & O_DIRECTORY);
+}
+
+// Whether an I/O on the fd goes through right away, or it's O_NONBLOCK and would have to wait
+static bool fd_ready(file_descriptor* fd, uint32_t event)
+{
+    if (!(fd->flags & O_NONBLOCK) || fd->global_fd->_poll == NULL)
+        return true;
+
+    // A hang up or an error is returned by the I/O itself without waiting
+    return fd->global_fd->_poll(fd->global_fd, NULL) & (event | POLLHUP | POLLERR);
+}
+
+// Copies the path out of user memory, it's only read once the table lock is held
+static int copy_path_from_user(char* dst, const char* path, uint32_t size)
+{
+    for (uint32_t i = 0; i < size; i++)
+    {
+        // Checked once for every page the path reaches into
+        if ((i == 0 || (uintptr_t)(path + i) % PAGE_SIZE == 0) && !is_user_range_mapped(path + i, 1))
+            return -EFAULT;
+
+        dst[i] = path[i];
+        if (dst[i] == '\0')
+            return 0;
+    }
+    return -ENAMETOOLONG;
+}
+
 int _open(char *path, uint32_t flags)
 {
     process_t* current_process = get_current_process();
     if (current_process == NULL)
         return -ESRCH;
+
+    char kernel_path[256];
+    int r = copy_path_from_user(kernel_path, path, sizeof(kernel_path));
+    if (r != 0)
+        return r;
+
+    // Looking the path up and allocating it has to be one step, or two opens could both allocate it
+    global_fd_lock();
+    r = open_locked(current_process, kernel_path, flags);
+    global_fd_unlock();
+    return r;
+}
+
+static int open_locked(process_t* current_process, char *path, uint32_t flags)
+{
     char full_path[256] = {0};
 
     if (path[0] == '/')
@@ -19,7 +79,7 @@ int _open(char *path, uint32_t flags)
     }
     else
     {
-        join_path(current_process->cwd, path, full_path, sizeof(full_path));
+        join_path(current_process->shared->cwd, path, full_path, sizeof(full_path));
         if (full_path[0] == '\0')
             return -ENOMEM;
     }
@@ -27,19 +87,22 @@ int _open(char *path, uint32_t flags)
     if (full_path == NULL)
         return -ENOMEM;
 
+    if (strncmp(full_path, SHM_PATH_PREFIX, strlen(SHM_PATH_PREFIX)) == 0)
+        return open_shm_locked(current_process, full_path + strlen(SHM_PATH_PREFIX), flags);
+
     for (int i = 0; i < MAX_FD; i++)
     {
-        if (!current_process->fd_table[i].is_used)
+        if (!current_process->shared->fd_table[i].is_used)
         {   
-            memset(&current_process->fd_table[i], 0, sizeof(current_process->fd_table[i]));
-            current_process->fd_table[i].global_fd = get_opened_fd(full_path);
+            memset(&current_process->shared->fd_table[i], 0, sizeof(current_process->shared->fd_table[i]));
+            current_process->shared->fd_table[i].global_fd = get_opened_fd(full_path);
 
-            if (current_process->fd_table[i].global_fd == NULL)
+            if (current_process->shared->fd_table[i].global_fd == NULL)
             {
-                current_process->fd_table[i].global_fd = allocate_global_fd(full_path);
+                current_process->shared->fd_table[i].global_fd = allocate_global_fd(full_path);
                 if (!(flags & O_DIRECTORY))
                 {    
-                    if(fat_get_file_data(full_path, &current_process->fd_table[i].global_fd->file) != 0)
+                    if(fat_get_file_data(full_path, &current_process->shared->fd_table[i].global_fd->file) != 0)
                     {
                         if (flags & O_CREAT)
                         {
@@ -49,7 +112,7 @@ int _open(char *path, uint32_t flags)
                             }
                             
                             // Retrieve newly created file data
-                            if (fat_get_file_data(full_path, &current_process->fd_table[i].global_fd->file) != 0) 
+                            if (fat_get_file_data(full_path, &current_process->shared->fd_table[i].global_fd->file) != 0) 
                             {
                                 return -ENOENT;
                             }     
@@ -62,7 +125,7 @@ int _open(char *path, uint32_t flags)
                 }
                 else
                 {
-                    if (fat_get_dir_data(full_path, &current_process->fd_table[i].global_fd->file) != 0) 
+                    if (fat_get_dir_data(full_path, &current_process->shared->fd_table[i].global_fd->file) != 0) 
                     {
                         return -ENOENT;
                     } 
@@ -70,12 +133,12 @@ int _open(char *path, uint32_t flags)
             }
             else
             {
-                if (current_process->fd_table[i].global_fd->is_dir && !(flags & O_DIRECTORY))
+                if (current_process->shared->fd_table[i].global_fd->is_dir && !(flags & O_DIRECTORY))
                     return -EISDIR;
-                if (!current_process->fd_table[i].global_fd->is_dir && flags & O_DIRECTORY)
+                if (!current_process->shared->fd_table[i].global_fd->is_dir && flags & O_DIRECTORY)
                     return -ENOTDIR;
 
-                current_process->fd_table[i].global_fd->ref_count++;
+                current_process->shared->fd_table[i].global_fd->ref_count++;
             }
 
             if (!(flags & O_DIRECTORY))
@@ -86,26 +149,28 @@ int _open(char *path, uint32_t flags)
 
                 if (flags & O_TRUNC)
                 {
-                    fat_truncate(&current_process->fd_table[i].global_fd->file, 0);
+                    global_fd_flush(current_process->shared->fd_table[i].global_fd);
+                    fat_truncate(&current_process->shared->fd_table[i].global_fd->file, 0);
                 }
 
                 if (flags & O_APPEND)
                 {
-                    current_process->fd_table[i].offset = current_process->fd_table[i].global_fd->file.file_entry.file_size;
+                    current_process->shared->fd_table[i].offset = global_fd_size(current_process->shared->fd_table[i].global_fd);
                 }
                 else
                 {
-                    current_process->fd_table[i].offset = 0;
+                    current_process->shared->fd_table[i].offset = 0;
                 }
             }
 
-            current_process->fd_table[i].global_fd->is_used = true;
-            current_process->fd_table[i].is_used = true;
-            current_process->fd_table[i].flags = flags;
-            current_process->fd_table[i].global_fd->is_dir = current_process->fd_table[i].global_fd->file.file_entry.attr & FAT_ATTR_DIRECTORY;
-            if (current_process->fd_table[i].global_fd->is_dir)
+            current_process->shared->fd_table[i].global_fd->is_used = true;
+            current_process->shared->fd_table[i].is_used = true;
+            current_process->shared->fd_table[i].flags = flags;
+            memset(&current_process->shared->fd_table[i].readahead, 0, sizeof(fat_readahead_t));
+            current_process->shared->fd_table[i].global_fd->is_dir = current_process->shared->fd_table[i].global_fd->file.file_entry.attr & FAT_ATTR_DIRECTORY;
+            if (current_process->shared->fd_table[i].global_fd->is_dir)
             {
-                current_process->fd_table[i].flags |= O_DIRECTORY;
+                current_process->shared->fd_table[i].flags |= O_DIRECTORY;
             }
             return i;
         }
@@ -113,6 +178,47 @@ int _open(char *path, uint32_t flags)
     return -EMFILE;
 }
 
+// Every open of a shared memory object gets a device fd of its own, the object is what they share
+static int open_shm_locked(process_t* current_process, const char *name, uint32_t flags)
+{
+    file_descriptor* curr_fd_table = current_process->shared->fd_table;
+    shm_object_t* shm;
+    int fd = 0;
+
+    while (fd < MAX_LOCAL_FD && curr_fd_table[fd].is_used)
+    {
+        fd++;
+    }
+    if (fd == MAX_LOCAL_FD)
+        return -EMFILE;
+
+    int r = shm_open_object(name, flags & O_CREAT, flags & O_EXCL, &shm);
+    if (r != 0)
+        return r;
+
+    if (flags & O_TRUNC && (r = shm_resize(shm, 0)) != 0)
+    {
+        shm_put(shm);
+        return r;
+    }
+
+    global_file_descriptor* global_fd = allocate_device_fd();
+    if (global_fd == NULL)
+    {
+        shm_put(shm);
+        return -ENFILE;
+    }
+    global_fd->shm = shm;
+    global_fd->_release = release_shm;
+
+    curr_fd_table[fd] = (file_descriptor){ .global_fd = global_fd, .flags = flags, .is_used = true };
+    return fd;
+}
+
+static void release_shm(global_file_descriptor* glob_fd)
+{
+    shm_put(glob_fd->shm);
+}
 
 int _close(int fd)
 {
@@ -127,23 +233,40 @@ int _close(int fd)
     if (fd == 0 || fd == 1)
         return -EBADF;
     
-    if (!current_process->fd_table[fd].is_used)
+    if (!current_process->shared->fd_table[fd].is_used)
         return -EBADF;
+
+    // what this fd appended goes to the disk now, even if the file stays open elsewhere. The
+    // clusters for it are only allocated now, so this is where running out of space shows up
+    int r = 0;
+    if (current_process->shared->fd_table[fd].global_fd != NULL)
+        r = global_fd_flush(current_process->shared->fd_table[fd].global_fd);
     
-    // decremet ref count from global fd
-    current_process->fd_table[fd].global_fd->ref_count--;
+    // drops the reference to the global fd, the last one frees it. The fd is closed even if the flush failed
+    fd_put(&current_process->shared->fd_table[fd]);
+    return r;
+}
 
-    // check if ref count is 0
-    if(current_process->fd_table[fd].global_fd->ref_count == 0)
-    {
-        memset(current_process->fd_table[fd].global_fd, 0, sizeof(global_file_descriptor));
-    }
+/*
+ * The user buffers are checked before anything is done with them. The FAT driver, the pipes and the
+ * terminals copy to and from them with a lock held, a page fault there would kill the process and
+ * leave the lock held for good.
+ */
+int _read(int fd, void* buf, uint32_t count)
+{
+    if (!is_user_range_mapped(buf, count))
+        return -EFAULT;
+    return read_unchecked(fd, buf, count);
+}
 
-    memset(&current_process->fd_table[fd], 0, sizeof(file_descriptor));
-    return 0;
+int _write(int fd, void* buf, uint32_t count)
+{
+    if (!is_user_range_mapped(buf, count))
+        return -EFAULT;
+    return write_unchecked(fd, buf, count);
 }
 
-int _read(int fd, void* buf, uint32_t count)
+static int read_unchecked(int fd, void* buf, uint32_t count)
 {
     process_t* current_process = get_current_process();
     if (current_process == NULL)
@@ -152,35 +275,52 @@ int _read(int fd, void* buf, uint32_t count)
     if (fd < 0 || fd >= MAX_FD)
         return -EBADF;
 
-    if (!current_process->fd_table[fd].is_used)
+    if (!current_process->shared->fd_table[fd].is_used)
         return -EBADF;
 
-    if (current_process->fd_table[fd].flags & O_DIRECTORY)
+    if (current_process->shared->fd_table[fd].flags & O_DIRECTORY)
         return -EISDIR;
     
-    if (current_process->fd_table[fd].flags & O_RDONLY)
+    if (current_process->shared->fd_table[fd].flags & O_RDONLY)
         return -EPERM;
 
-    if (current_process->fd_table[fd].global_fd == NULL)
+    if (current_process->shared->fd_table[fd].global_fd == NULL)
         return -EBADF;
+
+    // the write end of a pipe
+    if (current_process->shared->fd_table[fd].global_fd->_read == NULL)
+        return -EBADF;
+
+    if (!fd_ready(&current_process->shared->fd_table[fd], POLLIN))
+        return -EAGAIN;
+
+    // files on the disk are read with readahead
+    if (fd_is_fat_file(&current_process->shared->fd_table[fd]))
+    {
+        struct iovec iov = { .iov_base = buf, .iov_len = count };
+        return do_readv(fd, &iov, 1, 0, false);
+    }
     
-    uint32_t bytes_read = current_process->fd_table[fd].global_fd->_read(buf, count, current_process->fd_table[fd].offset, current_process->fd_table[fd].global_fd);
-    current_process->fd_table[fd].offset += bytes_read;
+    int bytes_read = current_process->shared->fd_table[fd].global_fd->_read(buf, count, current_process->shared->fd_table[fd].offset, current_process->shared->fd_table[fd].global_fd);
+    current_process->shared->fd_table[fd].offset += bytes_read;
     return bytes_read;
 }
 
-int _write(int fd, void* buf, uint32_t count)
+static int write_unchecked(int fd, void* buf, uint32_t count)
 {
     process_t* current_process = get_current_process();
     if (current_process == NULL)
         return -ESRCH;
-    file_descriptor* curr_fd_table = current_process->fd_table;
+    file_descriptor* curr_fd_table = current_process->shared->fd_table;
+
+    if (fd < 0 || fd >= MAX_LOCAL_FD)
+        return -EBADF;
 
-    if (fd == 0 || fd == 2)
+    if (!curr_fd_table[fd].is_used)
         return -EBADF;
 
-    // stdout
-    if (fd == 1)
+    // stdout and stderr of a process that has no terminal still go to the screen
+    if (curr_fd_table[fd].global_fd == NULL && (fd == 1 || fd == 2))
     {
         char* str = (char*)buf;
         for (uint32_t i = 0; i < count; i++) {
@@ -188,11 +328,8 @@ int _write(int fd, void* buf, uint32_t count)
         }
         return count;  // Return number of bytes written
     }
-    
-    if (fd < 0 || fd >= MAX_FD)
-        return -EBADF;
 
-    if (!curr_fd_table[fd].is_used)
+    if (curr_fd_table[fd].global_fd == NULL)
         return -EBADF;
 
     if (curr_fd_table[fd].flags & O_DIRECTORY)
@@ -200,23 +337,393 @@ int _write(int fd, void* buf, uint32_t count)
     
     if (curr_fd_table[fd].flags & O_RDONLY)
         return -EPERM;
+
+    // terminals and pipes write their own way, wherever the fd was redirected to
+    if (curr_fd_table[fd].global_fd->_write != NULL)
+    {
+        if (!fd_ready(&curr_fd_table[fd], POLLOUT))
+            return -EAGAIN;
+
+        int written = curr_fd_table[fd].global_fd->_write(buf, count, curr_fd_table[fd].offset, curr_fd_table[fd].global_fd);
+        if (written > 0)
+            curr_fd_table[fd].offset += written;
+        return written;
+    }
+
+    // any other device can't be written, like stdin or the read end of a pipe
+    if (curr_fd_table[fd].global_fd->is_device)
+        return -EBADF;
     
-    int bytes_written = fat_write(&curr_fd_table[fd].global_fd->file.file_entry, &curr_fd_table[fd].global_fd->file.parent_entry, curr_fd_table[fd].offset, count, buf);
-    
-    if (bytes_written < 0)
-        return EAGAIN;
-    
-    curr_fd_table[fd].offset += bytes_written;
+    // files on the disk hold small appends back
+    struct iovec iov = { .iov_base = buf, .iov_len = count };
+    return do_writev(fd, &iov, 1, 0, false);
+}
+
+// The total size of the buffers, -EINVAL if there are too many or they add up past what a return value
+// holds, or -EFAULT if one isn't user memory
+static int iov_length(const struct iovec* iov, uint32_t iovcnt)
+{
+    uint32_t total = 0;
+
+    if (iovcnt > IOV_MAX)
+        return -EINVAL;
+
+    for (uint32_t i = 0; i < iovcnt; i++)
+    {
+        if (iov[i].iov_len > INT32_MAX - total)
+            return -EINVAL;
+        if (!is_user_range_mapped(iov[i].iov_base, iov[i].iov_len))
+            return -EFAULT;
+        total += iov[i].iov_len;
+    }
+    return total;
+}
+
+// The array of a v call is user memory too, unlike the single iovec _read() and the others build
+static int iov_check_array(const struct iovec* iov, uint32_t iovcnt)
+{
+    if (iovcnt > IOV_MAX)
+        return -EINVAL;
+    return is_user_range_mapped(iov, iovcnt * sizeof(struct iovec)) ? 0 : -EFAULT;
+}
+
+/*
+ * Reads into the buffers one after the other. A file on the disk is read by one call to the FAT
+ * driver at the fd's offset, or at offset if positional. Terminals and pipes are read buffer by
+ * buffer and stop at the first short read, like a single read() they only wait for the first one.
+ */
+static int do_readv(int fd, const struct iovec* iov, uint32_t iovcnt, uint32_t offset, bool positional)
+{
+    process_t* current_process = get_current_process();
+    if (current_process == NULL)
+        return -ESRCH;
+    file_descriptor* curr_fd_table = current_process->shared->fd_table;
+
+    if (fd < 0 || fd >= MAX_LOCAL_FD || !curr_fd_table[fd].is_used)
+        return -EBADF;
+
+    int total = iov_length(iov, iovcnt);
+    if (total <= 0)
+        return total;
+
+    if (fd_is_fat_file(&curr_fd_table[fd]))
+    {
+        uint32_t position = positional ? offset : curr_fd_table[fd].offset;
+        // The disk must have what the file held back before it's read
+        int r = global_fd_flush(curr_fd_table[fd].global_fd);
+        if (r != 0)
+            return r;
+
+        // Positional reads don't move the offset, nor tell where the next read will be
+        int bytes_read = fat_readv(&curr_fd_table[fd].global_fd->file.file_entry, position, iov, iovcnt,
+            positional ? NULL : &curr_fd_table[fd].readahead);
+        if (bytes_read < 0)
+            return -EIO;
+
+        if (!positional)
+            curr_fd_table[fd].offset += bytes_read;
+        return bytes_read;
+    }
+
+    if (positional)
+        return -ESPIPE;
+
+    int bytes_read = 0;
+    for (uint32_t i = 0; i < iovcnt; i++)
+    {
+        if (iov[i].iov_len == 0)
+            continue;
+
+        // What was read already is returned rather than waiting for more
+        global_file_descriptor* glob_fd = curr_fd_table[fd].global_fd;
+        if (bytes_read > 0 && glob_fd != NULL && glob_fd->_poll != NULL
+            && !(glob_fd->_poll(glob_fd, NULL) & (POLLIN | POLLHUP)))
+        {
+            break;
+        }
+
+        int r = read_unchecked(fd, iov[i].iov_base, iov[i].iov_len);
+        if (r < 0)
+            return bytes_read > 0 ? bytes_read : r;
+
+        bytes_read += r;
+        if ((uint32_t)r < iov[i].iov_len)
+            break;
+    }
+    return bytes_read;
+}
+
+/*
+ * Writes the buffers one after the other. A file on the disk is extended once and written by one
+ * call to the FAT driver, terminals and pipes take the buffers one by one.
+ */
+static int do_writev(int fd, const struct iovec* iov, uint32_t iovcnt, uint32_t offset, bool positional)
+{
+    process_t* current_process = get_current_process();
+    if (current_process == NULL)
+        return -ESRCH;
+    file_descriptor* curr_fd_table = current_process->shared->fd_table;
+
+    if (fd < 0 || fd >= MAX_LOCAL_FD || !curr_fd_table[fd].is_used)
+        return -EBADF;
+
+    int total = iov_length(iov, iovcnt);
+    if (total <= 0)
+        return total;
+
+    if (fd_is_fat_file(&curr_fd_table[fd]))
+    {
+        uint32_t position = positional ? offset : curr_fd_table[fd].offset;
+        global_file_descriptor* glob_fd = curr_fd_table[fd].global_fd;
+        int bytes_written = fat_write_buffered(&glob_fd->file, &glob_fd->write_buffer, position, iov, iovcnt);
+        if (bytes_written < 0)
+            return bytes_written == CANT_ALLOCATE_SPACE ? -ENOSPC : -EIO;
+        if (glob_fd->write_buffer.length > 0)
+            writeback_schedule();
+
+        if (!positional)
+            curr_fd_table[fd].offset += bytes_written;
+        return bytes_written;
+    }
+
+    if (positional)
+        return -ESPIPE;
+
+    int bytes_written = 0;
+    for (uint32_t i = 0; i < iovcnt; i++)
+    {
+        if (iov[i].iov_len == 0)
+            continue;
+
+        int r = write_unchecked(fd, iov[i].iov_base, iov[i].iov_len);
+        if (r < 0)
+            return bytes_written > 0 ? bytes_written : r;
+
+        bytes_written += r;
+        if ((uint32_t)r < iov[i].iov_len)
+            break;
+    }
     return bytes_written;
 }
 
+int _readv(int fd, const struct iovec *iov, uint32_t iovcnt)
+{
+    int r = iov_check_array(iov, iovcnt);
+    if (r != 0)
+        return r;
+    return do_readv(fd, iov, iovcnt, 0, false);
+}
+
+int _writev(int fd, const struct iovec *iov, uint32_t iovcnt)
+{
+    int r = iov_check_array(iov, iovcnt);
+    if (r != 0)
+        return r;
+    return do_writev(fd, iov, iovcnt, 0, false);
+}
+
+int _preadv(int fd, const struct iovec *iov, uint32_t iovcnt, uint32_t offset)
+{
+    int r = iov_check_array(iov, iovcnt);
+    if (r != 0)
+        return r;
+    return do_readv(fd, iov, iovcnt, offset, true);
+}
+
+int _pwritev(int fd, const struct iovec *iov, uint32_t iovcnt, uint32_t offset)
+{
+    int r = iov_check_array(iov, iovcnt);
+    if (r != 0)
+        return r;
+    return do_writev(fd, iov, iovcnt, offset, true);
+}
+
+int _pread(int fd, void *buf, uint32_t count, uint32_t offset)
+{
+    struct iovec iov = { .iov_base = buf, .iov_len = count };
+    return do_readv(fd, &iov, 1, offset, true);
+}
+
+int _pwrite(int fd, const void *buf, uint32_t count, uint32_t offset)
+{
+    struct iovec iov = { .iov_base = (void*)buf, .iov_len = count };
+    return do_writev(fd, &iov, 1, offset, true);
+}
+
+/*
+ * Copies up to len bytes from fd_in to fd_out without going through user space. The offsets are
+ * taken from and moved in off_in and off_out when they are set, otherwise the fds' own offsets
+ * are. fd_in must be a file on the disk. A file on the disk as fd_out is copied into straight by
+ * the FAT driver, anything else (a terminal, a pipe) is only taken when any_output is set.
+ */
+static int do_copy_range(int fd_in, uint32_t* off_in, int fd_out, uint32_t* off_out, uint32_t len, bool any_output)
+{
+    process_t* current_process = get_current_process();
+    if (current_process == NULL)
+        return -ESRCH;
+    file_descriptor* curr_fd_table = current_process->shared->fd_table;
+
+    if (fd_in < 0 || fd_in >= MAX_LOCAL_FD || !curr_fd_table[fd_in].is_used)
+        return -EBADF;
+    if (fd_out < 0 || fd_out >= MAX_LOCAL_FD || !curr_fd_table[fd_out].is_used)
+        return -EBADF;
+
+    file_descriptor* in = &curr_fd_table[fd_in];
+    file_descriptor* out = &curr_fd_table[fd_out];
+    if (!fd_is_fat_file(in))
+        return -EINVAL;
+
+    // The copy goes from disk to disk
+    int r = global_fd_flush(in->global_fd);
+    if (r == 0 && fd_is_fat_file(out))
+        r = global_fd_flush(out->global_fd);
+    if (r != 0)
+        return r;
+
+    FAT16_DirEntry* src = &in->global_fd->file.file_entry;
+    uint32_t in_pos = off_in != NULL ? *off_in : in->offset;
+    if (in_pos >= src->file_size)
+        return 0;
+    if (len > src->file_size - in_pos)
+        len = src->file_size - in_pos;
+    if (len > INT32_MAX)
+        len = INT32_MAX;
+
+    int copied = 0;
+    if (fd_is_fat_file(out))
+    {
+        FAT16_DirEntry* dst = &out->global_fd->file.file_entry;
+        uint32_t out_pos = off_out != NULL ? *off_out : out->offset;
+
+        if (out->flags & O_APPEND)
+            return -EBADF;
+        if (len > UINT32_MAX - out_pos)
+            return -EFBIG;
+        // Within a single file the ranges may not overlap, the copy would read what it wrote
+        if (src->start_cluster == dst->start_cluster && in_pos < out_pos + len && out_pos < in_pos + len)
+            return -EINVAL;
+
+        copied = fat_copy_range(src, in_pos, dst, &out->global_fd->file.parent_entry, out_pos, len);
+        if (copied < 0)
+            return -EIO;
+
+        if (off_out != NULL)
+            *off_out += copied;
+        else
+            out->offset += copied;
+    }
+    else
+    {
+        if (!any_output)
+            return -EINVAL;
+
+        uint32_t chunk_size = len < FAT_COPY_CHUNK_MAX ? len : FAT_COPY_CHUNK_MAX;
+        uint8_t* buffer = kmalloc(chunk_size);
+        if (buffer == NULL)
+            return -ENOMEM;
+
+        // write_unchecked() takes care of the terminal, the pipe or the screen behind the fd, the
+        // buffer is the kernel's
+        while ((uint32_t)copied < len)
+        {
+            uint32_t chunk = len - copied < chunk_size ? len - copied : chunk_size;
+            int bytes_read = fat_read(src, in_pos + copied, chunk, buffer);
+            if (bytes_read <= 0)
+            {
+                if (bytes_read < 0 && copied == 0)
+                    copied = -EIO;
+                break;
+            }
+
+            int written = write_unchecked(fd_out, buffer, bytes_read);
+            if (written < 0)
+            {
+                if (copied == 0)
+                    copied = written;
+                break;
+            }
+            copied += written;
+            if (written < bytes_read)
+                break;
+        }
+        kfree(buffer);
+        if (copied < 0)
+            return copied;
+    }
+
+    if (off_in != NULL)
+        *off_in += copied;
+    else
+        in->offset += copied;
+    return copied;
+}
+
+int _copy_file_range(int fd_in, int64_t *off_in, int fd_out, int64_t *off_out, uint32_t len, uint32_t flags)
+{
+    uint32_t in_pos = 0, out_pos = 0;
+
+    if (flags != 0)
+        return -EINVAL;
+    // FAT16 files never reach past 4 GiB, the offsets fit the low half
+    if ((off_in != NULL && (*off_in < 0 || *off_in > UINT32_MAX))
+        || (off_out != NULL && (*off_out < 0 || *off_out > UINT32_MAX)))
+    {
+        return -EINVAL;
+    }
+
+    if (off_in != NULL)
+        in_pos = *off_in;
+    if (off_out != NULL)
+        out_pos = *off_out;
+
+    int copied = do_copy_range(fd_in, off_in != NULL ? &in_pos : NULL, fd_out, off_out != NULL ? &out_pos : NULL, len, false);
+    if (copied > 0)
+    {
+        if (off_in != NULL)
+            *off_in = in_pos;
+        if (off_out != NULL)
+            *off_out = out_pos;
+    }
+    return copied;
+}
+
+int _sendfile(int out_fd, int in_fd, int32_t *offset, uint32_t count)
+{
+    uint32_t pos = 0;
+
+    if (offset != NULL && *offset < 0)
+        return -EINVAL;
+    if (offset != NULL)
+        pos = *offset;
+
+    int copied = do_copy_range(in_fd, offset != NULL ? &pos : NULL, out_fd, NULL, count, true);
+    if (copied > 0 && offset != NULL)
+        *offset = pos;
+    return copied;
+}
+
+int _sendfile64(int out_fd, int in_fd, int64_t *offset, uint32_t count)
+{
+    uint32_t pos = 0;
+
+    if (offset != NULL && (*offset < 0 || *offset > UINT32_MAX))
+        return -EINVAL;
+    if (offset != NULL)
+        pos = *offset;
+
+    int copied = do_copy_range(in_fd, offset != NULL ? &pos : NULL, out_fd, NULL, count, true);
+    if (copied > 0 && offset != NULL)
+        *offset = pos;
+    return copied;
+}
+
 int _lseek(int fd, int offset, int whence)
 {
     int new_offset;
     process_t* current_process = get_current_process();
     if (current_process == NULL)
         return -ESRCH;
-    file_descriptor* curr_fd_table = current_process->fd_table;
+    file_descriptor* curr_fd_table = current_process->shared->fd_table;
 
     if (fd == 0 || fd == 1 || fd == 2)
         return -EBADF;
@@ -226,6 +733,9 @@ int _lseek(int fd, int offset, int whence)
 
     if (!curr_fd_table[fd].is_used)
         return -EBADF;
+
+    if (curr_fd_table[fd].global_fd->pipe != NULL)
+        return -ESPIPE;
     
     switch (whence)
     {
@@ -236,7 +746,7 @@ int _lseek(int fd, int offset, int whence)
             new_offset = curr_fd_table[fd].offset + offset;
             break;
         case SEEK_END:
-            new_offset = curr_fd_table[fd].global_fd->file.file_entry.file_size; // dont support seeking past the end of the file
+            new_offset = global_fd_size(curr_fd_table[fd].global_fd); // dont support seeking past the end of the file
             break;
         default:
             return -EINVAL;
@@ -269,7 +779,7 @@ int _stat(const char *pathname, struct stat *statbuf)
     }
     else
     {
-        join_path(current_process->cwd, pathname, full_path, sizeof(full_path));
+        join_path(current_process->shared->cwd, pathname, full_path, sizeof(full_path));
         if (full_path[0] == '\0')
             return -ENOMEM;
     }
@@ -283,8 +793,14 @@ int _stat(const char *pathname, struct stat *statbuf)
     }
     
     statbuf->st_size = tmp_file.file_entry.file_size;
+    // an open file may hold appends back, the disk doesn't know them yet
+    global_fd_lock();
+    global_file_descriptor* glob_fd = get_opened_fd(full_path);
+    if (glob_fd != NULL)
+        statbuf->st_size += glob_fd->write_buffer.length;
+    global_fd_unlock();
     statbuf->st_mode = tmp_file.file_entry.attr;
-    statbuf->st_blocks = (tmp_file.file_entry.file_size + 511) / 512;
+    statbuf->st_blocks = (statbuf->st_size + 511) / 512;
     statbuf->st_blksize = 512; // Standard block size
     statbuf->st_nlink = 1;     // FAT doesn't support hard links
     statbuf->st_uid = 0;       // Owner ID
@@ -297,7 +813,7 @@ int _fstat(int fd, struct stat *statbuf)
     process_t* current_process = get_current_process();
     if (current_process == NULL)
         return -ESRCH;
-    file_descriptor* curr_fd_table = current_process->fd_table;
+    file_descriptor* curr_fd_table = current_process->shared->fd_table;
 
     if (fd == 0 || fd == 1 || fd == 2)
         return -EBADF;
@@ -307,11 +823,30 @@ int _fstat(int fd, struct stat *statbuf)
 
     if (!curr_fd_table[fd].is_used)
         return -EBADF;
+
+    if (curr_fd_table[fd].global_fd->pipe != NULL)
+    {
+        memset(statbuf, 0, sizeof(struct stat));
+        statbuf->st_mode = FILE_TYPE_FIFO;
+        statbuf->st_blksize = PIPE_SIZE;
+        return 0;
+    }
+
+    if (curr_fd_table[fd].global_fd->shm != NULL)
+    {
+        memset(statbuf, 0, sizeof(struct stat));
+        statbuf->st_size = curr_fd_table[fd].global_fd->shm->size;
+        statbuf->st_mode = FILE_TYPE_REGULAR;
+        statbuf->st_blocks = (statbuf->st_size + 511) / 512;
+        statbuf->st_blksize = PAGE_SIZE;
+        statbuf->st_nlink = 1;
+        return 0;
+    }
     
-    statbuf->st_size = curr_fd_table[fd].global_fd->file.file_entry.file_size;
+    statbuf->st_size = global_fd_size(curr_fd_table[fd].global_fd);
     statbuf->st_mode = curr_fd_table[fd].global_fd->is_device? FILE_TYPE_CHAR_DEVICE :  
                         (curr_fd_table[fd].global_fd->file.file_entry.attr & FAT_ATTR_DIRECTORY)? FILE_TYPE_DIRECTORY : FILE_TYPE_REGULAR;
-    statbuf->st_blocks = (curr_fd_table[fd].global_fd->file.file_entry.file_size + 511) / 512;
+    statbuf->st_blocks = (statbuf->st_size + 511) / 512;
     statbuf->st_blksize = 512; // Standard block size
     statbuf->st_nlink = 1;     // FAT doesn't support hard links
     statbuf->st_uid = 0;       // Owner ID
@@ -332,12 +867,20 @@ int _truncate(const char *path, long length)
     }
     else
     {
-        join_path(current_process->cwd, path, full_path, sizeof(full_path));
+        join_path(current_process->shared->cwd, path, full_path, sizeof(full_path));
     }
 
     if (full_path == NULL)
         return -ENOMEM;
 
+    // what an open file held back is written before the size changes under it
+    global_fd_lock();
+    global_file_descriptor* glob_fd = get_opened_fd(full_path);
+    r = glob_fd != NULL ? global_fd_flush(glob_fd) : 0;
+    global_fd_unlock();
+    if (r != 0)
+        return r;
+
     FileData tmp_file;
     if (fat_get_file_data(full_path, &tmp_file) != 0)
     {
@@ -347,6 +890,9 @@ int _truncate(const char *path, long length)
     if (r == 0)
     {
         tmp_file.file_entry.file_size = length;
+        // Nothing closes the file later to write the zeros, so they go now
+        if (fat_fill_unwritten(&tmp_file.file_entry) != 0)
+            r = -EIO;
     }
     return r;
 }
@@ -358,7 +904,7 @@ int _ftruncate(int fd, long length)
     process_t* current_process = get_current_process();
     if (current_process == NULL)
         return -ESRCH;
-    file_descriptor* curr_fd_table = current_process->fd_table;
+    file_descriptor* curr_fd_table = current_process->shared->fd_table;
 
     if (fd == 0 || fd == 1 || fd == 2)
         return -EBADF;
@@ -369,6 +915,18 @@ int _ftruncate(int fd, long length)
     if (!curr_fd_table[fd].is_used)
         return -EBADF;
 
+    // Shared memory objects get their size this way, before they are mapped
+    if (curr_fd_table[fd].global_fd != NULL && curr_fd_table[fd].global_fd->shm != NULL)
+        return length < 0 ? -EINVAL : shm_resize(curr_fd_table[fd].global_fd->shm, length);
+
+    // Pipes and terminals have no clusters, their zeroed FileData would truncate the FAT itself
+    if (!fd_is_fat_file(&curr_fd_table[fd]))
+        return -EINVAL;
+
+    r = global_fd_flush(curr_fd_table[fd].global_fd);
+    if (r != 0)
+        return r;
+
     r = fat_truncate(&curr_fd_table[fd].global_fd->file, length);
     if (r == 0)
     {
@@ -376,4 +934,293 @@ int _ftruncate(int fd, long length)
     }
 
     return r;
-}
\ No newline at end of file
+}
+
+int _fsync(int fd)
+{
+    process_t* current_process = get_current_process();
+    if (current_process == NULL)
+        return -ESRCH;
+    file_descriptor* curr_fd_table = current_process->shared->fd_table;
+
+    if (fd < 0 || fd >= MAX_LOCAL_FD || !curr_fd_table[fd].is_used)
+        return -EBADF;
+
+    // Terminals, pipes and shared memory have nothing to write out
+    if (curr_fd_table[fd].global_fd == NULL)
+        return 0;
+
+    // The disk driver writes through, so once the held back appends and the zeros of an unwritten
+    // part are written it's all there
+    int r = global_fd_flush(curr_fd_table[fd].global_fd);
+    if (r != 0)
+        return r;
+    if (fd_is_fat_file(&curr_fd_table[fd]) && fat_fill_unwritten(&curr_fd_table[fd].global_fd->file.file_entry) != 0)
+        return -EIO;
+    return 0;
+}
+
+int _fallocate(int fd, int mode, uint32_t offset, uint32_t len)
+{
+    process_t* current_process = get_current_process();
+    if (current_process == NULL)
+        return -ESRCH;
+    file_descriptor* curr_fd_table = current_process->shared->fd_table;
+
+    if (fd < 0 || fd >= MAX_LOCAL_FD || !curr_fd_table[fd].is_used)
+        return -EBADF;
+    if ((curr_fd_table[fd].flags & O_ACCMODE) == O_RDONLY)
+        return -EBADF;
+    if (!fd_is_fat_file(&curr_fd_table[fd]))
+        return -ENODEV;
+    if (mode != 0)
+        return -EOPNOTSUPP;
+    if (len == 0)
+        return -EINVAL;
+    if (offset + len < offset)
+        return -EFBIG;
+
+    global_file_descriptor* glob_fd = curr_fd_table[fd].global_fd;
+    int r = global_fd_flush(glob_fd);
+    if (r != 0)
+        return r;
+
+    // The clusters inside the file are already there, FAT has no holes
+    if (offset + len <= glob_fd->file.file_entry.file_size)
+        return 0;
+
+    // Grown like by ftruncate(), the clusters are taken as one run and nothing is written to them
+    return fat_truncate(&glob_fd->file, offset + len) != 0 ? -ENOSPC : 0;
+}
+
+int _defrag(fat_frag_stats_t *before, fat_frag_stats_t *after)
+{
+    return global_fd_defrag(before, after) != 0 ? -EIO : 0;
+}
+
+int _pipe(int pipefd[2])
+{
+    process_t* current_process = get_current_process();
+    if (current_process == NULL)
+        return -ESRCH;
+    file_descriptor* curr_fd_table = current_process->shared->fd_table;
+
+    if (pipefd == NULL)
+        return -EFAULT;
+
+    int read_fd = -1, write_fd = -1;
+    for (int i = 0; i < MAX_LOCAL_FD && write_fd < 0; i++)
+    {
+        if (curr_fd_table[i].is_used)
+            continue;
+        if (read_fd < 0)
+            read_fd = i;
+        else
+            write_fd = i;
+    }
+    if (write_fd < 0)
+        return -EMFILE;
+
+    global_file_descriptor* read_end;
+    global_file_descriptor* write_end;
+    global_fd_lock();
+    int r = pipe_create(&read_end, &write_end);
+    global_fd_unlock();
+    if (r != 0)
+        return r;
+
+    curr_fd_table[read_fd] = (file_descriptor){ .global_fd = read_end, .flags = O_RDONLY, .is_used = true };
+    curr_fd_table[write_fd] = (file_descriptor){ .global_fd = write_end, .flags = O_WRONLY, .is_used = true };
+    pipefd[0] = read_fd;
+    pipefd[1] = write_fd;
+    return 0;
+}
+
+int _dup(int oldfd)
+{
+    process_t* current_process = get_current_process();
+    if (current_process == NULL)
+        return -ESRCH;
+    file_descriptor* curr_fd_table = current_process->shared->fd_table;
+
+    if (oldfd < 0 || oldfd >= MAX_LOCAL_FD || !curr_fd_table[oldfd].is_used)
+        return -EBADF;
+
+    for (int i = 0; i < MAX_LOCAL_FD; i++)
+    {
+        if (!curr_fd_table[i].is_used)
+        {
+            fd_get(&curr_fd_table[i], &curr_fd_table[oldfd]);
+            return i;
+        }
+    }
+    return -EMFILE;
+}
+
+int _dup2(int oldfd, int newfd)
+{
+    process_t* current_process = get_current_process();
+    if (current_process == NULL)
+        return -ESRCH;
+    file_descriptor* curr_fd_table = current_process->shared->fd_table;
+
+    if (oldfd < 0 || oldfd >= MAX_LOCAL_FD || !curr_fd_table[oldfd].is_used)
+        return -EBADF;
+    if (newfd < 0 || newfd >= MAX_LOCAL_FD)
+        return -EBADF;
+    if (oldfd == newfd)
+        return newfd;
+
+    // Unlike close(), redirecting stdin and stdout is fine, that's what dup2 is for
+    if (curr_fd_table[newfd].is_used)
+        fd_put(&curr_fd_table[newfd]);
+    fd_get(&curr_fd_table[newfd], &curr_fd_table[oldfd]);
+    return newfd;
+}
+
+int _poll(struct pollfd *fds, uint32_t nfds, int timeout)
+{
+    if (get_current_process() == NULL)
+        return -ESRCH;
+    if (nfds > MAX_LOCAL_FD)
+        return -EINVAL;
+    if (fds == NULL && nfds > 0)
+        return -EFAULT;
+
+    int32_t timeout_ticks = timeout < 0 ? -1 : (int32_t)timer_ns_to_ticks((uint64_t)timeout * 1000000);
+    return poll_fds(fds, nfds, timeout_ticks);
+}
+
+// Whether the fd is in the select() set, the sets are arrays of 32 bit words
+static inline bool fd_set_has(const uint32_t *set, int fd)
+{
+    return set != NULL && (set[fd / 32] & (1u << (fd % 32)));
+}
+
+int _select(int nfds, uint32_t *readfds, uint32_t *writefds, uint32_t *exceptfds, struct timeval *timeout)
+{
+    if (get_current_process() == NULL)
+        return -ESRCH;
+    if (nfds < 0 || nfds > MAX_LOCAL_FD)
+        return -EINVAL;
+
+    struct pollfd* fds = NULL;
+    uint32_t count = 0;
+    if (nfds > 0)
+    {
+        fds = kmalloc(nfds * sizeof(struct pollfd));
+        if (fds == NULL)
+            return -ENOMEM;
+    }
+
+    // select() is poll() on the fds that are in any of the sets
+    for (int fd = 0; fd < nfds; fd++)
+    {
+        short events = (fd_set_has(readfds, fd) ? POLLIN : 0) | (fd_set_has(writefds, fd) ? POLLOUT : 0)
+            | (fd_set_has(exceptfds, fd) ? POLLPRI : 0);
+        if (events != 0)
+            fds[count++] = (struct pollfd){ .fd = fd, .events = events };
+    }
+
+    int32_t timeout_ticks = -1;
+    if (timeout != NULL)
+    {
+        uint64_t ns = (uint64_t)timeout->tv_sec * 1000000000 + (uint64_t)timeout->tv_usec * 1000;
+        uint32_t ticks = timer_ns_to_ticks(ns);
+        timeout_ticks = ticks > INT32_MAX ? INT32_MAX : (int32_t)ticks;
+    }
+
+    int r = poll_fds(fds, count, timeout_ticks);
+    if (r < 0)
+    {
+        kfree(fds);
+        return r;
+    }
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (fds[i].revents & POLLNVAL)
+        {
+            kfree(fds);
+            return -EBADF;
+        }
+    }
+
+    // The sets come back with only the ready fds in them
+    for (int i = 0; i < (nfds + 31) / 32; i++)
+    {
+        if (readfds != NULL)
+            readfds[i] = 0;
+        if (writefds != NULL)
+            writefds[i] = 0;
+        if (exceptfds != NULL)
+            exceptfds[i] = 0;
+    }
+
+    r = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        int fd = fds[i].fd;
+        uint32_t bit = 1u << (fd % 32);
+
+        // A hang up or an error is something a read or write returns right away
+        if (fds[i].events & POLLIN && fds[i].revents & (POLLIN | POLLHUP | POLLERR))
+        {
+            readfds[fd / 32] |= bit;
+            r++;
+        }
+        if (fds[i].events & POLLOUT && fds[i].revents & (POLLOUT | POLLERR))
+        {
+            writefds[fd / 32] |= bit;
+            r++;
+        }
+        if (fds[i].events & POLLPRI && fds[i].revents & POLLPRI)
+        {
+            exceptfds[fd / 32] |= bit;
+            r++;
+        }
+    }
+
+    kfree(fds);
+    return r;
+}
+
+
+int _fcntl(int fd, int cmd, uint32_t arg)
+{
+    process_t* current_process = get_current_process();
+    if (current_process == NULL)
+        return -ESRCH;
+    file_descriptor* curr_fd_table = current_process->shared->fd_table;
+
+    if (fd < 0 || fd >= MAX_LOCAL_FD || !curr_fd_table[fd].is_used)
+        return -EBADF;
+
+    switch (cmd)
+    {
+    case F_GETFL:
+        return curr_fd_table[fd].flags & (O_ACCMODE | O_APPEND | O_NONBLOCK);
+    case F_SETFL:
+        curr_fd_table[fd].flags = (curr_fd_table[fd].flags & ~(O_APPEND | O_NONBLOCK))
+            | (arg & (O_APPEND | O_NONBLOCK));
+        return 0;
+    default:
+        return -EINVAL;
+    }
+}
+
+int _ioctl(int fd, uint32_t request, void *arg)
+{
+    process_t* current_process = get_current_process();
+    if (current_process == NULL)
+        return -ESRCH;
+    file_descriptor* curr_fd_table = current_process->shared->fd_table;
+
+    if (fd < 0 || fd >= MAX_LOCAL_FD || !curr_fd_table[fd].is_used)
+        return -EBADF;
+
+    if (curr_fd_table[fd].global_fd == NULL || curr_fd_table[fd].global_fd->_ioctl == NULL)
+        return -ENOTTY;
+
+    return curr_fd_table[fd].global_fd->_ioctl(curr_fd_table[fd].global_fd, request, arg);
+}
@@ -1,6 +1,9 @@
 #include <stdint.h>
 #include <string.h>
 #include "process/manager/process_manager.h"
+#include "process/syscalls/handlers/time/time.h"
+#include "filesystem/vfs/poll.h"
+#include "uio.h"
 
 enum lseek_whence_e
 {
@@ -30,11 +33,6 @@ typedef uint32_t gid_t;
 typedef uint32_t blksize_t;
 typedef uint32_t blkcnt_t;
 
-struct timespec {
-    uint32_t tv_sec;
-    uint32_t tv_nsec;
-};
-
 struct stat {
     dev_t     st_dev;         /* ID of device containing file */
     ino_t     st_ino;         /* Inode number */
@@ -74,6 +72,7 @@ int _open(char *path, uint32_t flags);
  *   0 on success.
  *   -EBADF if the file descriptor is invalid.
  *   -ESRCH if the current process is not found.
+ *   -ENOSPC or -EIO if what the fd appended couldn't be written out, the fd is closed anyway.
  */
 int _close(int fd);
 
@@ -89,6 +88,7 @@ int _close(int fd);
  *   -EBADF if the file descriptor is invalid.
  *   -EPERM if the file descriptor is not open for reading.
  *   -ESRCH if the current process is not found.
+ *   -EFAULT if the buffer isn't mapped user memory.
  */
 int _read(int fd, void *buf, uint32_t count);
 
@@ -104,9 +104,103 @@ int _read(int fd, void *buf, uint32_t count);
  *   -EBADF if the file descriptor is invalid.
  *   -EPERM if the file descriptor is not open for writing.
  *   -ESRCH if the current process is not found.
+ *   -EFAULT if the buffer isn't mapped user memory.
  */
 int _write(int fd, void *buf, uint32_t count);
 
+/**
+ * _readv - Reads into several buffers at once, filling each before moving to the next.
+ *
+ * A file on the disk is read in one go, its cluster chain walked once for all the buffers.
+ *
+ * @iov: The buffers.
+ * @iovcnt: The amount of buffers, up to IOV_MAX.
+ *
+ * Returns:
+ *   The number of bytes read on success, 0 at the end of the file.
+ *   -EBADF if the file descriptor is invalid.
+ *   -EINVAL if there are too many buffers or their sizes add up past INT32_MAX.
+ *   -EFAULT if the array or a buffer isn't mapped user memory.
+ *   -EIO if the disk can't be read.
+ *   -ENOSPC if the appends the file held back can't be written out first.
+ */
+int _readv(int fd, const struct iovec *iov, uint32_t iovcnt);
+
+/**
+ * _writev - Writes several buffers at once, as if they were one buffer.
+ *
+ * A file on the disk is extended once for all the buffers and written in one go.
+ *
+ * Returns:
+ *   The number of bytes written on success.
+ *   -EBADF if the file descriptor is invalid.
+ *   -EINVAL if there are too many buffers or their sizes add up past INT32_MAX.
+ *   -EFAULT if the array or a buffer isn't mapped user memory.
+ *   -EIO if the disk can't be written.
+ */
+int _writev(int fd, const struct iovec *iov, uint32_t iovcnt);
+
+/**
+ * _preadv - _readv() at the given offset, the offset of the fd stays where it is.
+ *
+ * Returns:
+ *   Same as _readv().
+ *   -ESPIPE if the fd isn't a file on the disk.
+ */
+int _preadv(int fd, const struct iovec *iov, uint32_t iovcnt, uint32_t offset);
+
+/**
+ * _pwritev - _writev() at the given offset, the offset of the fd stays where it is.
+ *
+ * Returns:
+ *   Same as _writev().
+ *   -ESPIPE if the fd isn't a file on the disk.
+ */
+int _pwritev(int fd, const struct iovec *iov, uint32_t iovcnt, uint32_t offset);
+
+// _preadv() and _pwritev() with a single buffer
+int _pread(int fd, void *buf, uint32_t count, uint32_t offset);
+int _pwrite(int fd, const void *buf, uint32_t count, uint32_t offset);
+
+/**
+ * _copy_file_range - Copies data between two files on the disk without going through user space.
+ *
+ * The destination's chain is extended in one pass, then the data moves a run of clusters at a
+ * time with multi-sector transfers.
+ *
+ * @off_in, @off_out: Where to copy from and to, moved past what was copied. When NULL the offset
+ *                    of the fd is used and moved instead.
+ * @flags: Must be 0.
+ *
+ * Returns:
+ *   The number of bytes copied, 0 at the end of the source.
+ *   -EBADF if a file descriptor is invalid, or fd_out is O_APPEND.
+ *   -EINVAL if either fd isn't a file on the disk, flags isn't 0, or the ranges overlap within one file.
+ *   -EFBIG if the destination would grow past 4 GiB.
+ *   -EIO if the disk can't be read or written.
+ *   -ENOSPC if the appends a file held back can't be written out first.
+ */
+int _copy_file_range(int fd_in, int64_t *off_in, int fd_out, int64_t *off_out, uint32_t len, uint32_t flags);
+
+/**
+ * _sendfile - Copies data from a file on the disk to any fd without going through user space.
+ *
+ * Like _copy_file_range() when out_fd is a file, otherwise the data is written to it from a
+ * kernel buffer.
+ *
+ * @offset: Where to read from, moved past what was copied. When NULL the offset of in_fd is used
+ *          and moved instead.
+ *
+ * Returns:
+ *   The number of bytes copied.
+ *   -EBADF if a file descriptor is invalid.
+ *   -EINVAL if in_fd isn't a file on the disk.
+ *   What writing to out_fd returns, if nothing was copied.
+ */
+int _sendfile(int out_fd, int in_fd, int32_t *offset, uint32_t count);
+// _sendfile() with a 64 bit offset
+int _sendfile64(int out_fd, int in_fd, int64_t *offset, uint32_t count);
+
 /**
  * _lseek - Repositions the file offset of a file descriptor.
  *
@@ -149,4 +243,137 @@ int _stat(const char *pathname, struct stat *statbuf);
 int _fstat(int fd, struct stat *statbuf);
 
 int _truncate(const char *path, long length);
-int _ftruncate(int fd, long length);
\ No newline at end of file
+int _ftruncate(int fd, long length);
+
+/**
+ * _fsync - Writes what the file holds back in memory to the disk.
+ *
+ * Appends to a file are held back for up to WRITEBACK_DELAY_MS, so they are written out in whole
+ * clusters. This doesn't wait for that.
+ *
+ * Returns:
+ *   0 on success, also for fds that have nothing to write out.
+ *   -EBADF if the file descriptor is invalid.
+ *   -ENOSPC if there are no free clusters for the appends held back, they stay held back.
+ *   -EIO if the disk can't be written.
+ */
+int _fsync(int fd);
+
+/**
+ * _fallocate - Makes sure the file has clusters for a range, growing it if the range goes past its end.
+ *
+ * The new clusters are taken as a single run when the volume has a free one that long, so the file
+ * can be read sequentially in multi-sector transfers later. Nothing is written to them, the part the
+ * file grows by reads as zeros.
+ *
+ * @mode: Must be 0, the size always covers what is allocated.
+ *
+ * Returns:
+ *   0 on success.
+ *   -EBADF if the file descriptor is invalid or not open for writing.
+ *   -ENODEV if the fd isn't a file on the disk.
+ *   -EOPNOTSUPP if mode isn't 0.
+ *   -EINVAL if len is 0.
+ *   -EFBIG if the file would grow past 4 GiB.
+ *   -ENOSPC if there aren't enough free clusters.
+ *   -EIO if the appends the file held back can't be written out first.
+ */
+int _fallocate(int fd, int mode, uint32_t offset, uint32_t len);
+
+/**
+ * _defrag - Moves every fragmented file on the disk into a single run of clusters.
+ *
+ * Runs while the system does, open files keep working and follow their clusters. Directories stay
+ * where they are.
+ *
+ * @before, @after: Get the fragmentation of the volume before and after, either may be NULL.
+ *
+ * Returns:
+ *   0 on success, also when some files had no free run to fit in.
+ *   -EIO if the disk can't be read or written, the files moved until then stay moved.
+ */
+int _defrag(fat_frag_stats_t *before, fat_frag_stats_t *after);
+
+/**
+ * _pipe - Creates a pipe, an in-memory channel between a read end and a write end.
+ *
+ * @pipefd: Gets the read end in [0] and the write end in [1].
+ *
+ * Returns:
+ *   0 on success.
+ *   -EMFILE if the process has no two free file descriptors.
+ *   -ENFILE or -ENOMEM if the pipe can't be allocated.
+ */
+int _pipe(int pipefd[2]);
+
+/**
+ * _dup - Duplicates a file descriptor into the lowest free one.
+ *
+ * Returns:
+ *   The new file descriptor on success.
+ *   -EBADF if oldfd is invalid.
+ *   -EMFILE if there is no free file descriptor.
+ */
+int _dup(int oldfd);
+
+/**
+ * _dup2 - Makes newfd refer to what oldfd refers to, closing newfd first if it's open.
+ *
+ * Returns:
+ *   newfd on success.
+ *   -EBADF if either file descriptor is invalid.
+ */
+int _dup2(int oldfd, int newfd);
+
+
+/**
+ * _poll - Waits until one of the fds is ready for what is asked of it.
+ *
+ * @fds: The fds and the events to wait for, revents is filled in. Negative fds are skipped.
+ * @nfds: The amount of fds.
+ * @timeout: In milliseconds, 0 only checks and a negative one waits forever.
+ *
+ * Returns:
+ *   The amount of fds with revents set, 0 if the timeout ran out.
+ *   -EINTR if an alarm fired while waiting.
+ *   -EINVAL if there are too many fds.
+ */
+int _poll(struct pollfd *fds, uint32_t nfds, int timeout);
+
+/**
+ * _select - Waits until one of the fds in the sets is ready, poll() with fd bitmaps.
+ *
+ * @nfds: One more than the highest fd in the sets.
+ * @readfds, @writefds, @exceptfds: Bitmaps of 32 bit words, any can be NULL. On return they
+ *                                  only hold the ready fds.
+ * @timeout: NULL waits forever.
+ *
+ * Returns:
+ *   The amount of bits set in the sets, 0 if the timeout ran out.
+ *   -EBADF if one of the fds isn't open.
+ *   -EINTR if an alarm fired while waiting.
+ */
+int _select(int nfds, uint32_t *readfds, uint32_t *writefds, uint32_t *exceptfds, struct timeval *timeout);
+
+/**
+ * _fcntl - Gets or sets the status flags of a file descriptor.
+ *
+ * @cmd: F_GETFL or F_SETFL, only O_APPEND and O_NONBLOCK can be set.
+ * @arg: The new flags for F_SETFL.
+ *
+ * Returns:
+ *   The flags for F_GETFL, 0 for F_SETFL.
+ *   -EBADF if the file descriptor is invalid.
+ *   -EINVAL if the command isn't supported.
+ */
+int _fcntl(int fd, int cmd, uint32_t arg);
+
+/**
+ * _ioctl - Device specific control, the termios requests of terminals.
+ *
+ * Returns:
+ *   What the device returns, 0 on success.
+ *   -EBADF if the file descriptor is invalid.
+ *   -ENOTTY if the fd isn't a device that takes requests.
+ */
+int _ioctl(int fd, uint32_t request, void *arg);
\ No newline at end of file
@@ -0,0 +1,82 @@
+#include "mem.h"
+#include "process/manager/process_manager.h"
+#include "filesystem/vfs/file.h"
+#include "memory/shm/shm.h"
+#include "errno.h"
+#include <stddef.h>
+
+void* _mmap(const struct mmap_arg_struct *args)
+{
+    process_t* current_process = get_current_process();
+    if (current_process == NULL)
+        return (void*)-ESRCH;
+    if (args == NULL)
+        return (void*)-EFAULT;
+
+    uint32_t page_count = (args->len + PAGE_SIZE - 1) / PAGE_SIZE;
+    uint32_t first_page = args->offset / PAGE_SIZE;
+    shm_object_t* shm;
+
+    // Private mappings would need copy on write, without it they'd be just as shared
+    if (args->len == 0 || page_count == 0 || !(args->flags & MAP_SHARED) || args->flags & MAP_FIXED)
+        return (void*)-EINVAL;
+    if (args->offset % PAGE_SIZE != 0)
+        return (void*)-EINVAL;
+
+    if (args->flags & MAP_ANONYMOUS)
+    {
+        shm = shm_create_anonymous(page_count * PAGE_SIZE);
+        if (shm == NULL)
+            return (void*)-ENOMEM;
+        // The mapping holds the only reference
+        shm_map_get(shm);
+        shm_put(shm);
+        first_page = 0;
+    }
+    else
+    {
+        file_descriptor* curr_fd_table = current_process->shared->fd_table;
+        if (args->fd >= MAX_LOCAL_FD || !curr_fd_table[args->fd].is_used)
+            return (void*)-EBADF;
+
+        // Another thread may close the fd, take the mapping reference while it's still open
+        global_fd_lock();
+        global_file_descriptor* global_fd = curr_fd_table[args->fd].global_fd;
+        shm = global_fd != NULL ? global_fd->shm : NULL;
+        if (shm != NULL)
+            shm_map_get(shm);
+        global_fd_unlock();
+        if (shm == NULL)
+            return (void*)-EBADF;
+
+        // Pages past the end of the object have no memory behind them
+        if (first_page + page_count < first_page
+            || first_page + page_count > (shm->size + PAGE_SIZE - 1) / PAGE_SIZE)
+        {
+            shm_map_put(shm);
+            return (void*)-EINVAL;
+        }
+    }
+
+    uintptr_t addr;
+    int r = mmap_map(current_process->shared, shm, first_page, page_count,
+        args->prot & PROT_WRITE, &addr);
+    if (r != 0)
+    {
+        shm_map_put(shm);
+        return (void*)r;
+    }
+    return (void*)addr;
+}
+
+int _munmap(void *addr, uint32_t length)
+{
+    process_t* current_process = get_current_process();
+    if (current_process == NULL)
+        return -ESRCH;
+
+    if ((uintptr_t)addr % PAGE_SIZE != 0 || length == 0)
+        return -EINVAL;
+
+    return mmap_unmap(current_process->shared, (uintptr_t)addr, length);
+}
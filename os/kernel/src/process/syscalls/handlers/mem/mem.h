@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdint.h>
+#include "memory/mmap/mmap.h"
+
+// The arguments of the old i386 mmap syscall, passed by pointer since they don't fit in registers
+struct mmap_arg_struct {
+    uint32_t addr;
+    uint32_t len;
+    uint32_t prot;
+    uint32_t flags;
+    uint32_t fd;
+    uint32_t offset;
+};
+
+/**
+ * _mmap - Maps a shared memory object, or new anonymous memory, into the process.
+ *
+ * @args: The mapping, only MAP_SHARED mappings of shm_open() fds and MAP_ANONYMOUS ones are
+ *        supported. The address is a hint and is ignored, MAP_FIXED isn't supported.
+ *
+ * Returns:
+ *   The address of the mapping on success, otherwise a negative errno:
+ *   -EBADF if the fd is not a shared memory object.
+ *   -EINVAL if the length is 0, the offset isn't page aligned, the range is past the end of
+ *           the object or the flags aren't supported.
+ *   -ENOMEM if there is no room for the mapping.
+ */
+void* _mmap(const struct mmap_arg_struct *args);
+
+/**
+ * _munmap - Removes a mapping made by _mmap.
+ *
+ * @addr: The address _mmap returned.
+ * @length: The length it was mapped with, mappings can only be removed whole.
+ *
+ * Returns:
+ *   0 on success.
+ *   -EINVAL if there is no such mapping.
+ */
+int _munmap(void *addr, uint32_t length);
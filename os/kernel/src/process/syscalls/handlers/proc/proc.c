@@ -2,6 +2,12 @@
 #include "process/manager/process_manager.h"
 #include "memory/paging/paging.h"
 #include "memory/heap/heap.h"
+#include "sync/futex.h"
+#include "memory/mmap/mmap.h"
+#include "time/clock.h"
+#include "time/timer.h"
+#include "errno.h"
+#include <stddef.h>
 
 #define ALIGN_UP(size, alignment) (((size) + (alignment)-1) & ~((alignment)-1))
 
@@ -10,6 +16,11 @@ void _exit(int status)
     exit_current_process();
 }
 
+void _exit_group(int status)
+{
+    exit_current_thread_group();
+}
+
 int _execve(const char *pathname, char *const argv[], char *const envp[])
 {
     int code = create_usermode_process(pathname, 0);
@@ -18,18 +29,62 @@ int _execve(const char *pathname, char *const argv[], char *const envp[])
 }
 
 int _getpid()
+{
+    return get_current_process()->shared->pid;
+}
+
+int _gettid()
 {
     return get_current_process()->pid;
 }
 
+int _clone(uint32_t flags, uintptr_t stack, uint32_t *parent_tid, uint32_t *child_tid, const struct int_registers *regs)
+{
+    uint32_t supported = CLONE_THREAD_FLAGS | CLONE_SYSVSEM | CLONE_PARENT_SETTID
+        | CLONE_CHILD_CLEARTID | CLONE_CHILD_SETTID;
+
+    // New processes still come from execve(), and there are no TLS segments
+    if ((flags & CLONE_THREAD_FLAGS) != CLONE_THREAD_FLAGS || (flags & ~supported) != 0)
+        return -EINVAL;
+    if (stack == 0 || stack >= RELOCATION_OFFSET)
+        return -EINVAL;
+
+    process_t* thread = create_thread(regs, stack);
+    if (thread == NULL)
+        return -ENOMEM;
+
+    // Written before the thread can run, so it finds its own id there
+    if ((flags & CLONE_PARENT_SETTID) && parent_tid != NULL)
+        *parent_tid = thread->pid;
+    if ((flags & CLONE_CHILD_SETTID) && child_tid != NULL)
+        *child_tid = thread->pid;
+    if (flags & CLONE_CHILD_CLEARTID)
+        thread->clear_child_tid = child_tid;
+
+    int tid = thread->pid;
+    start_thread(thread);
+    return tid;
+}
+
+int _sched_yield()
+{
+    force_switch_process();
+    return 0;
+}
+
 void* _sbrk(int increment)
 {
     process_t* proc = get_current_process();
-    uintptr_t proc_break = proc->process_break;
+    uintptr_t proc_break = proc->shared->process_break;
     uintptr_t current_page_end = ALIGN_UP(proc_break, PAGE_SIZE);
     uintptr_t page_tables_boundary = ALIGN_UP(proc_break, PAGES_PER_TABLE * PAGE_SIZE);
 
-    if (get_physical_address((void*)proc->process_break) == 0)
+    if (get_physical_address((void*)proc->shared->process_break) == 0)
+    {
+        return (void*)-1;
+    }
+    // The break can't grow into where mmap() puts its mappings
+    if (increment > 0 && proc_break + increment > MMAP_BASE)
     {
         return (void*)-1;
     }
@@ -70,6 +125,30 @@ void* _sbrk(int increment)
             return (void*)-1;
         }
     }
-    proc->process_break += increment;
+    proc->shared->process_break += increment;
     return (void*)proc_break;
-}
\ No newline at end of file
+}
+
+int _futex(uint32_t *uaddr, int futex_op, uint32_t val, const struct timespec *timeout)
+{
+    uint32_t timeout_ticks = 0;
+
+    switch (futex_op & FUTEX_CMD_MASK)
+    {
+    case FUTEX_WAIT:
+        if (timeout != NULL)
+        {
+            if (timeout->tv_sec < 0 || timeout->tv_nsec < 0 || timeout->tv_nsec >= (long)NSEC_PER_SEC)
+                return -EINVAL;
+            // A zero timeout still has to wait for the word to change, make it the shortest sleep
+            timeout_ticks = timer_ns_to_ticks((uint64_t)timeout->tv_sec * NSEC_PER_SEC + timeout->tv_nsec);
+            if (timeout_ticks == 0)
+                timeout_ticks = 1;
+        }
+        return futex_wait(uaddr, val, timeout_ticks);
+    case FUTEX_WAKE:
+        return futex_wake(uaddr, val);
+    default:
+        return -ENOSYS;
+    }
+}
@@ -1,6 +1,30 @@
 #pragma once
 
+#include <stdint.h>
+#include "process/syscalls/handlers/time/time.h"
+#include "cpu/idt/isr.h"
+
+// clone() flags, same as Linux
+#define CLONE_VM             0x00000100
+#define CLONE_FS             0x00000200
+#define CLONE_FILES          0x00000400
+#define CLONE_SIGHAND        0x00000800
+#define CLONE_THREAD         0x00010000
+#define CLONE_SYSVSEM        0x00040000
+#define CLONE_SETTLS         0x00080000
+#define CLONE_PARENT_SETTID  0x00100000
+#define CLONE_CHILD_CLEARTID 0x00200000
+#define CLONE_CHILD_SETTID   0x01000000
+
+// Only threads can be cloned, they share everything with the process
+#define CLONE_THREAD_FLAGS (CLONE_VM | CLONE_FS | CLONE_FILES | CLONE_SIGHAND | CLONE_THREAD)
+
 void _exit(int status);
+void _exit_group(int status);
 int _execve(const char *pathname, char *const argv[], char *const envp[]);
 int _getpid();
+int _gettid();
+int _clone(uint32_t flags, uintptr_t stack, uint32_t *parent_tid, uint32_t *child_tid, const struct int_registers *regs);
 void* _sbrk(int increment);
+int _sched_yield();
+int _futex(uint32_t *uaddr, int futex_op, uint32_t val, const struct timespec *timeout);
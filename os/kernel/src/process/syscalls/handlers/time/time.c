@@ -1,22 +1,41 @@
 #include "time.h"
-#include "util/io/io.h"
+#include "cpu/pit/pit.h"
+#include "time/clock.h"
+#include "time/timer.h"
+#include "util/math/div64.h"
+#include "process/manager/process_manager.h"
+#include "errno-base.h"
 #include <string.h>
 #include <stddef.h>
 
-static uint8_t cmos_read(uint8_t reg) {
-    io_out_byte(CMOS_ADDRESS, reg);
-    return io_in_byte(CMOS_DATA);
+#define TICKS_PER_SECOND TARGET_FREQ_HZ
+
+static void ns_to_timespec(uint64_t ns, struct timespec *ts)
+{
+    uint32_t nsec;
+    ts->tv_sec = (time_t)div64_u32(ns, NSEC_PER_SEC, &nsec);
+    ts->tv_nsec = nsec;
+}
+
+static uint64_t timeval_to_ns(const struct timeval *tv)
+{
+    return (uint64_t)tv->tv_sec * NSEC_PER_SEC + (uint64_t)tv->tv_usec * NSEC_PER_USEC;
+}
+
+static void ticks_to_itimer_timeval(uint32_t ticks, struct timeval *tv)
+{
+    uint32_t nsec;
+    tv->tv_sec = (time_t)div64_u32(timer_ticks_to_ns(ticks), NSEC_PER_SEC, &nsec);
+    tv->tv_usec = nsec / NSEC_PER_USEC;
 }
 
 int _gettimeofday(struct timeval *p, struct timezone *z)
 {
-    // Get the current time from RTC
-    p->tv_sec = (time_t)(
-        (cmos_read(0x09) * 3600) +  // Hours
-        (cmos_read(0x08) * 60) +    // Minutes
-        (cmos_read(0x07))           // Seconds
-    );
-    p->tv_usec = 0;  // RTC doesn't provide microseconds, set to 0
+    struct timespec now;
+    ns_to_timespec(clock_realtime_ns(), &now);
+
+    p->tv_sec = now.tv_sec;
+    p->tv_usec = now.tv_nsec / NSEC_PER_USEC;
 
     // Fill in timezone (optional, set to 0 if not needed)
     if (z != NULL) {
@@ -27,8 +46,184 @@ int _gettimeofday(struct timeval *p, struct timezone *z)
     return 0;  // Success
 }
 
+static void ticks_to_timeval(uint32_t ticks, struct timeval *tv)
+{
+    tv->tv_sec = ticks / TICKS_PER_SECOND;
+    tv->tv_usec = (ticks % TICKS_PER_SECOND) * (1000000 / TICKS_PER_SECOND);
+}
+
+int _clock_gettime(clockid_t clock_id, struct timespec *tp)
+{
+    process_t* current_process = get_current_process();
+
+    switch (clock_id)
+    {
+        case CLOCK_REALTIME:
+            ns_to_timespec(clock_realtime_ns(), tp);
+            return 0;
+        case CLOCK_MONOTONIC:
+            ns_to_timespec(clock_monotonic_ns(), tp);
+            return 0;
+        case CLOCK_PROCESS_CPUTIME_ID:
+            if (current_process == NULL)
+                return -ESRCH;
+            ns_to_timespec((uint64_t)(current_process->acct.user_ticks + current_process->acct.system_ticks)
+                * clock_tick_period_ns(), tp);
+            return 0;
+        default:
+            return -EINVAL;
+    }
+}
+
+int _clock_getres(clockid_t clock_id, struct timespec *res)
+{
+    uint32_t resolution;
+
+    switch (clock_id)
+    {
+        case CLOCK_REALTIME:
+        case CLOCK_MONOTONIC:
+            resolution = clock_resolution_ns();
+            break;
+        case CLOCK_PROCESS_CPUTIME_ID:
+            resolution = clock_tick_period_ns();
+            break;
+        default:
+            return -EINVAL;
+    }
+
+    if (res != NULL)
+    {
+        res->tv_sec = 0;
+        res->tv_nsec = resolution;
+    }
+    return 0;
+}
+
 clock_t _times(struct tms *buf)
 {
+    process_t* current_process = get_current_process();
+
     memset(buf, 0, sizeof(struct tms));
+    if (current_process != NULL)
+    {
+        buf->tms_utime = current_process->acct.user_ticks;
+        buf->tms_stime = current_process->acct.system_ticks;
+        buf->tms_cutime = current_process->children_acct.user_ticks;
+        buf->tms_cstime = current_process->children_acct.system_ticks;
+    }
+
+    return get_system_time();
+}
+
+int _getrusage(int who, struct rusage *usage)
+{
+    process_accounting_t* acct;
+    process_t* current_process = get_current_process();
+    if (current_process == NULL)
+        return -ESRCH;
+
+    switch (who)
+    {
+        case RUSAGE_SELF:
+            acct = &current_process->acct;
+            break;
+        case RUSAGE_CHILDREN:
+            acct = &current_process->children_acct;
+            break;
+        default:
+            return -EINVAL;
+    }
+
+    memset(usage, 0, sizeof(struct rusage));
+    ticks_to_timeval(acct->user_ticks, &usage->ru_utime);
+    ticks_to_timeval(acct->system_ticks, &usage->ru_stime);
+    usage->ru_nvcsw = acct->voluntary_switches;
+    usage->ru_nivcsw = acct->involuntary_switches;
+    return 0;
+}
+int _nanosleep(const struct timespec *req, struct timespec *rem)
+{
+    process_t* current_process = get_current_process();
+
+    if (req == NULL || req->tv_sec < 0 || req->tv_nsec < 0 || req->tv_nsec >= (long)NSEC_PER_SEC)
+        return -EINVAL;
+    if (current_process == NULL)
+        return -ESRCH;
+
+    uint32_t ticks = timer_ns_to_ticks((uint64_t)req->tv_sec * NSEC_PER_SEC + req->tv_nsec);
+    uint32_t deadline = get_system_ticks() + ticks + 1;
+
+    if (sleep_current_process(ticks))
+        return 0;
+
+    if (rem != NULL)
+    {
+        int32_t left = (int32_t)(deadline - get_system_ticks());
+        ns_to_timespec(left > 0 ? timer_ticks_to_ns(left) : 0, rem);
+    }
+    return -EINTR;
+}
+
+int _getitimer(int which, struct itimerval *curr_value)
+{
+    process_t* current_process = get_current_process();
+
+    if (which != ITIMER_REAL || curr_value == NULL)
+        return -EINVAL;
+    if (current_process == NULL)
+        return -ESRCH;
+
+    ticks_to_itimer_timeval(current_process->alarm_interval, &curr_value->it_interval);
+    ticks_to_itimer_timeval(timer_remaining(&current_process->alarm_timer), &curr_value->it_value);
+    return 0;
+}
+
+int _setitimer(int which, const struct itimerval *new_value, struct itimerval *old_value)
+{
+    process_t* current_process = get_current_process();
+
+    // ITIMER_VIRTUAL and ITIMER_PROF would need to count cpu time, only wall clock timers exist
+    if (which != ITIMER_REAL || new_value == NULL)
+        return -EINVAL;
+    if (new_value->it_value.tv_usec < 0 || new_value->it_value.tv_usec >= 1000000
+        || new_value->it_interval.tv_usec < 0 || new_value->it_interval.tv_usec >= 1000000)
+        return -EINVAL;
+    if (current_process == NULL)
+        return -ESRCH;
+
+    if (old_value != NULL)
+        _getitimer(which, old_value);
+
+    timer_cancel(&current_process->alarm_timer);
+    current_process->alarm_interval = timer_ns_to_ticks(timeval_to_ns(&new_value->it_interval));
+
+    uint64_t value_ns = timeval_to_ns(&new_value->it_value);
+    if (value_ns != 0)
+        timer_add(&current_process->alarm_timer, get_system_ticks() + timer_ns_to_ticks(value_ns));
     return 0;
-}
\ No newline at end of file
+}
+
+unsigned int _alarm(unsigned int seconds)
+{
+    struct itimerval new_value = {0};
+    struct itimerval old_value = {0};
+
+    new_value.it_value.tv_sec = seconds;
+    if (_setitimer(ITIMER_REAL, &new_value, &old_value) < 0)
+        return 0;
+
+    // Round up, so a pending alarm never reads as "no alarm"
+    if (old_value.it_value.tv_usec)
+        old_value.it_value.tv_sec++;
+    return old_value.it_value.tv_sec;
+}
+
+int _pause()
+{
+    if (get_current_process() == NULL)
+        return -ESRCH;
+
+    pause_current_process();
+    return -EINTR;
+}
@@ -1,17 +1,35 @@
 #pragma once
 
-#define CMOS_ADDRESS 0x70
-#define CMOS_DATA    0x71
+#include <stdint.h>
 
-typedef long long time_t;
-typedef long long clock_t;
+#define RUSAGE_SELF     0
+#define RUSAGE_CHILDREN (-1)
+
+#define ITIMER_REAL    0
+#define ITIMER_VIRTUAL 1
+#define ITIMER_PROF    2
+
+// Types must match the newlib ABI used by user programs
+typedef long time_t;
+typedef unsigned long clock_t;
 typedef long suseconds_t; 
+typedef int clockid_t;
 
 struct timeval {
     time_t      tv_sec;     /* seconds */
     suseconds_t tv_usec;    /* microseconds */
 };
 
+struct timespec {
+    time_t tv_sec;          /* seconds */
+    long   tv_nsec;         /* nanoseconds */
+};
+
+struct itimerval {
+    struct timeval it_interval; /* period, zero for a one shot timer */
+    struct timeval it_value;    /* time until the next expiration */
+};
+
 struct timezone {
     int tz_minuteswest;     /* minutes west of Greenwich */
     int tz_dsttime;         /* type of DST correction */
@@ -24,5 +42,127 @@ struct tms {
     clock_t tms_cstime; /* system time of children */
 };
 
+// Linux layout, only the cpu time and context switch fields are filled
+struct rusage {
+    struct timeval ru_utime; /* user CPU time used */
+    struct timeval ru_stime; /* system CPU time used */
+    long ru_maxrss;
+    long ru_ixrss;
+    long ru_idrss;
+    long ru_isrss;
+    long ru_minflt;
+    long ru_majflt;
+    long ru_nswap;
+    long ru_inblock;
+    long ru_oublock;
+    long ru_msgsnd;
+    long ru_msgrcv;
+    long ru_nsignals;
+    long ru_nvcsw;           /* voluntary context switches */
+    long ru_nivcsw;          /* involuntary context switches */
+};
+
 int _gettimeofday(struct timeval *p, struct timezone *z);
-clock_t _times(struct tms *buf);
\ No newline at end of file
+
+/**
+ * _clock_gettime - Get the time of a clock with nanosecond resolution.
+ *
+ * @clock_id: CLOCK_REALTIME, CLOCK_MONOTONIC or CLOCK_PROCESS_CPUTIME_ID.
+ * @tp: The buffer to store the time in.
+ *
+ * Returns:
+ *   0 on success.
+ *   -EINVAL if the clock is not supported.
+ */
+int _clock_gettime(clockid_t clock_id, struct timespec *tp);
+
+/**
+ * _clock_getres - Get the resolution of a clock.
+ *
+ * @clock_id: CLOCK_REALTIME, CLOCK_MONOTONIC or CLOCK_PROCESS_CPUTIME_ID.
+ * @res: The buffer to store the resolution in, can be NULL.
+ *
+ * Returns:
+ *   0 on success.
+ *   -EINVAL if the clock is not supported.
+ */
+int _clock_getres(clockid_t clock_id, struct timespec *res);
+
+/**
+ * _times - Get the cpu time used by the calling process and its exited children.
+ *
+ * @buf: Filled with the times, in clock ticks (CLOCKS_PER_SEC).
+ *
+ * Returns:
+ *   The clock ticks elapsed since boot.
+ */
+clock_t _times(struct tms *buf);
+
+/**
+ * _getrusage - Get the resource usage of the calling process or its exited children.
+ *
+ * @who: RUSAGE_SELF or RUSAGE_CHILDREN.
+ * @usage: The buffer to store the usage in.
+ *
+ * Returns:
+ *   0 on success.
+ *   -EINVAL if who is invalid.
+ *   -ESRCH if the current process is not found.
+ */
+int _getrusage(int who, struct rusage *usage);
+
+/**
+ * _nanosleep - Suspend the calling process for at least the given time.
+ *
+ * @req: The time to sleep.
+ * @rem: If not NULL and the sleep was interrupted by an alarm, filled with the time left.
+ *
+ * Returns:
+ *   0 on success.
+ *   -EINVAL if req is invalid.
+ *   -EINTR if an alarm went off during the sleep.
+ */
+int _nanosleep(const struct timespec *req, struct timespec *rem);
+
+/**
+ * _setitimer - Arm or disarm the interval timer of the calling process.
+ *
+ * @which: Only ITIMER_REAL is supported.
+ * @new_value: The new timer, a zero it_value disarms it.
+ * @old_value: If not NULL, filled with the previous timer.
+ *
+ * Returns:
+ *   0 on success.
+ *   -EINVAL if which or new_value is invalid.
+ */
+int _setitimer(int which, const struct itimerval *new_value, struct itimerval *old_value);
+
+/**
+ * _getitimer - Get the interval timer of the calling process.
+ *
+ * @which: Only ITIMER_REAL is supported.
+ * @curr_value: The buffer to store the timer in.
+ *
+ * Returns:
+ *   0 on success.
+ *   -EINVAL if which is invalid.
+ */
+int _getitimer(int which, struct itimerval *curr_value);
+
+/**
+ * _alarm - Arm a one shot ITIMER_REAL, replacing the current one.
+ *
+ * @seconds: Seconds until the alarm, 0 cancels the pending alarm.
+ *
+ * Returns:
+ *   The seconds that were left on the previous alarm, 0 if there was none.
+ */
+unsigned int _alarm(unsigned int seconds);
+
+/**
+ * _pause - Wait until an alarm goes off.
+ *
+ * Returns:
+ *   -EINTR, like pause() after a signal.
+ */
+int _pause();
@@ -4,10 +4,17 @@
 #include "cpu/gdt/gdt.h"
 #include "drivers/vga/vga.h"
 #include "process/manager/process_manager.h"
+#include "cpu/cpuid/cpuid.h"
+#include "cpu/msr/msr.h"
+#include "time/vdso.h"
+#include "sync/kernel_lock.h"
+
+extern void sysenter_entry();
 
 static void (*syscall_handler_array[SYSCALLS_MANAGER_MAX_HANDLERS])(struct int_registers *registers);
 
-static void handle_syscall(struct int_registers* registers);
+static bool sysenter_supported();
+static bool sysenter_enabled = false;
 
 
 void syscall_init()
@@ -23,17 +30,53 @@ void syscall_init()
     syscalls_manager_attach_handler(10, sys_unlink);
     syscalls_manager_attach_handler(12, sys_chdir);
     syscalls_manager_attach_handler(19, sys_lseek);
+    syscalls_manager_attach_handler(20, sys_getpid);
+    syscalls_manager_attach_handler(27, sys_alarm);
+    syscalls_manager_attach_handler(29, sys_pause);
     syscalls_manager_attach_handler(38, sys_rename);
     syscalls_manager_attach_handler(39, sys_mkdir);
     syscalls_manager_attach_handler(40, sys_rmdir);
-    syscalls_manager_attach_handler(40, sys_times);
+    syscalls_manager_attach_handler(41, sys_dup);
+    syscalls_manager_attach_handler(42, sys_pipe);
+    syscalls_manager_attach_handler(43, sys_times);
+    syscalls_manager_attach_handler(54, sys_ioctl);
+    syscalls_manager_attach_handler(55, sys_fcntl);
+    syscalls_manager_attach_handler(63, sys_dup2);
+    syscalls_manager_attach_handler(77, sys_getrusage);
     syscalls_manager_attach_handler(78, sys_gettimeofday);
+    syscalls_manager_attach_handler(90, sys_mmap);
+    syscalls_manager_attach_handler(91, sys_munmap);
     syscalls_manager_attach_handler(92, sys_truncate);
     syscalls_manager_attach_handler(93, sys_ftruncate);
+    syscalls_manager_attach_handler(104, sys_setitimer);
+    syscalls_manager_attach_handler(105, sys_getitimer);
     syscalls_manager_attach_handler(106, sys_stat);
     syscalls_manager_attach_handler(108, sys_fstat);
     syscalls_manager_attach_handler(141, sys_getdents);
+    syscalls_manager_attach_handler(142, sys_select);
+    syscalls_manager_attach_handler(145, sys_readv);
+    syscalls_manager_attach_handler(146, sys_writev);
+    syscalls_manager_attach_handler(148, sys_fsync);
+    syscalls_manager_attach_handler(118, sys_fsync);
+    syscalls_manager_attach_handler(120, sys_clone);
+    syscalls_manager_attach_handler(158, sys_sched_yield);
+    syscalls_manager_attach_handler(162, sys_nanosleep);
+    syscalls_manager_attach_handler(168, sys_poll);
+    syscalls_manager_attach_handler(180, sys_pread64);
+    syscalls_manager_attach_handler(181, sys_pwrite64);
     syscalls_manager_attach_handler(183, sys_getcwd);
+    syscalls_manager_attach_handler(187, sys_sendfile);
+    syscalls_manager_attach_handler(224, sys_gettid);
+    syscalls_manager_attach_handler(239, sys_sendfile64);
+    syscalls_manager_attach_handler(240, sys_futex);
+    syscalls_manager_attach_handler(252, sys_exit_group);
+    syscalls_manager_attach_handler(265, sys_clock_gettime);
+    syscalls_manager_attach_handler(266, sys_clock_getres);
+    syscalls_manager_attach_handler(324, sys_fallocate);
+    syscalls_manager_attach_handler(333, sys_preadv);
+    syscalls_manager_attach_handler(334, sys_pwritev);
+    syscalls_manager_attach_handler(377, sys_copy_file_range);
+    syscalls_manager_attach_handler(500, sys_defrag);
 
     syscalls_manager_attach_handler(59, sys_execve);
     syscalls_manager_attach_handler(183, sys_getcwd);
@@ -41,21 +84,60 @@ void syscall_init()
 
     syscalls_manager_attach_handler(169, print_logo);
     syscalls_manager_attach_handler(170, print_bye);
+
+    // int 0x80 stays as the fallback, user space only uses sysenter if the vDSO says so
+    sysenter_enabled = sysenter_supported();
+    syscall_init_cpu();
+    vdso_set_sysenter(sysenter_enabled);
+}
+
+void syscall_init_cpu()
+{
+    if (!sysenter_enabled)
+        return;
+
+    // sysexit takes the user segments from this one: cs + 16 (0x1B) and cs + 24 (0x23)
+    msr_write(MSR_IA32_SYSENTER_CS, GDT_KERNEL_CODE_INDEX);
+    // The entry loads the current kernel stack from this cpu's TSS through this pointer
+    msr_write(MSR_IA32_SYSENTER_ESP, (uint32_t)tss_get_esp0_address());
+    msr_write(MSR_IA32_SYSENTER_EIP, (uint32_t)sysenter_entry);
+}
+
+static bool sysenter_supported()
+{
+    cpuid_registers regs;
+
+    if (!cpuid_has_feature(CPUID_EDX_SEP | CPUID_EDX_MSR))
+        return false;
+
+    // The Pentium Pro reports SEP without actually supporting it
+    cpuid(CPUID_LEAF_FEATURES, &regs);
+    uint32_t family = (regs.eax >> 8) & 0xF;
+    uint32_t model = (regs.eax >> 4) & 0xF;
+    uint32_t stepping = regs.eax & 0xF;
+    if (family == 6 && model < 3 && stepping < 3)
+        return false;
+
+    return true;
 }
 
 
-static void handle_syscall(struct int_registers* registers)
+void handle_syscall(struct int_registers* registers)
 {
     if (registers->eax < SYSCALLS_MANAGER_MAX_HANDLERS && syscall_handler_array[registers->eax] != 0)
     {
-        get_current_process()->is_kernel_mode = true;
+        kernel_lock();
+        get_current_process()->in_syscall = true;
         (*syscall_handler_array[registers->eax])(registers);
-        get_current_process()->is_kernel_mode = false;
-        tss_fill_esp0((uint32_t)get_current_process()->kernel_stack);
+        get_current_process()->in_syscall = false;
+        // Another thread of the process called exit_group() while this one was in the syscall
+        if (get_current_process()->shared->exiting)
+            exit_current_process();
+        kernel_unlock();
     }
 }
 
-void syscalls_manager_attach_handler(uint8_t function_number, void (*handler)(int_registers *state))
+void syscalls_manager_attach_handler(uint16_t function_number, void (*handler)(int_registers *state))
 {
     if (function_number < SYSCALLS_MANAGER_MAX_HANDLERS) 
     {
@@ -63,7 +145,7 @@ void syscalls_manager_attach_handler(uint8_t function_number, void (*handler)(in
     }
 }
 
-void syscalls_manager_detach_handler(uint8_t function_number)
+void syscalls_manager_detach_handler(uint16_t function_number)
 {
     if (function_number < SYSCALLS_MANAGER_MAX_HANDLERS)
     {
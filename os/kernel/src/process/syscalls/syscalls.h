@@ -1,8 +1,12 @@
 #pragma once
 #include "cpu/idt/isr.h"
 
-#define SYSCALLS_MANAGER_MAX_HANDLERS 256
+#define SYSCALLS_MANAGER_MAX_HANDLERS 512
 
 void syscall_init();
-void syscalls_manager_attach_handler(uint8_t function_number, void (*handler)(struct int_registers *state));
-void syscalls_manager_detach_handler(uint8_t function_number);
\ No newline at end of file
+// Points this cpu's sysenter MSRs at the kernel, syscall_init does it for the boot cpu
+void syscall_init_cpu();
+// Called with the frame of an int 0x80, or the same frame built by the sysenter entry
+void handle_syscall(struct int_registers* registers);
+void syscalls_manager_attach_handler(uint16_t function_number, void (*handler)(struct int_registers *state));
+void syscalls_manager_detach_handler(uint16_t function_number);
\ No newline at end of file
@@ -0,0 +1,82 @@
+bits 32
+
+extern handle_syscall
+extern exit_current_process
+
+; The user stub (toolchains/newlib/dbolos/syscall.h) does:
+;   push <return address>
+;   push ecx
+;   push edx
+;   push ebp
+;   mov ebp, esp
+;   sysenter
+; so ecx and edx (the 2nd and 3rd arguments) are on the user stack, and ebp points at them.
+USER_FRAME_EBP equ 0
+USER_FRAME_EDX equ 4
+USER_FRAME_ECX equ 8
+USER_FRAME_EIP equ 12
+USER_FRAME_SIZE equ 16
+
+USER_SPACE_END equ 0xC0000000
+
+section .text
+
+; IA32_SYSENTER_ESP points at tss.esp0, so the first thing to do is to load the real kernel stack
+global sysenter_entry
+sysenter_entry:
+    mov esp, [esp]
+
+    cmp ebp, USER_SPACE_END - USER_FRAME_SIZE
+    ja .bad_frame
+
+    ; Build the same frame isr_common builds for int 0x80, so the handlers can't tell the difference
+    push dword 0x23                         ; ss
+    push ebp                                ; esp
+    pushfd                                  ; eflags
+    push dword 0x1B                         ; cs
+    push dword [ebp + USER_FRAME_EIP]       ; eip
+    push dword 0                            ; error
+    push dword 0x80                         ; interrupt
+    push eax
+    push dword [ebp + USER_FRAME_ECX]
+    push dword [ebp + USER_FRAME_EDX]
+    push ebx
+    push dword 0                            ; kern_esp, ignored by popad
+    push dword [ebp + USER_FRAME_EBP]
+    push esi
+    push edi
+
+    xor eax, eax                            ; ds
+    mov ax, ds
+    push eax
+
+    mov ax, 0x10                            ; use kernel data segment
+    mov ds, ax
+    mov es, ax
+    mov fs, ax
+    mov gs, ax
+
+    push esp
+    call handle_syscall
+    add esp, 4
+
+    pop eax                                 ; restore old ds
+    mov ds, ax
+    mov es, ax
+    mov fs, ax
+    mov gs, ax
+
+    popad
+    add esp, 8                              ; remove error code and interrupt number
+    mov edx, [esp]                          ; sysexit jumps to edx
+    mov ecx, [esp + 12]                     ; with esp = ecx
+    add esp, 8                              ; skip eip and cs
+    popfd                                   ; interrupts stay off until the sysexit
+    sti
+    sysexit
+
+.bad_frame:
+    mov ax, 0x10
+    mov ds, ax
+    mov es, ax
+    call exit_current_process
@@ -0,0 +1,119 @@
+#include "workqueue.h"
+#include "process/manager/process_manager.h"
+#include "sync/spinlock.h"
+#include <stddef.h>
+
+static work_t* queue_head = NULL;
+static work_t* queue_tail = NULL;
+static process_t* worker = NULL;
+// Interrupt handlers queue work, possibly on another cpu than the worker
+static spinlock_t queue_lock = SPINLOCK_INIT;
+
+// Must be called with the queue lock held
+static work_t* dequeue_work()
+{
+    work_t* work = queue_head;
+    if (work == NULL)
+        return NULL;
+
+    queue_head = work->next;
+    if (queue_head == NULL)
+        queue_tail = NULL;
+
+    work->next = NULL;
+    work->pending = false;
+    return work;
+}
+
+// Must be called with the queue lock held
+static bool unlink_work(work_t* work)
+{
+    work_t* prev = NULL;
+    for (work_t* iter = queue_head; iter != NULL; prev = iter, iter = iter->next)
+    {
+        if (iter != work)
+            continue;
+
+        if (prev == NULL)
+            queue_head = work->next;
+        else
+            prev->next = work->next;
+        if (queue_tail == work)
+            queue_tail = prev;
+
+        work->next = NULL;
+        work->pending = false;
+        return true;
+    }
+    return false;
+}
+
+static int worker_thread(void* arg)
+{
+    while (true)
+    {
+        uint32_t flags = spin_lock_irqsave(&queue_lock);
+        work_t* work = dequeue_work();
+        if (work == NULL)
+        {
+            // Asleep before the lock is dropped, so work queued in between still wakes us up
+            worker->state = PROCESS_SLEEPING;
+            spin_unlock_irqrestore(&queue_lock, flags);
+            force_switch_process();
+            continue;
+        }
+        spin_unlock_irqrestore(&queue_lock, flags);
+
+        work->func(work);
+    }
+    return 0;
+}
+
+bool workqueue_init()
+{
+    worker = kthread_create(worker_thread, NULL);
+    return worker != NULL;
+}
+
+void work_init(work_t* work, void (*func)(work_t* work), void* data)
+{
+    work->next = NULL;
+    work->func = func;
+    work->data = data;
+    work->pending = false;
+}
+
+bool schedule_work(work_t* work)
+{
+    uint32_t flags = spin_lock_irqsave(&queue_lock);
+
+    if (work->pending)
+    {
+        spin_unlock_irqrestore(&queue_lock, flags);
+        return false;
+    }
+
+    work->pending = true;
+    work->next = NULL;
+    if (queue_tail != NULL)
+        queue_tail->next = work;
+    else
+        queue_head = work;
+    queue_tail = work;
+
+    spin_unlock_irqrestore(&queue_lock, flags);
+
+    if (worker != NULL)
+        wake_up_process(worker);
+    return true;
+}
+
+void flush_work(work_t* work)
+{
+    uint32_t flags = spin_lock_irqsave(&queue_lock);
+    bool was_queued = unlink_work(work);
+    spin_unlock_irqrestore(&queue_lock, flags);
+
+    if (was_queued)
+        work->func(work);
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Deferred work, run by a kernel thread with interrupts enabled.
+ * IRQ handlers queue a work item and return right away, the slow part (drawing to the screen,
+ * flushing buffers) happens later in the worker thread.
+ */
+typedef struct work {
+    struct work* next;
+    void (*func)(struct work* work);
+    void* data;
+    bool pending;
+} work_t;
+
+// Starts the worker thread
+bool workqueue_init();
+
+void work_init(work_t* work, void (*func)(work_t* work), void* data);
+// Safe to call from interrupt handlers, returns false if the work is already queued
+bool schedule_work(work_t* work);
+// If the work is queued, run it now in the caller's context instead of waiting for the worker
+// A run the worker already started isn't waited for, it may still be going when this returns
+void flush_work(work_t* work);
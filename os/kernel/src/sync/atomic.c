@@ -0,0 +1,19 @@
+#include "atomic.h"
+
+uint32_t atomic_xchg(volatile uint32_t* addr, uint32_t value)
+{
+    // xchg with a memory operand is always locked
+    asm volatile("xchg %0, %1" : "+r"(value), "+m"(*addr) :: "memory");
+    return value;
+}
+
+uint32_t atomic_add(volatile uint32_t* addr, uint32_t value)
+{
+    asm volatile("lock xadd %0, %1" : "+r"(value), "+m"(*addr) :: "memory");
+    return value;
+}
+
+uint32_t atomic_sub(volatile uint32_t* addr, uint32_t value)
+{
+    return atomic_add(addr, -value);
+}
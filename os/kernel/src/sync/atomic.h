@@ -0,0 +1,15 @@
+#pragma once
+#include <stdint.h>
+
+// Locked read-modify-write operations, safe against the other cpus
+uint32_t atomic_xchg(volatile uint32_t* addr, uint32_t value);
+// Returns the value before the add
+uint32_t atomic_add(volatile uint32_t* addr, uint32_t value);
+uint32_t atomic_sub(volatile uint32_t* addr, uint32_t value);
+
+// Keeps the compiler from moving memory accesses across it. x86 itself keeps stores in order with
+// other stores and loads with other loads, which is all a single producer single consumer ring needs
+static inline void compiler_barrier()
+{
+    asm volatile("" ::: "memory");
+}
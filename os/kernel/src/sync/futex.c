@@ -0,0 +1,94 @@
+#include "futex.h"
+#include "spinlock.h"
+#include "wait_queue.h"
+#include "memory/paging/paging.h"
+#include "process/manager/process_manager.h"
+#include "cpu/pit/pit.h"
+#include "time/timer.h"
+#include "errno.h"
+#include <stddef.h>
+
+typedef struct futex_waiter {
+    wait_entry_t entry;     // must stay first, the bucket queue links the entries
+    uintptr_t key;          // physical address of the word
+} futex_waiter_t;
+
+// Words that hash the same share a bucket, a wake skips the waiters of other words
+typedef struct futex_bucket {
+    spinlock_t lock;
+    wait_queue_t waiters;
+} futex_bucket_t;
+
+static futex_bucket_t futex_buckets[FUTEX_HASH_SIZE];
+
+static futex_bucket_t* futex_hash(uintptr_t key)
+{
+    // Words are 4 byte aligned, Fibonacci hashing spreads the rest over the buckets
+    return &futex_buckets[((key >> 2) * 0x9E3779B1u) >> (32 - FUTEX_HASH_BITS)];
+}
+
+// The word must be an aligned, mapped user address of the current process
+static uintptr_t futex_key(volatile uint32_t* uaddr)
+{
+    if ((uintptr_t)uaddr % sizeof(uint32_t) != 0 || (uintptr_t)uaddr >= RELOCATION_OFFSET)
+        return 0;
+    return get_physical_address((void*)uaddr);
+}
+
+int futex_wait(volatile uint32_t* uaddr, uint32_t val, uint32_t timeout_ticks)
+{
+    process_t* proc = get_current_process();
+    uintptr_t key = futex_key(uaddr);
+    if (key == 0)
+        return -EFAULT;
+
+    futex_bucket_t* bucket = futex_hash(key);
+    futex_waiter_t waiter = { .key = key };
+    uint32_t alarms = proc->pending_alarms;
+
+    uint32_t flags = spin_lock_irqsave(&bucket->lock);
+    // The waker changes the word before it takes the bucket lock, so either we see the new
+    // value here or it finds us on the queue
+    if (*uaddr != val)
+    {
+        spin_unlock_irqrestore(&bucket->lock, flags);
+        return -EAGAIN;
+    }
+    wait_queue_add(&bucket->waiters, &waiter.entry);
+    // Woken by futex_wake, the timeout or an alarm, whichever comes first
+    bool woken = wait_queue_sleep_timed(&waiter.entry, &bucket->lock, &flags, timeout_ticks != 0,
+        get_system_ticks() + timeout_ticks + 1);
+    if (!woken)
+        wait_queue_remove(&bucket->waiters, &waiter.entry);
+    spin_unlock_irqrestore(&bucket->lock, flags);
+
+    if (woken)
+        return 0;
+    return proc->pending_alarms != alarms ? -EINTR : -ETIMEDOUT;
+}
+
+int futex_wake(volatile uint32_t* uaddr, uint32_t count)
+{
+    uintptr_t key = futex_key(uaddr);
+    if (key == 0)
+        return -EFAULT;
+
+    futex_bucket_t* bucket = futex_hash(key);
+    int woken = 0;
+
+    uint32_t flags = spin_lock_irqsave(&bucket->lock);
+    wait_entry_t* iter = bucket->waiters.head;
+    while (iter != NULL && (uint32_t)woken < count)
+    {
+        wait_entry_t* next = iter->next;
+        if (((futex_waiter_t*)iter)->key == key)
+        {
+            wait_queue_wake(&bucket->waiters, iter);
+            woken++;
+        }
+        iter = next;
+    }
+    spin_unlock_irqrestore(&bucket->lock, flags);
+
+    return woken;
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Fast user space locks. A user lock is a plain 32 bit word that user space changes with atomic
+ * instructions, the kernel is only entered once a lock is contended: the loser waits on the word
+ * with futex_wait, and whoever releases a contended lock wakes it with futex_wake.
+ * Waiters are hashed by the physical address of the word, so processes that share the page find
+ * each other no matter where they mapped it.
+ */
+#define FUTEX_WAIT 0
+#define FUTEX_WAKE 1
+#define FUTEX_PRIVATE_FLAG 128 // accepted and ignored, every futex is keyed by its physical address
+#define FUTEX_CMD_MASK (~FUTEX_PRIVATE_FLAG)
+
+#define FUTEX_HASH_BITS 6
+#define FUTEX_HASH_SIZE (1 << FUTEX_HASH_BITS)
+
+// Sleeps while *uaddr == val until a futex_wake on the same word, or timeout_ticks pass (0 waits
+// forever). Returns 0 when woken, -EAGAIN if the word already changed, -ETIMEDOUT or -EINTR
+int futex_wait(volatile uint32_t* uaddr, uint32_t val, uint32_t timeout_ticks);
+// Wakes up to count waiters of the word, returns how many were woken
+int futex_wake(volatile uint32_t* uaddr, uint32_t count);
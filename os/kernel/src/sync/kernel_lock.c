@@ -0,0 +1,75 @@
+#include "kernel_lock.h"
+#include "spinlock.h"
+#include "cpu/idt/irq.h"
+#include "cpu/smp/smp.h"
+
+#define NO_OWNER 0xFFFFFFFF
+
+static lock_stats_t lock_stats = LOCK_STATS_INIT("kernel lock");
+static spinlock_t lock = SPINLOCK_INIT_STATS(&lock_stats);
+static volatile uint32_t owner = NO_OWNER;  // id of the cpu that holds it
+static uint32_t depth = 0;
+
+// Interrupts stay off while the owner changes, a switch in between would see a half taken lock
+void kernel_lock()
+{
+    uint32_t flags = irq_save();
+    uint32_t cpu_id = smp_cpu_id();
+
+    if (owner == cpu_id)
+    {
+        depth++;
+    }
+    else
+    {
+        spin_lock(&lock);
+        owner = cpu_id;
+        depth = 1;
+    }
+    irq_restore(flags);
+}
+
+void kernel_unlock()
+{
+    uint32_t flags = irq_save();
+
+    if (owner == smp_cpu_id() && --depth == 0)
+    {
+        owner = NO_OWNER;
+        spin_unlock(&lock);
+    }
+    irq_restore(flags);
+}
+
+bool kernel_lock_held()
+{
+    return owner == smp_cpu_id();
+}
+
+uint32_t kernel_lock_release_all()
+{
+    uint32_t flags = irq_save();
+    uint32_t held_depth = 0;
+
+    if (owner == smp_cpu_id())
+    {
+        held_depth = depth;
+        depth = 0;
+        owner = NO_OWNER;
+        spin_unlock(&lock);
+    }
+    irq_restore(flags);
+    return held_depth;
+}
+
+void kernel_lock_reacquire(uint32_t held_depth)
+{
+    if (held_depth == 0)
+        return;
+
+    uint32_t flags = irq_save();
+    spin_lock(&lock);
+    owner = smp_cpu_id();
+    depth = held_depth;
+    irq_restore(flags);
+}
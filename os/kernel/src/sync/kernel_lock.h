@@ -0,0 +1,20 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * The big kernel lock. The kernel was written for one cpu, so process context kernel code
+ * (syscalls and kernel threads) still runs on one cpu at a time: it takes this lock.
+ * The lock belongs to the process, not the cpu: the scheduler drops it when a process that
+ * holds it switches out, and takes it back before the process is switched back in.
+ * Interrupt handlers never take it, they protect what they share with their own spinlocks.
+ */
+
+// Recursive on the same cpu
+void kernel_lock();
+void kernel_unlock();
+bool kernel_lock_held();
+
+// For the scheduler, drops the lock completely and returns the depth it was held at (0 if not held)
+uint32_t kernel_lock_release_all();
+void kernel_lock_reacquire(uint32_t depth);
@@ -0,0 +1,58 @@
+#include "lock_stats.h"
+#include "spinlock.h"
+#include "time/clock.h"
+#include "drivers/vga/vga.h"
+#include "util/math/div64.h"
+#include <stddef.h>
+
+static lock_stats_t* stats_list = NULL;
+// A plain lock, it can't count itself
+static spinlock_t stats_list_lock = SPINLOCK_INIT;
+
+inline uint64_t lock_stats_now()
+{
+    return clock_monotonic_ns();
+}
+
+void lock_stats_acquired(lock_stats_t* stats, uint64_t wait_start)
+{
+    if (!stats->listed)
+    {
+        uint32_t flags = spin_lock_irqsave(&stats_list_lock);
+        stats->next = stats_list;
+        stats_list = stats;
+        stats->listed = true;
+        spin_unlock_irqrestore(&stats_list_lock, flags);
+    }
+
+    stats->acquisitions++;
+    if (wait_start != 0)
+    {
+        stats->contentions++;
+        stats->wait_ns += lock_stats_now() - wait_start;
+    }
+}
+
+void lock_stats_released(lock_stats_t* stats, uint64_t hold_start)
+{
+    uint64_t held = lock_stats_now() - hold_start;
+
+    stats->hold_ns += held;
+    if (held > stats->max_hold_ns)
+        stats->max_hold_ns = held;
+}
+
+void lock_stats_dump()
+{
+    uint32_t flags = spin_lock_irqsave(&stats_list_lock);
+    for (lock_stats_t* iter = stats_list; iter != NULL; iter = iter->next)
+    {
+        // vga_printf has no 64 bit format, microseconds fit in 32 bits for a long while
+        vga_printf("%s: %d taken, %d contended, waited %dus, held %dus (max %dus)\n",
+            iter->name, iter->acquisitions, iter->contentions,
+            (uint32_t)div64_u32(iter->wait_ns, NSEC_PER_USEC, NULL),
+            (uint32_t)div64_u32(iter->hold_ns, NSEC_PER_USEC, NULL),
+            (uint32_t)div64_u32(iter->max_hold_ns, NSEC_PER_USEC, NULL));
+    }
+    spin_unlock_irqrestore(&stats_list_lock, flags);
+}
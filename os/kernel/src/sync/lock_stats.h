@@ -0,0 +1,30 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Optional contention and hold time counters for the sync primitives.
+ * A lock only keeps them if it was given a lock_stats_t, every other lock pays a NULL check.
+ * The counters are only touched by the lock's holder, so they need no locking of their own.
+ * Times are in nanoseconds of the monotonic clock.
+ */
+typedef struct lock_stats {
+    const char* name;
+    uint32_t acquisitions;
+    uint32_t contentions;       // acquisitions that had to wait
+    uint64_t wait_ns;
+    uint64_t hold_ns;
+    uint64_t max_hold_ns;
+    bool listed;                // in the list lock_stats_dump walks
+    struct lock_stats* next;
+} lock_stats_t;
+
+#define LOCK_STATS_INIT(lock_name) { .name = (lock_name) }
+
+uint64_t lock_stats_now();
+// Called by the primitives once they got the lock, wait_start is 0 if it wasn't contended
+void lock_stats_acquired(lock_stats_t* stats, uint64_t wait_start);
+void lock_stats_released(lock_stats_t* stats, uint64_t hold_start);
+
+// Prints the counters of every lock that was taken at least once
+void lock_stats_dump();
@@ -0,0 +1,72 @@
+#include "mutex.h"
+#include "process/manager/process_manager.h"
+#include <stddef.h>
+
+// Must be called with the wait lock held
+static void mutex_take(mutex_t* mutex, uint64_t wait_start)
+{
+    mutex->locked = true;
+    mutex->owner = get_current_process();
+    if (mutex->stats != NULL)
+    {
+        lock_stats_acquired(mutex->stats, wait_start);
+        mutex->hold_start = lock_stats_now();
+    }
+}
+
+void mutex_init(mutex_t* mutex)
+{
+    spin_init(&mutex->wait_lock);
+    mutex->locked = false;
+    mutex->owner = NULL;
+    wait_queue_init(&mutex->waiters);
+    mutex->stats = NULL;
+    mutex->hold_start = 0;
+}
+
+void mutex_lock(mutex_t* mutex)
+{
+    uint32_t flags = spin_lock_irqsave(&mutex->wait_lock);
+    if (!mutex->locked)
+    {
+        mutex_take(mutex, 0);
+        spin_unlock_irqrestore(&mutex->wait_lock, flags);
+        return;
+    }
+
+    uint64_t wait_start = mutex->stats != NULL ? lock_stats_now() : 0;
+    wait_entry_t entry;
+    wait_queue_add(&mutex->waiters, &entry);
+    // mutex_unlock leaves it locked and hands it to us
+    wait_queue_sleep(&entry, &mutex->wait_lock, &flags);
+
+    mutex_take(mutex, wait_start);
+    spin_unlock_irqrestore(&mutex->wait_lock, flags);
+}
+
+bool mutex_trylock(mutex_t* mutex)
+{
+    uint32_t flags = spin_lock_irqsave(&mutex->wait_lock);
+    bool taken = !mutex->locked;
+    if (taken)
+        mutex_take(mutex, 0);
+    spin_unlock_irqrestore(&mutex->wait_lock, flags);
+    return taken;
+}
+
+void mutex_unlock(mutex_t* mutex)
+{
+    uint32_t flags = spin_lock_irqsave(&mutex->wait_lock);
+    if (mutex->stats != NULL)
+        lock_stats_released(mutex->stats, mutex->hold_start);
+
+    mutex->owner = NULL;
+    if (!wait_queue_wake_one(&mutex->waiters))
+        mutex->locked = false;
+    spin_unlock_irqrestore(&mutex->wait_lock, flags);
+}
+
+bool mutex_is_locked(mutex_t* mutex)
+{
+    return mutex->locked;
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "spinlock.h"
+#include "wait_queue.h"
+#include "lock_stats.h"
+
+struct process;
+
+// A sleeping lock for process context, waiters give up the cpu instead of spinning.
+// Unlocking hands the mutex straight to the first waiter, so waiters are served in order
+typedef struct mutex {
+    spinlock_t wait_lock;   // protects everything below
+    bool locked;
+    struct process* owner;  // NULL while the scheduler isn't running yet
+    wait_queue_t waiters;
+    lock_stats_t* stats;    // NULL unless the mutex is being measured
+    uint64_t hold_start;
+} mutex_t;
+
+#define MUTEX_INIT {0}
+#define MUTEX_INIT_STATS(lock_stats) { .stats = (lock_stats) }
+
+void mutex_init(mutex_t* mutex);
+void mutex_lock(mutex_t* mutex);
+bool mutex_trylock(mutex_t* mutex);
+void mutex_unlock(mutex_t* mutex);
+bool mutex_is_locked(mutex_t* mutex);
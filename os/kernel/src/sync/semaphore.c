@@ -0,0 +1,55 @@
+#include "semaphore.h"
+#include <stddef.h>
+
+void semaphore_init(semaphore_t* semaphore, uint32_t count)
+{
+    spin_init(&semaphore->wait_lock);
+    semaphore->count = count;
+    wait_queue_init(&semaphore->waiters);
+    semaphore->stats = NULL;
+}
+
+void semaphore_down(semaphore_t* semaphore)
+{
+    uint32_t flags = spin_lock_irqsave(&semaphore->wait_lock);
+    if (semaphore->count > 0)
+    {
+        semaphore->count--;
+        if (semaphore->stats != NULL)
+            lock_stats_acquired(semaphore->stats, 0);
+        spin_unlock_irqrestore(&semaphore->wait_lock, flags);
+        return;
+    }
+
+    uint64_t wait_start = semaphore->stats != NULL ? lock_stats_now() : 0;
+    wait_entry_t entry;
+    wait_queue_add(&semaphore->waiters, &entry);
+    // semaphore_up gives us its unit without adding it to the count
+    wait_queue_sleep(&entry, &semaphore->wait_lock, &flags);
+
+    if (semaphore->stats != NULL)
+        lock_stats_acquired(semaphore->stats, wait_start);
+    spin_unlock_irqrestore(&semaphore->wait_lock, flags);
+}
+
+bool semaphore_trydown(semaphore_t* semaphore)
+{
+    uint32_t flags = spin_lock_irqsave(&semaphore->wait_lock);
+    bool taken = semaphore->count > 0;
+    if (taken)
+    {
+        semaphore->count--;
+        if (semaphore->stats != NULL)
+            lock_stats_acquired(semaphore->stats, 0);
+    }
+    spin_unlock_irqrestore(&semaphore->wait_lock, flags);
+    return taken;
+}
+
+void semaphore_up(semaphore_t* semaphore)
+{
+    uint32_t flags = spin_lock_irqsave(&semaphore->wait_lock);
+    if (!wait_queue_wake_one(&semaphore->waiters))
+        semaphore->count++;
+    spin_unlock_irqrestore(&semaphore->wait_lock, flags);
+}
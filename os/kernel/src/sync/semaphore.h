@@ -0,0 +1,23 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "spinlock.h"
+#include "wait_queue.h"
+#include "lock_stats.h"
+
+// A counting semaphore for process context, down sleeps while the count is 0.
+// up hands its unit straight to the first waiter, so a late down can't take it first
+typedef struct semaphore {
+    spinlock_t wait_lock;   // protects everything below
+    uint32_t count;
+    wait_queue_t waiters;
+    lock_stats_t* stats;    // counts the downs and how long they waited, NULL unless measured
+} semaphore_t;
+
+#define SEMAPHORE_INIT(initial_count) { .count = (initial_count) }
+#define SEMAPHORE_INIT_STATS(initial_count, lock_stats) { .count = (initial_count), .stats = (lock_stats) }
+
+void semaphore_init(semaphore_t* semaphore, uint32_t count);
+void semaphore_down(semaphore_t* semaphore);
+bool semaphore_trydown(semaphore_t* semaphore);
+void semaphore_up(semaphore_t* semaphore);
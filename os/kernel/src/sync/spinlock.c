@@ -0,0 +1,78 @@
+#include "spinlock.h"
+#include "atomic.h"
+#include "cpu/idt/irq.h"
+#include <stddef.h>
+
+static inline void cpu_relax()
+{
+    asm volatile("pause" ::: "memory");
+}
+
+void spin_init(spinlock_t* lock)
+{
+    lock->locked = 0;
+    lock->stats = NULL;
+    lock->hold_start = 0;
+}
+
+void spin_lock(spinlock_t* lock)
+{
+    if (atomic_xchg(&lock->locked, 1) == 0)
+    {
+        if (lock->stats != NULL)
+        {
+            lock_stats_acquired(lock->stats, 0);
+            lock->hold_start = lock_stats_now();
+        }
+        return;
+    }
+
+    uint64_t wait_start = lock->stats != NULL ? lock_stats_now() : 0;
+    do {
+        // Spin on a plain read, so the cache line isn't bounced between the waiting cpus
+        while (lock->locked)
+            cpu_relax();
+    } while (atomic_xchg(&lock->locked, 1) != 0);
+
+    if (lock->stats != NULL)
+    {
+        lock_stats_acquired(lock->stats, wait_start);
+        lock->hold_start = lock_stats_now();
+    }
+}
+
+bool spin_trylock(spinlock_t* lock)
+{
+    if (atomic_xchg(&lock->locked, 1) != 0)
+        return false;
+
+    if (lock->stats != NULL)
+    {
+        lock_stats_acquired(lock->stats, 0);
+        lock->hold_start = lock_stats_now();
+    }
+    return true;
+}
+
+void spin_unlock(spinlock_t* lock)
+{
+    if (lock->stats != NULL)
+        lock_stats_released(lock->stats, lock->hold_start);
+
+    // x86 doesn't reorder stores with older loads and stores, a compiler barrier is enough
+    asm volatile("" ::: "memory");
+    lock->locked = 0;
+}
+
+uint32_t spin_lock_irqsave(spinlock_t* lock)
+{
+    uint32_t flags = irq_save();
+    spin_lock(lock);
+    return flags;
+}
+
+void spin_unlock_irqrestore(spinlock_t* lock, uint32_t flags)
+{
+    spin_unlock(lock);
+    irq_restore(flags);
+}
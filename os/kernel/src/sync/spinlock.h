@@ -0,0 +1,23 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "lock_stats.h"
+
+// A plain test-and-set lock, only for short critical sections that never sleep
+typedef struct spinlock {
+    volatile uint32_t locked;
+    lock_stats_t* stats;    // NULL unless the lock is being measured
+    uint64_t hold_start;
+} spinlock_t;
+
+#define SPINLOCK_INIT {0}
+#define SPINLOCK_INIT_STATS(lock_stats) { .stats = (lock_stats) }
+
+void spin_init(spinlock_t* lock);
+void spin_lock(spinlock_t* lock);
+bool spin_trylock(spinlock_t* lock);
+void spin_unlock(spinlock_t* lock);
+
+// For locks an interrupt handler also takes, keeps interrupts off while the lock is held
+uint32_t spin_lock_irqsave(spinlock_t* lock);
+void spin_unlock_irqrestore(spinlock_t* lock, uint32_t flags);
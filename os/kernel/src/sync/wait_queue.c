@@ -0,0 +1,116 @@
+#include "wait_queue.h"
+#include "process/manager/process_manager.h"
+#include "time/timer.h"
+#include <stddef.h>
+
+void wait_queue_init(wait_queue_t* queue)
+{
+    queue->head = NULL;
+    queue->tail = NULL;
+}
+
+inline bool wait_queue_is_empty(const wait_queue_t* queue)
+{
+    return queue->head == NULL;
+}
+
+void wait_queue_add(wait_queue_t* queue, wait_entry_t* entry)
+{
+    entry->proc = get_current_process();
+    entry->next = NULL;
+    entry->woken = false;
+
+    if (queue->tail != NULL)
+        queue->tail->next = entry;
+    else
+        queue->head = entry;
+    queue->tail = entry;
+}
+
+bool wait_queue_remove(wait_queue_t* queue, wait_entry_t* entry)
+{
+    wait_entry_t* prev = NULL;
+    for (wait_entry_t* iter = queue->head; iter != NULL; prev = iter, iter = iter->next)
+    {
+        if (iter != entry)
+            continue;
+
+        if (prev == NULL)
+            queue->head = entry->next;
+        else
+            prev->next = entry->next;
+        if (queue->tail == entry)
+            queue->tail = prev;
+
+        entry->next = NULL;
+        return true;
+    }
+    return false;
+}
+
+void wait_entry_wake(wait_entry_t* entry)
+{
+    // The waiter only looks at woken with the lock held, so the entry stays valid until we drop it
+    entry->woken = true;
+    if (entry->proc != NULL)
+        wake_up_process(entry->proc);
+}
+
+bool wait_queue_wake_one(wait_queue_t* queue)
+{
+    wait_entry_t* entry = queue->head;
+    if (entry == NULL)
+        return false;
+
+    queue->head = entry->next;
+    if (queue->head == NULL)
+        queue->tail = NULL;
+    entry->next = NULL;
+
+    wait_entry_wake(entry);
+    return true;
+}
+
+void wait_queue_wake(wait_queue_t* queue, wait_entry_t* entry)
+{
+    if (wait_queue_remove(queue, entry))
+        wait_entry_wake(entry);
+}
+
+void wait_queue_sleep(wait_entry_t* entry, spinlock_t* lock, uint32_t* flags)
+{
+    while (!entry->woken)
+    {
+        // Asleep before the lock is dropped, so a wake up that comes in between isn't lost
+        if (entry->proc != NULL)
+            entry->proc->state = PROCESS_SLEEPING;
+        spin_unlock_irqrestore(lock, *flags);
+
+        if (entry->proc != NULL)
+            force_switch_process();
+        else
+            asm volatile("pause");
+
+        *flags = spin_lock_irqsave(lock);
+    }
+}
+
+bool wait_queue_sleep_timed(wait_entry_t* entry, spinlock_t* lock, uint32_t* flags, bool timed, uint32_t deadline)
+{
+    process_t* proc = entry->proc;
+    if (entry->woken)
+        return true;
+
+    // Asleep before the lock is dropped, so a wake up that comes in between isn't lost
+    proc->state = PROCESS_SLEEPING;
+    spin_unlock_irqrestore(lock, *flags);
+
+    if (timed)
+        timer_add(&proc->sleep_timer, deadline);
+    force_switch_process();
+    if (timed)
+        timer_cancel(&proc->sleep_timer);
+
+    *flags = spin_lock_irqsave(lock);
+    return entry->woken;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "spinlock.h"
+
+struct process;
+
+// A process waiting for something, lives on the waiter's own stack
+typedef struct wait_entry {
+    struct process* proc;       // NULL when waiting before the scheduler runs, the waiter spins then
+    struct wait_entry* next;
+    volatile bool woken;        // set by whoever hands the waiter what it waited for
+} wait_entry_t;
+
+// FIFO of waiters, protected by a spinlock of whoever owns the queue
+typedef struct wait_queue {
+    wait_entry_t* head;
+    wait_entry_t* tail;
+} wait_queue_t;
+
+#define WAIT_QUEUE_INIT {0}
+
+void wait_queue_init(wait_queue_t* queue);
+bool wait_queue_is_empty(const wait_queue_t* queue);
+
+// Queues the current process, the entry is given back woken by wait_queue_wake_one
+void wait_queue_add(wait_queue_t* queue, wait_entry_t* entry);
+bool wait_queue_remove(wait_queue_t* queue, wait_entry_t* entry);
+// Takes the first waiter off the queue and wakes it, returns false if there was none
+bool wait_queue_wake_one(wait_queue_t* queue);
+// Takes the given waiter off the queue and wakes it, for queues whose waiters aren't all equal
+void wait_queue_wake(wait_queue_t* queue, wait_entry_t* entry);
+// Wakes a waiter that isn't on a queue, like a poller, with the lock it sleeps under held
+void wait_entry_wake(wait_entry_t* entry);
+
+// Sleeps until the entry is woken. lock protects the queue, it is held (with the saved flags)
+// on entry and on return, and dropped while sleeping
+void wait_queue_sleep(wait_entry_t* entry, spinlock_t* lock, uint32_t* flags);
+/*
+ * Sleeps once, until the entry is woken, the deadline tick passes (if timed) or anything else wakes
+ * the process, like an alarm. Only for processes, the lock is held and dropped like above. Returns
+ * whether the entry was woken, if it wasn't the caller takes it off its queue
+ */
+bool wait_queue_sleep_timed(wait_entry_t* entry, spinlock_t* lock, uint32_t* flags, bool timed, uint32_t deadline);
@@ -3,6 +3,7 @@
 #include "process/syscalls/handlers/dir/dir.h"
 #include "process/syscalls/handlers/proc/proc.h"
 #include "process/syscalls/handlers/time/time.h"
+#include "process/syscalls/handlers/mem/mem.h"
 
 void sys_exit(struct int_registers *state)
 {
@@ -74,16 +75,104 @@ void sys_rmdir(struct int_registers *state)
     state->eax = _rmdir((const char*)state->ebx);
 }
 
+void sys_dup(struct int_registers *state)
+{
+    // First argument (old fd) in ebx
+    state->eax = _dup(state->ebx);
+}
+
+void sys_pipe(struct int_registers *state)
+{
+    // First argument (the two fds) in ebx
+    state->eax = _pipe((int*)state->ebx);
+}
+
+void sys_dup2(struct int_registers *state)
+{
+    // First argument (old fd) in ebx, second (new fd) in ecx
+    state->eax = _dup2(state->ebx, state->ecx);
+}
+
 void sys_times(struct int_registers *state)
 {
     state->eax = _times((struct tms *)state->ebx);
 }
 
+void sys_ioctl(struct int_registers *state)
+{
+    // First argument (fd) in ebx, second (request) in ecx, third (argument) in edx
+    state->eax = _ioctl(state->ebx, state->ecx, (void*)state->edx);
+}
+
+void sys_fcntl(struct int_registers *state)
+{
+    // First argument (fd) in ebx, second (command) in ecx, third (argument) in edx
+    state->eax = _fcntl(state->ebx, state->ecx, state->edx);
+}
+
+void sys_getrusage(struct int_registers *state)
+{
+    // First argument (who) in ebx, second (rusage struct) in ecx
+    state->eax = _getrusage(state->ebx, (struct rusage *)state->ecx);
+}
+
 void sys_gettimeofday(struct int_registers *state)
 {
     state->eax = _gettimeofday((struct timeval *)state->ebx, (struct timezone *)state->ecx);
 }
 
+void sys_clock_gettime(struct int_registers *state)
+{
+    // First argument (clock id) in ebx, second (timespec struct) in ecx
+    state->eax = _clock_gettime(state->ebx, (struct timespec *)state->ecx);
+}
+
+void sys_clock_getres(struct int_registers *state)
+{
+    // First argument (clock id) in ebx, second (timespec struct) in ecx
+    state->eax = _clock_getres(state->ebx, (struct timespec *)state->ecx);
+}
+
+void sys_nanosleep(struct int_registers *state)
+{
+    // First argument (requested time) in ebx, second (remaining time) in ecx
+    state->eax = _nanosleep((const struct timespec *)state->ebx, (struct timespec *)state->ecx);
+}
+
+void sys_setitimer(struct int_registers *state)
+{
+    // First argument (which) in ebx, second (new value) in ecx, third (old value) in edx
+    state->eax = _setitimer(state->ebx, (const struct itimerval *)state->ecx, (struct itimerval *)state->edx);
+}
+
+void sys_getitimer(struct int_registers *state)
+{
+    // First argument (which) in ebx, second (current value) in ecx
+    state->eax = _getitimer(state->ebx, (struct itimerval *)state->ecx);
+}
+
+void sys_alarm(struct int_registers *state)
+{
+    state->eax = _alarm(state->ebx);
+}
+
+void sys_pause(struct int_registers *state)
+{
+    state->eax = _pause();
+}
+
+void sys_mmap(struct int_registers *state)
+{
+    // First argument (the mmap_arg_struct) in ebx
+    state->eax = (uint32_t)_mmap((const struct mmap_arg_struct*)state->ebx);
+}
+
+void sys_munmap(struct int_registers *state)
+{
+    // First argument (address) in ebx, second (length) in ecx
+    state->eax = _munmap((void*)state->ebx, state->ecx);
+}
+
 void sys_truncate(struct int_registers *state)
 {
     // First argument (filename) in ebx, second (length) in ecx
@@ -114,6 +203,126 @@ void sys_getdents(struct int_registers *state)
     state->eax = _getdents(state->ebx, (struct linux_dirent*)state->ecx, state->edx);
 }
 
+void sys_select(struct int_registers *state)
+{
+    // First argument (nfds) in ebx, the read, write and except sets in ecx, edx and esi,
+    // the timeout in edi
+    state->eax = _select(state->ebx, (uint32_t*)state->ecx, (uint32_t*)state->edx,
+        (uint32_t*)state->esi, (struct timeval*)state->edi);
+}
+
+void sys_fsync(struct int_registers *state)
+{
+    // First argument (fd) in ebx. fdatasync() is the same, FAT has no metadata apart from the data
+    state->eax = _fsync(state->ebx);
+}
+
+void sys_readv(struct int_registers *state)
+{
+    // First argument (fd) in ebx, second (iovec array) in ecx, third (iovec count) in edx
+    state->eax = _readv(state->ebx, (const struct iovec*)state->ecx, state->edx);
+}
+
+void sys_writev(struct int_registers *state)
+{
+    // First argument (fd) in ebx, second (iovec array) in ecx, third (iovec count) in edx
+    state->eax = _writev(state->ebx, (const struct iovec*)state->ecx, state->edx);
+}
+
+void sys_poll(struct int_registers *state)
+{
+    // First argument (fds) in ebx, second (nfds) in ecx, third (timeout in ms) in edx
+    state->eax = _poll((struct pollfd*)state->ebx, state->ecx, state->edx);
+}
+
+// The 64 bit offsets come split in two registers, FAT16 files never reach past the low half
+void sys_pread64(struct int_registers *state)
+{
+    // First argument (fd) in ebx, second (buffer) in ecx, third (count) in edx,
+    // the offset in esi (low) and edi (high)
+    if (state->edi != 0)
+    {
+        state->eax = -EINVAL;
+        return;
+    }
+    state->eax = _pread(state->ebx, (void*)state->ecx, state->edx, state->esi);
+}
+
+void sys_pwrite64(struct int_registers *state)
+{
+    // First argument (fd) in ebx, second (buffer) in ecx, third (count) in edx,
+    // the offset in esi (low) and edi (high)
+    if (state->edi != 0)
+    {
+        state->eax = -EINVAL;
+        return;
+    }
+    state->eax = _pwrite(state->ebx, (const void*)state->ecx, state->edx, state->esi);
+}
+
+void sys_preadv(struct int_registers *state)
+{
+    // First argument (fd) in ebx, second (iovec array) in ecx, third (iovec count) in edx,
+    // the offset in esi (low) and edi (high)
+    if (state->edi != 0)
+    {
+        state->eax = -EINVAL;
+        return;
+    }
+    state->eax = _preadv(state->ebx, (const struct iovec*)state->ecx, state->edx, state->esi);
+}
+
+void sys_pwritev(struct int_registers *state)
+{
+    // First argument (fd) in ebx, second (iovec array) in ecx, third (iovec count) in edx,
+    // the offset in esi (low) and edi (high)
+    if (state->edi != 0)
+    {
+        state->eax = -EINVAL;
+        return;
+    }
+    state->eax = _pwritev(state->ebx, (const struct iovec*)state->ecx, state->edx, state->esi);
+}
+
+void sys_fallocate(struct int_registers *state)
+{
+    // First argument (fd) in ebx, second (mode) in ecx, the offset in edx (low) and esi (high),
+    // the length in edi (low) and ebp (high)
+    if ((int32_t)state->esi < 0 || (int32_t)state->ebp < 0)
+        state->eax = -EINVAL;
+    else if (state->esi != 0 || state->ebp != 0)
+        state->eax = -EFBIG;
+    else
+        state->eax = _fallocate(state->ebx, state->ecx, state->edx, state->edi);
+}
+
+void sys_defrag(struct int_registers *state)
+{
+    // First argument (stats before) in ebx, second (stats after) in ecx
+    state->eax = _defrag((fat_frag_stats_t*)state->ebx, (fat_frag_stats_t*)state->ecx);
+}
+
+void sys_sendfile(struct int_registers *state)
+{
+    // First argument (out fd) in ebx, second (in fd) in ecx, third (offset pointer) in edx, fourth (count) in esi
+    state->eax = _sendfile(state->ebx, state->ecx, (int32_t*)state->edx, state->esi);
+}
+
+void sys_sendfile64(struct int_registers *state)
+{
+    // First argument (out fd) in ebx, second (in fd) in ecx, third (64 bit offset pointer) in edx,
+    // fourth (count) in esi
+    state->eax = _sendfile64(state->ebx, state->ecx, (int64_t*)state->edx, state->esi);
+}
+
+void sys_copy_file_range(struct int_registers *state)
+{
+    // First argument (in fd) in ebx, second (in offset pointer) in ecx, third (out fd) in edx,
+    // fourth (out offset pointer) in esi, fifth (length) in edi, sixth (flags) in ebp
+    state->eax = _copy_file_range(state->ebx, (int64_t*)state->ecx, state->edx, (int64_t*)state->esi,
+        state->edi, state->ebp);
+}
+
 void sys_getcwd(struct int_registers *state)
 {
     // First argument (buffer) in ebx, second (buffer size) in ecx
@@ -126,6 +335,34 @@ void sys_execve(struct int_registers *state)
     state->eax = _execve((const char*)state->ebx, (char**)state->ecx, (char**)state->edx);
 }
 
+void sys_sched_yield(struct int_registers *state)
+{
+    state->eax = _sched_yield();
+}
+
+void sys_clone(struct int_registers *state)
+{
+    // First argument (flags) in ebx, second (stack) in ecx, third (parent tid) in edx, fourth (tls) in esi,
+    // fifth (child tid) in edi
+    state->eax = _clone(state->ebx, state->ecx, (uint32_t *)state->edx, (uint32_t *)state->edi, state);
+}
+
+void sys_gettid(struct int_registers *state)
+{
+    state->eax = _gettid();
+}
+
+void sys_exit_group(struct int_registers *state)
+{
+    _exit_group(state->ebx);
+}
+
+void sys_futex(struct int_registers *state)
+{
+    // First argument (word) in ebx, second (operation) in ecx, third (value) in edx, fourth (timeout) in esi
+    state->eax = _futex((uint32_t *)state->ebx, state->ecx, state->edx, (const struct timespec *)state->esi);
+}
+
 void sys_sbrk(struct int_registers *state)
 {
     // First argument (increment) in ebx
@@ -11,16 +11,50 @@ void sys_unlink(struct int_registers *state);        // 10
 void sys_chdir(struct int_registers *state);         // 12
 void sys_lseek(struct int_registers *state);         // 19
 void sys_getpid(struct int_registers *state);        // 20
+void sys_alarm(struct int_registers *state);         // 27
+void sys_pause(struct int_registers *state);         // 29
 void sys_rename(struct int_registers *state);        // 38
 void sys_mkdir(struct int_registers *state);         // 39
 void sys_rmdir(struct int_registers *state);         // 40
+void sys_dup(struct int_registers *state);           // 41
+void sys_pipe(struct int_registers *state);          // 42
 void sys_times(struct int_registers *state);         // 43
+void sys_ioctl(struct int_registers *state);         // 54
+void sys_fcntl(struct int_registers *state);         // 55
+void sys_getrusage(struct int_registers *state);     // 77
+void sys_dup2(struct int_registers *state);          // 63
 void sys_gettimeofday(struct int_registers *state);  // 78
+void sys_mmap(struct int_registers *state);          // 90
+void sys_munmap(struct int_registers *state);        // 91
 void sys_truncate(struct int_registers *state);      // 92
 void sys_ftruncate(struct int_registers *state);     // 93
+void sys_setitimer(struct int_registers *state);     // 104
+void sys_getitimer(struct int_registers *state);     // 105
 void sys_stat(struct int_registers *state);          // 106
 void sys_fstat(struct int_registers *state);         // 108
 void sys_getdents(struct int_registers *state);      // 141
+void sys_select(struct int_registers *state);        // 142
+void sys_readv(struct int_registers *state);         // 145
+void sys_writev(struct int_registers *state);        // 146
+void sys_fsync(struct int_registers *state);         // 118, 148 (fdatasync)
+void sys_clone(struct int_registers *state);         // 120
+void sys_sched_yield(struct int_registers *state);   // 158
+void sys_nanosleep(struct int_registers *state);     // 162
+void sys_poll(struct int_registers *state);          // 168
+void sys_pread64(struct int_registers *state);       // 180
+void sys_pwrite64(struct int_registers *state);      // 181
 void sys_getcwd(struct int_registers *state);        // 183
+void sys_sendfile(struct int_registers *state);      // 187
+void sys_gettid(struct int_registers *state);        // 224
+void sys_sendfile64(struct int_registers *state);    // 239
+void sys_futex(struct int_registers *state);         // 240
+void sys_exit_group(struct int_registers *state);    // 252
+void sys_clock_gettime(struct int_registers *state); // 265
+void sys_clock_getres(struct int_registers *state);  // 266
+void sys_fallocate(struct int_registers *state);     // 324
+void sys_preadv(struct int_registers *state);        // 333
+void sys_pwritev(struct int_registers *state);       // 334
+void sys_copy_file_range(struct int_registers *state); // 377
+void sys_defrag(struct int_registers *state);        // 500, DbolOS only, past the Linux numbers
 void sys_execve(struct int_registers *state);
 void sys_sbrk(struct int_registers *state); // 45
@@ -1,5 +1,11 @@
 #include "terminal_manager.h"
 #include "filesystem/vfs/file.h"
+#include "drivers/keyboard/keyboard.h"
+#include "drivers/vga/vga.h"
+#include "cpu/pit/pit.h"
+#include "time/timer.h"
+#include "sync/atomic.h"
+#include "errno-base.h"
 
 #define TERMINAL_AMMOUNT 4
 static terminal_struct_t terminals[TERMINAL_AMMOUNT] = {0};
@@ -17,9 +23,14 @@ bool attach_process_to_terminal(uint32_t terminal_id, process_t *proc_info)
     proc_info->terminal_id= terminal_id;
 
     // initialize process in/out fd's
-    proc_info->fd_table[0].global_fd = terminals[terminal_id - 1].terminal_fds.stdin;
-    proc_info->fd_table[1].global_fd = terminals[terminal_id - 1].terminal_fds.stdout;
-    proc_info->fd_table[2].global_fd = terminals[terminal_id - 1].terminal_fds.stderr;
+    proc_info->shared->fd_table[0].global_fd = terminals[terminal_id - 1].terminal_fds.stdin;
+    proc_info->shared->fd_table[1].global_fd = terminals[terminal_id - 1].terminal_fds.stdout;
+    proc_info->shared->fd_table[2].global_fd = terminals[terminal_id - 1].terminal_fds.stderr;
+    // the terminal keeps its own reference, the fds are never freed
+    global_fd_lock();
+    for (int i = 0; i < 3; i++)
+        proc_info->shared->fd_table[i].global_fd->ref_count++;
+    global_fd_unlock();
 
     return true;
 }
@@ -35,15 +46,30 @@ uint32_t create_terminal(uint32_t parent_process_id)
     }
 
     terminals[i].id = i + 1;
-    memset(terminals[i].input_buf, 0, INPUT_BUFFER_SIZE);
-    terminals[i].is_input_ready = false;
+    terminals[i].input_head = 0;
+    terminals[i].input_tail = 0;
+    terminals[i].input_committed = 0;
+    memset(&terminals[i].termios, 0, sizeof(struct termios));
+    terminals[i].termios.c_lflag = ISIG | ICANON | ECHO;
+    terminals[i].termios.c_cc[VMIN] = 1;
+    mutex_init(&terminals[i].read_mutex);
+    spin_init(&terminals[i].input_lock);
+    wait_queue_init(&terminals[i].readers);
+    poll_head_init(&terminals[i].input_poll);
     terminals[i].parent_process_pid= parent_process_id;
+    global_fd_lock();
     terminals[i].terminal_fds.stdin = allocate_device_fd();
     terminals[i].terminal_fds.stdout = allocate_device_fd();
     terminals[i].terminal_fds.stderr = allocate_device_fd();
-    terminals[i].input_len = 0;
+    global_fd_unlock();
 
     terminals[i].terminal_fds.stdin->_read = read_terminal_input;
+    terminals[i].terminal_fds.stdin->_poll = poll_terminal_input;
+    terminals[i].terminal_fds.stdin->_ioctl = ioctl_terminal;
+    terminals[i].terminal_fds.stdout->_write = write_terminal_output;
+    terminals[i].terminal_fds.stdout->_ioctl = ioctl_terminal;
+    terminals[i].terminal_fds.stderr->_write = write_terminal_output;
+    terminals[i].terminal_fds.stderr->_ioctl = ioctl_terminal;
 
     return i + 1;
 }
@@ -73,22 +99,215 @@ bool set_active_terminal(uint32_t terminal_id)
     return true;
 }
 
+// The terminal whose stdin, stdout or stderr the fd is
+static terminal_struct_t* terminal_from_fd(struct global_file_descriptor_t* glob_fd)
+{
+    for (int i = 0; i < TERMINAL_AMMOUNT; i++)
+    {
+        struct terminal_file_descriptors_t* fds = &terminals[i].terminal_fds;
+        if (terminals[i].id != 0 && (fds->stdin == glob_fd || fds->stdout == glob_fd || fds->stderr == glob_fd))
+            return &terminals[i];
+    }
+    return NULL;
+}
+
+// Bytes a reader can take, a line being typed in canonical mode isn't committed yet
+static inline uint32_t input_available(terminal_struct_t* terminal)
+{
+    return terminal->input_committed - terminal->input_tail;
+}
+
+bool terminal_push_input(terminal_struct_t* terminal, char c)
+{
+    bool canonical = terminal->termios.c_lflag & ICANON;
+    bool taken = false;
+
+    // Interrupts are already off in here
+    spin_lock(&terminal->input_lock);
+    uint32_t head = terminal->input_head;
+    uint32_t used = head - terminal->input_tail;
+    if (canonical && c == '\b')
+    {
+        // Only the line being typed can be taken back, what's committed belongs to the readers
+        if (head != terminal->input_committed)
+        {
+            terminal->input_head = head - 1;
+            taken = true;
+        }
+    }
+    // A line always keeps room for its \n, or a full ring would never be read in canonical mode
+    else if (used < INPUT_RING_SIZE && (!canonical || c == '\n' || used < INPUT_RING_SIZE - 1))
+    {
+        terminal->input_ring[head % INPUT_RING_SIZE] = c;
+        terminal->input_head = head + 1;
+        taken = true;
+
+        if (!canonical || c == '\n')
+        {
+            terminal->input_committed = head + 1;
+            // read_mutex lets a single reader wait at a time
+            wait_queue_wake_one(&terminal->readers);
+        }
+    }
+    spin_unlock(&terminal->input_lock);
+
+    if (taken && terminal->input_committed == terminal->input_head)
+        poll_wake(&terminal->input_poll);
+
+    return taken && (terminal->termios.c_lflag & ECHO);
+}
+
+// Sleeps until more than seen bytes are available, the deadline passes (if timed) or an alarm fires
+static void wait_for_input(terminal_struct_t* terminal, uint32_t seen, bool timed, uint32_t deadline)
+{
+    process_t* proc = get_current_process();
+    wait_entry_t entry;
+
+    uint32_t flags = spin_lock_irqsave(&terminal->input_lock);
+    // The keyboard commits under the lock, so either we see the input here or it finds us queued
+    if (input_available(terminal) != seen || proc->shared->exiting)
+    {
+        spin_unlock_irqrestore(&terminal->input_lock, flags);
+        return;
+    }
+    wait_queue_add(&terminal->readers, &entry);
+    if (!wait_queue_sleep_timed(&entry, &terminal->input_lock, &flags, timed, deadline))
+        wait_queue_remove(&terminal->readers, &entry);
+    spin_unlock_irqrestore(&terminal->input_lock, flags);
+}
+
+/*
+ * Canonical mode returns a line at a time. Raw mode follows VMIN and VTIME like termios:
+ * VMIN bytes are waited for, with VTIME as the gap allowed between them once the first came in,
+ * or as the timeout for any input at all when VMIN is 0.
+ */
 int read_terminal_input(void *buf, uint32_t count, uint32_t off, struct global_file_descriptor_t* glob_fd)
 {
-    // yeald blocked until \n pressed
-    while (!get_active_terminal_struct()->is_input_ready)
+    terminal_struct_t* terminal = terminal_from_fd(glob_fd);
+    process_t* proc = get_current_process();
+    char* dst = buf;
+
+    if (terminal == NULL)
+        return -EBADF;
+    if (count == 0)
+        return 0;
+
+    mutex_lock(&terminal->read_mutex);
+    bool canonical = terminal->termios.c_lflag & ICANON;
+    uint32_t min = canonical ? 1 : terminal->termios.c_cc[VMIN];
+    uint32_t time = canonical ? 0 : timer_ns_to_ticks((uint64_t)terminal->termios.c_cc[VTIME] * 100000000);
+    uint32_t want = min < count ? min : count;
+    uint32_t alarms = proc->pending_alarms;
+    bool timed = min == 0 && time != 0;
+    uint32_t deadline = get_system_ticks() + time + 1;
+    uint32_t available;
+
+    while (true)
     {
-        get_current_process()->state = PROCESS_BLOCKED;
-        force_switch_process();
+        available = input_available(terminal);
+        if (available >= want && (available > 0 || !timed))
+            break;
+        if (timed && (int32_t)(get_system_ticks() - deadline) >= 0)
+            break;
+        // Another thread called exit_group(), the syscall exits this one on its way out
+        if (proc->shared->exiting)
+        {
+            mutex_unlock(&terminal->read_mutex);
+            return 0;
+        }
+        if (proc->pending_alarms != alarms && available == 0)
+        {
+            mutex_unlock(&terminal->read_mutex);
+            return -EINTR;
+        }
+
+        wait_for_input(terminal, available, timed, deadline);
+
+        // The gap timer starts over with every byte that comes in
+        if (min > 0 && time != 0 && input_available(terminal) != available)
+        {
+            timed = true;
+            deadline = get_system_ticks() + time + 1;
+        }
     }
-    int copy_len = count;
-    get_active_terminal_struct()->is_input_ready = false;
-    if (count > get_active_terminal_struct()->input_len)
-        copy_len = get_active_terminal_struct()->input_len;
 
-    memcpy(buf ,get_active_terminal_struct()->input_buf, copy_len);
-    memset(get_active_terminal_struct()->input_buf, 0, INPUT_BUFFER_SIZE);
-    get_active_terminal_struct()->input_len = 0;
+    uint32_t tail = terminal->input_tail;
+    uint32_t copy_len = 0;
+    while (copy_len < count && copy_len < available)
+    {
+        char c = terminal->input_ring[(tail + copy_len) % INPUT_RING_SIZE];
+        dst[copy_len++] = c;
+        if (canonical && c == '\n')
+            break;
+    }
+    // The bytes are copied out before the keyboard may reuse their room
+    compiler_barrier();
+    terminal->input_tail = tail + copy_len;
+    mutex_unlock(&terminal->read_mutex);
+
+    keyboard_flush_echo();
 
     return copy_len;
-}
\ No newline at end of file
+}
+
+uint32_t poll_terminal_input(struct global_file_descriptor_t* glob_fd, struct poll_table* table)
+{
+    terminal_struct_t* terminal = terminal_from_fd(glob_fd);
+    if (terminal == NULL)
+        return POLLNVAL;
+
+    // Registered before the check, so input that comes in between still wakes the poller
+    poll_wait(&terminal->input_poll, table);
+
+    // A raw read waits for VMIN bytes, so that's when it's ready
+    uint32_t min = terminal->termios.c_lflag & ICANON ? 1 : terminal->termios.c_cc[VMIN];
+    return input_available(terminal) >= (min > 0 ? min : 1) ? POLLIN : 0;
+}
+
+int write_terminal_output(const void *buf, uint32_t count, uint32_t off, struct global_file_descriptor_t* glob_fd)
+{
+    const char* str = buf;
+    for (uint32_t i = 0; i < count; i++)
+        vga_putchar(str[i]);
+    return count;
+}
+
+int ioctl_terminal(struct global_file_descriptor_t* glob_fd, uint32_t request, void* arg)
+{
+    terminal_struct_t* terminal = terminal_from_fd(glob_fd);
+    if (terminal == NULL)
+        return -ENOTTY;
+    if (arg == NULL)
+        return -EFAULT;
+
+    switch (request)
+    {
+    case TCGETS:
+        memcpy(arg, &terminal->termios, sizeof(struct termios));
+        return 0;
+    case TCSETS:
+    case TCSETSW:
+    case TCSETSF:
+    {
+        // Holding the read mutex makes this the ring's consumer, so it can drop the input
+        mutex_lock(&terminal->read_mutex);
+        uint32_t flags = spin_lock_irqsave(&terminal->input_lock);
+        memcpy(&terminal->termios, arg, sizeof(struct termios));
+        // Leaving canonical mode hands the line being typed to the readers
+        if (!(terminal->termios.c_lflag & ICANON))
+            terminal->input_committed = terminal->input_head;
+        if (request == TCSETSF)
+        {
+            terminal->input_committed = terminal->input_head;
+            terminal->input_tail = terminal->input_head;
+        }
+        spin_unlock_irqrestore(&terminal->input_lock, flags);
+        mutex_unlock(&terminal->read_mutex);
+
+        poll_wake(&terminal->input_poll);
+        return 0;
+    }
+    default:
+        return -EINVAL;
+    }
+}
@@ -1,8 +1,13 @@
 #pragma once
 #include <stdint.h>
 #include "process/manager/process_manager.h"
+#include "sync/spinlock.h"
+#include "sync/mutex.h"
+#include "sync/wait_queue.h"
+#include "filesystem/vfs/poll.h"
+#include "termios.h"
 
-#define INPUT_BUFFER_SIZE 256
+#define INPUT_RING_SIZE 1024 // a power of two, the ring indexes wrap on their own
 
 struct terminal_file_descriptors_t {
     struct global_file_descriptor_t* stdin;
@@ -10,11 +15,24 @@ struct terminal_file_descriptors_t {
     struct global_file_descriptor_t* stderr;
 };
 
+/*
+ * The input is a single producer single consumer ring: only the keyboard interrupt moves
+ * input_head and only the reader holding read_mutex moves input_tail. Both count bytes forever,
+ * so the ring is full when they are INPUT_RING_SIZE apart.
+ * In canonical mode the line being typed sits between input_committed and input_head, where
+ * backspace can still take it back, and readers only get what's committed by a \n.
+ */
 typedef struct terminal_struct_t {
     uint32_t id;
-    char input_buf[INPUT_BUFFER_SIZE];
-    uint32_t input_len;
-    bool is_input_ready;
+    char input_ring[INPUT_RING_SIZE];
+    volatile uint32_t input_head;
+    volatile uint32_t input_tail;
+    volatile uint32_t input_committed;
+    struct termios termios;
+    mutex_t read_mutex;     // one reader at a time, so the ring has a single consumer
+    spinlock_t input_lock;  // protects readers, the keyboard interrupt wakes them under it
+    wait_queue_t readers;   // waiting for input
+    poll_head_t input_poll; // woken with the readers when input is committed
     uint32_t parent_process_pid;
     struct terminal_file_descriptors_t terminal_fds;
 } terminal_struct_t;
@@ -25,4 +43,11 @@ uint32_t create_terminal(uint32_t parent_process_id);
 struct terminal_struct_t* get_active_terminal_struct();
 uint32_t get_active_terminal_id();
 bool set_active_terminal(uint32_t terminal_id);
-int read_terminal_input(void *buf, uint32_t count, uint32_t off, struct global_file_descriptor_t* glob_fd);
\ No newline at end of file
+
+// Called from the keyboard interrupt with a typed character, returns true if it should be echoed
+bool terminal_push_input(terminal_struct_t* terminal, char c);
+
+int read_terminal_input(void *buf, uint32_t count, uint32_t off, struct global_file_descriptor_t* glob_fd);
+uint32_t poll_terminal_input(struct global_file_descriptor_t* glob_fd, struct poll_table* table);
+int write_terminal_output(const void *buf, uint32_t count, uint32_t off, struct global_file_descriptor_t* glob_fd);
+int ioctl_terminal(struct global_file_descriptor_t* glob_fd, uint32_t request, void* arg);
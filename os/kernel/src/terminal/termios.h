@@ -0,0 +1,32 @@
+#pragma once
+#include <stdint.h>
+
+// Terminal settings, the layout and values of Linux i386 so the same ioctl()s work
+#define NCCS 19
+
+// c_cc indexes
+#define VTIME 5     // raw reads: timeout in tenths of a second
+#define VMIN  6     // raw reads: bytes to wait for
+
+// c_lflag bits
+#define ISIG   0x0001
+#define ICANON 0x0002   // line by line input with backspace editing
+#define ECHO   0x0008   // echo typed characters
+
+// ioctl() requests
+#define TCGETS  0x5401
+#define TCSETS  0x5402
+#define TCSETSW 0x5403  // after the output drains, the same as TCSETS here
+#define TCSETSF 0x5404  // and drop the pending input
+
+typedef uint32_t tcflag_t;
+typedef uint8_t cc_t;
+
+struct termios {
+    tcflag_t c_iflag;
+    tcflag_t c_oflag;
+    tcflag_t c_cflag;
+    tcflag_t c_lflag;
+    cc_t c_line;
+    cc_t c_cc[NCCS];
+};
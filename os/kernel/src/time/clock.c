@@ -0,0 +1,134 @@
+#include "clock.h"
+#include "vdso.h"
+#include "cpu/tsc/tsc.h"
+#include "cpu/pit/pit.h"
+#include "drivers/rtc/rtc.h"
+#include "drivers/vga/vga.h"
+#include "util/math/div64.h"
+
+// The largest shift that keeps the cycles to ns multiplier in 32 bits
+#define MAX_TSC_SHIFT 32
+
+static bool use_tsc = false;
+static uint32_t tsc_mult = 0;
+static uint32_t tsc_shift = 0;
+
+static uint32_t tick_period_ns = 0;
+
+// Monotonic time at the last tick, everything after it is interpolated with the TSC
+static uint64_t base_ns = 0;
+static uint64_t base_tsc = 0;
+// Odd while the tick updates the base, readers on any cpu retry instead of taking a lock
+static volatile uint32_t base_seq = 0;
+
+// Realtime = monotonic + this, the RTC is only read once at boot
+static uint64_t realtime_offset_ns = 0;
+
+static uint64_t cycles_to_ns(uint64_t cycles)
+{
+    uint32_t low = (uint32_t)cycles;
+    uint32_t high = (uint32_t)(cycles >> 32);
+
+    return (((uint64_t)low * tsc_mult) >> tsc_shift)
+        + (((uint64_t)high * tsc_mult) << (32 - tsc_shift));
+}
+
+// Find mult and shift such that ns = cycles * mult >> shift
+static void clock_set_tsc_scale(uint32_t khz)
+{
+    tsc_shift = MAX_TSC_SHIFT;
+    while (tsc_shift > 0)
+    {
+        uint64_t mult = div64_u32((uint64_t)NSEC_PER_MSEC << tsc_shift, khz, NULL);
+        if (mult <= 0xFFFFFFFF)
+        {
+            tsc_mult = (uint32_t)mult;
+            return;
+        }
+        tsc_shift--;
+    }
+    tsc_mult = NSEC_PER_MSEC / khz;
+}
+
+void clock_init()
+{
+    tick_period_ns = (uint32_t)div64_u32((uint64_t)NSEC_PER_SEC * get_reload_time(), FREQ_HZ, NULL);
+
+    if (tsc_init())
+    {
+        clock_set_tsc_scale(tsc_get_khz());
+        use_tsc = true;
+        base_tsc = tsc_read();
+        vga_printf("TSC calibrated: %d kHz\n", tsc_get_khz());
+    }
+    else
+    {
+        vga_printf("No TSC, clock resolution is one PIT tick\n");
+    }
+    base_ns = 0;
+
+    realtime_offset_ns = (uint64_t)rtc_read_unix_time() * NSEC_PER_SEC - clock_monotonic_ns();
+
+    if (vdso_init())
+    {
+        vdso_set_clock(use_tsc, tsc_mult, tsc_shift, realtime_offset_ns, clock_resolution_ns(), tick_period_ns);
+        vdso_update(base_tsc, base_ns);
+    }
+}
+
+void clock_tick()
+{
+    base_seq++;
+    asm volatile("" ::: "memory");
+    if (use_tsc)
+    {
+        uint64_t now = tsc_read();
+        base_ns += cycles_to_ns(now - base_tsc);
+        base_tsc = now;
+    }
+    else
+    {
+        base_ns += tick_period_ns;
+    }
+    asm volatile("" ::: "memory");
+    base_seq++;
+    vdso_update(base_tsc, base_ns);
+}
+
+uint64_t clock_monotonic_ns()
+{
+    uint64_t now;
+    uint32_t seq;
+
+    // The tick may update the base in the middle of the read, on this cpu or another one
+    do {
+        seq = base_seq;
+        asm volatile("" ::: "memory");
+        now = base_ns;
+        if (use_tsc)
+            now += cycles_to_ns(tsc_read() - base_tsc);
+        asm volatile("" ::: "memory");
+    } while ((seq & 1) || seq != base_seq);
+
+    return now;
+}
+
+uint64_t clock_realtime_ns()
+{
+    return clock_monotonic_ns() + realtime_offset_ns;
+}
+
+uint32_t clock_resolution_ns()
+{
+    if (use_tsc)
+    {
+        uint32_t khz = tsc_get_khz();
+        return khz >= NSEC_PER_MSEC ? 1 : (NSEC_PER_MSEC + khz - 1) / khz;
+    }
+    return tick_period_ns;
+}
+
+inline uint32_t clock_tick_period_ns()
+{
+    return tick_period_ns;
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+#define NSEC_PER_SEC  1000000000U
+#define NSEC_PER_MSEC 1000000U
+#define NSEC_PER_USEC 1000U
+
+// Clock ids, same values as newlib's <time.h>
+#define CLOCK_REALTIME           1
+#define CLOCK_PROCESS_CPUTIME_ID 2
+#define CLOCK_MONOTONIC          4
+
+// Calibrates the TSC, reads the RTC and sets up the vDSO page, must run before the PIT starts ticking
+void clock_init();
+// Called from the timer interrupt on every PIT tick
+void clock_tick();
+
+uint64_t clock_monotonic_ns();
+uint64_t clock_realtime_ns();
+uint32_t clock_resolution_ns();
+uint32_t clock_tick_period_ns();
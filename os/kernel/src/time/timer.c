@@ -0,0 +1,190 @@
+#include "timer.h"
+#include "clock.h"
+#include "util/math/div64.h"
+#include "sync/spinlock.h"
+#include <stddef.h>
+
+#define LEVEL_SHIFT(level) (TIMER_ROOT_BITS + (level) * TIMER_LEVEL_BITS)
+#define LEVEL_INDEX(ticks, level) (((ticks) >> LEVEL_SHIFT(level)) & TIMER_LEVEL_MASK)
+
+static ktimer_t* root_slots[TIMER_ROOT_SIZE];
+static ktimer_t* level_slots[TIMER_LEVELS][TIMER_LEVEL_SIZE];
+
+// Every tick before this one was already handled
+static uint32_t wheel_ticks = 0;
+
+// Timers are armed from every cpu, the wheel itself only runs on the one the PIT interrupts
+static spinlock_t wheel_lock = SPINLOCK_INIT;
+// The timer whose callback runs right now, callbacks run without the lock
+static ktimer_t* volatile running_timer = NULL;
+
+static void slot_insert(ktimer_t** slot, ktimer_t* timer)
+{
+    timer->next = *slot;
+    timer->pprev = slot;
+    if (*slot != NULL)
+        (*slot)->pprev = &timer->next;
+    *slot = timer;
+}
+
+static void timer_unlink(ktimer_t* timer)
+{
+    *timer->pprev = timer->next;
+    if (timer->next != NULL)
+        timer->next->pprev = timer->pprev;
+
+    timer->next = NULL;
+    timer->pprev = NULL;
+    timer->pending = false;
+}
+
+static void timer_enqueue(ktimer_t* timer)
+{
+    uint32_t expires = timer->expires;
+    uint32_t delta = expires - wheel_ticks;
+    ktimer_t** slot;
+
+    if ((int32_t)delta < 0)
+    {
+        // Already due, run it on the next tick
+        slot = &root_slots[wheel_ticks & TIMER_ROOT_MASK];
+    }
+    else if (delta < TIMER_ROOT_SIZE)
+    {
+        slot = &root_slots[expires & TIMER_ROOT_MASK];
+    }
+    else
+    {
+        int level = 0;
+        while (level < TIMER_LEVELS - 1 && delta >= (1U << LEVEL_SHIFT(level + 1)))
+            level++;
+        slot = &level_slots[level][LEVEL_INDEX(expires, level)];
+    }
+
+    slot_insert(slot, timer);
+    timer->pending = true;
+}
+
+// Move the timers of an outer slot into the levels below it, returns the slot index
+static uint32_t timer_cascade(int level)
+{
+    uint32_t index = LEVEL_INDEX(wheel_ticks, level);
+    ktimer_t* timer = level_slots[level][index];
+
+    level_slots[level][index] = NULL;
+    while (timer != NULL)
+    {
+        ktimer_t* next = timer->next;
+        timer_enqueue(timer);
+        timer = next;
+    }
+    return index;
+}
+
+void timer_init(ktimer_t* timer, void (*callback)(ktimer_t* timer), void* data)
+{
+    timer->next = NULL;
+    timer->pprev = NULL;
+    timer->expires = 0;
+    timer->callback = callback;
+    timer->data = data;
+    timer->pending = false;
+}
+
+void timer_add(ktimer_t* timer, uint32_t expires)
+{
+    uint32_t flags = spin_lock_irqsave(&wheel_lock);
+    if (timer->pending)
+        timer_unlink(timer);
+
+    timer->expires = expires;
+    timer_enqueue(timer);
+    spin_unlock_irqrestore(&wheel_lock, flags);
+}
+
+bool timer_cancel(ktimer_t* timer)
+{
+    uint32_t flags = spin_lock_irqsave(&wheel_lock);
+
+    // The timer's owner usually goes away right after this, don't let the callback still use it
+    while (running_timer == timer)
+    {
+        spin_unlock_irqrestore(&wheel_lock, flags);
+        asm volatile("pause");
+        flags = spin_lock_irqsave(&wheel_lock);
+    }
+
+    bool was_pending = timer->pending;
+    if (was_pending)
+        timer_unlink(timer);
+    spin_unlock_irqrestore(&wheel_lock, flags);
+    return was_pending;
+}
+
+uint32_t timer_remaining(const ktimer_t* timer)
+{
+    uint32_t flags = spin_lock_irqsave(&wheel_lock);
+    int32_t delta = (int32_t)(timer->expires - wheel_ticks);
+    bool pending = timer->pending;
+    spin_unlock_irqrestore(&wheel_lock, flags);
+
+    if (!pending)
+        return 0;
+    return delta > 0 ? (uint32_t)delta : 0;
+}
+
+void timer_wheel_run(uint32_t now)
+{
+    uint32_t flags = spin_lock_irqsave(&wheel_lock);
+    while ((int32_t)(now - wheel_ticks) >= 0)
+    {
+        uint32_t index = wheel_ticks & TIMER_ROOT_MASK;
+
+        // The root wrapped, pull down the next batch, each level only when the one below wrapped
+        if (index == 0)
+        {
+            for (int level = 0; level < TIMER_LEVELS && timer_cascade(level) == 0; level++)
+                ;
+        }
+
+        // Callbacks may re-arm their timer, so detach the whole slot first and move on to the
+        // next tick, that way a timer re-armed for "now" lands in the next slot and not in this one.
+        // Other cpus can still cancel the detached timers, through pprev, while the lock is dropped
+        ktimer_t* timer = root_slots[index];
+        root_slots[index] = NULL;
+        if (timer != NULL)
+            timer->pprev = &timer;
+        wheel_ticks++;
+
+        while (timer != NULL)
+        {
+            ktimer_t* current = timer;
+            timer_unlink(current);
+            running_timer = current;
+
+            // Callbacks take run queue locks and arm timers, they run without the wheel lock
+            spin_unlock_irqrestore(&wheel_lock, flags);
+            current->callback(current);
+            flags = spin_lock_irqsave(&wheel_lock);
+
+            running_timer = NULL;
+        }
+    }
+    spin_unlock_irqrestore(&wheel_lock, flags);
+}
+
+uint32_t timer_ns_to_ticks(uint64_t ns)
+{
+    uint32_t period = clock_tick_period_ns();
+    uint32_t remainder;
+    uint64_t ticks = div64_u32(ns, period, &remainder);
+
+    if (remainder)
+        ticks++;
+    return ticks > TIMER_MAX_TICKS ? TIMER_MAX_TICKS : (uint32_t)ticks;
+}
+
+uint64_t timer_ticks_to_ns(uint32_t ticks)
+{
+    return (uint64_t)ticks * clock_tick_period_ns();
+}
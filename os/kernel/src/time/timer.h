@@ -0,0 +1,49 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Hierarchical timer wheel driven by the PIT tick.
+ * The first level has a slot for each of the next 256 ticks, every level after it covers 64 times
+ * the range of the one before with the same amount of slots. Timers far in the future sit in the
+ * outer levels and are cascaded down once the inner level wraps, so a tick only touches the timers
+ * that expire on it (plus one cascade every 256 ticks), no matter how many timers are armed.
+ */
+#define TIMER_ROOT_BITS  8
+#define TIMER_LEVEL_BITS 6
+#define TIMER_ROOT_SIZE  (1 << TIMER_ROOT_BITS)
+#define TIMER_LEVEL_SIZE (1 << TIMER_LEVEL_BITS)
+#define TIMER_ROOT_MASK  (TIMER_ROOT_SIZE - 1)
+#define TIMER_LEVEL_MASK (TIMER_LEVEL_SIZE - 1)
+#define TIMER_LEVELS     4 // 8 + 6 * 4 = 32 bits of ticks
+
+typedef struct ktimer
+{
+    struct ktimer* next;
+    struct ktimer** pprev;                  // the pointer that points to this timer, for O(1) removal
+    uint32_t expires;                       // tick to fire on
+    void (*callback)(struct ktimer* timer); // runs in the timer interrupt
+    void* data;
+    bool pending;
+} ktimer_t;
+
+void timer_init(ktimer_t* timer, void (*callback)(ktimer_t* timer), void* data);
+
+// Arm the timer to fire on the given tick, re-arms it if it's already pending
+void timer_add(ktimer_t* timer, uint32_t expires);
+// Returns true if the timer was pending. If the callback is running on another cpu it waits for
+// it to finish, so a callback must never cancel its own timer
+bool timer_cancel(ktimer_t* timer);
+// Ticks left until the timer fires, 0 if it isn't pending
+uint32_t timer_remaining(const ktimer_t* timer);
+
+// Called from the timer interrupt, runs every timer up to the given tick
+void timer_wheel_run(uint32_t now);
+
+// The longest delay timer_ns_to_ticks() returns, longer ones are cut to it. Half the range of the
+// wheel, so a deadline computed from it, plus the tick callers round up by, never reads as already due
+#define TIMER_MAX_TICKS (INT32_MAX / 2)
+
+// Conversions between time and ticks, rounding up so sleeps never end early
+uint32_t timer_ns_to_ticks(uint64_t ns);
+uint64_t timer_ticks_to_ns(uint32_t ticks);
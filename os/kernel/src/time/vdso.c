@@ -0,0 +1,81 @@
+#include "vdso.h"
+#include "memory/heap/heap.h"
+#include "memory/paging/paging.h"
+
+static vdso_time_data_t* vdso_data = NULL;
+static uint32_t vdso_phys_page = 0;
+
+static inline void vdso_write_begin()
+{
+    vdso_data->seq++;
+    asm volatile("" ::: "memory");
+}
+
+static inline void vdso_write_end()
+{
+    asm volatile("" ::: "memory");
+    vdso_data->seq++;
+}
+
+bool vdso_init()
+{
+    vdso_data = (vdso_time_data_t*)kmalloc_pages(1);
+    if (vdso_data == NULL)
+        return false;
+
+    memset(vdso_data, 0, PAGE_SIZE);
+    vdso_phys_page = get_physical_address(vdso_data) / PAGE_SIZE;
+    return true;
+}
+
+void vdso_set_clock(bool use_tsc, uint32_t tsc_mult, uint32_t tsc_shift, uint64_t realtime_offset_ns,
+    uint32_t resolution_ns, uint32_t tick_period_ns)
+{
+    if (vdso_data == NULL)
+        return;
+
+    vdso_write_begin();
+    vdso_data->flags &= ~VDSO_FLAG_TSC;
+    vdso_data->flags |= VDSO_FLAG_READY | (use_tsc ? VDSO_FLAG_TSC : 0);
+    vdso_data->tsc_mult = tsc_mult;
+    vdso_data->tsc_shift = tsc_shift;
+    vdso_data->realtime_offset_ns = realtime_offset_ns;
+    vdso_data->resolution_ns = resolution_ns;
+    vdso_data->tick_period_ns = tick_period_ns;
+    vdso_write_end();
+}
+
+void vdso_set_sysenter(bool available)
+{
+    if (vdso_data == NULL)
+        return;
+
+    vdso_write_begin();
+    if (available)
+        vdso_data->flags |= VDSO_FLAG_SYSENTER;
+    else
+        vdso_data->flags &= ~VDSO_FLAG_SYSENTER;
+    vdso_write_end();
+}
+
+void vdso_update(uint64_t base_tsc, uint64_t base_ns)
+{
+    if (vdso_data == NULL)
+        return;
+
+    vdso_write_begin();
+    vdso_data->base_tsc = base_tsc;
+    vdso_data->base_ns = base_ns;
+    vdso_data->ticks++;
+    vdso_write_end();
+}
+
+void vdso_map(uintptr_t page_table_phys_addr)
+{
+    if (vdso_data == NULL)
+        return;
+
+    paging_map_page(vdso_phys_page, VDSO_VIRT_ADDR / PAGE_SIZE, false, page_table_phys_addr);
+    // The kernel writes through its own mapping, user space may only read
+    get_pte(VDSO_VIRT_ADDR / PAGE_SIZE)->read_write = 0;
+}
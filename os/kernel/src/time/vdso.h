@@ -0,0 +1,40 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+// The page right above the user stack, mapped read only into every process
+#define VDSO_VIRT_ADDR 0xBFFFF000
+
+#define VDSO_FLAG_READY 0x1
+#define VDSO_FLAG_TSC   0x2
+#define VDSO_FLAG_SYSENTER 0x4  // syscalls can go through sysenter instead of int 0x80
+
+/*
+ * The layout is shared with user space (toolchains/newlib/dbolos/vdso.h), only append to it.
+ * The kernel bumps seq to an odd value before writing and back to even after, readers retry
+ * if seq was odd or changed while they were reading.
+ */
+typedef struct vdso_time_data
+{
+    volatile uint32_t seq;
+    uint32_t flags;
+    uint64_t base_tsc;              // TSC value at the last tick
+    uint64_t base_ns;               // Monotonic time at the last tick
+    uint64_t realtime_offset_ns;    // Realtime = monotonic + this
+    uint32_t tsc_mult;              // ns = cycles * tsc_mult >> tsc_shift
+    uint32_t tsc_shift;
+    uint32_t resolution_ns;
+    uint32_t tick_period_ns;
+    uint64_t ticks;
+} __attribute__((packed)) vdso_time_data_t;
+
+// Allocates the shared page, must run after the heap is initialized
+bool vdso_init();
+// Publish the clock parameters that only change on calibration
+void vdso_set_clock(bool use_tsc, uint32_t tsc_mult, uint32_t tsc_shift, uint64_t realtime_offset_ns,
+    uint32_t resolution_ns, uint32_t tick_period_ns);
+void vdso_set_sysenter(bool available);
+// Called from clock_tick, publishes the new base
+void vdso_update(uint64_t base_tsc, uint64_t base_ns);
+// Map the page into the page tables of a process being loaded (its page directory must be loaded)
+void vdso_map(uintptr_t page_table_phys_addr);
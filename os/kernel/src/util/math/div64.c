@@ -0,0 +1,20 @@
+#include "div64.h"
+
+// Long division in two 32 bit steps, divl can't overflow since the high remainder < divisor
+uint64_t div64_u32(uint64_t dividend, uint32_t divisor, uint32_t* remainder)
+{
+    uint32_t high = (uint32_t)(dividend >> 32);
+    uint32_t low = (uint32_t)dividend;
+    uint32_t quotient_high = high / divisor;
+    uint32_t quotient_low;
+    uint32_t rem = high % divisor;
+
+    asm("divl %4"
+            : "=a"(quotient_low), "=d"(rem)
+            : "a"(low), "d"(rem), "rm"(divisor));
+
+    if (remainder != NULL)
+        *remainder = rem;
+
+    return ((uint64_t)quotient_high << 32) | quotient_low;
+}
@@ -0,0 +1,6 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// The kernel isn't linked with libgcc, so 64 bit divisions must go through here
+uint64_t div64_u32(uint64_t dividend, uint32_t divisor, uint32_t* remainder);
@@ -8,15 +8,34 @@
 #include <errno.h>
 #include <limits.h>
 #include <ctype.h>
+#include <sys/times.h>
+#include <sys/time.h>
+#include <sys/sendfile.h>
+#include "syscall.h"
+#include "defrag.h"
 
 #define MAX_INPUT_LENGTH 256
 #define MAX_ARGS 64
 #define MAX_PATH 256
 #define MAX_BUFFER_SIZE 4096
 
+#define SYS_GETRUSAGE 77
+#define RUSAGE_SELF 0
+#define RUSAGE_CHILDREN -1
+
+// The kernel fills the full Linux rusage layout (newlib's only has the times)
+struct kernel_rusage {
+    struct timeval ru_utime;
+    struct timeval ru_stime;
+    long ru_unused[12];
+    long ru_nvcsw;
+    long ru_nivcsw;
+};
+
 typedef int (*cmd_func)(char **args);
 
 int execute_command(char **args);
+int run_command(char **args);
 int parse_input(char *input, char *arg_buffer, char **args);
 int start_shell();
 void print_cwd();
@@ -25,24 +44,34 @@ int cmd_help(char **args);
 int cmd_ls(char **args);
 int cmd_cd(char **args);
 int cmd_cat(char **args);
+int cmd_cp(char **args);
 int cmd_echo(char **args);
 int cmd_mkdir(char **args);
 int cmd_rm(char **args);
 int cmd_rmdir(char **args);
 int cmd_run(char **args);
 int cmd_exit(char **args);
+int cmd_time(char **args);
+int cmd_sleep(char **args);
+int cmd_bench(char **args);
+int cmd_defrag(char **args);
 
 char *supported_commands[] = {
     "help",
     "ls",
     "cd",
     "cat",
+    "cp",
     "echo",
     "mkdir",
     "rm",
     "rmdir",
     "run",
-    "exit"
+    "exit",
+    "time",
+    "sleep",
+    "bench",
+    "defrag"
 };
 
 cmd_func command_funcs[] = {
@@ -50,12 +79,17 @@ cmd_func command_funcs[] = {
     &cmd_ls,
     &cmd_cd,
     &cmd_cat,
+    &cmd_cp,
     &cmd_echo,
     &cmd_mkdir,
     &cmd_rm,
     &cmd_rmdir,
     &cmd_run,
-    &cmd_exit
+    &cmd_exit,
+    &cmd_time,
+    &cmd_sleep,
+    &cmd_bench,
+    &cmd_defrag
 };
 
 int num_cmds()
@@ -124,7 +158,122 @@ void print_cwd()
     fflush(stdout);
 }
 
+// Set while stdin comes from a pipe instead of the keyboard
+static int stdin_redirected = 0;
+
+// Runs the command with target_fd (stdin or stdout) pointing at fd, then puts it back
+static int run_redirected(char **args, int target_fd, int fd)
+{
+    int status;
+    int saved_fd;
+
+    fflush(stdout);
+    saved_fd = dup(target_fd);
+    if (saved_fd < 0 || dup2(fd, target_fd) < 0)
+    {
+        puts("redirect");
+        if (saved_fd >= 0)
+            close(saved_fd);
+        return 1;
+    }
+    if (target_fd == STDIN_FILENO)
+        stdin_redirected = 1;
+
+    status = execute_command(args);
+
+    fflush(stdout);
+    dup2(saved_fd, target_fd);
+    close(saved_fd);
+    if (target_fd == STDIN_FILENO)
+        stdin_redirected = 0;
+    return status;
+}
+
+// left | right, the right side may be a pipeline of its own.
+// The shell runs the stages one after the other, so the output of a stage has to fit in the pipe
+static int execute_pipeline(char **left, char **right)
+{
+    int fds[2];
+    int status;
+
+    if (left[0] == NULL || right[0] == NULL)
+    {
+        const char err_msg[] = "syntax error near |\n";
+        write(STDERR_FILENO, err_msg, sizeof(err_msg) - 1);
+        return 1;
+    }
+
+    if (pipe(fds) < 0)
+    {
+        puts("pipe");
+        return 1;
+    }
+
+    status = run_redirected(left, STDOUT_FILENO, fds[1]);
+    // Without a writer left the next stage reads to the end of the data instead of blocking
+    close(fds[1]);
+    if (status)
+        status = run_redirected(right, STDIN_FILENO, fds[0]);
+    close(fds[0]);
+    return status;
+}
+
+// command > file or command >> file
+static int execute_output_redirect(char **args, const char *path, int append)
+{
+    int status;
+
+    if (path == NULL)
+    {
+        const char err_msg[] = "syntax error, expected file name\n";
+        write(STDERR_FILENO, err_msg, sizeof(err_msg) - 1);
+        return 1;
+    }
+
+    FILE *fp = fopen(path, append ? "a" : "w");
+    if (fp == NULL)
+    {
+        puts("redirect");
+        return 1;
+    }
+
+    status = run_redirected(args, STDOUT_FILENO, fileno(fp));
+    fclose(fp);
+    return status;
+}
+
 int execute_command(char **args)
+{
+    if (args[0] == NULL)
+    {
+        return 1;
+    }
+
+    // | splits the line first, so "a > f | b" sends the output of a to f
+    for (int i = 0; args[i] != NULL; ++i)
+    {
+        if (strcmp(args[i], "|") == 0)
+        {
+            args[i] = NULL;
+            return execute_pipeline(args, &args[i + 1]);
+        }
+    }
+
+    for (int i = 0; args[i] != NULL; ++i)
+    {
+        if (strcmp(args[i], ">") == 0 || strcmp(args[i], ">>") == 0)
+        {
+            int append = args[i][1] == '>';
+            const char *path = args[i + 1];
+            args[i] = NULL;
+            return execute_output_redirect(args, path, append);
+        }
+    }
+
+    return run_command(args);
+}
+
+int run_command(char **args)
 {
     if (args[0] == NULL)
     {
@@ -159,9 +308,16 @@ int parse_input(char *input, char *arg_buffer, char **args) {
         // Mark start of argument
         args[arg_count] = &arg_buffer[buf_pos];
         
-        // Copy characters until whitespace
-        while (i < input_len && !isspace((unsigned char)input[i])) {
+        if (input[i] == '|' || input[i] == '>') {
+            // | and > (or >>) are arguments of their own, spaces around them or not
             arg_buffer[buf_pos++] = input[i++];
+            if (input[i - 1] == '>' && i < input_len && input[i] == '>')
+                arg_buffer[buf_pos++] = input[i++];
+        } else {
+            // Copy characters until whitespace or an operator
+            while (i < input_len && !isspace((unsigned char)input[i]) && input[i] != '|' && input[i] != '>') {
+                arg_buffer[buf_pos++] = input[i++];
+            }
         }
         
         // Null-terminate this argument
@@ -234,8 +390,22 @@ int cmd_cd(char **args)
     return 1;
 }
 
+// cat with no file copies a piped stdin to stdout
+static int cat_stdin()
+{
+    char buffer[MAX_BUFFER_SIZE];
+    int bytes_read;
+
+    while ((bytes_read = read(STDIN_FILENO, buffer, sizeof(buffer))) > 0)
+        write(STDOUT_FILENO, buffer, bytes_read);
+    return 1;
+}
+
 int cmd_cat(char **args)
 {
+    if (args[1] == NULL && stdin_redirected)
+        return cat_stdin();
+
     if (args[1] == NULL)
     {
         const char err_msg[] = "cat: missing file\n";
@@ -270,9 +440,42 @@ int cmd_cat(char **args)
     return 1;
 }
 
+// The data never leaves the kernel, copy_file_range() moves it cluster run by cluster run
+int cmd_cp(char **args)
+{
+    if (args[1] == NULL || args[2] == NULL)
+    {
+        const char err_msg[] = "cp: cp <source> <destination>\n";
+        write(STDERR_FILENO, err_msg, sizeof(err_msg) - 1);
+        return 1;
+    }
+
+    FILE* src = fopen(args[1], "rb");
+    if (!src) {
+        puts("cp");
+        return 1;
+    }
+
+    FILE* dst = fopen(args[2], "wb");
+    if (!dst) {
+        puts("cp");
+        fclose(src);
+        return 1;
+    }
+
+    ssize_t copied;
+    while ((copied = copy_file_range(fileno(src), NULL, fileno(dst), NULL, 64 * 1024, 0)) > 0)
+        ;
+    if (copied < 0)
+        puts("cp");
+
+    fclose(dst);
+    fclose(src);
+    return 1;
+}
+
 int cmd_echo(char **args)
 {
-    FILE* fd = stdout;
     char buffer[MAX_INPUT_LENGTH] = {0};
     int i = 1;
     
@@ -282,49 +485,8 @@ int cmd_echo(char **args)
         return 1;
     }
     
-    // First pass: find redirection if any
-    while(args[i] != NULL)
-    {
-        if (strcmp(args[i], ">") == 0)
-        {
-            if (args[i+1] == NULL)
-            {
-                const char err_msg[] = "echo: syntax error, expected file name\n";
-                write(STDERR_FILENO, err_msg, sizeof(err_msg) - 1);
-                return 1;
-            }
-
-            fd = fopen(args[i+1], "w+");
-            if (fd == NULL) {
-                puts("echo");
-                return 1;
-            }
-            args[i] = NULL; // Mark end of content
-            break;
-        }
-        else if (strcmp(args[i], ">>") == 0)
-        {
-            if (args[i+1] == NULL)
-            {
-                const char err_msg[] = "echo: syntax error, expected file name\n";
-                write(STDERR_FILENO, err_msg, sizeof(err_msg) - 1);
-                return 1;
-            }
-
-            fd = fopen(args[i+1], "a");
-            if (fd == NULL) {
-                puts("echo");
-                return 1;
-            }
-            args[i] = NULL; // Mark end of content
-            break;
-        }
-        i++;
-    }
-    
-    // Second pass: build the output string
+    // > and >> are taken care of by execute_command, stdout is already the file
     buffer[0] = '\0';
-    i = 1;
     while(args[i] != NULL)
     {
         if (i > 1) {
@@ -334,15 +496,8 @@ int cmd_echo(char **args)
         i++;
     }
 
-    // Write to file or stdout
-    if (fd == stdout) {
-        write(STDOUT_FILENO, buffer, strlen(buffer));
-        write(STDOUT_FILENO, "\n", 1);
-    } else {
-        fwrite(buffer, sizeof(char), strlen(buffer), fd);
-        fclose(fd);
-    }
-
+    write(STDOUT_FILENO, buffer, strlen(buffer));
+    write(STDOUT_FILENO, "\n", 1);
     return 1;
 }
 
@@ -437,4 +592,171 @@ int cmd_exit(char **args)
     
 
     return 0;
-}
\ No newline at end of file
+}
+
+static int kernel_getrusage(int who, struct kernel_rusage *usage)
+{
+    int ret;
+    asm volatile(
+        "movl $77, %%eax\n"     // SYS_getrusage
+        "movl %1, %%ebx\n"      // who
+        "movl %2, %%ecx\n"      // usage
+        "int $0x80\n"
+        "movl %%eax, %0\n"
+        : "=r"(ret)
+        : "g"(who), "g"(usage)
+        : "%eax", "%ebx", "%ecx", "memory");
+    return ret;
+}
+
+static long rusage_switches(struct kernel_rusage *self, struct kernel_rusage *children, int voluntary)
+{
+    if (voluntary)
+        return self->ru_nvcsw + children->ru_nvcsw;
+    return self->ru_nivcsw + children->ru_nivcsw;
+}
+
+static void print_ticks(const char *label, clock_t ticks)
+{
+    printf("%s\t%lu.%03lus\n", label, ticks / CLOCKS_PER_SEC, (ticks % CLOCKS_PER_SEC) * 1000 / CLOCKS_PER_SEC);
+}
+
+int cmd_time(char **args)
+{
+    struct tms start_times, end_times;
+    struct kernel_rusage start_self, start_children, end_self, end_children;
+    clock_t start, end;
+
+    if (args[1] == NULL)
+    {
+        const char err_msg[] = "time: time <command>\n";
+        write(STDERR_FILENO, err_msg, sizeof(err_msg) - 1);
+        return 1;
+    }
+
+    kernel_getrusage(RUSAGE_SELF, &start_self);
+    kernel_getrusage(RUSAGE_CHILDREN, &start_children);
+    start = times(&start_times);
+
+    int status = execute_command(&args[1]);
+
+    end = times(&end_times);
+    kernel_getrusage(RUSAGE_SELF, &end_self);
+    kernel_getrusage(RUSAGE_CHILDREN, &end_children);
+
+    print_ticks("real", end - start);
+    print_ticks("user", (end_times.tms_utime - start_times.tms_utime)
+        + (end_times.tms_cutime - start_times.tms_cutime));
+    print_ticks("sys", (end_times.tms_stime - start_times.tms_stime)
+        + (end_times.tms_cstime - start_times.tms_cstime));
+    printf("csw\t%ld voluntary, %ld involuntary\n",
+        rusage_switches(&end_self, &end_children, 1) - rusage_switches(&start_self, &start_children, 1),
+        rusage_switches(&end_self, &end_children, 0) - rusage_switches(&start_self, &start_children, 0));
+
+    return status;
+}
+
+int cmd_sleep(char **args)
+{
+    if (args[1] == NULL)
+    {
+        const char err_msg[] = "sleep: sleep <milliseconds>\n";
+        write(STDERR_FILENO, err_msg, sizeof(err_msg) - 1);
+        return 1;
+    }
+
+    long ms = atol(args[1]);
+
+    if (ms < 0 || usleep(ms * 1000) < 0)
+        printf("sleep failed %d\n", errno);
+    return 1;
+}
+
+#define BENCH_DEFAULT_ITERATIONS 10000
+
+enum bench_kind {
+    BENCH_GETPID_INT80,
+    BENCH_GETPID,
+    BENCH_YIELD
+};
+
+static int int80_getpid()
+{
+    int ret;
+    asm volatile(
+        "movl $20, %%eax\n"    // SYS_getpid
+        "int $0x80\n"
+        "movl %%eax, %0\n"
+        : "=r"(ret)
+        :
+        : "%eax", "memory");
+    return ret;
+}
+
+// Returns the average time of one call in nanoseconds
+static long bench_run(enum bench_kind kind, int iterations)
+{
+    struct timeval start, end;
+
+    gettimeofday(&start, NULL);
+    for (int i = 0; i < iterations; i++)
+    {
+        switch (kind)
+        {
+            case BENCH_GETPID_INT80:
+                int80_getpid();
+                break;
+            case BENCH_GETPID:
+                syscall0(SYS_GETPID);
+                break;
+            case BENCH_YIELD:
+                syscall0(SYS_SCHED_YIELD);
+                break;
+        }
+    }
+    gettimeofday(&end, NULL);
+
+    long long elapsed_us = (long long)(end.tv_sec - start.tv_sec) * 1000000 + (end.tv_usec - start.tv_usec);
+    return (long)(elapsed_us * 1000 / iterations);
+}
+
+int cmd_bench(char **args)
+{
+    int iterations = BENCH_DEFAULT_ITERATIONS;
+
+    if (args[1] != NULL)
+        iterations = atoi(args[1]);
+    if (iterations <= 0)
+    {
+        const char err_msg[] = "bench: bench [iterations]\n";
+        write(STDERR_FILENO, err_msg, sizeof(err_msg) - 1);
+        return 1;
+    }
+
+    printf("%d iterations\n", iterations);
+    printf("getpid (int 0x80)\t%ld ns\n", bench_run(BENCH_GETPID_INT80, iterations));
+    printf("getpid (%s)\t%ld ns\n", (VDSO_TIME_DATA->flags & VDSO_FLAG_SYSENTER) ? "sysenter" : "int 0x80",
+        bench_run(BENCH_GETPID, iterations));
+    // Every yield switches to the next ready process and back
+    printf("sched_yield\t\t%ld ns\n", bench_run(BENCH_YIELD, iterations));
+    return 1;
+}
+
+static void print_defrag_stats(const char *when, const struct defrag_stats *stats)
+{
+    printf("%s:\t%u files, %u fragmented, %u fragments in %u clusters\n",
+        when, stats->files, stats->fragmented_files, stats->fragments, stats->clusters);
+    printf("\tfree %u clusters, largest run %u\n", stats->free_clusters, stats->largest_free_run);
+}
+
+int cmd_defrag(char **args)
+{
+    struct defrag_stats before = {0}, after = {0};
+
+    int r = defrag(&before, &after);
+    print_defrag_stats("before", &before);
+    print_defrag_stats("after", &after);
+    if (r != 0)
+        puts("defrag");
+    return 1;
+}
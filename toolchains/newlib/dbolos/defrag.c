@@ -0,0 +1,7 @@
+#include "defrag.h"
+#include "syscall.h"
+
+int defrag(struct defrag_stats *before, struct defrag_stats *after)
+{
+    return syscall_result(syscall2(SYS_DEFRAG, (int)before, (int)after));
+}
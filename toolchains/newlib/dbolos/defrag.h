@@ -0,0 +1,18 @@
+#pragma once
+
+/*
+ * The online defragmenter, DbolOS only. struct defrag_stats must match fat_frag_stats_t in
+ * os/kernel/src/filesystem/fat/fat.h.
+ */
+
+struct defrag_stats {
+    unsigned int files;             // regular files, directories aren't counted
+    unsigned int fragmented_files;  // files whose clusters aren't a single run
+    unsigned int fragments;         // runs of clusters of all the files together
+    unsigned int clusters;          // clusters of all the files together
+    unsigned int free_clusters;
+    unsigned int largest_free_run;  // in clusters
+};
+
+// Moves every fragmented file into a single run of clusters, either stats may be NULL
+int defrag(struct defrag_stats *before, struct defrag_stats *after);
@@ -0,0 +1,30 @@
+#include "fallocate.h"
+#include <errno.h>
+#include "syscall.h"
+
+int fallocate(int fd, int mode, off_t offset, off_t len)
+{
+    int ret;
+
+    // The offset and the length are 64 bit, split in two registers each. The high half of the
+    // length goes in ebp, which the sysenter entry takes for its frame, so this one always goes
+    // through int 0x80. off_t is 32 bit, so the high halves only hold the sign
+    asm volatile(
+        "push %%ebp\n"
+        "mov %%edi, %%ebp\n"
+        "sar $31, %%ebp\n"
+        "int $0x80\n"
+        "pop %%ebp\n"
+        : "=a"(ret)
+        : "a"(SYS_FALLOCATE), "b"(fd), "c"(mode), "d"(offset), "S"(offset < 0 ? -1 : 0), "D"(len)
+        : "memory");
+    return syscall_result(ret);
+}
+
+int posix_fallocate(int fd, off_t offset, off_t len)
+{
+    int saved_errno = errno;
+    int r = fallocate(fd, 0, offset, len) == 0 ? 0 : errno;
+    errno = saved_errno;
+    return r;
+}
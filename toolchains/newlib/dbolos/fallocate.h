@@ -0,0 +1,11 @@
+#pragma once
+#include <sys/types.h>
+
+/*
+ * File preallocation, which newlib doesn't declare. Only mode 0 exists: the file grows to cover
+ * the range, and the new clusters follow each other on the disk when the volume has room for that.
+ */
+
+int fallocate(int fd, int mode, off_t offset, off_t len);
+// Returns the error number instead of setting errno
+int posix_fallocate(int fd, off_t offset, off_t len);
@@ -0,0 +1,59 @@
+#include "futex.h"
+#include "syscall.h"
+
+#define UMUTEX_UNLOCKED  0
+#define UMUTEX_LOCKED    1
+#define UMUTEX_CONTENDED 2
+
+// Written with lock prefixed instructions, the toolchain targets i386 and has no atomic builtins
+static inline uint32_t cmpxchg(volatile uint32_t *addr, uint32_t expected, uint32_t desired)
+{
+    uint32_t prev;
+    asm volatile("lock cmpxchg %2, %1"
+                 : "=a"(prev), "+m"(*addr)
+                 : "r"(desired), "0"(expected)
+                 : "memory", "cc");
+    return prev;
+}
+
+static inline uint32_t xchg(volatile uint32_t *addr, uint32_t value)
+{
+    asm volatile("xchg %0, %1"
+                 : "+r"(value), "+m"(*addr)
+                 :
+                 : "memory");
+    return value;
+}
+
+int futex(volatile uint32_t *uaddr, int futex_op, uint32_t val, const struct timespec *timeout)
+{
+    return syscall_result(syscall4(SYS_FUTEX, (int)uaddr, futex_op, (int)val, (int)timeout));
+}
+
+void umutex_lock(umutex_t *mutex)
+{
+    uint32_t state = cmpxchg(&mutex->state, UMUTEX_UNLOCKED, UMUTEX_LOCKED);
+    if (state == UMUTEX_UNLOCKED)
+        return;
+
+    // Mark the lock contended before sleeping, so the owner knows to wake us up. Taking it with
+    // the contended mark is fine, at worst the next unlock makes one syscall too many
+    if (state != UMUTEX_CONTENDED)
+        state = xchg(&mutex->state, UMUTEX_CONTENDED);
+    while (state != UMUTEX_UNLOCKED)
+    {
+        futex(&mutex->state, FUTEX_WAIT | FUTEX_PRIVATE_FLAG, UMUTEX_CONTENDED, NULL);
+        state = xchg(&mutex->state, UMUTEX_CONTENDED);
+    }
+}
+
+int umutex_trylock(umutex_t *mutex)
+{
+    return cmpxchg(&mutex->state, UMUTEX_UNLOCKED, UMUTEX_LOCKED) == UMUTEX_UNLOCKED ? 0 : EBUSY;
+}
+
+void umutex_unlock(umutex_t *mutex)
+{
+    if (xchg(&mutex->state, UMUTEX_UNLOCKED) == UMUTEX_CONTENDED)
+        futex(&mutex->state, FUTEX_WAKE | FUTEX_PRIVATE_FLAG, 1, NULL);
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <stdint.h>
+#include <time.h>
+
+/*
+ * User side of the futex syscall, the numbers must match os/kernel/src/sync/futex.h.
+ */
+
+#define FUTEX_WAIT 0
+#define FUTEX_WAKE 1
+#define FUTEX_PRIVATE_FLAG 128
+
+int futex(volatile uint32_t *uaddr, int futex_op, uint32_t val, const struct timespec *timeout);
+
+/*
+ * A lock that only enters the kernel when it's contended: 0 is unlocked, 1 locked, and 2 locked
+ * with (maybe) someone asleep on it, so an unlock of an uncontended lock never makes a syscall.
+ */
+typedef struct {
+    volatile uint32_t state;
+} umutex_t;
+
+#define UMUTEX_INITIALIZER { 0 }
+
+void umutex_lock(umutex_t *mutex);
+int umutex_trylock(umutex_t *mutex);
+void umutex_unlock(umutex_t *mutex);
@@ -0,0 +1,76 @@
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include "syscall.h"
+
+// The hot path of every stdio call, worth the fast entry
+_READ_WRITE_RETURN_TYPE read(int fd, void *buf, size_t count)
+{
+    return syscall_result(syscall3(SYS_READ, fd, (int)buf, count));
+}
+
+_READ_WRITE_RETURN_TYPE write(int fd, const void *buf, size_t count)
+{
+    return syscall_result(syscall3(SYS_WRITE, fd, (int)buf, count));
+}
+
+// Appends are held back in the kernel for a while, these write them out right away
+int fsync(int fd)
+{
+    return syscall_result(syscall1(SYS_FSYNC, fd));
+}
+
+int fdatasync(int fd)
+{
+    return syscall_result(syscall1(SYS_FDATASYNC, fd));
+}
+
+int pipe(int fildes[2])
+{
+    return syscall_result(syscall1(SYS_PIPE, (int)fildes));
+}
+
+int dup(int fildes)
+{
+    return syscall_result(syscall1(SYS_DUP, fildes));
+}
+
+int dup2(int fildes, int fildes2)
+{
+    return syscall_result(syscall2(SYS_DUP2, fildes, fildes2));
+}
+
+// Only the flags that can change after open() are translated, the rest mean nothing to F_SETFL
+static int flags_to_kernel(int flags)
+{
+    return (flags & O_ACCMODE) | (flags & O_APPEND ? KERNEL_O_APPEND : 0)
+        | (flags & O_NONBLOCK ? KERNEL_O_NONBLOCK : 0);
+}
+
+static int flags_from_kernel(int flags)
+{
+    return (flags & O_ACCMODE) | (flags & KERNEL_O_APPEND ? O_APPEND : 0)
+        | (flags & KERNEL_O_NONBLOCK ? O_NONBLOCK : 0);
+}
+
+int fcntl(int fd, int cmd, ...)
+{
+    va_list args;
+    va_start(args, cmd);
+    int arg = va_arg(args, int);
+    va_end(args);
+
+    switch (cmd)
+    {
+    case F_GETFL:
+    {
+        int ret = syscall_result(syscall2(SYS_FCNTL, fd, F_GETFL));
+        return ret < 0 ? ret : flags_from_kernel(ret);
+    }
+    case F_SETFL:
+        return syscall_result(syscall3(SYS_FCNTL, fd, F_SETFL, flags_to_kernel(arg)));
+    default:
+        errno = EINVAL;
+        return -1;
+    }
+}
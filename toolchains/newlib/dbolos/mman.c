@@ -0,0 +1,87 @@
+#include <fcntl.h>
+#include <string.h>
+#include <stdint.h>
+#include "mman.h"
+#include "syscall.h"
+
+#define SHM_PATH_PREFIX "/dev/shm"
+#define SHM_PATH_MAX 80
+
+// Same layout as struct mmap_arg_struct in the kernel
+struct mmap_args {
+    uint32_t addr;
+    uint32_t len;
+    uint32_t prot;
+    uint32_t flags;
+    uint32_t fd;
+    uint32_t offset;
+};
+
+static int shm_path(const char *name, char *path)
+{
+    if (name[0] != '/' || strchr(name + 1, '/') != NULL)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    if (strlen(SHM_PATH_PREFIX) + strlen(name) >= SHM_PATH_MAX)
+    {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strcpy(path, SHM_PATH_PREFIX);
+    strcat(path, name);
+    return 0;
+}
+
+int shm_open(const char *name, int oflag, mode_t mode)
+{
+    char path[SHM_PATH_MAX];
+    int flags = 0;
+
+    if (shm_path(name, path) != 0)
+        return -1;
+
+    switch (oflag & O_ACCMODE)
+    {
+    case O_WRONLY: flags = KERNEL_O_WRONLY; break;
+    case O_RDWR: flags = KERNEL_O_RDWR; break;
+    default: flags = KERNEL_O_RDONLY; break;
+    }
+    if (oflag & O_CREAT)
+        flags |= KERNEL_O_CREAT;
+    if (oflag & O_EXCL)
+        flags |= KERNEL_O_EXCL;
+    if (oflag & O_TRUNC)
+        flags |= KERNEL_O_TRUNC;
+
+    return syscall_result(syscall2(SYS_OPEN, (int)path, flags));
+}
+
+int shm_unlink(const char *name)
+{
+    char path[SHM_PATH_MAX];
+
+    if (shm_path(name, path) != 0)
+        return -1;
+    return syscall_result(syscall1(SYS_UNLINK, (int)path));
+}
+
+void *mmap(void *addr, size_t length, int prot, int flags, int fd, off_t offset)
+{
+    struct mmap_args args = { (uint32_t)addr, length, prot, flags, fd, offset };
+
+    // Mappings can be above 2GB, only the last page of the range is -errno
+    uint32_t ret = syscall1(SYS_MMAP, (int)&args);
+    if (ret > (uint32_t)-4096)
+    {
+        errno = -(int)ret;
+        return MAP_FAILED;
+    }
+    return (void *)ret;
+}
+
+int munmap(void *addr, size_t length)
+{
+    return syscall_result(syscall2(SYS_MUNMAP, (int)addr, length));
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <stddef.h>
+#include <sys/types.h>
+
+/*
+ * Shared memory and mmap(), which newlib doesn't declare. The numbers must match
+ * os/kernel/src/memory/mmap/mmap.h.
+ * Only MAP_SHARED mappings exist: of shm_open() objects, or MAP_ANONYMOUS memory.
+ */
+
+#define PROT_NONE  0x0
+#define PROT_READ  0x1
+#define PROT_WRITE 0x2
+#define PROT_EXEC  0x4
+
+#define MAP_SHARED    0x01
+#define MAP_PRIVATE   0x02
+#define MAP_FIXED     0x10
+#define MAP_ANONYMOUS 0x20
+#define MAP_ANON      MAP_ANONYMOUS
+
+#define MAP_FAILED ((void *)-1)
+
+void *mmap(void *addr, size_t length, int prot, int flags, int fd, off_t offset);
+int munmap(void *addr, size_t length);
+
+// Objects are named "/name", size them with ftruncate() before mapping them
+int shm_open(const char *name, int oflag, mode_t mode);
+int shm_unlink(const char *name);
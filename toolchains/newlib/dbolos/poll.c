@@ -0,0 +1,16 @@
+#include <sys/select.h>
+#include <sys/time.h>
+#include "poll.h"
+#include "syscall.h"
+
+int poll(struct pollfd *fds, nfds_t nfds, int timeout)
+{
+    return syscall_result(syscall3(SYS_POLL, (int)fds, nfds, timeout));
+}
+
+// newlib's fd_set is an array of 32 bit longs, the layout the kernel takes
+int select(int nfds, fd_set *readfds, fd_set *writefds, fd_set *exceptfds, struct timeval *timeout)
+{
+    return syscall_result(syscall5(SYS_SELECT, nfds, (int)readfds, (int)writefds, (int)exceptfds,
+        (int)timeout));
+}
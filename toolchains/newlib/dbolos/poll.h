@@ -0,0 +1,23 @@
+#pragma once
+
+/*
+ * poll(), which newlib doesn't declare. The numbers must match os/kernel/src/filesystem/vfs/poll.h.
+ * select() is declared by newlib's <sys/select.h>.
+ */
+
+#define POLLIN   0x001
+#define POLLPRI  0x002
+#define POLLOUT  0x004
+#define POLLERR  0x008
+#define POLLHUP  0x010
+#define POLLNVAL 0x020
+
+typedef unsigned int nfds_t;
+
+struct pollfd {
+    int fd;
+    short events;
+    short revents;
+};
+
+int poll(struct pollfd *fds, nfds_t nfds, int timeout);
@@ -0,0 +1,7 @@
+#include <sched.h>
+#include "syscall.h"
+
+int sched_yield(void)
+{
+    return syscall_result(syscall0(SYS_SCHED_YIELD));
+}
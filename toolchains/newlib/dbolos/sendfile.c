@@ -0,0 +1,32 @@
+#include <sys/sendfile.h>
+#include <errno.h>
+#include "syscall.h"
+
+ssize_t sendfile(int out_fd, int in_fd, off_t *offset, size_t count)
+{
+    return syscall_result(syscall4(SYS_SENDFILE, out_fd, in_fd, (int)offset, count));
+}
+
+ssize_t copy_file_range(int fd_in, loff_t *off_in, int fd_out, loff_t *off_out, size_t len, unsigned int flags)
+{
+    int ret;
+
+    // No flag is defined yet, and this way the sixth argument is always 0
+    if (flags != 0)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    // The sixth argument goes in ebp, which the sysenter entry takes for its frame, so this one
+    // always goes through int 0x80
+    asm volatile(
+        "push %%ebp\n"
+        "xor %%ebp, %%ebp\n"
+        "int $0x80\n"
+        "pop %%ebp\n"
+        : "=a"(ret)
+        : "a"(SYS_COPY_FILE_RANGE), "b"(fd_in), "c"(off_in), "d"(fd_out), "S"(off_out), "D"(len)
+        : "memory");
+    return syscall_result(ret);
+}
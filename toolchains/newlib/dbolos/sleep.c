@@ -0,0 +1,48 @@
+#include <time.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include "syscall.h"
+
+int nanosleep(const struct timespec *req, struct timespec *rem)
+{
+    return syscall_result(syscall2(SYS_NANOSLEEP, (int)req, (int)rem));
+}
+
+int usleep(useconds_t usec)
+{
+    struct timespec req;
+
+    req.tv_sec = usec / 1000000;
+    req.tv_nsec = (usec % 1000000) * 1000;
+    return nanosleep(&req, NULL);
+}
+
+unsigned sleep(unsigned seconds)
+{
+    struct timespec req = { seconds, 0 };
+    struct timespec rem = { 0, 0 };
+
+    if (nanosleep(&req, &rem) == 0)
+        return 0;
+    return rem.tv_sec + (rem.tv_nsec ? 1 : 0);
+}
+
+unsigned alarm(unsigned seconds)
+{
+    return syscall1(SYS_ALARM, seconds);
+}
+
+int pause(void)
+{
+    return syscall_result(syscall1(SYS_PAUSE, 0));
+}
+
+int setitimer(int which, const struct itimerval *new_value, struct itimerval *old_value)
+{
+    return syscall_result(syscall3(SYS_SETITIMER, which, (int)new_value, (int)old_value));
+}
+
+int getitimer(int which, struct itimerval *curr_value)
+{
+    return syscall_result(syscall2(SYS_GETITIMER, which, (int)curr_value));
+}
@@ -0,0 +1,12 @@
+#pragma once
+#include <sys/types.h>
+
+/*
+ * In-kernel file copies, newlib doesn't come with them for DbolOS.
+ * copy_file_range() lives in <unistd.h> on Linux, newlib's can't be extended so it's here too.
+ */
+
+typedef long long loff_t;
+
+ssize_t sendfile(int out_fd, int in_fd, off_t *offset, size_t count);
+ssize_t copy_file_range(int fd_in, loff_t *off_in, int fd_out, loff_t *off_out, size_t len, unsigned int flags);
@@ -0,0 +1,38 @@
+#pragma once
+#include <sys/types.h>
+
+/*
+ * What newlib's <termios.h> includes, it doesn't come with one for DbolOS.
+ * The layout and values must match os/kernel/src/terminal/termios.h.
+ * Only ICANON, ECHO, VMIN and VTIME do anything.
+ */
+
+#define NCCS 19
+
+#define VTIME 5
+#define VMIN  6
+
+#define ISIG   0x0001
+#define ICANON 0x0002
+#define ECHO   0x0008
+
+#define TCSANOW   0
+#define TCSADRAIN 1
+#define TCSAFLUSH 2
+
+typedef unsigned int tcflag_t;
+typedef unsigned char cc_t;
+
+struct termios {
+    tcflag_t c_iflag;
+    tcflag_t c_oflag;
+    tcflag_t c_cflag;
+    tcflag_t c_lflag;
+    cc_t c_line;
+    cc_t c_cc[NCCS];
+};
+
+int tcgetattr(int fd, struct termios *termios_p);
+int tcsetattr(int fd, int optional_actions, const struct termios *termios_p);
+// Byte at a time input without echo, a read returns as soon as a byte is there
+void cfmakeraw(struct termios *termios_p);
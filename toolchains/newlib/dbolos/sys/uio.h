@@ -0,0 +1,19 @@
+#pragma once
+#include <sys/types.h>
+
+/*
+ * Scatter/gather I/O, newlib doesn't come with it for DbolOS.
+ * struct iovec must match lib/src/uio.h.
+ */
+
+#define IOV_MAX 1024
+
+struct iovec {
+    void  *iov_base;
+    size_t iov_len;
+};
+
+ssize_t readv(int fd, const struct iovec *iov, int iovcnt);
+ssize_t writev(int fd, const struct iovec *iov, int iovcnt);
+ssize_t preadv(int fd, const struct iovec *iov, int iovcnt, off_t offset);
+ssize_t pwritev(int fd, const struct iovec *iov, int iovcnt, off_t offset);
@@ -0,0 +1,125 @@
+#pragma once
+#include <errno.h>
+#include "vdso.h"
+
+// Syscall numbers, same as Linux i386
+#define SYS_EXIT 1
+#define SYS_READ 3
+#define SYS_WRITE 4
+#define SYS_OPEN 5
+#define SYS_UNLINK 10
+#define SYS_ALARM 27
+#define SYS_GETPID 20
+#define SYS_PAUSE 29
+#define SYS_DUP 41
+#define SYS_IOCTL 54
+#define SYS_FCNTL 55
+#define SYS_PIPE 42
+#define SYS_DUP2 63
+#define SYS_GETTIMEOFDAY 78
+#define SYS_MMAP 90
+#define SYS_MUNMAP 91
+#define SYS_SETITIMER 104
+#define SYS_GETITIMER 105
+#define SYS_FSYNC 118
+#define SYS_CLONE 120
+#define SYS_SELECT 142
+#define SYS_READV 145
+#define SYS_WRITEV 146
+#define SYS_FDATASYNC 148
+#define SYS_SCHED_YIELD 158
+#define SYS_NANOSLEEP 162
+#define SYS_POLL 168
+#define SYS_PREAD64 180
+#define SYS_PWRITE64 181
+#define SYS_SENDFILE 187
+#define SYS_GETTID 224
+#define SYS_FUTEX 240
+#define SYS_EXIT_GROUP 252
+#define SYS_CLOCK_GETTIME 265
+#define SYS_CLOCK_GETRES 266
+#define SYS_FALLOCATE 324
+#define SYS_PREADV 333
+#define SYS_PWRITEV 334
+#define SYS_COPY_FILE_RANGE 377
+#define SYS_DEFRAG 500 // DbolOS only
+
+// The kernel takes the Linux open flags (lib/src/fcntl.h), newlib's have other values
+#define KERNEL_O_RDONLY   00
+#define KERNEL_O_WRONLY   01
+#define KERNEL_O_RDWR     02
+#define KERNEL_O_CREAT    0100
+#define KERNEL_O_EXCL     0200
+#define KERNEL_O_TRUNC    01000
+#define KERNEL_O_APPEND   02000
+#define KERNEL_O_NONBLOCK 04000
+
+static inline int syscall5(int number, int arg1, int arg2, int arg3, int arg4, int arg5)
+{
+    int ret;
+
+    if (VDSO_TIME_DATA->flags & VDSO_FLAG_SYSENTER)
+    {
+        // sysexit clobbers ecx and edx, so they go on the stack along with the return address,
+        // the kernel reads them from there through ebp (see os/kernel/src/process/syscalls/sysenter.asm)
+        asm volatile(
+            "push $1f\n"
+            "push %%ecx\n"
+            "push %%edx\n"
+            "push %%ebp\n"
+            "mov %%esp, %%ebp\n"
+            "sysenter\n"
+            "1:\n"
+            "pop %%ebp\n"
+            "pop %%edx\n"
+            "pop %%ecx\n"
+            "add $4, %%esp\n"
+            : "=a"(ret)
+            : "a"(number), "b"(arg1), "c"(arg2), "d"(arg3), "S"(arg4), "D"(arg5)
+            : "memory", "cc");
+        return ret;
+    }
+
+    asm volatile(
+        "int $0x80\n"
+        : "=a"(ret)
+        : "a"(number), "b"(arg1), "c"(arg2), "d"(arg3), "S"(arg4), "D"(arg5)
+        : "memory");
+    return ret;
+}
+
+static inline int syscall4(int number, int arg1, int arg2, int arg3, int arg4)
+{
+    return syscall5(number, arg1, arg2, arg3, arg4, 0);
+}
+
+static inline int syscall3(int number, int arg1, int arg2, int arg3)
+{
+    return syscall4(number, arg1, arg2, arg3, 0);
+}
+
+static inline int syscall2(int number, int arg1, int arg2)
+{
+    return syscall3(number, arg1, arg2, 0);
+}
+
+static inline int syscall1(int number, int arg1)
+{
+    return syscall3(number, arg1, 0, 0);
+}
+
+static inline int syscall0(int number)
+{
+    return syscall3(number, 0, 0, 0);
+}
+
+// The kernel returns -errno, libc returns -1 and sets errno
+static inline int syscall_result(int ret)
+{
+    if (ret < 0)
+    {
+        errno = -ret;
+        return -1;
+    }
+    return ret;
+}
@@ -0,0 +1,28 @@
+#include <termios.h>
+#include "syscall.h"
+
+#define TCGETS  0x5401
+#define TCSETS  0x5402
+
+int tcgetattr(int fd, struct termios *termios_p)
+{
+    return syscall_result(syscall3(SYS_IOCTL, fd, TCGETS, (int)termios_p));
+}
+
+int tcsetattr(int fd, int optional_actions, const struct termios *termios_p)
+{
+    if (optional_actions < TCSANOW || optional_actions > TCSAFLUSH)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    // TCSETSW and TCSETSF follow TCSETS in the same order as the actions
+    return syscall_result(syscall3(SYS_IOCTL, fd, TCSETS + optional_actions, (int)termios_p));
+}
+
+void cfmakeraw(struct termios *termios_p)
+{
+    termios_p->c_lflag &= ~(ICANON | ECHO | ISIG);
+    termios_p->c_cc[VMIN] = 1;
+    termios_p->c_cc[VTIME] = 0;
+}
@@ -0,0 +1,68 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <unistd.h>
+#include "thread.h"
+#include "futex.h"
+#include "syscall.h"
+
+#define THREAD_FLAGS (CLONE_VM | CLONE_FS | CLONE_FILES | CLONE_SIGHAND | CLONE_THREAD | CLONE_SYSVSEM \
+    | CLONE_PARENT_SETTID | CLONE_CHILD_CLEARTID)
+
+int clone(int (*fn)(void *), void *stack, int flags, void *arg, pid_t *parent_tid, void *tls, pid_t *child_tid)
+{
+    int ret;
+
+    if (fn == NULL || stack == NULL)
+        return syscall_result(-EINVAL);
+
+    // The child starts with only fn and arg on its stack, placed so fn sees a 16 byte aligned frame
+    uint32_t *sp = (uint32_t *)(((uintptr_t)stack & ~0xF) - 16);
+    sp[0] = (uint32_t)arg;
+    *--sp = (uint32_t)fn;
+
+    // Always int 0x80: the sysenter stub pops its frame off the stack it returns on, which for
+    // the child is the new one
+    asm volatile(
+        "int $0x80\n"
+        "test %%eax, %%eax\n"
+        "jnz 1f\n"
+        "pop %%eax\n"           // the child: fn, then call it with arg on top of the stack
+        "call *%%eax\n"
+        "mov %%eax, %%ebx\n"
+        "mov %[sys_exit], %%eax\n"
+        "int $0x80\n"
+        "1:\n"
+        : "=a"(ret)
+        : "a"(SYS_CLONE), "b"(flags), "c"(sp), "d"(parent_tid), "S"(tls), "D"(child_tid),
+          [sys_exit] "i"(SYS_EXIT)
+        : "memory", "cc");
+    return syscall_result(ret);
+}
+
+pid_t gettid(void)
+{
+    return syscall0(SYS_GETTID);
+}
+
+// exit() has to take the other threads down with it, not just end the one that called it
+void _exit(int status)
+{
+    syscall1(SYS_EXIT_GROUP, status);
+    while (1);
+}
+
+int thread_create(thread_t *thread, void *stack, size_t stack_size, int (*fn)(void *), void *arg)
+{
+    int tid = clone(fn, (char *)stack + stack_size, THREAD_FLAGS, arg,
+                    (pid_t *)&thread->tid, NULL, (pid_t *)&thread->tid);
+    return tid < 0 ? -1 : 0;
+}
+
+void thread_join(thread_t *thread)
+{
+    pid_t tid;
+
+    // The kernel zeroes tid and wakes the word once the thread is gone
+    while ((tid = thread->tid) != 0)
+        futex((volatile uint32_t *)&thread->tid, FUTEX_WAIT, tid, NULL);
+}
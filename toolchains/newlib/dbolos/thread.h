@@ -0,0 +1,29 @@
+#pragma once
+#include <sys/types.h>
+
+/*
+ * Threads on top of the clone syscall, the numbers must match os/kernel/src/process/syscalls/handlers/proc/proc.h.
+ */
+
+#define CLONE_VM             0x00000100
+#define CLONE_FS             0x00000200
+#define CLONE_FILES          0x00000400
+#define CLONE_SIGHAND        0x00000800
+#define CLONE_THREAD         0x00010000
+#define CLONE_SYSVSEM        0x00040000
+#define CLONE_PARENT_SETTID  0x00100000
+#define CLONE_CHILD_CLEARTID 0x00200000
+#define CLONE_CHILD_SETTID   0x01000000
+
+// Runs fn(arg) on the given stack (its top) in a new thread, which exits when fn returns.
+// Same interface as glibc's clone(), tls is ignored
+int clone(int (*fn)(void *), void *stack, int flags, void *arg, pid_t *parent_tid, void *tls, pid_t *child_tid);
+pid_t gettid(void);
+
+// The minimum a pthread layer needs: start a thread on a stack the caller owns, and wait for it
+typedef struct {
+    volatile pid_t tid;     // cleared by the kernel when the thread exits
+} thread_t;
+
+int thread_create(thread_t *thread, void *stack, size_t stack_size, int (*fn)(void *), void *arg);
+void thread_join(thread_t *thread);
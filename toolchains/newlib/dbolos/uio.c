@@ -0,0 +1,36 @@
+#include <sys/uio.h>
+#include <unistd.h>
+#include "syscall.h"
+
+// The kernel takes 64 bit offsets split in two registers, off_t is 32 bit so the high one only
+// holds its sign
+
+ssize_t readv(int fd, const struct iovec *iov, int iovcnt)
+{
+    return syscall_result(syscall3(SYS_READV, fd, (int)iov, iovcnt));
+}
+
+ssize_t writev(int fd, const struct iovec *iov, int iovcnt)
+{
+    return syscall_result(syscall3(SYS_WRITEV, fd, (int)iov, iovcnt));
+}
+
+ssize_t preadv(int fd, const struct iovec *iov, int iovcnt, off_t offset)
+{
+    return syscall_result(syscall5(SYS_PREADV, fd, (int)iov, iovcnt, offset, offset < 0 ? -1 : 0));
+}
+
+ssize_t pwritev(int fd, const struct iovec *iov, int iovcnt, off_t offset)
+{
+    return syscall_result(syscall5(SYS_PWRITEV, fd, (int)iov, iovcnt, offset, offset < 0 ? -1 : 0));
+}
+
+ssize_t pread(int fd, void *buf, size_t count, off_t offset)
+{
+    return syscall_result(syscall5(SYS_PREAD64, fd, (int)buf, count, offset, offset < 0 ? -1 : 0));
+}
+
+ssize_t pwrite(int fd, const void *buf, size_t count, off_t offset)
+{
+    return syscall_result(syscall5(SYS_PWRITE64, fd, (int)buf, count, offset, offset < 0 ? -1 : 0));
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <stdint.h>
+
+/*
+ * User side view of the kernel's time page, must match os/kernel/src/time/vdso.h.
+ */
+
+#define VDSO_VIRT_ADDR 0xBFFFF000
+
+#define VDSO_FLAG_READY 0x1
+#define VDSO_FLAG_TSC   0x2
+#define VDSO_FLAG_SYSENTER 0x4
+
+typedef struct vdso_time_data
+{
+    volatile uint32_t seq;
+    uint32_t flags;
+    uint64_t base_tsc;
+    uint64_t base_ns;
+    uint64_t realtime_offset_ns;
+    uint32_t tsc_mult;
+    uint32_t tsc_shift;
+    uint32_t resolution_ns;
+    uint32_t tick_period_ns;
+    uint64_t ticks;
+} __attribute__((packed)) vdso_time_data_t;
+
+#define VDSO_TIME_DATA ((const volatile vdso_time_data_t*)VDSO_VIRT_ADDR)
@@ -0,0 +1,95 @@
+#include <time.h>
+#include <sys/time.h>
+#include "vdso.h"
+#include "syscall.h"
+
+// newlib only defines it when _POSIX_MONOTONIC_CLOCK is set
+#ifndef CLOCK_MONOTONIC
+#define CLOCK_MONOTONIC (clockid_t)4
+#endif
+
+#define NSEC_PER_SEC 1000000000ULL
+#define NSEC_PER_USEC 1000
+
+static inline uint64_t rdtsc(void)
+{
+    uint32_t low, high;
+    asm volatile("rdtsc" : "=a"(low), "=d"(high));
+    return ((uint64_t)high << 32) | low;
+}
+
+// Same conversion the kernel does, see os/kernel/src/time/clock.c
+static uint64_t cycles_to_ns(uint64_t cycles, uint32_t mult, uint32_t shift)
+{
+    uint32_t low = (uint32_t)cycles;
+    uint32_t high = (uint32_t)(cycles >> 32);
+
+    return (((uint64_t)low * mult) >> shift) + (((uint64_t)high * mult) << (32 - shift));
+}
+
+// Returns 0 and the time in ns, or -1 if the page can't be used and the caller must trap
+static int vdso_read_ns(clockid_t clock_id, uint64_t *ns)
+{
+    const volatile vdso_time_data_t *data = VDSO_TIME_DATA;
+    uint32_t seq;
+    uint64_t now;
+
+    do
+    {
+        seq = data->seq;
+        asm volatile("" ::: "memory");
+        if (seq & 1)
+            continue;
+
+        if (!(data->flags & VDSO_FLAG_READY))
+            return -1;
+
+        now = data->base_ns;
+        if (data->flags & VDSO_FLAG_TSC)
+            now += cycles_to_ns(rdtsc() - data->base_tsc, data->tsc_mult, data->tsc_shift);
+        if (clock_id == CLOCK_REALTIME)
+            now += data->realtime_offset_ns;
+
+        asm volatile("" ::: "memory");
+    } while ((seq & 1) || seq != data->seq);
+
+    *ns = now;
+    return 0;
+}
+
+int clock_gettime(clockid_t clock_id, struct timespec *tp)
+{
+    uint64_t ns;
+
+    if ((clock_id == CLOCK_REALTIME || clock_id == CLOCK_MONOTONIC) && vdso_read_ns(clock_id, &ns) == 0)
+    {
+        tp->tv_sec = (time_t)(ns / NSEC_PER_SEC);
+        tp->tv_nsec = (long)(ns % NSEC_PER_SEC);
+        return 0;
+    }
+
+    // CPU time is per process, only the kernel knows it
+    return syscall_result(syscall2(SYS_CLOCK_GETTIME, clock_id, (int)tp));
+}
+
+int clock_getres(clockid_t clock_id, struct timespec *res)
+{
+    return syscall_result(syscall2(SYS_CLOCK_GETRES, clock_id, (int)res));
+}
+
+int gettimeofday(struct timeval *tv, struct timezone *tz)
+{
+    uint64_t ns;
+
+    if (tv == NULL)
+        return 0;
+
+    if (vdso_read_ns(CLOCK_REALTIME, &ns) == 0)
+    {
+        tv->tv_sec = (time_t)(ns / NSEC_PER_SEC);
+        tv->tv_usec = (suseconds_t)((ns % NSEC_PER_SEC) / NSEC_PER_USEC);
+        return 0;
+    }
+
+    return syscall_result(syscall2(SYS_GETTIMEOFDAY, (int)tv, (int)tz));
+}